@@ -31,24 +31,25 @@ BGAME Dynamic Memory Allocation
 
 Use BG_Alloc(), BG_Alloc0() and BG_Free() for general memory allocation of
 misclanous allocations of types that are infrequently reallocated.  Utilizes a
-binary search of multiple memory allacotor "class sizes".  BG_Alloc() returns
+lookup table from the requested size to the best fitting of multiple memory
+allacotor "class sizes", and a lookup table from the page of the memory arena
+shared by all the classes to the class that owns it.  BG_Alloc() returns
 unitialized memory chunks, while BG_Alloc0() returns memory chunks with all bits
 set to 0.
 
 To add a new general allocator memory class, define its chunk size, define its
-maximum number of chunks (can be different for each QVM), create the allocator
-for the new memory class with the createMemoryAllocatorForClass() macro, and
-then instantiate the memory class inside the memClasses[] array with the
-instantiateMemoryClass() macro.  All of this is done inside the bg_alloc.c file
-only.
+maximum number of chunks (can be different for each QVM), instantiate the memory
+class inside the memClasses[] array with the instantiateMemoryClass() macro,
+and add its pages and bitmap words to BG_MEMORY_ARENA_PAGES and
+BG_MEMORY_MAP_WORDS.  All of this is done inside the bg_alloc.c file only.
 
 The same memory chunk size can't be set in more than one memory class, if more
 memory chunks of the same size are needed, simply increase the max number of
-chunks for the class that has that memory chunk size. Keep in mind that more
-general allocator memory classes may require more searching for BG_Alloc(),
-BG_Alloc0() and BG_Free().  Definning the memory classes in a specific order is
-not functionally necessary, as all required sorting is built into the allocator
-system, and performed inside BG_InitMemory().
+chunks for the class that has that memory chunk size.  Chunk sizes must be
+multiples of BG_MEMORY_GRANULE and no larger than BG_MEMORY_MAX_CHUNK_SIZE.
+Definning the memory classes in a specific order is not functionally necessary,
+as all required sorting is built into the allocator system, and performed
+inside BG_InitMemory().
 
 Use BG_StackPoolAlloc(), BG_StackPoolFree(), BG_StackPoolReset(), and
 BG_StackPoolMemoryInfo for the stack pool allocator, which is used for temporary
@@ -128,202 +129,390 @@ macro wrappers.
 #endif
 #endif
 
-#define createMemoryAllocatorForClass( chunkSize, numOfChunks ) \
-  allocator_protos( chunkSize ) \
-  allocator( chunkSize, chunkSize, numOfChunks )
-
-// create the memory allocators for the memory classes here
-createMemoryAllocatorForClass( MEMORY_CLASS_00_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_00_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_01_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_01_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_02_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_02_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_03_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_03_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_04_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_04_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_05_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_05_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_06_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_06_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_07_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_07_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_08_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_08_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_09_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_09_NUM_OF_CHUNKS)
-createMemoryAllocatorForClass( MEMORY_CLASS_10_CHUNK_SIZE,
-                               MAX_MEMORY_CLASS_10_NUM_OF_CHUNKS)
-
-typedef struct bgMemoryClass_s
-{
-  const size_t chunkSize; // Used for sorting and searching by chunk size
+// Requested sizes are mapped to memory classes in steps of BG_MEMORY_GRANULE
+// bytes up to BG_MEMORY_MAX_CHUNK_SIZE, which must be the largest chunk size
+#define BG_MEMORY_GRANULE                 8
+#define BG_MEMORY_MAX_CHUNK_SIZE          MEMORY_CLASS_10_CHUNK_SIZE
+
+// The memory classes share one arena, each starting on its own page
+#define BG_MEMORY_PAGE_SIZE               4096
+
+#define BG_MEMORY_CLASS_PAGES( size, count ) \
+  ( ( (count) * BG_POOL_STRIDE( size ) + BG_MEMORY_PAGE_SIZE - 1 ) / \
+    BG_MEMORY_PAGE_SIZE )
+#define BG_MEMORY_CLASS_MAP_WORDS( count ) \
+  ( BG_POOL_MAP_WORDS( count ) + BG_POOL_MAP_WORDS( BG_POOL_MAP_WORDS( count ) ) )
+
+#define BG_MEMORY_ARENA_PAGES ( \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_00_CHUNK_SIZE, MAX_MEMORY_CLASS_00_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_01_CHUNK_SIZE, MAX_MEMORY_CLASS_01_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_02_CHUNK_SIZE, MAX_MEMORY_CLASS_02_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_03_CHUNK_SIZE, MAX_MEMORY_CLASS_03_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_04_CHUNK_SIZE, MAX_MEMORY_CLASS_04_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_05_CHUNK_SIZE, MAX_MEMORY_CLASS_05_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_06_CHUNK_SIZE, MAX_MEMORY_CLASS_06_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_07_CHUNK_SIZE, MAX_MEMORY_CLASS_07_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_08_CHUNK_SIZE, MAX_MEMORY_CLASS_08_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_09_CHUNK_SIZE, MAX_MEMORY_CLASS_09_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_PAGES( MEMORY_CLASS_10_CHUNK_SIZE, MAX_MEMORY_CLASS_10_NUM_OF_CHUNKS ) )
+
+#define BG_MEMORY_MAP_WORDS ( \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_00_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_01_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_02_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_03_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_04_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_05_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_06_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_07_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_08_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_09_NUM_OF_CHUNKS ) + \
+  BG_MEMORY_CLASS_MAP_WORDS( MAX_MEMORY_CLASS_10_NUM_OF_CHUNKS ) )
 
-  // used for sorting and searching by memory address  
-  uint8_t * const bufferStart;  // The first element of the memory class buffer
-  uint8_t * const bufferEnd; // The last element of the memory class buffer
+#ifdef GAME
+int Sys_Milliseconds( void );
+#define BG_MemoryMilliseconds( ) Sys_Milliseconds( )
+#else
+int trap_Milliseconds( void );
+#define BG_MemoryMilliseconds( ) trap_Milliseconds( )
+#endif
 
-  void    (* const memoryInfo)(void);
-  void    (* const initPool)(char *calledFile, int calledLine);
-  void    *(* const alloc)(char *calledFile, int calledLine);
-  void    (* const free)(void *ptr, char *calledFile, int calledLine);
-} bgMemoryClass_t;
+/*
+--------------------------------------------------------------------------------
+Fixed Chunk Size Memory Pools
 
-// A macro used for easily adding memory classes in the memClasses[] array, and
-// for better readability
-#define _instantiateMemoryClass( classChunkSize ) \
-  { \
-    (size_t)(classChunkSize), \
-    buffer_##classChunkSize, \
-    &buffer_##classChunkSize[ ARRAY_LEN( buffer_##classChunkSize ) - 1 ], \
-    memoryInfo_##classChunkSize, \
-    initPool_##classChunkSize, \
-    alloc_##classChunkSize, \
-    free_##classChunkSize \
+Shared by the general memory classes and the custom allocators created with the
+allocator() macro
+--------------------------------------------------------------------------------
+*/
+
+/*
+======================
+BG_LowestSetBit
+
+Returns the index of the lowest set bit of a word that is not 0
+======================
+*/
+static ID_INLINE int BG_LowestSetBit( uint32_t word )
+{
+  int bit = 0;
+
+  if( !( word & 0xFFFF ) )
+  {
+    word >>= 16;
+    bit += 16;
+  }
+  if( !( word & 0xFF ) )
+  {
+    word >>= 8;
+    bit += 8;
   }
+  if( !( word & 0xF ) )
+  {
+    word >>= 4;
+    bit += 4;
+  }
+  if( !( word & 0x3 ) )
+  {
+    word >>= 2;
+    bit += 2;
+  }
+  if( !( word & 0x1 ) )
+    bit += 1;
 
-// Macro used to ensure that a #define constant used as an argument expands
-#define instantiateMemoryClass( classChunkSize ) _instantiateMemoryClass( classChunkSize )
+  return bit;
+}
+
+/*
+======================
+BG_SetLowBits
 
-// Instatiate memory classes here in this array. A binary search is performed
-// in this array to find the memory class with the size for the best fit in the
-// general memory allocator.
-static const bgMemoryClass_t memClasses[ ] =
+Sets the first count bits of a bitmap and clears the rest of its last word
+======================
+*/
+static void BG_SetLowBits( uint32_t *map, int count )
 {
-  instantiateMemoryClass( MEMORY_CLASS_00_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_01_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_02_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_03_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_04_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_05_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_06_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_07_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_08_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_09_CHUNK_SIZE ),
-  instantiateMemoryClass( MEMORY_CLASS_10_CHUNK_SIZE )
-};
+  int i;
 
-#define NUMBER_OF_MEMORY_CLASSES ( ARRAY_LEN( memClasses ) )
+  for( i = 0; i < count / 32; i++ )
+    map[ i ] = 0xFFFFFFFFu;
 
-static const bgMemoryClass_t *memClassesSortedChunkSize[ NUMBER_OF_MEMORY_CLASSES ]; // used for BG_Alloc()
-static const bgMemoryClass_t *memClassesSortedBufferAddress[ NUMBER_OF_MEMORY_CLASSES ]; // used for BG_Free()
+  if( count & 31 )
+    map[ i ] = ( 1u << ( count & 31 ) ) - 1;
+}
 
 /*
 ======================
-BG_MemClassNumFromChunkSize
+_BG_PoolInit
 
-Utilizes a binary search based on the allocator classes' chunk sizes to
-determine which allocator class would have the best fit for the memory requested
-in BG_Alloc
+Marks every chunk of a pool as free and clears its statistics
 ======================
 */
-static ID_INLINE const bgMemoryClass_t *BG_MemClassNumFromChunkSize( size_t size,
-                                                                     char *calledFile,
-                                                                     int calledLine )
+void _BG_PoolInit( bgMemoryPool_t *pool, char *calledFile, int calledLine )
 {
-  size_t low = 0, high = ( NUMBER_OF_MEMORY_CLASSES -1 ), middle;
+  int i;
 
-  assertMemSize( ( size ) > 0, size,
-                 calledFile, calledLine );
-  assertMemSize( ( size ) <= memClassesSortedChunkSize[ high ]->chunkSize, size,
-                 calledFile, calledLine );
+  assertMem( ( pool->chunkSize > 0 && "size must be greater than 0." ),
+             calledFile, calledLine );
+  assertMem( ( pool->numChunks > 0 && "count must be greater than 0." ),
+             calledFile, calledLine );
+
+  for( i = 0; i < pool->numChunks; i++ )
+    pool->buffer[ i * pool->stride + pool->chunkSize ] = 0;
+
+  BG_SetLowBits( pool->freeMap, pool->numChunks );
+  BG_SetLowBits( pool->summaryMap, BG_POOL_MAP_WORDS( pool->numChunks ) );
+  pool->firstSummary = 0;
+  pool->initialized = qtrue;
+
+  pool->used = 0;
+  pool->highWater = 0;
+  pool->allocs = 0;
+  pool->frees = 0;
+  pool->failures = 0;
+
+  pool->reportAllocs = 0;
+  pool->reportFrees = 0;
+  pool->reportTime = BG_MemoryMilliseconds( );
+}
 
-  while( low < high )
+/*
+======================
+_BG_PoolAlloc
+
+Allocates the lowest free chunk of a pool.  Returns NULL if the pool is
+exhausted and NDEBUGMEM is defined.
+======================
+*/
+void *_BG_PoolAlloc( bgMemoryPool_t *pool, char *calledFile, int calledLine )
+{
+  int     numSummaryWords = BG_POOL_MAP_WORDS( BG_POOL_MAP_WORDS( pool->numChunks ) );
+  int     summary, word, bit;
+  uint8_t *ptr;
+
+  assertMemPool( ( pool->initialized && "pool not initialized." ),
+                 pool, calledFile, calledLine );
+
+  for( summary = pool->firstSummary;
+       summary < numSummaryWords && !pool->summaryMap[ summary ];
+       summary++ );
+
+  pool->firstSummary = summary;
+
+  if( summary >= numSummaryWords )
   {
-    middle = low + (high - low) / 2;
-    if( memClassesSortedChunkSize[ middle ]->chunkSize < size )
-      low = middle + 1;
-    else
-      high = middle;
+    pool->failures++;
+    assertMemPool( ( summary < numSummaryWords && "out of memory." ),
+                   pool, calledFile, calledLine );
+    return NULL;
   }
 
-  return memClassesSortedChunkSize[ high ];
+  word = ( summary << 5 ) + BG_LowestSetBit( pool->summaryMap[ summary ] );
+  bit = BG_LowestSetBit( pool->freeMap[ word ] );
+
+  pool->freeMap[ word ] &= ~( 1u << bit );
+  if( !pool->freeMap[ word ] )
+    pool->summaryMap[ summary ] &= ~( 1u << ( word & 31 ) );
+
+  ptr = pool->buffer + ( ( word << 5 ) + bit ) * pool->stride;
+  assertMemPoolChunk( ( ptr[ pool->chunkSize ] == 0 && "invalid memory access" ),
+                      pool, ptr, calledFile, calledLine );
+  ptr[ pool->chunkSize ] = 0x1A;
+
+  pool->allocs++;
+  pool->used++;
+  if( pool->used > pool->highWater )
+    pool->highWater = pool->used;
+
+  return ptr;
 }
 
 /*
 ======================
-BG_MemClassNumFromAddress
+_BG_PoolFree
 
-Utilizes a binary search based on the allocator classes' buffer addresses to
-determine which allocator class (if any) a given memory chunk that is attempted
-to be freed by BG_Free().
+Returns a chunk allocated by _BG_PoolAlloc() to its pool
 ======================
 */
-static ID_INLINE const bgMemoryClass_t *BG_MemClassNumFromAdress( void *ptr, char *calledFile, int calledLine )
+void _BG_PoolFree( bgMemoryPool_t *pool, void *ptr, char *calledFile, int calledLine )
 {
-  size_t low = 0, high = ( NUMBER_OF_MEMORY_CLASSES -1 ), middle;
-  int             passes = 0;
+  size_t   offset = (size_t)( (uint8_t *)ptr - pool->buffer );
+  int      index, word;
+  uint32_t mask;
+
+  assertMemPoolChunk( ( offset < pool->numChunks * pool->stride && "out of bounds." ),
+                      pool, ptr, calledFile, calledLine );
+  assertMemPoolChunk( ( offset % pool->stride == 0 && "not head of chunk." ),
+                      pool, ptr, calledFile, calledLine );
+
+  index = (int)( offset / pool->stride );
+  word = index >> 5;
+  mask = 1u << ( index & 31 );
+
+  assertMemPoolChunk( ( !( pool->freeMap[ word ] & mask ) &&
+                        "pointer freed more than once" ),
+                      pool, ptr, calledFile, calledLine );
+  assertMemPoolChunk( ( ( (uint8_t *)ptr )[ pool->chunkSize ] == 0x1A &&
+                        "invalid memory access" ),
+                      pool, ptr, calledFile, calledLine );
+
+  ( (uint8_t *)ptr )[ pool->chunkSize ] = 0;
+
+  pool->freeMap[ word ] |= mask;
+  pool->summaryMap[ word >> 5 ] |= 1u << ( word & 31 );
+  if( ( word >> 5 ) < pool->firstSummary )
+    pool->firstSummary = word >> 5;
+
+  pool->frees++;
+  pool->used--;
+}
+
+/*
+======================
+BG_PoolMemoryInfo
 
-  assertMemChunk( ((uint8_t *)ptr >= memClassesSortedBufferAddress[ low ]->bufferStart &&
-                  (uint8_t *)ptr <= memClassesSortedBufferAddress[ high ]->bufferEnd),
-                  ptr, calledFile, calledLine );
+Prints the usage and statistics of a pool.  Allocation and free rates are
+measured since the previous report of the same pool.
+======================
+*/
+void BG_PoolMemoryInfo( bgMemoryPool_t *pool )
+{
+  int time = BG_MemoryMilliseconds( );
+  int elapsed = time - pool->reportTime;
 
-  while( low < high )
+  Com_Printf( "^5---------------------------------------------^7\n" );
+  Com_Printf( "^3Memory Info for Allocator ( ^6%s^3 )^7\n", pool->name );
+  Com_Printf( "^5---------------------------------------------^7\n" );
+
+  if( !pool->initialized )
   {
-    middle = low + (high - low) / 2;
-    passes++;
-
-    if( (uint8_t *)(ptr) < memClassesSortedBufferAddress[ middle ]->bufferStart )
-      high = middle;
-    else if( memClassesSortedBufferAddress[ middle ]->bufferEnd < (uint8_t *)(ptr) )
-      low = middle + 1;
-    else
-      return memClassesSortedBufferAddress[ middle ];
+    Com_Printf( "^3pool not initialized.^7\n" );
+    Com_Printf( "^5---------------------------------------------^7\n" );
+    return;
   }
 
-  if( low == high )
+  Com_Printf( "^3Memory Pool Size: ^6%i bytes^7\n",
+              (int)( pool->numChunks * pool->stride ) );
+  Com_Printf( "^3Free Memory: ^6%i bytes^7\n",
+              (int)( ( pool->numChunks - pool->used ) * pool->stride ) );
+  Com_Printf( "^3Allocated Memory: ^6%i bytes^7\n",
+              (int)( pool->used * pool->stride ) );
+  Com_Printf( "^3Size of Chunks: ^6%i bytes^7\n", (int)pool->stride );
+  Com_Printf( "^3Total Number of Chunks: ^6%i^7\n", pool->numChunks );
+  Com_Printf( "^3Number of Unused Chunks: ^6%i^7\n",
+              pool->numChunks - pool->used );
+  Com_Printf( "^3Number of Used Chunks: ^6%i^7\n", pool->used );
+  Com_Printf( "^3High Water Mark: ^6%i^3 chunks (^6%i%%^3)^7\n",
+              pool->highWater, ( pool->highWater * 100 ) / pool->numChunks );
+  Com_Printf( "^3Allocations: ^6%u^3, Frees: ^6%u^3, Failed Allocations: ^6%u^7\n",
+              pool->allocs, pool->frees, pool->failures );
+
+  if( elapsed > 0 )
   {
-    passes++;
-
-    if( ( (uint8_t *)(ptr) >= memClassesSortedBufferAddress[ low ]->bufferStart ) &&
-        ( memClassesSortedBufferAddress[ low ]->bufferEnd >= (uint8_t *)(ptr) ) )
-      return memClassesSortedBufferAddress[ low ];
+    Com_Printf( "^3Allocation Rate: ^6%.1f/s^3, Free Rate: ^6%.1f/s^3 "
+                "over the last ^6%.1f s^7\n",
+                ( pool->allocs - pool->reportAllocs ) * 1000.0f / elapsed,
+                ( pool->frees - pool->reportFrees ) * 1000.0f / elapsed,
+                elapsed / 1000.0f );
   }
 
-  // The memory chunk is not from any of the general allocator memory classes
-  BG_MemoryInfo();
-  Com_Printf("^3Memory Chunk Address: (^6%p^3)\n", ( ptr ) );
-  BG_MemFuncCalledFrom( calledFile, calledLine );
-  Com_Error( ERR_DROP, "%s:%d: Assertion `%s' failed",
-             __FILE__, __LINE__, "BG_MemClassNumFromAdress: out of bounds." );
+  Com_Printf( "^3Memory Pool Address Range: from (^60x%p^3) to (^60x%p^3)^7\n",
+              pool->buffer, pool->buffer + pool->numChunks * pool->stride - 1 );
+  Com_Printf( "^5---------------------------------------------^7\n" );
 
-  return NULL;
+  pool->reportAllocs = pool->allocs;
+  pool->reportFrees = pool->frees;
+  pool->reportTime = time;
 }
 
+/*
+--------------------------------------------------------------------------------
+General Memory Classes
+--------------------------------------------------------------------------------
+*/
+
+// The memory shared by all the general memory classes, and their bitmaps
+static uint8_t  memArena[ BG_MEMORY_ARENA_PAGES * BG_MEMORY_PAGE_SIZE ] __attribute__ ((aligned (16)));
+static uint32_t memMaps[ BG_MEMORY_MAP_WORDS ];
+
+// A macro used for easily adding memory classes in the memClasses[] array, and
+// for better readability.  The buffers and bitmaps are assigned from memArena[]
+// and memMaps[] in BG_InitMemory().
+#define _instantiateMemoryClass( classChunkSize, classNumOfChunks ) \
+  { \
+    #classChunkSize, \
+    (size_t)(classChunkSize), \
+    BG_POOL_STRIDE( classChunkSize ), \
+    (classNumOfChunks) \
+  }
+
+// Macro used to ensure that #define constants used as arguments expand
+#define instantiateMemoryClass( classChunkSize, classNumOfChunks ) \
+  _instantiateMemoryClass( classChunkSize, classNumOfChunks )
+
+// Instatiate memory classes here in this array.
+static bgMemoryPool_t memClasses[ ] =
+{
+  instantiateMemoryClass( MEMORY_CLASS_00_CHUNK_SIZE, MAX_MEMORY_CLASS_00_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_01_CHUNK_SIZE, MAX_MEMORY_CLASS_01_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_02_CHUNK_SIZE, MAX_MEMORY_CLASS_02_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_03_CHUNK_SIZE, MAX_MEMORY_CLASS_03_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_04_CHUNK_SIZE, MAX_MEMORY_CLASS_04_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_05_CHUNK_SIZE, MAX_MEMORY_CLASS_05_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_06_CHUNK_SIZE, MAX_MEMORY_CLASS_06_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_07_CHUNK_SIZE, MAX_MEMORY_CLASS_07_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_08_CHUNK_SIZE, MAX_MEMORY_CLASS_08_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_09_CHUNK_SIZE, MAX_MEMORY_CLASS_09_NUM_OF_CHUNKS ),
+  instantiateMemoryClass( MEMORY_CLASS_10_CHUNK_SIZE, MAX_MEMORY_CLASS_10_NUM_OF_CHUNKS )
+};
+
+#define NUMBER_OF_MEMORY_CLASSES ( ARRAY_LEN( memClasses ) )
+
+static bgMemoryPool_t *memClassesSortedChunkSize[ NUMBER_OF_MEMORY_CLASSES ]; // used for BG_MemoryInfo()
+static bgMemoryPool_t *memClassForSize[ BG_MEMORY_MAX_CHUNK_SIZE / BG_MEMORY_GRANULE ]; // used for BG_Alloc()
+static bgMemoryPool_t *memClassForPage[ BG_MEMORY_ARENA_PAGES ]; // used for BG_Free()
+static unsigned int   memOversizeFailures;
+
 /*
 ======================
-BG_CmpMemoryClassChunkSize
+BG_MemClassFromSize
 
-Compares the chunk sizes of memory classes for a qsort used in BG_InitMemory
+Looks up the memory class that has the best fit for the memory requested in
+BG_Alloc.  Returns NULL if no class is large enough and NDEBUGMEM is defined.
 ======================
 */
-static int BG_CmpMemoryClassChunkSize( const void *a, const void *b )
+static ID_INLINE bgMemoryPool_t *BG_MemClassFromSize( size_t size,
+                                                      char *calledFile,
+                                                      int calledLine )
 {
-  const bgMemoryClass_t *classA = *(const bgMemoryClass_t **)a;
-  const bgMemoryClass_t *classB = *(const bgMemoryClass_t **)b;
+  assertMemSize( ( size ) > 0, size,
+                 calledFile, calledLine );
 
-  return ( classA->chunkSize - classB->chunkSize );
+  // a size of 0 wraps around and fails here as well
+  if( size - 1 >= BG_MEMORY_MAX_CHUNK_SIZE )
+  {
+    memOversizeFailures++;
+    assertMemSize( ( size ) <= BG_MEMORY_MAX_CHUNK_SIZE, size,
+                   calledFile, calledLine );
+    return NULL;
+  }
+
+  return memClassForSize[ ( size - 1 ) / BG_MEMORY_GRANULE ];
 }
 
 /*
 ======================
-BG_CmpMemoryClassBufferAddress
+BG_CmpMemoryClassChunkSize
 
-Compares the buffer addresses of memory classes for a qsort used in BG_InitMemory
+Compares the chunk sizes of memory classes for a qsort used in BG_InitMemory
 ======================
 */
-static int BG_CmpMemoryClassBufferAddress( const void *a, const void *b )
+static int BG_CmpMemoryClassChunkSize( const void *a, const void *b )
 {
-  const bgMemoryClass_t *classA = *(const bgMemoryClass_t **)a;
-  const bgMemoryClass_t *classB = *(const bgMemoryClass_t **)b;
-
-  if( ( classA->bufferStart -  classB->bufferStart ) < 0 )
-    return -1;
-  else if( ( classA->bufferStart -  classB->bufferStart ) > 0 )
-    return 1;
-  else
-    return 0;
+  const bgMemoryPool_t *classA = *(const bgMemoryPool_t **)a;
+  const bgMemoryPool_t *classB = *(const bgMemoryPool_t **)b;
+
+  return ( (int)classA->chunkSize - (int)classB->chunkSize );
 }
 
 /*
@@ -336,24 +525,57 @@ the modules that use BGAME Memory Allocation.
 */
 void  _BG_InitMemory( char *calledFile, int calledLine )
 {
-  int i;
+  uint32_t *maps = memMaps;
+  int      page = 0, granule = 0;
+  int      i, j;
 
-  // Init the general use memory pools
+  // Sort the memory classes by chunk size
   for( i = 0; i < NUMBER_OF_MEMORY_CLASSES; i++ )
-    memClasses[ i ].initPool( calledFile, calledLine );
+    memClassesSortedChunkSize[ i ] = &memClasses[ i ];
 
-  // initialize the memory class pointer arrays
+  qsort( memClassesSortedChunkSize, ARRAY_LEN( memClassesSortedChunkSize ), sizeof( memClassesSortedChunkSize[0] ),
+         BG_CmpMemoryClassChunkSize );
+
+  // Lay the general use memory pools out in the arena, and fill in the tables
+  // from requested sizes and arena pages to the memory classes
   for( i = 0; i < NUMBER_OF_MEMORY_CLASSES; i++ )
   {
-    memClassesSortedChunkSize[ i ] = &memClasses[ i ];
-    memClassesSortedBufferAddress[ i ] = &memClasses[ i ];
+    bgMemoryPool_t *memoryClass = memClassesSortedChunkSize[ i ];
+    int            numPages = BG_MEMORY_CLASS_PAGES( memoryClass->chunkSize,
+                                                     memoryClass->numChunks );
+    int            numWords = BG_POOL_MAP_WORDS( memoryClass->numChunks );
+
+    assertMemSize( ( memoryClass->chunkSize % BG_MEMORY_GRANULE == 0 ),
+                   memoryClass->chunkSize, calledFile, calledLine );
+    assertMemSize( ( memoryClass->chunkSize <= BG_MEMORY_MAX_CHUNK_SIZE ),
+                   memoryClass->chunkSize, calledFile, calledLine );
+    assertMemSize( ( i == 0 ||
+                     memoryClass->chunkSize > memClassesSortedChunkSize[ i - 1 ]->chunkSize ),
+                   memoryClass->chunkSize, calledFile, calledLine );
+    assertMem( ( page + numPages <= BG_MEMORY_ARENA_PAGES &&
+                 "memory class exceeds the arena." ), calledFile, calledLine );
+
+    memoryClass->buffer = memArena + page * BG_MEMORY_PAGE_SIZE;
+    memoryClass->freeMap = maps;
+    maps += numWords;
+    memoryClass->summaryMap = maps;
+    maps += BG_POOL_MAP_WORDS( numWords );
+
+    for( j = 0; j < numPages; j++ )
+      memClassForPage[ page++ ] = memoryClass;
+
+    for( ; granule < memoryClass->chunkSize / BG_MEMORY_GRANULE; granule++ )
+      memClassForSize[ granule ] = memoryClass;
+
+    _BG_PoolInit( memoryClass, calledFile, calledLine );
   }
 
-  // Sort the memClassesSortedChunkSize and memClassesSortedBufferAddress arrays
-  qsort( memClassesSortedChunkSize, ARRAY_LEN( memClassesSortedChunkSize ), sizeof( memClassesSortedChunkSize[0] ),
-         BG_CmpMemoryClassChunkSize );
-  qsort( memClassesSortedBufferAddress, ARRAY_LEN( memClassesSortedBufferAddress ), sizeof( memClassesSortedBufferAddress[0] ),
-         BG_CmpMemoryClassBufferAddress );
+  assertMem( ( page == BG_MEMORY_ARENA_PAGES && maps == memMaps + BG_MEMORY_MAP_WORDS &&
+               "memory classes don't match BG_MEMORY_ARENA_PAGES." ), calledFile, calledLine );
+  assertMem( ( granule == ARRAY_LEN( memClassForSize ) &&
+               "largest chunk size doesn't match BG_MEMORY_MAX_CHUNK_SIZE." ), calledFile, calledLine );
+
+  memOversizeFailures = 0;
 
   // Init the memory stack pool
   BG_StackPoolReset( );
@@ -368,20 +590,22 @@ void  _BG_InitMemory( char *calledFile, int calledLine )
 _BG_Alloc
 
 Allocates memory from the general memory class that has the best fit for the
-given size. Utilizes a binary search, so this function is best for miscelanous
-types that are infrequently reallocated. Only use _BG_Free() or BG_Free() to
-free memory allocated by BG_Alloc().  For frequently reallocated types, consider
-making a custom allocator using the allocator_protos() and allocator() macros.
-The returned memory chunk is unitialized.
+given size. Only use _BG_Free() or BG_Free() to free memory allocated by
+BG_Alloc().  For frequently reallocated types, consider making a custom
+allocator using the allocator_protos() and allocator() macros.  The returned
+memory chunk is unitialized.
 ======================
 */
 void  *_BG_Alloc( size_t size, char *calledFile, int calledLine )
 {
-  const bgMemoryClass_t *memoryClass = BG_MemClassNumFromChunkSize( size,
-                                                                    calledFile,
-                                                                    calledLine );
+  bgMemoryPool_t *memoryClass = BG_MemClassFromSize( size,
+                                                     calledFile,
+                                                     calledLine );
 
-  return memoryClass->alloc( calledFile, calledLine );
+  if( !memoryClass )
+    return NULL;
+
+  return _BG_PoolAlloc( memoryClass, calledFile, calledLine );
 }
 
 /*
@@ -393,12 +617,18 @@ Same as _BG_Alloc(), but initializes all the bits to 0 with memset.
 */
 void  *_BG_Alloc0( size_t size, char *calledFile, int calledLine )
 {
-  const bgMemoryClass_t *memoryClass = BG_MemClassNumFromChunkSize( size,
-                                                                    calledFile,
-                                                                    calledLine );
-  void *ptr = memoryClass->alloc( calledFile, calledLine );
+  bgMemoryPool_t *memoryClass = BG_MemClassFromSize( size,
+                                                     calledFile,
+                                                     calledLine );
+  void           *ptr;
+
+  if( !memoryClass )
+    return NULL;
+
+  ptr = _BG_PoolAlloc( memoryClass, calledFile, calledLine );
+  if( ptr )
+    memset( ptr, 0, memoryClass->chunkSize );
 
-  memset( ptr, 0, memoryClass->chunkSize  );
   return ptr;
 }
 
@@ -413,11 +643,21 @@ instead.
 */
 void  _BG_Free( void *ptr, char *calledFile, int calledLine )
 {
-  const bgMemoryClass_t *memoryClass = BG_MemClassNumFromAdress( ptr,
-                                                                 calledFile,
-                                                                 calledLine );
+  size_t offset = (size_t)( (uint8_t *)ptr - memArena );
 
-  memoryClass->free(ptr, calledFile, calledLine);
+  if( offset >= sizeof( memArena ) )
+  {
+    // The memory chunk is not from any of the general allocator memory classes
+    BG_MemoryInfo();
+    Com_Printf("^3Memory Chunk Address: (^6%p^3)\n", ( ptr ) );
+    BG_MemFuncCalledFrom( calledFile, calledLine );
+    Com_Error( ERR_DROP, "%s:%d: Assertion `%s' failed",
+               __FILE__, __LINE__, "BG_Free: out of bounds." );
+    return;
+  }
+
+  _BG_PoolFree( memClassForPage[ offset / BG_MEMORY_PAGE_SIZE ], ptr,
+                calledFile, calledLine );
 }
 
 /*
@@ -459,7 +699,10 @@ void BG_MemoryInfo( void )
 
   // cycle through all the general memory classes
   for( i = 0; i < NUMBER_OF_MEMORY_CLASSES; i++ )
-    (*memClassesSortedChunkSize[ i ]).memoryInfo( );
+    BG_PoolMemoryInfo( memClassesSortedChunkSize[ i ] );
+
+  Com_Printf( "^3Allocations Larger Than Any Memory Class: ^6%u^7\n",
+              memOversizeFailures );
 
   BG_StackPoolMemoryInfo( );
 
@@ -29,24 +29,25 @@ BGAME Dynamic Memory Allocation
 
 Use BG_Alloc(), BG_Alloc0() and BG_Free() for general memory allocation of
 misclanous allocations of types that are infrequently reallocated.  Utilizes a
-binary search of multiple memory allacotor "class sizes".  BG_Alloc() returns
+lookup table from the requested size to the best fitting of multiple memory
+allacotor "class sizes", and a lookup table from the page of the memory arena
+shared by all the classes to the class that owns it.  BG_Alloc() returns
 unitialized memory chunks, while BG_Alloc0() returns memory chunks with all bits
 set to 0.
 
 To add a new general allocator memory class, define its chunk size, define its
-maximum number of chunks (can be different for each QVM), create the allocator
-for the new memory class with the createMemoryAllocatorForClass() macro, and
-then instantiate the memory class inside the memClasses[] array with the
-instantiateMemoryClass() macro.  All of this is done inside the bg_alloc.c file
-only.
+maximum number of chunks (can be different for each QVM), instantiate the memory
+class inside the memClasses[] array with the instantiateMemoryClass() macro,
+and add its pages and bitmap words to BG_MEMORY_ARENA_PAGES and
+BG_MEMORY_MAP_WORDS.  All of this is done inside the bg_alloc.c file only.
 
 The same memory chunk size can't be set in more than one memory class, if more
 memory chunks of the same size are needed, simply increase the max number of
-chunks for the class that has that memory chunk size. Keep in mind that more
-general allocator memory classes may require more searching for BG_Alloc(),
-BG_Alloc0() and BG_Free().  Definning the memory classes in a specific order is
-not functionally necessary, as all required sorting is built into the allocator
-system, and performed inside BG_InitMemory().
+chunks for the class that has that memory chunk size.  Chunk sizes must be
+multiples of BG_MEMORY_GRANULE and no larger than BG_MEMORY_MAX_CHUNK_SIZE.
+Definning the memory classes in a specific order is not functionally necessary,
+as all required sorting is built into the allocator system, and performed
+inside BG_InitMemory().
 
 Use BG_StackPoolAlloc(), BG_StackPoolFree(), BG_StackPoolReset(), and
 BG_StackPoolMemoryInfo for the stack pool allocator, which is used for temporary
@@ -81,6 +82,8 @@ macro wrappers.
   #define assertMemChunk(ignore, blank, calledFile, calledLine)((void) 0)
   #define assertMemKind(ignore, blank, calledFile, calledLine)((void) 0)
   #define assertMemKindChunk( ignore, blank, nothing, calledFile, calledLine )((void) 0)
+  #define assertMemPool(ignore, blank, calledFile, calledLine)((void) 0)
+  #define assertMemPoolChunk( ignore, blank, nothing, calledFile, calledLine )((void) 0)
   #define assertMemStack(ignore, calledFile, calledLine)((void) 0)
   #define assertMemStackChunk(ignore, blank,nothing, calledFile, calledLine)((void) 0)
 #else
@@ -127,6 +130,23 @@ macro wrappers.
         Com_Error( ERR_DROP, "%s:%d: Assertion `%s' failed", \
                    __FILE__, __LINE__, #expr ); \
       }
+  #define assertMemPool( expr, pool, calledFile, calledLine ) \
+      if( !( expr ) ){ \
+        BG_MemoryInfo(); \
+        BG_PoolMemoryInfo( pool ); \
+        BG_MemFuncCalledFrom( calledFile, calledLine ); \
+        Com_Error( ERR_DROP, "%s:%d: Assertion `%s' failed", \
+                   __FILE__, __LINE__, #expr ); \
+      }
+  #define assertMemPoolChunk( expr, pool, chunkAddress, calledFile, calledLine ) \
+      if( !( expr ) ){ \
+        BG_MemoryInfo(); \
+        BG_PoolMemoryInfo( pool ); \
+        Com_Printf("^3Memory Chunk Address: (^6%p^3)\n", ( chunkAddress ) ); \
+        BG_MemFuncCalledFrom( calledFile, calledLine ); \
+        Com_Error( ERR_DROP, "%s:%d: Assertion `%s' failed", \
+                   __FILE__, __LINE__, #expr ); \
+      }
   #define assertMemStack(expr, errString, calledFile, calledLine) \
       if( !( expr ) ){ \
         BG_MemoryInfo(); \
@@ -159,12 +179,70 @@ custom allocator by all files that include said header.
 ======================
 */
 #define allocator_protos(name) \
-  static int unused_memory_chunks_##name(void); \
   static void memoryInfo_##name(void); \
   static void initPool_##name(char *calledFile, int calledLine); \
   static void *alloc_##name(char *calledFile, int calledLine); \
   static void free_##name(void *ptr, char *calledFile, int calledLine);
 
+/*
+======================
+bgMemoryPool_t
+
+The state of a fixed chunk size memory pool.  Used both by the general memory
+classes behind BG_Alloc() and by the custom allocators created with the
+allocator() macro.
+
+Every chunk occupies stride bytes of buffer, which leaves room after the chunk
+for a guard byte used to catch writes past the end of the chunk.  freeMap has
+one bit per chunk that is set while the chunk is free, and summaryMap has one
+bit per freeMap word that is set while that word has any free chunk left, so
+the lowest free chunk is found with two lowest-set-bit lookups after skipping
+the summary words that are known to be full.  Allocating the lowest free chunk
+keeps the live chunks of a pool packed together at the front of its buffer
+instead of scattered in the order they were freed.
+
+The remaining fields are statistics reported by BG_PoolMemoryInfo() for sizing
+the pools: the number of chunks in use and the most ever in use at once, the
+total allocations and frees, and the allocations that failed because the pool
+was exhausted.  The report fields hold the counters and the time of the
+previous report so that allocation and free rates can be shown.
+======================
+*/
+typedef struct bgMemoryPool_s
+{
+  const char   *name;
+  size_t       chunkSize;
+  size_t       stride;
+  int          numChunks;
+
+  uint8_t      *buffer;
+  uint32_t     *freeMap;
+  uint32_t     *summaryMap;
+  int          firstSummary; // no free chunk below this summary word
+  qboolean     initialized;
+
+  int          used;
+  int          highWater;
+  unsigned int allocs;
+  unsigned int frees;
+  unsigned int failures;
+
+  unsigned int reportAllocs;
+  unsigned int reportFrees;
+  int          reportTime;
+} bgMemoryPool_t;
+
+// The number of bytes taken up by each chunk of a pool
+#define BG_POOL_STRIDE( size ) ( ( (size_t)( size ) & ~( (size_t)0xF ) ) + (size_t)16 )
+
+// The number of uint32_t words in a bitmap of count bits
+#define BG_POOL_MAP_WORDS( count ) ( ( (count) + 31 ) / 32 )
+
+void  _BG_PoolInit( bgMemoryPool_t *pool, char *calledFile, int calledLine );
+void  *_BG_PoolAlloc( bgMemoryPool_t *pool, char *calledFile, int calledLine );
+void  _BG_PoolFree( bgMemoryPool_t *pool, void *ptr, char *calledFile, int calledLine );
+void  BG_PoolMemoryInfo( bgMemoryPool_t *pool );
+
 /*
 ======================
 allocator
@@ -179,84 +257,34 @@ and functions. size indicates the size in bytes of each chunk in the allocator's
 memory pool (all chunks are the same size in a given allocator). count indicates
 the total number of chunks in the allocator's memory pool.  The total amount of
 memory in the allocator's memory pool in bytes is determined by multiplying the
-chunk size by the total number of chunks.
-
-buffer_##name[] is the allocator's memory pool. unused_##name[] is an array of
-uint8_t pointers that point to the beginning of each chunk in buffer_##name[]. 
-stack_##name is a pointer to an element in unused_##name[]. stack_##name is
-associated with the last free chunk in the memory pool that would also be the
-next memory chunk used for memory allocation by the allocator.  When memory is
-allocated by the allocator, stack_##name is decremented torwards the beginning
-of unused_##name[], and when memory is freed by the allocator, stack_##name is
-inremented towards the end of unused_##name[].
+chunk stride by the total number of chunks.
+
+buffer_##name[] is the allocator's memory pool, and freeMap_##name[] and
+summaryMap_##name[] are the bitmaps tracking its free chunks.  pool_##name ties
+them together for the shared pool functions _BG_PoolInit(), _BG_PoolAlloc(),
+_BG_PoolFree() and BG_PoolMemoryInfo(), which the functions defined here wrap.
 ======================
 */
 #define allocator(name,size,count) \
-  static uint8_t buffer_##name[(count) * (((size_t)(size) & ~((size_t)0xF)) + (size_t)16)] __attribute__ ((aligned (16))); \
-  static uint8_t *unused_##name[(count)]; \
-  static uint8_t **stack_##name; \
-  static int unused_memory_chunks_##name(void) { \
-    return ((int)(stack_##name - unused_##name)+1); \
-  } \
+  static uint8_t buffer_##name[(count) * BG_POOL_STRIDE(size)] __attribute__ ((aligned (16))); \
+  static uint32_t freeMap_##name[BG_POOL_MAP_WORDS(count)]; \
+  static uint32_t summaryMap_##name[BG_POOL_MAP_WORDS(BG_POOL_MAP_WORDS(count))]; \
+  static bgMemoryPool_t pool_##name = \
+  { \
+    #name, (size), BG_POOL_STRIDE(size), (count), \
+    buffer_##name, freeMap_##name, summaryMap_##name \
+  }; \
   static void memoryInfo_##name(void){ \
-    Com_Printf("^5---------------------------------------------^7\n"); \
-    Com_Printf("^3Memory Info for Allocator ( ^6" #name "^3 )^7\n"); \
-    Com_Printf("^5---------------------------------------------^7\n"); \
-    if(!stack_##name ) \
-    { \
-      Com_Printf("^3pool not initialized.^7\n"); \
-      Com_Printf("^5---------------------------------------------^7\n"); \
-      return; \
-    } \
-    Com_Printf("^3Memory Pool Size: ^6%i bytes^7\n", (int)((count) * (((size_t)(size) & ~((size_t)0xF)) + (size_t)16))); \
-    Com_Printf("^3Free Memory: ^6%i bytes^7\n", \
-               (int)((stack_##name - unused_##name) * (((size_t)(size) & ~((size_t)0xF)) + (size_t)16))); \
-    Com_Printf("^3Allocated Memory: ^6%i bytes^7\n", \
-               (int)((&unused_##name[(count)-1] - stack_##name) * (((size_t)(size) & ~((size_t)0xF)) + (size_t)16))); \
-    Com_Printf("^3Size of Chunks: ^6%i bytes^7\n", (int)(((size_t)(size) & ~((size_t)0xF)) + (size_t)16)); \
-    Com_Printf("^3Total Number of Chunks: ^6%i^7\n", (int)(count)); \
-    Com_Printf("^3Number of Unused Chunks: ^6%i^7\n", \
-               unused_memory_chunks_##name( )); \
-    Com_Printf("^3Number of Used Chunks: ^6%i^7\n", \
-               (int)(&unused_##name[(count)-1] - stack_##name)); \
-    Com_Printf("^3Memory Pool Address Range: from (^60x%p^3) to (^60x%p^3)^7\n", \
-               buffer_##name, &buffer_##name[ ARRAY_LEN( buffer_##name ) - 1 ]); \
-    Com_Printf("^5---------------------------------------------^7\n"); \
+    BG_PoolMemoryInfo(&pool_##name); \
   } \
   static void initPool_##name(char *calledFile, int calledLine){ \
-    int i; \
-    uint8_t *temp = buffer_##name; \
-    assertMem(((size) > 0 && "size must be greater than 0."), calledFile, calledLine); \
-    assertMem(((count) > 0 && "count must be greater than 0."), calledFile, calledLine); \
-    for(i = 0;i < (count);i++,temp += (((size_t)(size) & ~((size_t)0xF)) + (size_t)16)){ \
-      *((uint8_t *)temp + (size)) = 0; \
-      unused_##name[i] = temp; \
-    } \
-    stack_##name = unused_##name + ((count) - 1); \
+    _BG_PoolInit(&pool_##name, calledFile, calledLine); \
   } \
   static void *alloc_##name(char *calledFile, int calledLine){ \
-  void *ptr = (void *)*stack_##name; \
-    assertMem((stack_##name != 0 && "pool not initialized."), calledFile, calledLine); \
-    assertMemKind(((stack_##name >= unused_##name && "out of memory.")), name, calledFile, calledLine); \
-    assertMemKind((*((uint8_t *)ptr + (size)) == 0 && "invalid memory access"), name, calledFile, calledLine); \
-    stack_##name--; \
-    *((uint8_t *)ptr + (size)) = 0x1A; \
-    return ptr; \
+    return _BG_PoolAlloc(&pool_##name, calledFile, calledLine); \
   } \
   static void free_##name(void *ptr, char *calledFile, int calledLine){ \
-    assertMemKindChunk(((uint8_t *)ptr >= buffer_##name &&  \
-                    (uint8_t *)ptr < buffer_##name + ((count) * (((size_t)(size) & ~((size_t)0xF)) + (size_t)16)) && \
-                    "out of bounds."), name, ptr, calledFile, calledLine); \
-    assertMemKindChunk((((uint8_t *)ptr - buffer_##name) % (((size_t)(size) & ~((size_t)0xF)) + (size_t)16) == 0 && \
-                    "not head of chunk."), name, ptr, calledFile, calledLine); \
-    assertMemKindChunk((stack_##name < unused_##name + ((count) - 1) && \
-                    "exceeds pool size."), name, ptr, calledFile, calledLine); \
-    assertMemKindChunk((*((uint8_t *)ptr + (size)) == 0x1A && \
-                       "invalid memory access or pointer freed more than once"), \
-                       name, ptr, calledFile, calledLine); \
-    *((uint8_t *)ptr + (size)) = 0; \
-    stack_##name++; \
-    *stack_##name = ptr; \
+    _BG_PoolFree(&pool_##name, ptr, calledFile, calledLine); \
   }
 
 // Used to init all BGAME memory allocators  
@@ -268,7 +296,7 @@ void  _BG_InitMemory( char *calledFile, int calledLine );
 void  BG_MemoryInfo( void );
 
 // For general memory allocation of misclanous allocations of types that are
-// infrequently used.  Utilizes a binary search of multiple memory allacotor
+// infrequently used.  Utilizes a lookup table of multiple memory allacotor
 // "class sizes".  For types that are frequently allocated, custom allocators
 // can be created using the allocator_protos() and allocator() macros.
 void  *_BG_Alloc( size_t size, char *calledFile, int calledLine ); // returns unitialized memory
@@ -2265,7 +2265,9 @@ void ClientThink_real( gentity_t *ent )
   // For firing lightning bolts early
   BG_CheckBoltImpactTrigger(&pm);
 
+  SV_ProfileBegin( profileZones[ PROFILE_PMOVE ] );
   Pmove( &pm );
+  SV_ProfileEnd( profileZones[ PROFILE_PMOVE ] );
 
   G_UnlaggedDetectCollisions( ent );
 
@@ -325,6 +325,131 @@ g_admin_admin_t *g_admin_admins = NULL;
 g_admin_ban_t *g_admin_bans = NULL;
 g_admin_command_t *g_admin_commands = NULL;
 
+/*
+Admins and bans are also hashed by GUID, and bans by their address for each
+netmask length, so connecting clients don't have to be compared with every
+entry.  Bans are only ever appended to g_admin_bans, so the first match in the
+list is the matching ban with the lowest number.
+*/
+#define ADMIN_HASH_SIZE 1024
+#define BAN_HASH_SIZE   4096
+
+static g_admin_admin_t *g_admin_adminHash[ ADMIN_HASH_SIZE ];
+static g_admin_ban_t *g_admin_banGuidHash[ BAN_HASH_SIZE ];
+static g_admin_ban_t *g_admin_banAddrHash[ BAN_HASH_SIZE ];
+static int g_admin_banMasks[ 2 ][ 129 ]; // bans for each address type and netmask
+static int g_admin_numBans;
+
+static unsigned int admin_hash_guid( const char *guid )
+{
+  unsigned int hash = 2166136261u;
+
+  for( ; *guid; guid++ )
+    hash = ( hash ^ tolower( *guid ) ) * 16777619u;
+
+  return hash;
+}
+
+// the netmask G_AddressCompare uses for a
+static int admin_addr_mask( const addr_t *a )
+{
+  int max = ( a->type == IPv6 ) ? 128 : 32;
+
+  if( a->mask < 1 || a->mask > max )
+    return max;
+  return a->mask;
+}
+
+static unsigned int admin_hash_addr( const addr_t *a, int mask )
+{
+  unsigned int hash = 2166136261u ^ a->type ^ ( mask << 1 );
+  int i;
+
+  for( i = 0; mask > 0; i++, mask -= 8 )
+  {
+    if( mask >= 8 )
+      hash = ( hash ^ a->addr[ i ] ) * 16777619u;
+    else
+      hash = ( hash ^ ( a->addr[ i ] & ( 0xff00 >> mask ) ) ) * 16777619u;
+  }
+
+  return hash;
+}
+
+static void admin_index_admin( g_admin_admin_t *a )
+{
+  g_admin_admin_t **bucket, *h;
+
+  bucket = &g_admin_adminHash[ admin_hash_guid( a->guid ) % ADMIN_HASH_SIZE ];
+
+  // G_admin_admin gives the first one in the list
+  for( h = *bucket; h; h = h->nextHash )
+  {
+    if( !Q_stricmp( h->guid, a->guid ) )
+      return;
+  }
+
+  a->nextHash = *bucket;
+  *bucket = a;
+}
+
+static void admin_link_ban_addr( g_admin_ban_t *b )
+{
+  int mask = admin_addr_mask( &b->ip );
+  g_admin_ban_t **bucket;
+
+  if( b->ip.type != IPv4 && b->ip.type != IPv6 )
+    return;
+
+  bucket = &g_admin_banAddrHash[ admin_hash_addr( &b->ip, mask ) % BAN_HASH_SIZE ];
+  b->nextAddr = *bucket;
+  *bucket = b;
+  g_admin_banMasks[ b->ip.type ][ mask ]++;
+}
+
+static void admin_unlink_ban_addr( g_admin_ban_t *b )
+{
+  int mask = admin_addr_mask( &b->ip );
+  g_admin_ban_t **bucket;
+
+  if( b->ip.type != IPv4 && b->ip.type != IPv6 )
+    return;
+
+  bucket = &g_admin_banAddrHash[ admin_hash_addr( &b->ip, mask ) % BAN_HASH_SIZE ];
+  for( ; *bucket; bucket = &(*bucket)->nextAddr )
+  {
+    if( *bucket == b )
+    {
+      *bucket = b->nextAddr;
+      g_admin_banMasks[ b->ip.type ][ mask ]--;
+      return;
+    }
+  }
+}
+
+// call once the ban is at the end of g_admin_bans with its GUID and address
+static void admin_index_ban( g_admin_ban_t *b )
+{
+  g_admin_ban_t **bucket;
+
+  b->number = ++g_admin_numBans;
+
+  bucket = &g_admin_banGuidHash[ admin_hash_guid( b->guid ) % BAN_HASH_SIZE ];
+  b->nextGuid = *bucket;
+  *bucket = b;
+
+  admin_link_ban_addr( b );
+}
+
+static void admin_clear_index( void )
+{
+  memset( g_admin_adminHash, 0, sizeof( g_admin_adminHash ) );
+  memset( g_admin_banGuidHash, 0, sizeof( g_admin_banGuidHash ) );
+  memset( g_admin_banAddrHash, 0, sizeof( g_admin_banAddrHash ) );
+  memset( g_admin_banMasks, 0, sizeof( g_admin_banMasks ) );
+  g_admin_numBans = 0;
+}
+
 void G_admin_register_cmds( void )
 {
   int i;
@@ -416,7 +541,8 @@ g_admin_admin_t *G_admin_admin( const char *guid )
 {
   g_admin_admin_t *admin;
 
-  for( admin = g_admin_admins; admin; admin = admin->next )
+  for( admin = g_admin_adminHash[ admin_hash_guid( guid ) % ADMIN_HASH_SIZE ];
+       admin; admin = admin->nextHash )
   {
     if( !Q_stricmp( admin->guid, guid ) )
       return admin;
@@ -1029,17 +1155,12 @@ static void G_admin_ban_message(
 
   if( areason && ent )
   {
-    // we just want the ban number
-    int n = 1;
-    g_admin_ban_t *b = g_admin_bans;
-    for( ; b && b != ban; b = b->next, n++ )
-      ;
     Com_sprintf( areason, alen,
       S_COLOR_YELLOW "Banned player %s" S_COLOR_YELLOW
       " tried to connect from %s (ban #%d)",
       ent->client->pers.netname[ 0 ] ? ent->client->pers.netname : ban->name,
       ent->client->pers.ip.str,
-      n );
+      ban->number );
   }
 }
 
@@ -1053,23 +1174,55 @@ static qboolean G_admin_ban_matches( g_admin_ban_t *ban, gentity_t *ent )
 static g_admin_ban_t *G_admin_match_ban( gentity_t *ent )
 {
   int t;
-  g_admin_ban_t *ban;
+  int mask, max;
+  g_admin_ban_t *ban, *match = NULL;
+  const addr_t *ip = &ent->client->pers.ip;
 
   t = Com_RealTime( NULL );
   if( ent->client->pers.localClient )
     return NULL;
 
-  for( ban = g_admin_bans; ban; ban = ban->next )
+  for( ban = g_admin_banGuidHash[ admin_hash_guid( ent->client->pers.guid ) % BAN_HASH_SIZE ];
+       ban; ban = ban->nextGuid )
   {
     // 0 is for perm ban
     if( ban->expires != 0 && ban->expires <= t )
       continue;
 
-    if( G_admin_ban_matches( ban, ent ) )
-      return ban;
+    if( match && match->number < ban->number )
+      continue;
+
+    if( !Q_stricmp( ban->guid, ent->client->pers.guid ) )
+      match = ban;
   }
 
-  return NULL;
+  if( ( ip->type != IPv4 && ip->type != IPv6 ) ||
+      G_admin_permission( ent, ADMF_IMMUNITY ) )
+    return match;
+
+  // every netmask length that is used by a ban
+  max = ( ip->type == IPv6 ) ? 128 : 32;
+  for( mask = 1; mask <= max; mask++ )
+  {
+    if( !g_admin_banMasks[ ip->type ][ mask ] )
+      continue;
+
+    for( ban = g_admin_banAddrHash[ admin_hash_addr( ip, mask ) % BAN_HASH_SIZE ];
+         ban; ban = ban->nextAddr )
+    {
+      if( ban->expires != 0 && ban->expires <= t )
+        continue;
+
+      if( match && match->number < ban->number )
+        continue;
+
+      if( admin_addr_mask( &ban->ip ) == mask &&
+          G_AddressCompare( &ban->ip, ip ) )
+        match = ban;
+    }
+  }
+
+  return match;
 }
 
 qboolean G_admin_ban_check( gentity_t *ent, char *reason, int rlen )
@@ -1406,6 +1559,11 @@ qboolean G_admin_readconfig( gentity_t *ent )
     llsort( (struct llist **)&g_admin_admins, cmplevel );
   }
 
+  for( a = g_admin_admins; a; a = a->next )
+    admin_index_admin( a );
+  for( b = g_admin_bans; b; b = b->next )
+    admin_index_ban( b );
+
   // restore admin mapping
   for( i = 0; i < level.maxclients; i++ )
   {
@@ -1582,6 +1740,7 @@ qboolean G_admin_setlevel( gentity_t *ent )
       a = g_admin_admins = BG_Alloc0( sizeof( g_admin_admin_t ) );
     vic->client->pers.admin = a;
     Q_strncpyz( a->guid, vic->client->pers.guid, sizeof( a->guid ) );
+    admin_index_admin( a );
   }
 
   a->level = l->level;
@@ -1711,6 +1870,7 @@ static void admin_create_ban( gentity_t *ent,
   Q_strncpyz( b->name, netname, sizeof( b->name ) );
   Q_strncpyz( b->guid, guid, sizeof( b->guid ) );
   memcpy( &b->ip, ip, sizeof( b->ip ) );
+  admin_index_ban( b );
 
   Com_sprintf( b->made, sizeof( b->made ), "%04i-%02i-%02i %02i:%02i:%02i",
     qt.tm_year+1900, qt.tm_mon+1, qt.tm_mday,
@@ -2355,7 +2515,9 @@ qboolean G_admin_adjustban( gentity_t *ent )
       *p = '\0';
     else
       Com_sprintf( p, sizeof( ban->ip.str ) - ( p - ban->ip.str ), "/%d", mask );
+    admin_unlink_ban_addr( ban );
     ban->ip.mask = mask;
+    admin_link_ban_addr( ban );
   }
   reason = ConcatArgs( 3 + skiparg );
   if( *reason )
@@ -5114,6 +5276,7 @@ void G_admin_cleanup( void )
     BG_Free( c );
   }
   g_admin_commands = NULL;
+  admin_clear_index( );
 }
 
 void G_admin_scrim_status(gentity_t *ent ) {
@@ -6282,6 +6445,7 @@ qboolean G_admin_scrim(gentity_t *ent) {
 qboolean G_admin_seen( gentity_t *ent )
 {
   int        offset = 0;
+  int        result;
   char       offsetstr[ 10 ];
   char       name[ MAX_COLORFUL_NAME_LENGTH ];
 
@@ -6301,18 +6465,21 @@ qboolean G_admin_seen( gentity_t *ent )
   pack_text2( va( "%%%s%%", name ) );
   pack_int( 10 );
   pack_int( offset );
-  if( sl_query( DB_SEEN, level.database_data, NULL ) != 0 )
+  result = sl_query( DB_SEEN, level.database_data, NULL );
+  if( result > 0 )
   {
     ADMP( "^3seen: ^7Query failed\n" );
     return qfalse;
   }
-  ADMP( "^3seen: ^7Done\n" );
+  if( result != DB_QUEUED )
+    ADMP( "^3seen: ^7Done\n" );
   return qtrue;
 }
 
 qboolean G_admin_maplog( gentity_t *ent )
 {
   int        offset = 0;
+  int        result;
   char       offsetstr[ 10 ];
 
   if( Cmd_Argc() == 2 )
@@ -6326,11 +6493,13 @@ qboolean G_admin_maplog( gentity_t *ent )
   pack_int( -1 );
   pack_int( 10 );
   pack_int( offset );
-  if( sl_query( DB_LAST_MAPS, level.database_data, NULL ) != 0 )
+  result = sl_query( DB_LAST_MAPS, level.database_data, NULL );
+  if( result > 0 )
   {
     ADMP( "^3maplog: ^7Query failed\n" );
     return qfalse;
   }
-  ADMP( "^3maplog: ^7Done\n" );
+  if( result != DB_QUEUED )
+    ADMP( "^3maplog: ^7Done\n" );
   return qtrue;
 }
@@ -94,6 +94,7 @@ g_admin_level_t;
 typedef struct g_admin_admin
 {
   struct g_admin_admin *next;
+  struct g_admin_admin *nextHash; // same GUID hash bucket
   int level;
   char guid[ 33 ];
   char name[ MAX_COLORFUL_NAME_LENGTH ];
@@ -112,6 +113,9 @@ typedef struct g_admin_ban
   int expires;
   char banner[ MAX_COLORFUL_NAME_LENGTH ];
   int warnCount;
+  int number; // position in g_admin_bans, from 1
+  struct g_admin_ban *nextGuid; // same GUID hash bucket
+  struct g_admin_ban *nextAddr; // same address and mask hash bucket
 }
 g_admin_ban_t;
 
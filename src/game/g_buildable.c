@@ -348,6 +348,576 @@ static void G_PuntBlocker( gentity_t *self, gentity_t *blocker ) {
 
 #define POWER_REFRESH_TIME  2000
 
+/*
+================
+G_BuildPointPool
+
+The pool the build points of ent come out of when power powers it, a
+buildable powered by a repeater takes them from the zone of the repeater
+================
+*/
+static int G_BuildPointPool( gentity_t *ent, gentity_t *power )
+{
+  if( ent->s.eType != ET_BUILDABLE || ( ent->s.eFlags & EF_DEAD ) )
+    return BP_POOL_NONE;
+
+  if( ent->buildableTeam == TEAM_ALIENS )
+    return BP_POOL_ALIENS;
+
+  if( ent->s.modelindex == BA_H_REPEATER )
+    return BP_POOL_HUMANS;
+
+  if( ent->buildableTeam != TEAM_HUMANS || ent->s.modelindex == BA_H_REACTOR ||
+      !power )
+    return BP_POOL_NONE;
+
+  if( power->s.modelindex == BA_H_REACTOR )
+    return BP_POOL_HUMANS;
+
+  if( power->s.modelindex == BA_H_REPEATER && power->usesBuildPointZone &&
+      power->buildPointZone >= 0 &&
+      power->buildPointZone < g_humanRepeaterMaxZones.integer )
+    return BP_POOL_ZONES + power->buildPointZone;
+
+  return BP_POOL_NONE;
+}
+
+/*
+================
+G_BuildPointZoneHeld
+
+The zone ent keeps active plus one, or 0
+================
+*/
+static int G_BuildPointZoneHeld( gentity_t *ent )
+{
+  if( ent->s.eType != ET_BUILDABLE || ( ent->s.eFlags & EF_DEAD ) ||
+      !ent->usesBuildPointZone )
+    return 0;
+
+  if( ent->buildPointZone < 0 ||
+      ent->buildPointZone >= g_humanRepeaterMaxZones.integer )
+    return 0;
+
+  return ent->buildPointZone + 1;
+}
+
+/*
+================
+G_BuildPointLedger
+================
+*/
+static int *G_BuildPointLedger( int pool )
+{
+  if( pool == BP_POOL_ALIENS )
+    return &level.alienBuildPointsUsed;
+
+  if( pool == BP_POOL_HUMANS )
+    return &level.humanBuildPointsUsed;
+
+  if( pool >= BP_POOL_ZONES &&
+      pool - BP_POOL_ZONES < g_humanRepeaterMaxZones.integer )
+    return &level.buildPointZones[ pool - BP_POOL_ZONES ].usedBuildPoints;
+
+  return NULL;
+}
+
+/*
+================
+G_RefundBuildPoints
+
+Take back what ent was last charged
+================
+*/
+static void G_RefundBuildPoints( gentity_t *ent )
+{
+  int *ledger;
+
+  if( ent < g_entities || ent >= g_entities + MAX_GENTITIES )
+    return;
+
+  ledger = G_BuildPointLedger( ent->buildPointPool );
+  if( ledger )
+    *ledger -= ent->buildPointCharge;
+
+  if( ent->buildPointZoneHeld &&
+      ent->buildPointZoneHeld <= g_humanRepeaterMaxZones.integer )
+    level.buildPointZones[ ent->buildPointZoneHeld - 1 ].holders--;
+
+  ent->buildPointPool = BP_POOL_NONE;
+  ent->buildPointCharge = 0;
+  ent->buildPointZoneHeld = 0;
+}
+
+/*
+================
+G_RechargeBuildPoints
+
+Move the build points of ent to the ledger it belongs in now, call
+whenever it changes type, team, parentNode or dies
+================
+*/
+void G_RechargeBuildPoints( gentity_t *ent )
+{
+  int *ledger;
+
+  if( ent < g_entities || ent >= g_entities + MAX_GENTITIES )
+    return;
+
+  G_RefundBuildPoints( ent );
+
+  ent->buildPointPool = G_BuildPointPool( ent, ent->parentNode );
+  ledger = G_BuildPointLedger( ent->buildPointPool );
+  if( ledger )
+  {
+    ent->buildPointCharge = BG_Buildable( ent->s.modelindex )->buildPoints;
+    *ledger += ent->buildPointCharge;
+  }
+
+  ent->buildPointZoneHeld = G_BuildPointZoneHeld( ent );
+  if( ent->buildPointZoneHeld )
+    level.buildPointZones[ ent->buildPointZoneHeld - 1 ].holders++;
+}
+
+/*
+================
+G_PowerGraphTracked
+
+Buildables are counted in the load of their parentNode
+================
+*/
+static qboolean G_PowerGraphTracked( gentity_t *ent )
+{
+  return ent >= g_entities && ent < g_entities + MAX_GENTITIES &&
+         ent->s.eType == ET_BUILDABLE && ent->parentNode;
+}
+
+/*
+================
+G_PowerGraphLink
+
+Add ent to the load of its parentNode, call whenever an entity
+becomes a buildable or gets a new parentNode
+================
+*/
+void G_PowerGraphLink( gentity_t *ent )
+{
+  if( G_PowerGraphTracked( ent ) )
+  {
+    level.powerLoad[ ent->parentNode - g_entities ] +=
+      BG_Buildable( ent->s.modelindex )->buildPoints;
+    level.powerParentsValid = qfalse;
+  }
+
+  G_RechargeBuildPoints( ent );
+}
+
+/*
+================
+G_PowerGraphUnlink
+
+Remove ent from the load of its parentNode, call before an entity
+stops being a buildable or loses its parentNode
+================
+*/
+void G_PowerGraphUnlink( gentity_t *ent )
+{
+  if( G_PowerGraphTracked( ent ) )
+  {
+    level.powerLoad[ ent->parentNode - g_entities ] -=
+      BG_Buildable( ent->s.modelindex )->buildPoints;
+    level.powerParentsValid = qfalse;
+  }
+
+  G_RefundBuildPoints( ent );
+}
+
+/*
+================
+G_SetParentNode
+================
+*/
+void G_SetParentNode( gentity_t *self, gentity_t *parent )
+{
+  if( parent == self->parentNode )
+    return;
+
+  G_PowerGraphUnlink( self );
+  self->parentNode = parent;
+  G_PowerGraphLink( self );
+}
+
+/*
+================
+G_PowerZoneLoad
+
+Build points used by the buildables in the zone of node, not counting self
+================
+*/
+static int G_PowerZoneLoad( gentity_t *node, gentity_t *self )
+{
+  int load = level.powerLoad[ node - g_entities ];
+
+  if( self->parentNode == node && G_PowerGraphTracked( self ) )
+    load -= BG_Buildable( self->s.modelindex )->buildPoints;
+
+  return load;
+}
+
+/*
+================
+G_IsPowerSource
+================
+*/
+static qboolean G_IsPowerSource( gentity_t *ent )
+{
+  if( ent->s.eType == ET_BUILDABLE )
+    return ent->s.modelindex == BA_H_REACTOR || ent->s.modelindex == BA_H_REPEATER;
+
+  return ent->classname && !strcmp( ent->classname, "target_power" );
+}
+
+/*
+================
+G_InvalidatePowerSources
+
+Call when an entity may have become a power source, the list is a
+superset so sources that go away don't need to be reported
+================
+*/
+void G_InvalidatePowerSources( void )
+{
+  level.powerSourcesValid = qfalse;
+  level.powerParentsValid = qfalse;
+}
+
+/*
+================
+G_UpdatePowerSources
+================
+*/
+static void G_UpdatePowerSources( void )
+{
+  int       i;
+  gentity_t *ent;
+
+  if( level.powerSourcesValid )
+    return;
+
+  level.numPowerSources = 0;
+  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  {
+    if( G_IsPowerSource( ent ) )
+      level.powerSources[ level.numPowerSources++ ] = ent;
+  }
+
+  level.powerSourcesValid = qtrue;
+}
+
+/*
+================
+G_ResetBuildPoints
+
+Recharge every buildable from empty ledgers
+================
+*/
+void G_ResetBuildPoints( void )
+{
+  int       i;
+  gentity_t *ent;
+
+  level.alienBuildPointsUsed = level.humanBuildPointsUsed = 0;
+  for( i = 0; i < g_humanRepeaterMaxZones.integer; i++ )
+  {
+    level.buildPointZones[ i ].usedBuildPoints = 0;
+    level.buildPointZones[ i ].holders = 0;
+  }
+
+  for( i = 0, ent = g_entities; i < level.num_entities; i++, ent++ )
+  {
+    ent->buildPointPool = BP_POOL_NONE;
+    ent->buildPointCharge = 0;
+    ent->buildPointZoneHeld = 0;
+    G_RechargeBuildPoints( ent );
+  }
+}
+
+/*
+================
+G_PowerParentAgain
+
+Search power for ent from scratch and put its parentNode back, the
+result is what the last G_RefreshPowerParents should have settled on
+================
+*/
+static gentity_t *G_PowerParentAgain( gentity_t *ent )
+{
+  gentity_t *parent = ent->parentNode;
+  qboolean  valid = level.powerParentsValid;
+  gentity_t *power;
+
+  if( ent->s.eType != ET_BUILDABLE || ( ent->s.eFlags & EF_DEAD ) ||
+      ent->buildableTeam != TEAM_HUMANS ||
+      ent->s.modelindex == BA_H_REACTOR || ent->s.modelindex == BA_H_REPEATER )
+    return parent;
+
+  power = G_PowerEntityForEntity( ent );
+  G_SetParentNode( ent, parent );
+  level.powerParentsValid = valid;
+
+  return power;
+}
+
+/*
+================
+G_CheckBuildPoints
+
+Compare the build point ledgers against a count of every buildable and
+repair them, returns the number of differences
+================
+*/
+int G_CheckBuildPoints( void )
+{
+  int       i, pool, held, cost;
+  int       chargedPool, charge, chargedHeld;
+  int       alienUsed = 0, humanUsed = 0;
+  int       numZones = g_humanRepeaterMaxZones.integer;
+  int       zoneUsed[ MAX_GENTITIES ], zoneHolders[ MAX_GENTITIES ];
+  int       errors = 0;
+  gentity_t *ent, *power;
+
+  // a zone is only held by a living repeater, each takes the first free one
+  memset( zoneUsed, 0, sizeof( zoneUsed ) );
+  memset( zoneHolders, 0, sizeof( zoneHolders ) );
+
+  for( i = 0, ent = g_entities; i < level.num_entities; i++, ent++ )
+  {
+    chargedPool = ent->buildPointPool;
+    charge = ent->buildPointCharge;
+    chargedHeld = ent->buildPointZoneHeld;
+
+    // until the parents have settled a new search can find another one
+    power = ent->parentNode;
+    if( level.powerParentsValid )
+    {
+      power = G_PowerParentAgain( ent );
+
+      if( power != ent->parentNode )
+      {
+        Com_Printf( "entity %d (%s): powered by %d, should be %d\n", i,
+                    ent->classname ? ent->classname : "",
+                    ent->parentNode ? (int)( ent->parentNode - g_entities ) : -1,
+                    power ? (int)( power - g_entities ) : -1 );
+        level.powerParentsValid = qfalse;
+        errors++;
+      }
+    }
+
+    pool = G_BuildPointPool( ent, power );
+    held = G_BuildPointZoneHeld( ent );
+    cost = G_BuildPointLedger( pool ) ? BG_Buildable( ent->s.modelindex )->buildPoints : 0;
+
+    if( pool != chargedPool || cost != charge || held != chargedHeld )
+    {
+      Com_Printf( "entity %d (%s): charged %d to pool %d, should be %d to pool %d\n", i,
+                  ent->classname ? ent->classname : "", charge, chargedPool, cost, pool );
+      errors++;
+    }
+
+    if( ( pool >= BP_POOL_ZONES && pool - BP_POOL_ZONES >= MAX_GENTITIES ) ||
+        held > MAX_GENTITIES )
+    {
+      Com_Printf( "entity %d (%s): zone %d out of range\n", i,
+                  ent->classname ? ent->classname : "", ent->buildPointZone );
+      errors++;
+      continue;
+    }
+
+    if( pool == BP_POOL_ALIENS )
+      alienUsed += cost;
+    else if( pool == BP_POOL_HUMANS )
+      humanUsed += cost;
+    else if( pool >= BP_POOL_ZONES )
+      zoneUsed[ pool - BP_POOL_ZONES ] += cost;
+
+    if( held )
+      zoneHolders[ held - 1 ]++;
+  }
+
+  if( alienUsed != level.alienBuildPointsUsed )
+  {
+    Com_Printf( "alien build points used: %d, should be %d\n",
+                level.alienBuildPointsUsed, alienUsed );
+    errors++;
+  }
+
+  if( humanUsed != level.humanBuildPointsUsed )
+  {
+    Com_Printf( "human build points used: %d, should be %d\n",
+                level.humanBuildPointsUsed, humanUsed );
+    errors++;
+  }
+
+  for( i = 0; i < numZones; i++ )
+  {
+    buildPointZone_t *zone = &level.buildPointZones[ i ];
+    int              used = i < MAX_GENTITIES ? zoneUsed[ i ] : 0;
+    int              holders = i < MAX_GENTITIES ? zoneHolders[ i ] : 0;
+
+    if( used != zone->usedBuildPoints || holders != zone->holders )
+    {
+      Com_Printf( "zone %d: %d build points used by %d holders, should be %d by %d\n",
+                  i, zone->usedBuildPoints, zone->holders, used, holders );
+      errors++;
+    }
+  }
+
+  if( errors )
+    G_ResetBuildPoints( );
+
+  return errors;
+}
+
+/*
+================
+G_PowerSourceState
+
+What G_FindPower looks at when it considers ent
+================
+*/
+static int G_PowerSourceState( gentity_t *ent )
+{
+  if( !G_IsPowerSource( ent ) )
+    return 0;
+
+  return 1 | ( ent->powered ? 2 : 0 ) | ( ent->spawned ? 4 : 0 ) |
+         ( ent->health > 0 ? 8 : 0 ) | ( ent->MasterPower ? 16 : 0 ) |
+         ( ent->usesBuildPointZone ? 32 : 0 ) | ( ent->s.modelindex << 6 ) |
+         ( ent->buildPointZone << 16 );
+}
+
+/*
+================
+G_RefreshPowerParents
+
+Have the human buildables look for power again if anything G_FindPower
+depends on changed since they last did: a power source, the loads of
+the zones or the build points queued for them
+================
+*/
+void G_RefreshPowerParents( void )
+{
+  int       i, state;
+  gentity_t *ent;
+
+  G_UpdatePowerSources( );
+
+  for( i = 0; i < level.numPowerSources; i++ )
+  {
+    state = G_PowerSourceState( level.powerSources[ i ] );
+    if( state != level.powerSourceStates[ i ] )
+    {
+      level.powerSourceStates[ i ] = state;
+      level.powerParentsValid = qfalse;
+    }
+  }
+
+  if( level.humanBuildPointQueue != level.powerQueueState )
+  {
+    level.powerQueueState = level.humanBuildPointQueue;
+    level.powerParentsValid = qfalse;
+  }
+
+  for( i = 0; i < g_humanRepeaterMaxZones.integer; i++ )
+  {
+    buildPointZone_t *zone = &level.buildPointZones[ i ];
+
+    state = zone->active ? zone->queuedBuildPoints + 1 : 0;
+    if( state != zone->powerState )
+    {
+      zone->powerState = state;
+      level.powerParentsValid = qfalse;
+    }
+  }
+
+  if( level.powerParentsValid )
+    return;
+
+  // finding power can move the loads, in which case this runs again
+  // next frame until nothing moves
+  level.powerParentsValid = qtrue;
+
+  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  {
+    if( ent->s.eType != ET_BUILDABLE || ( ent->s.eFlags & EF_DEAD ) ||
+        ent->buildableTeam != TEAM_HUMANS )
+      continue;
+
+    if( ent->s.modelindex != BA_H_REACTOR && ent->s.modelindex != BA_H_REPEATER )
+      G_FindPower( ent, qfalse );
+
+    G_RechargeBuildPoints( ent );
+  }
+}
+
+/*
+================
+G_CheckPowerGraph
+
+Compare the power zone loads and sources against a scan of every entity
+and repair them
+================
+*/
+void G_CheckPowerGraph( void )
+{
+  int       i, j;
+  int       load[ MAX_GENTITIES ];
+  int       errors = 0;
+  gentity_t *ent;
+
+  memset( load, 0, sizeof( load ) );
+  for( i = 0, ent = g_entities; i < level.num_entities; i++, ent++ )
+  {
+    if( G_PowerGraphTracked( ent ) )
+      load[ ent->parentNode - g_entities ] += BG_Buildable( ent->s.modelindex )->buildPoints;
+  }
+
+  for( i = 0; i < MAX_GENTITIES; i++ )
+  {
+    if( load[ i ] != level.powerLoad[ i ] )
+    {
+      Com_Printf( "entity %d (%s): power load is %d, should be %d\n", i,
+                g_entities[ i ].classname ? g_entities[ i ].classname : "",
+                level.powerLoad[ i ], load[ i ] );
+      level.powerLoad[ i ] = load[ i ];
+      errors++;
+    }
+  }
+
+  if( level.powerSourcesValid )
+  {
+    for( i = MAX_CLIENTS, j = 0, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+    {
+      // the list may still hold old sources
+      while( j < level.numPowerSources && level.powerSources[ j ] < ent )
+        j++;
+
+      if( G_IsPowerSource( ent ) &&
+          ( j == level.numPowerSources || level.powerSources[ j ] != ent ) )
+      {
+        Com_Printf( "entity %d (%s): missing from the power sources\n", i, ent->classname );
+        errors++;
+      }
+    }
+
+    G_InvalidatePowerSources( );
+  }
+
+  errors += G_CheckBuildPoints( );
+
+  Com_Printf( "power graph: %d error%s\n", errors, errors == 1 ? "" : "s" );
+}
+
 /*
 ================
 G_FindPower
@@ -357,8 +927,8 @@ attempt to find power for self, return qtrue if successful
 */
 qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
 {
-  int       i, j;
-  gentity_t *ent, *ent2;
+  int       i;
+  gentity_t *ent;
   gentity_t *closestPower = NULL;
   int       distance = 0;
   int       minDistance = REPEATER_BASESIZE + 1;
@@ -370,7 +940,7 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
   // Reactor is always powered
   if( self->s.modelindex == BA_H_REACTOR )
   {
-    self->parentNode = self;
+    G_SetParentNode( self, self );
 
     return qtrue;
   }
@@ -378,19 +948,23 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
   // Handle repeaters
   if( self->s.modelindex == BA_H_REPEATER )
   {
-    self->parentNode = G_Reactor( );
+    G_SetParentNode( self, G_Reactor( ) );
 
     return self->parentNode != NULL;
   }
 
-  // Iterate through entities
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  G_UpdatePowerSources( );
+
+  // Iterate through the power sources
+  for( i = 0; i < level.numPowerSources; i++ )
   {
+    ent = level.powerSources[ i ];
+
     if(
-      !strcmp(ent->classname, "target_power") && ent->powered &&
+      ent->classname && !strcmp(ent->classname, "target_power") && ent->powered &&
       (int)Distance(self->r.currentOrigin, ent->r.currentOrigin) <= ent->PowerRadius &&
       (ent->MasterPower || G_Reactor( ) != NULL)) {
-      self->parentNode = ent;
+      G_SetParentNode( self, ent );
       return qtrue;
     }
 
@@ -412,20 +986,8 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
         {
           int buildPoints = g_humanBuildPoints.integer;
 
-          // Scan the buildables in the reactor zone
-          for( j = MAX_CLIENTS, ent2 = g_entities + j; j < level.num_entities; j++, ent2++ )
-          {
-            if( ent2->s.eType != ET_BUILDABLE )
-              continue;
-
-            if( ent2 == self )
-              continue;
-
-            if( ent2->parentNode == ent )
-            {
-              buildPoints -= BG_Buildable( ent2->s.modelindex )->buildPoints;
-            }
-          }
+          // The buildables in the reactor zone
+          buildPoints -= G_PowerZoneLoad( ent, self );
 
           buildPoints -= level.humanBuildPointQueue;
 
@@ -433,7 +995,7 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
 
           if( buildPoints >= 0 )
           {
-            self->parentNode = ent;
+            G_SetParentNode( self, ent );
             return qtrue;
           }
           else
@@ -447,7 +1009,7 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
         // Dummy buildables don't need to look for zones
         else
         {
-          self->parentNode = ent;
+          G_SetParentNode( self, ent );
           return qtrue;
         }
       }
@@ -460,18 +1022,8 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
         {
           int buildPoints = g_humanRepeaterBuildPoints.integer;
 
-          // Scan the buildables in the repeater zone
-          for( j = MAX_CLIENTS, ent2 = g_entities + j; j < level.num_entities; j++, ent2++ )
-          {
-            if( ent2->s.eType != ET_BUILDABLE )
-              continue;
-
-            if( ent2 == self )
-              continue;
-
-            if( ent2->parentNode == ent )
-              buildPoints -= BG_Buildable( ent2->s.modelindex )->buildPoints;
-          }
+          // The buildables in the repeater zone
+          buildPoints -= G_PowerZoneLoad( ent, self );
 
           if( ent->usesBuildPointZone && level.buildPointZones[ ent->buildPointZone ].active )
             buildPoints -= level.buildPointZones[ ent->buildPointZone ].queuedBuildPoints;
@@ -500,7 +1052,7 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
     }
   }
 
-  self->parentNode = closestPower;
+  G_SetParentNode( self, closestPower );
   return self->parentNode != NULL;
 }
 
@@ -708,10 +1260,14 @@ gentity_t *G_InPowerZone( gentity_t *self )
   int         distance;
   vec3_t      temp_v;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  G_UpdatePowerSources( );
+
+  for( i = 0; i < level.numPowerSources; i++ )
   {
+    ent = level.powerSources[ i ];
+
     if(
-      !strcmp(ent->classname, "target_power") && ent->powered &&
+      ent->classname && !strcmp(ent->classname, "target_power") && ent->powered &&
       (int)Distance(self->r.currentOrigin, ent->r.currentOrigin) <= ent->PowerRadius &&
       (ent->MasterPower || G_Reactor() != NULL)) {
       return ent;
@@ -746,6 +1302,42 @@ gentity_t *G_InPowerZone( gentity_t *self )
   return NULL;
 }
 
+/*
+================
+G_InvalidateDCCs
+
+Call when an entity may have become a DCC, the list is a superset
+so DCCs that go away don't need to be reported
+================
+*/
+static void G_InvalidateDCCs( void )
+{
+  level.dccsValid = qfalse;
+}
+
+/*
+================
+G_UpdateDCCs
+================
+*/
+static void G_UpdateDCCs( void )
+{
+  int       i;
+  gentity_t *ent;
+
+  if( level.dccsValid )
+    return;
+
+  level.numDCCs = 0;
+  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  {
+    if( ent->s.eType == ET_BUILDABLE && ent->s.modelindex == BA_H_DCC )
+      level.dccs[ level.numDCCs++ ] = ent;
+  }
+
+  level.dccsValid = qtrue;
+}
+
 /*
 ================
 G_FindDCC
@@ -764,9 +1356,13 @@ int G_FindDCC( gentity_t *self )
   if( self->buildableTeam != TEAM_HUMANS )
     return 0;
 
-  //iterate through entities
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  G_UpdateDCCs( );
+
+  //iterate through the DCCs
+  for( i = 0; i < level.numDCCs; i++ )
   {
+    ent = level.dccs[ i ];
+
     if( ent->s.eType != ET_BUILDABLE )
       continue;
 
@@ -797,8 +1393,12 @@ qboolean G_IsDCCBuilt( void )
   int       i;
   gentity_t *ent;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  G_UpdateDCCs( );
+
+  for( i = 0; i < level.numDCCs; i++ )
   {
+    ent = level.dccs[ i ];
+
     if( ent->s.eType != ET_BUILDABLE )
       continue;
 
@@ -892,7 +1492,7 @@ qboolean G_FindCreep( gentity_t *self )
         (int)Distance(self->r.currentOrigin, ent->r.currentOrigin) <= ent->PowerRadius &&
         (ent->MasterPower || G_Reactor() != NULL)) {
         if(!self->client) {
-          self->parentNode = ent;
+          G_SetParentNode( self, ent );
         }
 
         return qtrue;
@@ -918,7 +1518,7 @@ qboolean G_FindCreep( gentity_t *self )
     if( minDistance <= CREEP_BASESIZE )
     {
       if( !self->client )
-        self->parentNode = closestSpawn;
+        G_SetParentNode( self, closestSpawn );
       return qtrue;
     }
     else
@@ -1019,6 +1619,7 @@ void AGeneric_CreepRecede( gentity_t *self )
   if( !( self->s.eFlags & EF_DEAD ) )
   {
     self->s.eFlags |= EF_DEAD;
+    G_RechargeBuildPoints( self );
     G_QueueBuildPoints( self );
 
     G_RewardAttackers( self );
@@ -1648,16 +2249,15 @@ void AHive_Think( gentity_t *self )
   // Find a target to attack
   if( self->spawned && !self->active && self->powered )
   {
-    int i, num, entityList[ MAX_GENTITIES ];
-    vec3_t mins, maxs,
-           range = { HIVE_SENSE_RANGE, HIVE_SENSE_RANGE, HIVE_SENSE_RANGE };
+    int i, num;
+    gentity_t *targets[ MAX_CLIENTS ];
+    vec3_t tip_origin;
 
-    VectorAdd( self->r.currentOrigin, range, maxs );
-    VectorSubtract( self->r.currentOrigin, range, mins );
-
-    num =
-      SV_AreaEntities(
-        mins, maxs, Temp_Clip_Mask(MASK_SHOT, 0), entityList, MAX_GENTITIES);
+    // the humans the tip of the hive could sense
+    VectorMA( self->s.pos.trBase, self->r.maxs[ 2 ], self->s.origin2,
+              tip_origin );
+    num = G_PlayersInRadius( TEAM_HUMANS, tip_origin, HIVE_SENSE_RANGE,
+                             MASK_SHOT, targets, MAX_CLIENTS );
 
     if( num == 0 )
       return;
@@ -1665,7 +2265,7 @@ void AHive_Think( gentity_t *self )
     start = rand( ) / ( RAND_MAX / num + 1 );
     for( i = start; i < num + start; i++ )
     {
-      if( AHive_CheckTarget( self, g_entities + entityList[ i % num ] ) )
+      if( AHive_CheckTarget( self, targets[ i % num ] ) )
         return;
     }
   }
@@ -1901,22 +2501,28 @@ Used by ATrapper_Think to locate enemy gentities
 */
 static void ATrapper_FindEnemy( gentity_t *ent, int range )
 {
+  gentity_t *targets[ MAX_CLIENTS ];
   gentity_t *target;
-  int       i;
+  int       i, num;
   int       start;
 
-  // iterate through entities
-  start = rand( ) / ( RAND_MAX / level.num_entities + 1 );
-  for( i = start; i < level.num_entities + start; i++ )
+  // iterate through the humans in its field of "vision"
+  num = G_PlayersInCone( TEAM_HUMANS, ent->r.currentOrigin, ent->s.origin2,
+                         range, LOCKBLOB_DOT, targets, MAX_CLIENTS );
+  if( num )
   {
-    target = g_entities + ( i % level.num_entities );
-    //if target is not valid keep searching
-    if( !ATrapper_CheckTarget( ent, target, range ) )
-      continue;
+    start = rand( ) / ( RAND_MAX / num + 1 );
+    for( i = start; i < num + start; i++ )
+    {
+      target = targets[ i % num ];
+      //if target is not valid keep searching
+      if( !ATrapper_CheckTarget( ent, target, range ) )
+        continue;
 
-    //we found a target
-    ent->enemy = target;
-    return;
+      //we found a target
+      ent->enemy = target;
+      return;
+    }
   }
 
   //couldn't find a target
@@ -2066,6 +2672,7 @@ void HSpawn_Blast( gentity_t *self )
   G_QueueBuildPoints( self );
   G_RewardAttackers( self );
   // turn into an explosion
+  G_PowerGraphUnlink( self );
   self->s.eType = ET_EVENTS + EV_HUMAN_BUILDABLE_EXPLOSION;
   self->freeAfterEvent = qtrue;
 
@@ -2180,6 +2787,27 @@ void HSpawn_Think( gentity_t *self )
 
 
 
+/*
+================
+G_RechargePowerZone
+
+Recharge node and the buildables it powers after it changed zone
+================
+*/
+static void G_RechargePowerZone( gentity_t *node )
+{
+  int       i;
+  gentity_t *ent;
+
+  G_RechargeBuildPoints( node );
+
+  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  {
+    if( ent->parentNode == node && ent != node )
+      G_RechargeBuildPoints( ent );
+  }
+}
+
 /*
 ================
 HRepeater_Die
@@ -2229,6 +2857,7 @@ static void HRepeater_Die( gentity_t *self, gentity_t *inflictor, gentity_t *att
 
     zone->active = qfalse;
     self->usesBuildPointZone = qfalse;
+    G_RechargePowerZone( self );
   }
 }
 
@@ -2280,6 +2909,7 @@ void HRepeater_Think( gentity_t *self )
 
         self->buildPointZone = zone - level.buildPointZones;
         self->usesBuildPointZone = qtrue;
+        G_RechargePowerZone( self );
 
         break;
       }
@@ -3041,10 +3671,8 @@ Used by HMGTurret_Think to locate enemy gentities
 */
 static void HMGTurret_FindEnemy( gentity_t *self )
 {
-  int         entityList[ MAX_GENTITIES ];
+  gentity_t   *targets[ MAX_CLIENTS ];
   float       range = BG_Buildable(self->s.modelindex)->turretRange;
-  vec3_t      range_vector;
-  vec3_t      mins, maxs;
   int         i, num;
   gentity_t   *target;
   gentity_t   *prev_enemy;
@@ -3056,13 +3684,9 @@ static void HMGTurret_FindEnemy( gentity_t *self )
   prev_enemy = self->enemy;
   self->enemy = NULL;
 
-  // Look for targets in a box around the turret
-  VectorSet( range_vector, range, range, range );
-  VectorAdd( self->r.currentOrigin, range_vector, maxs );
-  VectorSubtract( self->r.currentOrigin, range_vector, mins );
-  num =
-    SV_AreaEntities(
-      mins, maxs, Temp_Clip_Mask(MASK_SHOT, 0), entityList, MAX_GENTITIES);
+  // Look for aliens within range of the turret
+  num = G_PlayersInRadius( TEAM_ALIENS, self->s.pos.trBase, range,
+                           MASK_SHOT, targets, MAX_CLIENTS );
 
   if( num == 0 )
     return;
@@ -3086,13 +3710,13 @@ static void HMGTurret_FindEnemy( gentity_t *self )
       }
     }
 
-    //check all other area entities
+    //check all other aliens in range
     start = rand( ) / ( RAND_MAX / num + 1 );
     for( i = start; i < num + start ; i++ ) {
       size_t         num_of_targeting;
       bboxPointNum_t trackedEnemyPointNumBackup;
 
-      target = &g_entities[ entityList[ i % num ] ];
+      target = targets[ i % num ];
 
       if(target == prev_enemy) {
         //already checked
@@ -3148,7 +3772,7 @@ static void HMGTurret_FindEnemy( gentity_t *self )
   } else {
     start = rand( ) / ( RAND_MAX / num + 1 );
     for( i = start; i < num + start ; i++ ) {
-      target = &g_entities[ entityList[ i % num ] ];
+      target = targets[ i % num ];
       if( !HMGTurret_CheckTarget( self, target, qtrue, qtrue ) ) {
         continue;
       }
@@ -3352,8 +3976,9 @@ void HTeslaGen_Think( gentity_t *self )
 
   if( self->spawned && self->timestamp < level.time )
   {
-    vec3_t origin, range, mins, maxs;
-    int entityList[ MAX_GENTITIES ], i, num;
+    vec3_t origin;
+    gentity_t *targets[ MAX_CLIENTS + PORTAL_NUM ];
+    int i, num;
 
     // Communicates firing state to client
     self->s.eFlags &= ~EF_FIRING;
@@ -3361,15 +3986,19 @@ void HTeslaGen_Think( gentity_t *self )
     // Move the muzzle from the entity origin up a bit to fire over turrets
     VectorMA( self->r.currentOrigin, self->r.maxs[ 2 ], self->s.origin2, origin );
 
-    VectorSet( range, TESLAGEN_RANGE, TESLAGEN_RANGE, TESLAGEN_RANGE );
-    VectorAdd( origin, range, maxs );
-    VectorSubtract( origin, range, mins );
-
     // Attack nearby Aliens and portals
-    num = SV_AreaEntities( mins, maxs, NULL, entityList, MAX_GENTITIES );
+    num = G_PlayersInRadius( TEAM_ALIENS, origin, TESLAGEN_RANGE, 0,
+                             targets, MAX_CLIENTS );
+    for( i = 0; i < PORTAL_NUM; i++ )
+    {
+      if( level.humanPortals.portals[ i ] &&
+          level.humanPortals.portals[ i ]->r.linked )
+        targets[ num++ ] = level.humanPortals.portals[ i ];
+    }
+
     for( i = 0; i < num; i++ )
     {
-      self->enemy = &g_entities[ entityList[ i ] ];
+      self->enemy = targets[ i ];
 
       if( G_NoTarget( self->enemy ) )
         continue;
@@ -3753,119 +4382,191 @@ void G_SetBuildableDropper( int removedBuildableNum, int dropperNum )
   }
 }
 
+/*
+===============
+G_BuildableDue
+
+Whether a buildable has work due in G_BuildableThink this frame: one of its
+own timers is up, its think function is due, it is moving or it is time to
+check what it is sitting on
+===============
+*/
+static qboolean G_BuildableDue( gentity_t *ent )
+{
+  if( level.time >= ent->timedThinkTime )
+    return qtrue;
+
+  if( ent->nextthink > 0 && ent->nextthink <= level.time )
+    return qtrue;
+
+  if( ent->s.groundEntityNum == ENTITYNUM_NONE ||
+      ent->s.pos.trType != TR_STATIONARY )
+    return qtrue;
+
+  if( ent->nextPhysicsTime < level.time )
+    return qtrue;
+
+  return qfalse;
+}
+
+/*
+===============
+G_ScheduleBuildable
+
+Works out when the timers of G_BuildableThink next need it: the next one
+second tick for regeneration, stacking and sizzle damage, and the end of
+construction.  Frame time that has not reached the timers yet counts
+towards the tick.
+===============
+*/
+static void G_ScheduleBuildable( gentity_t *ent )
+{
+  int buildTime = BG_Buildable( ent->s.modelindex )->buildTime;
+
+  ent->timedThinkTime = level.time + 1000 - ent->time1000 - ent->idleMsec;
+
+  if( !ent->spawned && ent->health > 0 &&
+      ent->buildTime + buildTime + 1 < ent->timedThinkTime )
+    ent->timedThinkTime = ent->buildTime + buildTime + 1;
+}
+
 /*
 ===============
 G_BuildableThink
 
-General think function for buildables
+General think function for buildables.  Called every frame with the frame
+time as msec, the timers, power and creep checks and physics only run on
+frames that G_BuildableDue finds work for.  The frame time of the frames in
+between is carried over so the timers see the same total.  Called with a
+msec of 0 to update a buildable straight away without running its physics,
+which leaves the carried over frame time for its next due frame.
 ===============
 */
 void G_BuildableThink( gentity_t *ent, int msec )
 {
-  int maxHealth = BG_Buildable( ent->s.modelindex )->health;
-  int regenRate = BG_Buildable( ent->s.modelindex )->regenRate;
-  int buildTime = BG_Buildable( ent->s.modelindex )->buildTime;
+  int       maxHealth = BG_Buildable( ent->s.modelindex )->health;
+  int       regenRate = BG_Buildable( ent->s.modelindex )->regenRate;
+  int       buildTime = BG_Buildable( ent->s.modelindex )->buildTime;
+  qboolean  due = qtrue;
+  int       frameMsec = msec;
+
+  if( msec != 0 )
+  {
+    due = G_BuildableDue( ent );
+    if( due )
+    {
+      msec += ent->idleMsec;
+      ent->idleMsec = 0;
+    }
+    else
+      ent->idleMsec += msec;
+  }
 
-  //toggle spawned flag for buildables
-  if( !ent->spawned && ent->health > 0 && !level.pausedTime )
+  if( due )
   {
-    if( ent->buildTime + buildTime < level.time )
+    //toggle spawned flag for buildables
+    if( !ent->spawned && ent->health > 0 && !level.pausedTime )
     {
-      ent->spawned = qtrue;
-      if( ent->s.modelindex == BA_A_OVERMIND )
+      if( ent->buildTime + buildTime < level.time )
       {
-        G_TeamCommand( TEAM_ALIENS,
-                       va( "cp \"The Overmind has awakened!\" %d",
-                       CP_OVERMIND_AWAKEN ) );
+        ent->spawned = qtrue;
+        if( ent->s.modelindex == BA_A_OVERMIND )
+        {
+          G_TeamCommand( TEAM_ALIENS,
+                         va( "cp \"The Overmind has awakened!\" %d",
+                         CP_OVERMIND_AWAKEN ) );
+        }
       }
     }
-  }
 
-  // Timer actions
-  ent->time1000 += msec;
-  if( ent->time1000 >= 1000 )
-  {
-    gentity_t *groundEnt;
+    ent->dcc = ( ent->buildableTeam != TEAM_HUMANS ) ? 0 : G_FindDCC( ent );
 
-    groundEnt = &g_entities[ ent->s.groundEntityNum ];
+    // Timer actions
+    ent->time1000 += msec;
+    if( ent->time1000 >= 1000 )
+    {
+      gentity_t *groundEnt;
 
-    ent->time1000 -= 1000;
+      groundEnt = &g_entities[ ent->s.groundEntityNum ];
 
-    if( ent->health > 0 && ent->health < maxHealth )
-    {
-      if( !ent->spawned )
-        ent->health += (int)( ceil( (float)maxHealth / (float)( buildTime * 0.001f ) ) );
-      else
+      ent->time1000 -= 1000;
+
+      if( ent->health > 0 && ent->health < maxHealth )
       {
-        if( ent->buildableTeam == TEAM_ALIENS && regenRate &&
-          ( ent->lastDamageTime + ALIEN_REGEN_DAMAGE_TIME ) < level.time )
+        if( !ent->spawned )
+          ent->health += (int)( ceil( (float)maxHealth / (float)( buildTime * 0.001f ) ) );
+        else
         {
-          ent->health += regenRate;
+          if( ent->buildableTeam == TEAM_ALIENS && regenRate &&
+            ( ent->lastDamageTime + ALIEN_REGEN_DAMAGE_TIME ) < level.time )
+          {
+            ent->health += regenRate;
+          }
+          else if( ent->buildableTeam == TEAM_HUMANS && ent->dcc &&
+            ( ent->lastDamageTime + HUMAN_REGEN_DAMAGE_TIME ) < level.time )
+          {
+            ent->health += DC_HEALRATE * ent->dcc;
+          }
         }
-        else if( ent->buildableTeam == TEAM_HUMANS && ent->dcc &&
-          ( ent->lastDamageTime + HUMAN_REGEN_DAMAGE_TIME ) < level.time )
+
+        if( ent->health >= maxHealth )
         {
-          ent->health += DC_HEALRATE * ent->dcc;
+          int i;
+          ent->health = maxHealth;
+          for( i = 0; i < MAX_CLIENTS; i++ )
+            ent->credits[ i ] = 0;
         }
       }
 
-      if( ent->health >= maxHealth )
+      if(  g_allowBuildableStacking.integer )
       {
-        int i;
-        ent->health = maxHealth;
-        for( i = 0; i < MAX_CLIENTS; i++ )
-          ent->credits[ i ] = 0;
-      }
-    }
-
-    if(  g_allowBuildableStacking.integer )
-    {
-      meansOfDeath_t meansOD;
+        meansOfDeath_t meansOD;
 
-      if( ent->dropperNum == ENTITYNUM_WORLD )
-        meansOD = MOD_CRUSH;
-      else
-        meansOD = MOD_DROP;
+        if( ent->dropperNum == ENTITYNUM_WORLD )
+          meansOD = MOD_CRUSH;
+        else
+          meansOD = MOD_DROP;
 
-      if( groundEnt->s.eType == ET_BUILDABLE &&
-          !BG_Buildable( groundEnt->s.modelindex )->stackable )
-      {
-        if( groundEnt->s.modelindex != BA_H_SPAWN &&
-            groundEnt->s.modelindex != BA_A_SPAWN )
+        if( groundEnt->s.eType == ET_BUILDABLE &&
+            !BG_Buildable( groundEnt->s.modelindex )->stackable )
+        {
+          if( groundEnt->s.modelindex != BA_H_SPAWN &&
+              groundEnt->s.modelindex != BA_A_SPAWN )
+            G_Damage( groundEnt, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
+                BG_Buildable( groundEnt->s.modelindex )->health / 5, DAMAGE_NO_PROTECTION,
+                meansOD );
+          else if(ent->builtBy || groundEnt->builtBy)
+            ent->damageDroppedBuildable = qtrue;
+        }
+        else if( groundEnt->client )
           G_Damage( groundEnt, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
-              BG_Buildable( groundEnt->s.modelindex )->health / 5, DAMAGE_NO_PROTECTION,
+              BG_HP2SU( 20 ), DAMAGE_NO_PROTECTION, meansOD );
+
+        if( ent->damageDroppedBuildable )
+          G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
+              BG_Buildable( ent->s.modelindex )->health / 5, DAMAGE_NO_PROTECTION,
               meansOD );
-        else if(ent->builtBy || groundEnt->builtBy)
-          ent->damageDroppedBuildable = qtrue;
       }
-      else if( groundEnt->client )
-        G_Damage( groundEnt, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
-            BG_HP2SU( 20 ), DAMAGE_NO_PROTECTION, meansOD );
-
-      if( ent->damageDroppedBuildable )
-        G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
-            BG_Buildable( ent->s.modelindex )->health / 5, DAMAGE_NO_PROTECTION,
-            meansOD );
-    }
 
-    //
-    // check for sizzle damage
-    //
-    if(ent->health > 0) {
-      trace_t   tr;
-      SV_Trace(
-        &tr, ent->r.currentOrigin, ent->r.mins, ent->r.maxs,
-        ent->r.currentOrigin, ent->s.number, qfalse,
-        *Temp_Clip_Mask((CONTENTS_LAVA|CONTENTS_SLIME), 0), TT_AABB);
-      if(tr.fraction < 1.0f || tr.allsolid || tr.startsolid) {
-        if( tr.contents & CONTENTS_LAVA ) {
-          G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
-            BG_Buildable( ent->s.modelindex )->health / 5, 0, MOD_LAVA );
-        }
+      //
+      // check for sizzle damage
+      //
+      if(ent->health > 0) {
+        trace_t   tr;
+        SV_Trace(
+          &tr, ent->r.currentOrigin, ent->r.mins, ent->r.maxs,
+          ent->r.currentOrigin, ent->s.number, qfalse,
+          *Temp_Clip_Mask((CONTENTS_LAVA|CONTENTS_SLIME), 0), TT_AABB);
+        if(tr.fraction < 1.0f || tr.allsolid || tr.startsolid) {
+          if( tr.contents & CONTENTS_LAVA ) {
+            G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
+              BG_Buildable( ent->s.modelindex )->health / 5, 0, MOD_LAVA );
+          }
 
-        if( ent->watertype & CONTENTS_SLIME ) {
-          G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
-            BG_Buildable( ent->s.modelindex )->health / 10, 0, MOD_SLIME );
+          if( ent->watertype & CONTENTS_SLIME ) {
+            G_Damage( ent, ent, &g_entities[ ent->dropperNum ], NULL, NULL,
+              BG_Buildable( ent->s.modelindex )->health / 10, 0, MOD_SLIME );
+          }
         }
       }
     }
@@ -3875,13 +4576,11 @@ void G_BuildableThink( gentity_t *ent, int msec )
     ent->lev1Grabbed = qfalse;
 
   if( ent->clientSpawnTime > 0 )
-    ent->clientSpawnTime -= msec;
+    ent->clientSpawnTime -= frameMsec;
 
   if( ent->clientSpawnTime < 0 )
     ent->clientSpawnTime = 0;
 
-  ent->dcc = ( ent->buildableTeam != TEAM_HUMANS ) ? 0 : G_FindDCC( ent );
-
   // Set health
   ent->s.misc = MAX( BG_SU2HP( ent->health ), 0 );
 
@@ -3899,9 +4598,15 @@ void G_BuildableThink( gentity_t *ent, int msec )
   // Check if this buildable is touching any triggers
   G_BuildableTouchTriggers( ent );
 
+  if( !due )
+    return;
+
   // Fall back on normal physics routines
   if( msec != 0 )
     G_Physics( ent, msec );
+
+  if( ent->inuse && ent->s.eType == ET_BUILDABLE )
+    G_ScheduleBuildable( ent );
 }
 
 
@@ -4856,11 +5561,15 @@ static gentity_t *G_Build( gentity_t *builder, buildable_t buildable,
   else
     built = builder;
 
+  G_PowerGraphUnlink( built );
   built->s.eType = ET_BUILDABLE;
   built->killedBy = ENTITYNUM_NONE;
   built->classname = BG_Buildable( buildable )->entityName;
   built->s.modelindex = buildable;
   built->buildableTeam = built->s.modelindex2 = BG_Buildable( buildable )->team;
+  G_PowerGraphLink( built );
+  G_InvalidatePowerSources( );
+  G_InvalidateDCCs( );
   BG_BuildableBoundingBox( buildable, built->r.mins, built->r.maxs );
 
   built->health = 1;
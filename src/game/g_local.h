@@ -351,6 +351,8 @@ struct gentity_s
   int               buildTime;          // when this buildable was built
   int               animTime;           // last animation change
   int               time1000;           // timer evaluated every second
+  int               timedThinkTime;     // when G_BuildableThink next has timed work to do
+  int               idleMsec;           // frame time skipped since that work was last done
   qboolean          deconstruct;        // deconstruct if no BP left
   int               deconstructTime;    // time at which structure marked
   int               markDeconstructor;  // number of the builder that marked the deconstructed buildable
@@ -401,6 +403,9 @@ struct gentity_s
 
   int               buildPointZone;                 // index for zone
   int               usesBuildPointZone;             // does it use a zone?
+  int               buildPointPool;                 // ledger buildPointCharge is in
+  int               buildPointCharge;
+  int               buildPointZoneHeld;             // zone counted as held + 1, or 0
 
   // AMP variables
   int               hurt;
@@ -685,8 +690,21 @@ typedef struct
   int totalBuildPoints;
   int queuedBuildPoints;
   int nextQueueTime;
+
+  int usedBuildPoints;      // charged by the buildables powered through the zone
+  int holders;              // buildables using the zone
+  int powerState;           // what G_FindPower last saw of the zone
 } buildPointZone_t;
 
+// where a buildable's build points are charged, zone i is BP_POOL_ZONES + i
+typedef enum
+{
+  BP_POOL_NONE,
+  BP_POOL_ALIENS,
+  BP_POOL_HUMANS,
+  BP_POOL_ZONES
+} buildPointPool_t;
+
 // store locational damage regions
 typedef struct damageRegion_s
 {
@@ -873,6 +891,19 @@ typedef struct
   int               humanNextQueueTime;
 
   buildPointZone_t  *buildPointZones;
+  int               alienBuildPointsUsed;           // charged by the living buildables
+  int               humanBuildPointsUsed;
+
+  int               powerLoad[ MAX_GENTITIES ];     // BP of the buildables with this parentNode
+  gentity_t         *powerSources[ MAX_GENTITIES ]; // possible power providers by number
+  int               numPowerSources;
+  qboolean          powerSourcesValid;
+  int               powerSourceStates[ MAX_GENTITIES ]; // by index in powerSources
+  int               powerQueueState;
+  qboolean          powerParentsValid;
+  gentity_t         *dccs[ MAX_GENTITIES ];         // possible DCCs by number
+  int               numDCCs;
+  qboolean          dccsValid;
 
   gentity_t         *markedBuildables[ MAX_GENTITIES ];
   int               numBuildablesForRemoval;
@@ -1162,6 +1193,15 @@ void              G_QueueBuildPoints( gentity_t *self );
 int               G_GetBuildPoints( const vec3_t pos, team_t team );
 int               G_GetMarkedBuildPoints( playerState_t *ps );
 qboolean          G_FindPower( gentity_t *self, qboolean searchUnspawned );
+void              G_SetParentNode( gentity_t *self, gentity_t *parent );
+void              G_PowerGraphLink( gentity_t *ent );
+void              G_PowerGraphUnlink( gentity_t *ent );
+void              G_InvalidatePowerSources( void );
+void              G_CheckPowerGraph( void );
+void              G_RechargeBuildPoints( gentity_t *ent );
+void              G_ResetBuildPoints( void );
+int               G_CheckBuildPoints( void );
+void              G_RefreshPowerParents( void );
 gentity_t         *G_PowerEntityForPoint( const vec3_t origin );
 gentity_t         *G_PowerEntityForEntity( gentity_t *ent );
 gentity_t         *G_RepeaterEntityForPoint( vec3_t origin );
@@ -1457,6 +1497,28 @@ void                G_Scrim_Player_Refresh_Registered_Names( void );
 //
 // g_main.c
 //
+
+// phases of G_RunFrame and ClientThink timed by the engine's profile command
+typedef enum
+{
+  PROFILE_MISSILES,
+  PROFILE_BUILDABLES,
+  PROFILE_PHYSICS,
+  PROFILE_MOVERS,
+  PROFILE_CLIENTS,
+  PROFILE_THINK,
+  PROFILE_CLIENTENDFRAME,
+  PROFILE_UNLAGGEDSTORE,
+  PROFILE_BUILDPOINTS,
+  PROFILE_STAGES,
+  PROFILE_CHECKEXITRULES,
+  PROFILE_PMOVE,
+
+  PROFILE_NUM_ZONES
+} gameProfileZone_t;
+
+extern int profileZones[ PROFILE_NUM_ZONES ];
+
 void     ScoreboardMessage( gentity_t *client );
 void     G_ReplacableBuildablesMessage( gentity_t *ent );
 void     MoveClientToIntermission( gentity_t *client );
@@ -1561,6 +1623,13 @@ void G_namelog_update_score( gclient_t *client );
 void G_namelog_update_name( gclient_t *client );
 void G_namelog_cleanup( void );
 
+//
+// g_log.c
+//
+void      G_LogStart( void );
+void      G_LogStop( void );
+void      G_LogWrite( const char *text );
+
 //
 // g_playermodel.c
 //
@@ -1570,6 +1639,15 @@ qboolean G_IsValidPlayerModel(const char *model);
 void G_GetPlayerModelSkins( const char *modelname, char skins[MAX_PLAYER_MODEL][ 64 ], int maxskins, int *numskins );
 char *GetSkin( char *modelname, char *wish );
 
+//
+// g_playerindex.c
+//
+void      G_ClearPlayerIndex( void );
+int       G_PlayersInRadius( team_t team, const vec3_t origin, float radius,
+                             int contents, gentity_t **list, int maxList );
+int       G_PlayersInCone( team_t team, const vec3_t apex, const vec3_t dir,
+                           float range, float minDot, gentity_t **list, int maxList );
+
 //
 // g_portal.c
 //
@@ -1740,6 +1818,11 @@ extern  vmCvar_t  g_teamStatus;
 
 extern  vmCvar_t  g_censorship;
 
+extern  vmCvar_t  g_logFile;
+extern  vmCvar_t  g_logFileSync;
+extern  vmCvar_t  g_logFlushTime;
+extern  vmCvar_t  g_logFormat;
+
 void      Com_Printf( const char *msg, ... );
 void      Com_Error( int level, const char *error, ... );
 int       Sys_Milliseconds( void );
@@ -1749,6 +1832,7 @@ void      Cmd_ArgvBuffer( int n, char *buffer, int bufferLength );
 int       FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode );
 int       FS_Read2( void *buffer, int len, fileHandle_t f );
 void      FS_Write( const void *buffer, int len, fileHandle_t f );
+qboolean  FS_ThreadWrite( const void *buffer, int len, fileHandle_t f );
 void      FS_FCloseFile( fileHandle_t f );
 int       FS_GetFileList( const char *path, const char *extension, char *listbuf, int bufsize );
 int       FS_GetFilteredFiles( const char *path, const char *extension, char *filter, char *listbuf, int bufsize );
@@ -1814,3 +1898,22 @@ void      Cmd_AddCommand( const char *cmdName, xcommand_t function );
 void      Cmd_RemoveCommand( const char *cmdName );
 
 int       sl_query( dbArray_t type, char *data, int *steps );
+
+int       SV_ProfileZone( const char *name );
+void      SV_ProfileBegin( int zone );
+void      SV_ProfileEnd( int zone );
+
+typedef struct sysThread_s  sysThread_t;
+typedef struct sysMutex_s   sysMutex_t;
+typedef struct sysCond_s    sysCond_t;
+sysThread_t *Sys_CreateThread( void (*function)( void *data ), void *data );
+void      Sys_JoinThread( sysThread_t *thread );
+sysMutex_t *Sys_CreateMutex( void );
+void      Sys_DestroyMutex( sysMutex_t *mutex );
+void      Sys_LockMutex( sysMutex_t *mutex );
+void      Sys_UnlockMutex( sysMutex_t *mutex );
+sysCond_t *Sys_CreateCond( void );
+void      Sys_DestroyCond( sysCond_t *cond );
+qboolean  Sys_WaitCond( sysCond_t *cond, sysMutex_t *mutex, int msec );
+void      Sys_SignalCond( sysCond_t *cond );
+void      Sys_BroadcastCond( sysCond_t *cond );
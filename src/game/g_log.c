@@ -0,0 +1,255 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+
+// g_log.c -- buffered writer for the game log
+
+#include "g_local.h"
+
+/*
+Lines from G_LogPrintf are copied into a ring buffer and written out by a
+thread of their own, either once LOG_FLUSH_SIZE bytes are pending or
+g_logFlushTime msec after the last write, so a slow disk never stalls a
+frame. G_LogStop writes out everything still pending before the file is
+closed. With g_logFileSync set, or g_logFlushTime 0, every line is written
+straight to the file as before.
+*/
+
+#define LOG_BUFFER_SIZE ( 256 * 1024 ) // must be a power of two
+#define LOG_FLUSH_SIZE  ( 16 * 1024 )
+
+static struct
+{
+  fileHandle_t  file;
+  sysThread_t   *thread;
+  sysMutex_t    *mutex;
+  sysCond_t     *flushCond;   // wakes the log thread
+  sysCond_t     *spaceCond;   // wakes the game when the buffer was full
+  qboolean      shutdown;
+  qboolean      failed;
+  int           flushTime;
+  unsigned int  head;         // bytes added by the game
+  unsigned int  tail;         // bytes written by the log thread
+  char          buffer[ LOG_BUFFER_SIZE ];
+} logSink;
+
+/*
+================
+G_LogThread
+================
+*/
+static void G_LogThread( void *data )
+{
+  Sys_LockMutex( logSink.mutex );
+  while( 1 )
+  {
+    unsigned int start, len;
+    qboolean     written;
+
+    while( !logSink.shutdown && logSink.head - logSink.tail < LOG_FLUSH_SIZE )
+    {
+      if( !Sys_WaitCond( logSink.flushCond, logSink.mutex, logSink.flushTime ) )
+        break;
+    }
+
+    if( logSink.head == logSink.tail )
+    {
+      if( logSink.shutdown )
+        break;
+      continue;
+    }
+
+    // the game only ever appends, so the pending bytes can be written
+    // without holding the lock
+    start = logSink.tail & ( LOG_BUFFER_SIZE - 1 );
+    len = MIN( logSink.head - logSink.tail, LOG_BUFFER_SIZE - start );
+
+    Sys_UnlockMutex( logSink.mutex );
+    written = FS_ThreadWrite( logSink.buffer + start, len, logSink.file );
+    Sys_LockMutex( logSink.mutex );
+
+    if( !written )
+      logSink.failed = qtrue;
+    logSink.tail += len;
+    Sys_BroadcastCond( logSink.spaceCond );
+  }
+  Sys_UnlockMutex( logSink.mutex );
+}
+
+/*
+================
+G_LogStart
+
+Called once level.logFile is open
+================
+*/
+void G_LogStart( void )
+{
+  if( !level.logFile || logSink.thread )
+    return;
+
+  if( g_logFileSync.integer || g_logFlushTime.integer <= 0 )
+    return;
+
+  logSink.file = level.logFile;
+  logSink.flushTime = g_logFlushTime.integer;
+  logSink.head = logSink.tail = 0;
+  logSink.shutdown = qfalse;
+  logSink.failed = qfalse;
+
+  logSink.mutex = Sys_CreateMutex( );
+  logSink.flushCond = Sys_CreateCond( );
+  logSink.spaceCond = Sys_CreateCond( );
+  if( logSink.mutex && logSink.flushCond && logSink.spaceCond )
+    logSink.thread = Sys_CreateThread( G_LogThread, NULL );
+
+  if( !logSink.thread )
+  {
+    Com_Printf( "WARNING: Couldn't start the log thread, writing %s directly\n",
+      g_logFile.string );
+    G_LogStop( );
+  }
+}
+
+/*
+================
+G_LogStop
+
+Writes out everything still buffered, called before level.logFile is closed
+================
+*/
+void G_LogStop( void )
+{
+  if( logSink.thread )
+  {
+    Sys_LockMutex( logSink.mutex );
+    logSink.shutdown = qtrue;
+    Sys_SignalCond( logSink.flushCond );
+    Sys_UnlockMutex( logSink.mutex );
+    Sys_JoinThread( logSink.thread );
+    logSink.thread = NULL;
+
+    if( logSink.failed )
+      Com_Printf( "WARNING: Some lines could not be written to %s\n", g_logFile.string );
+  }
+
+  Sys_DestroyCond( logSink.flushCond );
+  Sys_DestroyCond( logSink.spaceCond );
+  Sys_DestroyMutex( logSink.mutex );
+  logSink.flushCond = logSink.spaceCond = NULL;
+  logSink.mutex = NULL;
+  logSink.file = 0;
+}
+
+/*
+================
+G_LogJSON
+
+Turns a time stamped log line into a JSON object on a line of its own,
+splitting off the leading event name where there is one:
+{"time":83000,"event":"Kill","text":"0 1 10: a killed b by MOD_FLAMER"}
+================
+*/
+static void G_LogJSON( const char *line, char *out, int outSize )
+{
+  const char  *text = line, *p;
+  char        event[ 32 ] = "";
+  int         len;
+
+  // skip the "%3i:%i%i " stamp added by G_LogPrintf, the minutes take
+  // more than three characters after 999 of them
+  if( ( p = strchr( text, ':' ) ) && ( p = strchr( p, ' ' ) ) )
+    text = p + 1;
+
+  for( p = text; isalnum( (unsigned char)*p ) || *p == '_'; p++ );
+  if( *p == ':' && p > text && p - text < sizeof( event ) )
+  {
+    Q_strncpyz( event, text, p - text + 1 );
+    for( text = p + 1; *text == ' '; text++ );
+  }
+
+  Com_sprintf( out, outSize, "{\"time\":%d,\"event\":\"%s\",\"text\":\"",
+    level.time - level.startTime, event );
+  len = strlen( out );
+
+  // leave room for the longest escape and the closing "}\n
+  for( p = text; *p && len < outSize - 10; p++ )
+  {
+    if( *p == '\n' && !p[ 1 ] )
+      break;
+
+    if( *p == '"' || *p == '\\' )
+    {
+      out[ len++ ] = '\\';
+      out[ len++ ] = *p;
+    }
+    else if( (unsigned char)*p < ' ' )
+      len += Com_sprintf( out + len, outSize - len, "\\u%04x", *p );
+    else
+      out[ len++ ] = *p;
+  }
+
+  Q_strncpyz( out + len, "\"}\n", outSize - len );
+}
+
+/*
+================
+G_LogWrite
+
+Appends a decolored, time stamped line to level.logFile
+================
+*/
+void G_LogWrite( const char *line )
+{
+  char          json[ 2048 ];
+  const char    *text = line;
+  unsigned int  len, start, first;
+
+  if( g_logFormat.integer == 1 )
+  {
+    G_LogJSON( line, json, sizeof( json ) );
+    text = json;
+  }
+  len = strlen( text );
+
+  if( !logSink.thread )
+  {
+    FS_Write( text, len, level.logFile );
+    return;
+  }
+
+  Sys_LockMutex( logSink.mutex );
+  while( LOG_BUFFER_SIZE - ( logSink.head - logSink.tail ) < len )
+  {
+    Sys_SignalCond( logSink.flushCond );
+    Sys_WaitCond( logSink.spaceCond, logSink.mutex, -1 );
+  }
+
+  start = logSink.head & ( LOG_BUFFER_SIZE - 1 );
+  first = MIN( len, LOG_BUFFER_SIZE - start );
+  memcpy( logSink.buffer + start, text, first );
+  memcpy( logSink.buffer, text + first, len - first );
+  logSink.head += len;
+
+  if( logSink.head - logSink.tail >= LOG_FLUSH_SIZE )
+    Sys_SignalCond( logSink.flushCond );
+  Sys_UnlockMutex( logSink.mutex );
+}
@@ -103,6 +103,8 @@ vmCvar_t  g_restartingFlags;
 vmCvar_t  g_lockTeamsAtStart;
 vmCvar_t  g_logFile;
 vmCvar_t  g_logFileSync;
+vmCvar_t  g_logFlushTime;
+vmCvar_t  g_logFormat;
 vmCvar_t  g_allowVote;
 vmCvar_t  g_voteLimit;
 vmCvar_t  g_suddenDeathVotePercent;
@@ -284,6 +286,8 @@ static cvarTable_t   gameCvarTable[ ] =
   { &g_alienSpawnCountdown, "g_alienSpawnCountdown", "8", CVAR_ARCHIVE,0,qtrue },
   { &g_logFile, "g_logFile", "games.log", CVAR_ARCHIVE, 0, qfalse  },
   { &g_logFileSync, "g_logFileSync", "0", CVAR_ARCHIVE, 0, qfalse  },
+  { &g_logFlushTime, "g_logFlushTime", "1000", CVAR_ARCHIVE, 0, qfalse  },
+  { &g_logFormat, "g_logFormat", "0", CVAR_ARCHIVE, 0, qfalse  },
 
   { &g_password, "g_password", "", CVAR_USERINFO, 0, qfalse  },
 
@@ -592,6 +596,24 @@ void G_MapConfigs(const char *mapname) {
   Cvar_SetSafe("g_mapConfigsLoaded", va("%d", (mapConfigsLoadedVal + 1)));
 }
 
+static const char *profileZoneNames[ PROFILE_NUM_ZONES ] =
+{
+  "missiles",
+  "buildables",
+  "physics",
+  "movers",
+  "clients",
+  "think",
+  "ClientEndFrame",
+  "G_UnlaggedStore",
+  "G_CalculateBuildPoints",
+  "G_CalculateStages",
+  "CheckExitRules",
+  "Pmove"
+};
+
+int profileZones[ PROFILE_NUM_ZONES ];
+
 /*
 ============
 G_InitGame
@@ -613,8 +635,12 @@ Q_EXPORT void G_InitGame( int levelTime, int randomSeed, int restart )
   // Dynamic memory
   BG_InitMemory( );
 
+  for( i = 0; i < PROFILE_NUM_ZONES; i++ )
+    profileZones[ i ] = SV_ProfileZone( profileZoneNames[ i ] );
+
   // set some level globals
   memset( &level, 0, sizeof( level ) );
+  G_ClearPlayerIndex( );
 
   sl_query( DB_OPEN, "game.db", NULL );
   sl_query( DB_TIME_GET, level.database_data, NULL );
@@ -685,6 +711,8 @@ Q_EXPORT void G_InitGame( int levelTime, int randomSeed, int restart )
       char serverinfo[ MAX_INFO_STRING ];
       qtime_t qt;
 
+      G_LogStart( );
+
       SV_GetServerinfo( serverinfo, sizeof( serverinfo ) );
 
       G_LogPrintf( "------------------------------------------------------------\n" );
@@ -919,6 +947,7 @@ Q_EXPORT void G_ShutdownGame( int restart )
   {
     G_LogPrintf( "ShutdownGame:\n" );
     G_LogPrintf( "------------------------------------------------------------\n" );
+    G_LogStop( );
     FS_FCloseFile( level.logFile );
     level.logFile = 0;
   }
@@ -1307,97 +1336,57 @@ void G_CalculateBuildPoints( void )
     return;
   }
 
-  level.humanBuildPoints = g_humanBuildPoints.integer - level.humanBuildPointQueue;
-  level.alienBuildPoints = g_alienBuildPoints.integer - level.alienBuildPointQueue;
-
-  // Reset buildPointZones
+  // a zone is active while a repeater holds it
   for( i = 0; i < g_humanRepeaterMaxZones.integer; i++ )
   {
     buildPointZone_t *zone = &level.buildPointZones[ i ];
 
-    zone->active = qfalse;
-    zone->totalBuildPoints = g_humanRepeaterBuildPoints.integer;
+    zone->active = zone->holders > 0;
   }
 
-  // Iterate through entities
-  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
-  {
-    gentity_t         *ent = &g_entities[ i ];
-    buildPointZone_t  *zone;
-    buildable_t       buildable;
-    int               cost;
-
-    if( ent->s.eType != ET_BUILDABLE || ent->s.eFlags & EF_DEAD )
-      continue;
+  // the ledgers follow the buildables as they are built, die and
+  // change power, which only needs looking for again when power changed
+  G_RefreshPowerParents( );
 
-    // mark a zone as active
-    if( ent->usesBuildPointZone )
-    {
-      assert( ent->buildPointZone >= 0 && ent->buildPointZone < g_humanRepeaterMaxZones.integer );
-
-      zone = &level.buildPointZones[ ent->buildPointZone ];
-      zone->active = qtrue;
-    }
-
-    // Subtract the BP from the appropriate pool
-    buildable = ent->s.modelindex;
-    cost = BG_Buildable( buildable )->buildPoints;
-
-    if( ent->buildableTeam == TEAM_ALIENS )
-      level.alienBuildPoints -= cost;
-    if( buildable == BA_H_REPEATER )
-      level.humanBuildPoints -= cost;
-    else if( buildable != BA_H_REACTOR )
-    {
-      gentity_t *power = G_PowerEntityForEntity( ent );
+#ifndef NDEBUG
+  {
+    int errors = G_CheckBuildPoints( );
 
-      if( power )
-      {
-        if( power->s.modelindex == BA_H_REACTOR )
-          level.humanBuildPoints -= cost;
-        else if( power->s.modelindex == BA_H_REPEATER && power->usesBuildPointZone )
-          level.buildPointZones[ power->buildPointZone ].totalBuildPoints -= cost;
-      }
-    }
+    assert( !errors );
   }
+#endif
+
+  level.humanBuildPoints = g_humanBuildPoints.integer - level.humanBuildPointQueue -
+                           level.humanBuildPointsUsed;
+  level.alienBuildPoints = g_alienBuildPoints.integer - level.alienBuildPointQueue -
+                           level.alienBuildPointsUsed;
 
   // Finally, update repeater zones and their queues
-  // note that this has to be done after the used BP is calculated
-  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
+  for( i = 0; i < g_humanRepeaterMaxZones.integer; i++ )
   {
-    buildable_t buildable;
-    gentity_t   *ent = &g_entities[ i ];
-
-    if( ent->s.eType != ET_BUILDABLE || ent->s.eFlags & EF_DEAD ||
-        ent->buildableTeam != TEAM_HUMANS )
-      continue;
+    buildPointZone_t *zone = &level.buildPointZones[ i ];
 
-    buildable = ent->s.modelindex;
+    zone->totalBuildPoints = g_humanRepeaterBuildPoints.integer - zone->usedBuildPoints;
 
-    if( buildable != BA_H_REPEATER )
+    if( !zone->active )
       continue;
 
-    if( ent->usesBuildPointZone && level.buildPointZones[ ent->buildPointZone ].active )
+    if( G_TimeTilSuddenDeath( ) > 0 )
     {
-      buildPointZone_t *zone = &level.buildPointZones[ ent->buildPointZone ];
-
-      if( G_TimeTilSuddenDeath( ) > 0 )
+      // BP queue updates
+      while( zone->queuedBuildPoints > 0 &&
+             zone->nextQueueTime < level.time )
       {
-        // BP queue updates
-        while( zone->queuedBuildPoints > 0 &&
-               zone->nextQueueTime < level.time )
-        {
-          zone->queuedBuildPoints--;
-          zone->nextQueueTime += G_NextQueueTime( zone->queuedBuildPoints,
-                                     zone->totalBuildPoints,
-                                     g_humanRepeaterBuildQueueTime.integer );
-        }
-      }
-      else
-      {
-        zone->totalBuildPoints = zone->queuedBuildPoints = 0;
+        zone->queuedBuildPoints--;
+        zone->nextQueueTime += G_NextQueueTime( zone->queuedBuildPoints,
+                                   zone->totalBuildPoints,
+                                   g_humanRepeaterBuildQueueTime.integer );
       }
     }
+    else
+    {
+      zone->totalBuildPoints = zone->queuedBuildPoints = 0;
+    }
   }
 
   if( level.humanBuildPoints < 0 )
@@ -1934,7 +1923,7 @@ void QDECL G_LogPrintf( const char *fmt, ... )
     return;
 
   G_DecolorString( string, decolored, sizeof( decolored ) );
-  FS_Write( decolored, strlen( decolored ), level.logFile );
+  G_LogWrite( decolored );
 }
 
 /*
@@ -3101,6 +3090,7 @@ void CheckCvars(void) {
 
     level.buildPointZones = newZones;
     lastNumZones = g_humanRepeaterMaxZones.integer;
+    G_ResetBuildPoints( );
   }
 
   // adjust settings related to time limit extensions
@@ -3380,13 +3370,17 @@ Q_EXPORT void G_RunFrame( int levelTime )
 
     if( ent->s.eType == ET_MISSILE )
     {
+      SV_ProfileBegin( profileZones[ PROFILE_MISSILES ] );
       G_RunMissile( ent );
+      SV_ProfileEnd( profileZones[ PROFILE_MISSILES ] );
       continue;
     }
 
     if( ent->s.eType == ET_BUILDABLE )
     {
+      SV_ProfileBegin( profileZones[ PROFILE_BUILDABLES ] );
       G_BuildableThink( ent, msec );
+      SV_ProfileEnd( profileZones[ PROFILE_BUILDABLES ] );
       G_Unlagged_Link_To_Store_Data(
         ent,
         (ent->s.modelindex == BA_A_BARRICADE),
@@ -3398,49 +3392,65 @@ Q_EXPORT void G_RunFrame( int levelTime )
 
     if( ent->s.eType == ET_CORPSE || ent->physicsObject )
     {
+      SV_ProfileBegin( profileZones[ PROFILE_PHYSICS ] );
       G_Physics( ent, msec );
+      SV_ProfileEnd( profileZones[ PROFILE_PHYSICS ] );
       G_Unlagged_Link_To_Store_Data(ent, qfalse, qtrue, qfalse, qfalse);
       continue;
     }
 
     if( ent->s.eType == ET_MOVER )
     {
+      SV_ProfileBegin( profileZones[ PROFILE_MOVERS ] );
       G_RunMover( ent );
+      SV_ProfileEnd( profileZones[ PROFILE_MOVERS ] );
       G_Unlagged_Link_To_Store_Data(ent, qfalse, qtrue, qtrue, qfalse);
       continue;
     }
 
     if( i < MAX_CLIENTS )
     {
+      SV_ProfileBegin( profileZones[ PROFILE_CLIENTS ] );
       G_RunClient( ent );
+      SV_ProfileEnd( profileZones[ PROFILE_CLIENTS ] );
       if(ent->client->pers.connected == CON_CONNECTED) {
         G_Unlagged_Link_To_Store_Data(ent, qtrue, qfalse, qfalse, qtrue);
       }
       continue;
     }
 
+    SV_ProfileBegin( profileZones[ PROFILE_THINK ] );
     G_RunThink( ent );
+    SV_ProfileEnd( profileZones[ PROFILE_THINK ] );
   }
 
   // perform final fixups on the players
   ent = &g_entities[ 0 ];
 
+  SV_ProfileBegin( profileZones[ PROFILE_CLIENTENDFRAME ] );
   for( i = 0; i < level.maxclients; i++, ent++ )
   {
     if( ent->inuse )
       ClientEndFrame( ent );
   }
+  SV_ProfileEnd( profileZones[ PROFILE_CLIENTENDFRAME ] );
 
   // save position information for all active clients and other shootable entities
+  SV_ProfileBegin( profileZones[ PROFILE_UNLAGGEDSTORE ] );
   G_UnlaggedStore( );
+  SV_ProfileEnd( profileZones[ PROFILE_UNLAGGEDSTORE ] );
 
   G_CountBuildables( );
   if( IS_WARMUP ||
       !g_doCountdown.integer ||
       level.countdownTime <= level.time )
   {
+    SV_ProfileBegin( profileZones[ PROFILE_BUILDPOINTS ] );
     G_CalculateBuildPoints( );
+    SV_ProfileEnd( profileZones[ PROFILE_BUILDPOINTS ] );
+    SV_ProfileBegin( profileZones[ PROFILE_STAGES ] );
     G_CalculateStages( );
+    SV_ProfileEnd( profileZones[ PROFILE_STAGES ] );
     for(i = 0; i < NUM_TEAMS; i++) {
       BG_List_Foreach(&level.spawn_queue[i], NULL, G_SpawnClients, NULL);
     }
@@ -3478,7 +3488,9 @@ Q_EXPORT void G_RunFrame( int levelTime )
   G_LevelReady( );
 
   // see if it is time to end the level
+  SV_ProfileBegin( profileZones[ PROFILE_CHECKEXITRULES ] );
   CheckExitRules( );
+  SV_ProfileEnd( profileZones[ PROFILE_CHECKEXITRULES ] );
 
   // update to team status?
   CheckTeamStatus( );
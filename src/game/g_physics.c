@@ -271,6 +271,10 @@ void G_Physics( gentity_t *ent, int msec )
   SV_Trace( &tr, ent->r.currentOrigin, ent->r.mins, ent->r.maxs,
     origin, ent->s.number, qfalse, ent->clip_mask, TT_AABB );
 
+  // a buildable that moves can end up nearer to other power
+  if( ent->s.eType == ET_BUILDABLE && !VectorCompare( tr.endpos, ent->r.currentOrigin ) )
+    level.powerParentsValid = qfalse;
+
   VectorCopy( tr.endpos, ent->r.currentOrigin );
 
   if( tr.startsolid )
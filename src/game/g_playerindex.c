@@ -0,0 +1,186 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+
+#include "g_local.h"
+
+/*
+The living players of each team, gathered once a frame the first time a
+buildable looks for a target.  The clients come first in g_entities, so
+by then they have all moved for the frame.  The queries only narrow down
+the candidates, the callers still check each one where it is now.
+*/
+
+typedef struct
+{
+  gentity_t *ent;
+  vec3_t    origin;
+  vec3_t    absmin, absmax;
+  int       contents;
+} indexedPlayer_t;
+
+typedef struct
+{
+  int             framenum;     // level.framenum the index was built in
+  int             numPlayers[ NUM_TEAMS ];
+  indexedPlayer_t players[ NUM_TEAMS ][ MAX_CLIENTS ];
+} playerIndex_t;
+
+static playerIndex_t playerIndex;
+
+/*
+================
+G_ClearPlayerIndex
+
+Forgets the players of the last level
+================
+*/
+void G_ClearPlayerIndex( void )
+{
+  memset( &playerIndex, 0, sizeof( playerIndex ) );
+}
+
+/*
+================
+G_BuildPlayerIndex
+================
+*/
+static void G_BuildPlayerIndex( void )
+{
+  gentity_t       *ent;
+  indexedPlayer_t *player;
+  team_t          team;
+  int             i;
+
+  if( playerIndex.framenum == level.framenum )
+    return;
+
+  playerIndex.framenum = level.framenum;
+  memset( playerIndex.numPlayers, 0, sizeof( playerIndex.numPlayers ) );
+
+  for( i = 0, ent = g_entities; i < level.maxclients; i++, ent++ )
+  {
+    if( !ent->inuse || !ent->client || !ent->r.linked )
+      continue;
+
+    if( ent->client->pers.connected != CON_CONNECTED ||
+        ent->client->sess.spectatorState != SPECTATOR_NOT ||
+        ent->health <= 0 )
+      continue;
+
+    team = ent->client->ps.stats[ STAT_TEAM ];
+    if( team != TEAM_ALIENS && team != TEAM_HUMANS )
+      continue;
+
+    player = &playerIndex.players[ team ][ playerIndex.numPlayers[ team ]++ ];
+    player->ent = ent;
+    VectorCopy( ent->r.currentOrigin, player->origin );
+    VectorCopy( ent->r.absmin, player->absmin );
+    VectorCopy( ent->r.absmax, player->absmax );
+    player->contents = ent->r.contents;
+  }
+}
+
+/*
+================
+G_PlayersInRadius
+
+Fills list with the players of team whose bounding boxes come within
+radius of origin, leaving out those without any of contents unless it
+is 0.  Returns the number of players in list.
+================
+*/
+int G_PlayersInRadius( team_t team, const vec3_t origin, float radius,
+                       int contents, gentity_t **list, int maxList )
+{
+  indexedPlayer_t *player;
+  float           d, distSq;
+  int             i, j, num;
+
+  G_BuildPlayerIndex( );
+
+  num = 0;
+  for( i = 0; i < playerIndex.numPlayers[ team ] && num < maxList; i++ )
+  {
+    player = &playerIndex.players[ team ][ i ];
+
+    if( contents && !( player->contents & contents ) )
+      continue;
+
+    // squared distance from origin to the nearest point of the box
+    distSq = 0.0f;
+    for( j = 0; j < 3; j++ )
+    {
+      if( origin[ j ] < player->absmin[ j ] )
+        d = player->absmin[ j ] - origin[ j ];
+      else if( origin[ j ] > player->absmax[ j ] )
+        d = origin[ j ] - player->absmax[ j ];
+      else
+        continue;
+
+      distSq += d * d;
+    }
+
+    if( distSq > radius * radius )
+      continue;
+
+    list[ num++ ] = player->ent;
+  }
+
+  return num;
+}
+
+/*
+================
+G_PlayersInCone
+
+Fills list with the players of team whose origins are within range of
+apex and no further off dir than minDot allows.  dir must be normalized.
+Returns the number of players in list.
+================
+*/
+int G_PlayersInCone( team_t team, const vec3_t apex, const vec3_t dir,
+                     float range, float minDot, gentity_t **list, int maxList )
+{
+  indexedPlayer_t *player;
+  vec3_t          delta;
+  int             i, num;
+
+  G_BuildPlayerIndex( );
+
+  num = 0;
+  for( i = 0; i < playerIndex.numPlayers[ team ] && num < maxList; i++ )
+  {
+    player = &playerIndex.players[ team ][ i ];
+
+    VectorSubtract( player->origin, apex, delta );
+    if( VectorLength( delta ) > range )
+      continue;
+
+    VectorNormalize( delta );
+    if( DotProduct( delta, dir ) < minDot )
+      continue;
+
+    list[ num++ ] = player->ent;
+  }
+
+  return num;
+}
@@ -129,6 +129,10 @@ typedef enum {
 
 #define DATABASE_DATA_MAX 4096
 
+// returned by sl_query for lookups whose results are printed once the
+// database thread gets to them
+#define DB_QUEUED -1
+
 //playmap
 #define MAX_PLAYMAP_QUEUE_ENTRIES 128
 // individual playmap entry in the queue
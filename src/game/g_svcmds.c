@@ -601,6 +601,11 @@ static void Svcmd_G_MemoryInfo( void ) {
   G_Unlagged_Memory_Info( );
 }
 
+static void Svcmd_CheckPower_f( void )
+{
+  G_CheckPowerGraph( );
+}
+
 struct svcmd
 {
   char     *cmd;
@@ -612,6 +617,7 @@ struct svcmd
   { "advanceMapRotation", qfalse, Svcmd_G_AdvanceMapRotation_f },
   { "alienWin", qfalse, Svcmd_TeamWin_f },
   { "chat", qtrue, Svcmd_MessageWrapper },
+  { "checkPower", qfalse, Svcmd_CheckPower_f },
   { "dumpuser", qfalse, Svcmd_DumpUser_f },
   { "eject", qfalse, Svcmd_EjectClient_f },
   { "entityList", qfalse, Svcmd_EntityList_f },
@@ -1253,6 +1253,8 @@ void SP_target_power(gentity_t *self) {
   }
 
   self->use = Use_target_power;
+
+  G_InvalidatePowerSources( );
 }
 
 void Use_target_creep( gentity_t *self, gentity_t *other, gentity_t *activator ) {
@@ -707,6 +707,7 @@ void G_FreeEntity( gentity_t *ent )
     return;
 
   G_UnlaggedClear( ent );
+  G_PowerGraphUnlink( ent );
   BG_List_Clear(&ent->targeted);
   if(ent->client) {
     ent->client->ps.misc[MISC_ID] = 0;
@@ -0,0 +1,1257 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// null_loadgen.c -- tremload, a null client that is many fake players
+
+#include "../qcommon/q_shared.h"
+#include "../qcommon/qcommon.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+tremload is the dedicated server binary with this file in place of
+null_client.c. It connects lg_clients fake players to the server at
+lg_server, each with a socket of its own, speaking the same netchan and
+usercmd protocol as a real client without parsing more of the snapshots
+than their time. What they do comes from lg_script, a text file with one
+entry per line:
+
+	msec pitch yaw roll forward right up buttons weapon
+	cmd <client command>
+	loop				where the script starts again once it ends
+	# comment
+
+or, with lg_demo set, from the usercmds and commands each client sent
+during a server demo recorded with svrecord.
+
+Once every client is active and lg_warmup seconds have passed the numbers
+are cleared, lg_report then prints snapshot rates and bandwidth per client
+and, with lg_rconPassword set, asks the server for its frame times with
+the profile command. The server needs sv_pure 0, and the clients send a
+packet every frame so sv_fps sets their packet rate. Linux and other
+unix-likes only.
+
+	tremload +set lg_server 127.0.0.1:30720 +set lg_clients 48 \
+		+set lg_rconPassword secret +set lg_duration 60 +lg_start
+*/
+
+#define LG_MAX_COMMANDS		16		// must be a power of two
+#define LG_RESEND_MSEC		1000
+#define LG_HASH_CHARS		32		// all MSG_HashKey looks at
+
+typedef enum {
+	LG_FREE,
+	LG_CHALLENGING,		// sent getchallenge
+	LG_CONNECTING,		// sent connect
+	LG_CONNECTED,		// waiting for the gamestate
+	LG_PRIMED,			// got the gamestate, waiting for a snapshot
+	LG_ACTIVE
+} lgState_t;
+
+typedef struct {
+	lgState_t	state;
+	int			socket;
+	int			qport;
+	int			clientChallenge;
+	int			challenge;
+	int			nextResend;
+
+	netchan_t	netchan;
+	int			serverId;
+	int			checksumFeed;
+	int			clientNum;
+	char		systemInfo[ BIG_INFO_STRING ];
+
+	int			serverMessageSequence;
+	int			serverCommandSequence;
+	char		serverCommands[ MAX_RELIABLE_COMMANDS ][ LG_HASH_CHARS + 1 ];
+	int			reliableSequence;
+	int			reliableAcknowledge;
+	char		reliableCommands[ LG_MAX_COMMANDS ][ MAX_STRING_CHARS ];
+	qboolean	noDelta;
+
+	int			snapshotTime;		// serverTime of the last snapshot
+	int			snapshotRealTime;	// when it came
+	int			cmdTime;			// serverTime of the last usercmd
+	usercmd_t	cmd;
+
+	demoInput_t	*inputs;
+	int			numInputs;
+	int			loop;
+	int			input;
+	int			inputLeft;			// msec until the next input
+
+	// since the measurement window started
+	int			snapshots;
+	int			bytesIn;
+	int			bytesOut;
+	int			dropped;
+} lgClient_t;
+
+static struct {
+	qboolean	running;
+	netadr_t	server;
+	struct sockaddr_in	serverAddr;
+	int			control;			// socket for rcon
+
+	int			numClients;
+	int			numStarted;
+	int			nextStart;
+	int			lastActive;			// when the last client went active
+	int			windowStart;		// 0 until the warmup is over
+	int			quitTime;
+	lgClient_t	clients[ MAX_CLIENTS ];
+
+	demoInput_t	*script;
+	int			numScript;
+	int			scriptLoop;
+
+	demoInput_t	*demoInputs[ MAX_CLIENTS ];
+	int			numDemoInputs[ MAX_CLIENTS ];
+} lg;
+
+static const char *lg_defaultScript =
+	"cmd team auto\n"
+	"cmd class level0\n"
+	"cmd class rifle\n"
+	"loop\n"
+	"1500 0 0 0 127 0 0 0 0\n"
+	"400 0 45 0 127 0 127 0 0\n"
+	"1200 0 90 0 127 -127 0 0 0\n"
+	"300 0 135 0 0 0 0 1 0\n"
+	"1500 10 180 0 127 127 0 1 0\n"
+	"800 0 225 0 -127 0 0 0 0\n"
+	"1000 -10 270 0 127 0 0 0 0\n"
+	"600 0 315 0 0 127 127 0 0\n";
+
+cvar_t	*cl_shownet;
+
+static cvar_t	*lg_server;
+static cvar_t	*lg_clients;
+static cvar_t	*lg_script;
+static cvar_t	*lg_demo;
+static cvar_t	*lg_rconPassword;
+static cvar_t	*lg_duration;
+static cvar_t	*lg_warmup;
+static cvar_t	*lg_connectInterval;
+static cvar_t	*lg_cmdMsec;
+static cvar_t	*lg_name;
+
+static void LG_Stop( void );
+
+/*
+===============================================================================
+
+INPUT
+
+===============================================================================
+*/
+
+/*
+==================
+LG_FreeInputs
+==================
+*/
+static void LG_FreeInputs( void ) {
+	int		i;
+
+	for ( i = 0; i < lg.numScript; i++ ) {
+		if ( lg.script[ i ].command ) {
+			Z_Free( lg.script[ i ].command );
+		}
+	}
+	if ( lg.script ) {
+		Z_Free( lg.script );
+	}
+	lg.script = NULL;
+	lg.numScript = 0;
+
+	SV_DemoFreeInput( lg.demoInputs, lg.numDemoInputs );
+}
+
+/*
+==================
+LG_ParseScript
+
+Turns script text into inputs, returns qfalse if it holds no usercmds
+==================
+*/
+static qboolean LG_ParseScript( const char *name, const char *text ) {
+	char		line[ MAX_STRING_CHARS ];
+	demoInput_t	*input;
+	const char	*end;
+	int			len, lines, numCmds;
+
+	for ( lines = 1, end = text; *end; end++ ) {
+		lines += ( *end == '\n' );
+	}
+
+	lg.script = Z_Malloc( lines * sizeof( *lg.script ) );
+	lg.numScript = 0;
+	lg.scriptLoop = 0;
+	numCmds = 0;
+
+	for ( ; *text; text = end + ( *end == '\n' ) ) {
+		end = strchr( text, '\n' );
+		if ( !end ) {
+			end = text + strlen( text );
+		}
+		len = MIN( end - text, sizeof( line ) - 1 );
+		Com_Memcpy( line, text, len );
+		line[ len ] = '\0';
+
+		Cmd_TokenizeString( line );
+		if ( !Cmd_Argc( ) || Cmd_Argv( 0 )[ 0 ] == '#' ) {
+			continue;
+		}
+
+		if ( !Q_stricmp( Cmd_Argv( 0 ), "loop" ) ) {
+			lg.scriptLoop = lg.numScript;
+			continue;
+		}
+
+		input = &lg.script[ lg.numScript++ ];
+		Com_Memset( input, 0, sizeof( *input ) );
+
+		if ( !Q_stricmp( Cmd_Argv( 0 ), "cmd" ) ) {
+			input->command = CopyString( Cmd_ArgsFrom( 1 ) );
+			continue;
+		}
+
+		input->msec = Com_Clamp( 1, 60000, atoi( Cmd_Argv( 0 ) ) );
+		input->cmd.angles[ PITCH ] = ANGLE2SHORT( atof( Cmd_Argv( 1 ) ) );
+		input->cmd.angles[ YAW ] = ANGLE2SHORT( atof( Cmd_Argv( 2 ) ) );
+		input->cmd.angles[ ROLL ] = ANGLE2SHORT( atof( Cmd_Argv( 3 ) ) );
+		input->cmd.forwardmove = Com_Clamp( -127, 127, atoi( Cmd_Argv( 4 ) ) );
+		input->cmd.rightmove = Com_Clamp( -127, 127, atoi( Cmd_Argv( 5 ) ) );
+		input->cmd.upmove = Com_Clamp( -127, 127, atoi( Cmd_Argv( 6 ) ) );
+		input->cmd.buttons = atoi( Cmd_Argv( 7 ) );
+		input->cmd.weapon = atoi( Cmd_Argv( 8 ) );
+		numCmds++;
+	}
+
+	if ( !numCmds ) {
+		Com_Printf( "%s has no usercmds in it\n", name );
+		return qfalse;
+	}
+
+	if ( lg.scriptLoop >= lg.numScript ) {
+		lg.scriptLoop = 0;
+	}
+	return qtrue;
+}
+
+/*
+==================
+LG_LoadInputs
+==================
+*/
+static qboolean LG_LoadInputs( void ) {
+	char	*text;
+	int		i, numSources, source;
+
+	LG_FreeInputs( );
+
+	if ( lg_demo->string[ 0 ] ) {
+		if ( !SV_DemoLoadInput( lg_demo->string, lg.demoInputs, lg.numDemoInputs ) ) {
+			return qfalse;
+		}
+
+		// give each fake client the input of a client who played
+		for ( i = 0, numSources = 0; i < MAX_CLIENTS; i++ ) {
+			numSources += ( lg.numDemoInputs[ i ] > 0 );
+		}
+		if ( !numSources ) {
+			Com_Printf( "%s has no usercmds in it, it needs to be version 2 or later\n",
+				lg_demo->string );
+			return qfalse;
+		}
+
+		for ( i = 0, source = -1; i < lg.numClients; i++ ) {
+			do {
+				source = ( source + 1 ) % MAX_CLIENTS;
+			} while ( !lg.numDemoInputs[ source ] );
+
+			lg.clients[ i ].inputs = lg.demoInputs[ source ];
+			lg.clients[ i ].numInputs = lg.numDemoInputs[ source ];
+			lg.clients[ i ].loop = 0;
+		}
+
+		Com_Printf( "Playing the input of %d clients from %s\n", numSources, lg_demo->string );
+		return qtrue;
+	}
+
+	if ( lg_script->string[ 0 ] ) {
+		if ( FS_ReadFile( lg_script->string, (void **)&text ) < 0 ) {
+			Com_Printf( "couldn't read %s\n", lg_script->string );
+			return qfalse;
+		}
+		if ( !LG_ParseScript( lg_script->string, text ) ) {
+			FS_FreeFile( text );
+			return qfalse;
+		}
+		FS_FreeFile( text );
+	} else {
+		LG_ParseScript( "the default script", lg_defaultScript );
+	}
+
+	for ( i = 0; i < lg.numClients; i++ ) {
+		lg.clients[ i ].inputs = lg.script;
+		lg.clients[ i ].numInputs = lg.numScript;
+		lg.clients[ i ].loop = lg.scriptLoop;
+	}
+	return qtrue;
+}
+
+/*
+===============================================================================
+
+NETWORK
+
+===============================================================================
+*/
+
+/*
+==================
+LG_OpenSocket
+
+A nonblocking UDP socket that only talks to the server
+==================
+*/
+static int LG_OpenSocket( void ) {
+	int		s;
+
+	s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( s < 0 ) {
+		Com_Printf( "WARNING: LG_OpenSocket: socket: %s\n", strerror( errno ) );
+		return -1;
+	}
+
+	if ( fcntl( s, F_SETFL, fcntl( s, F_GETFL ) | O_NONBLOCK ) < 0 ||
+		connect( s, (struct sockaddr *)&lg.serverAddr, sizeof( lg.serverAddr ) ) < 0 ) {
+		Com_Printf( "WARNING: LG_OpenSocket: %s\n", strerror( errno ) );
+		close( s );
+		return -1;
+	}
+
+	return s;
+}
+
+/*
+==================
+LG_Send
+==================
+*/
+static void LG_Send( lgClient_t *cl, int s, const void *data, int length ) {
+	if ( send( s, data, length, 0 ) < 0 && errno != EAGAIN && errno != ECONNREFUSED ) {
+		Com_DPrintf( "LG_Send: %s\n", strerror( errno ) );
+	}
+
+	if ( cl && lg.windowStart ) {
+		cl->bytesOut += length;
+	}
+}
+
+/*
+==================
+LG_OutOfBandPrint
+==================
+*/
+static void QDECL LG_OutOfBandPrint( lgClient_t *cl, int s, const char *format, ... ) {
+	va_list	argptr;
+	char	string[ MAX_MSGLEN ];
+
+	string[ 0 ] = string[ 1 ] = string[ 2 ] = string[ 3 ] = -1;
+
+	va_start( argptr, format );
+	Q_vsnprintf( string + 4, sizeof( string ) - 4, format, argptr );
+	va_end( argptr );
+
+	LG_Send( cl, s, string, strlen( string ) );
+}
+
+/*
+==================
+LG_SendConnect
+
+Like NET_OutOfBandData, the userinfo is huffman compressed
+==================
+*/
+static void LG_SendConnect( lgClient_t *cl ) {
+	char	info[ MAX_INFO_STRING ];
+	byte	data[ MAX_MSGLEN ];
+	msg_t	msg;
+	int		len;
+
+	info[ 0 ] = '\0';
+	Info_SetValueForKey( info, "name", va( "%s%d", lg_name->string, (int)( cl - lg.clients ) ) );
+	// the game turns away clients without a guid
+	Info_SetValueForKey( info, "cl_guid", va( "%08X%08X%08X%08X", cl->clientChallenge,
+		cl->qport, (int)( cl - lg.clients ), PROTOCOL_VERSION ) );
+	Info_SetValueForKey( info, "rate", "25000" );
+	Info_SetValueForKey( info, "snaps", "40" );
+	Info_SetValueForKey( info, "protocol", va( "%i", PROTOCOL_VERSION ) );
+	Info_SetValueForKey( info, "qport", va( "%i", cl->qport ) );
+	Info_SetValueForKey( info, "challenge", va( "%i", cl->challenge ) );
+
+	data[ 0 ] = data[ 1 ] = data[ 2 ] = data[ 3 ] = 0xff;
+	len = Com_sprintf( (char *)data + 4, sizeof( data ) - 4, "connect \"%s\"", info );
+
+	msg.data = data;
+	msg.cursize = len + 4;
+	Huff_Compress( &msg, 12 );
+	LG_Send( cl, cl->socket, msg.data, msg.cursize );
+}
+
+/*
+==================
+LG_Rcon
+==================
+*/
+static void LG_Rcon( const char *command ) {
+	if ( !lg_rconPassword->string[ 0 ] || lg.control < 0 ) {
+		return;
+	}
+
+	LG_OutOfBandPrint( NULL, lg.control, "rcon %s %s", lg_rconPassword->string, command );
+}
+
+/*
+==================
+LG_AddReliableCommand
+==================
+*/
+static void LG_AddReliableCommand( lgClient_t *cl, const char *text ) {
+	if ( cl->reliableSequence - cl->reliableAcknowledge >= LG_MAX_COMMANDS ) {
+		Com_DPrintf( "lg %d: dropped command %s\n", (int)( cl - lg.clients ), text );
+		return;
+	}
+
+	cl->reliableSequence++;
+	Q_strncpyz( cl->reliableCommands[ cl->reliableSequence & ( LG_MAX_COMMANDS - 1 ) ],
+		text, sizeof( cl->reliableCommands[ 0 ] ) );
+}
+
+/*
+==================
+LG_WritePacket
+
+Sends the unacknowledged commands and the usercmds made since the last
+packet, the way CL_WritePacket does
+==================
+*/
+static void LG_WritePacket( lgClient_t *cl, usercmd_t *cmds, int count ) {
+	byte		data[ MAX_MSGLEN ];
+	byte		packet[ MAX_MSGLEN + 16 ];
+	msg_t		buf, send;
+	usercmd_t	*oldcmd, nullcmd;
+	int			i, key;
+
+	MSG_Init( &buf, data, sizeof( data ) );
+	MSG_Bitstream( &buf );
+
+	MSG_WriteLong( &buf, cl->serverId );
+	MSG_WriteLong( &buf, cl->serverMessageSequence );
+	MSG_WriteLong( &buf, cl->serverCommandSequence );
+
+	for ( i = cl->reliableAcknowledge + 1; i <= cl->reliableSequence; i++ ) {
+		MSG_WriteByte( &buf, clc_clientCommand );
+		MSG_WriteLong( &buf, i );
+		MSG_WriteString( &buf, cl->reliableCommands[ i & ( LG_MAX_COMMANDS - 1 ) ] );
+	}
+
+	if ( count ) {
+		MSG_WriteByte( &buf, cl->noDelta ? clc_moveNoDelta : clc_move );
+		MSG_WriteByte( &buf, count );
+
+		key = cl->checksumFeed ^ cl->serverMessageSequence;
+		key ^= MSG_HashKey( 0, cl->serverCommands[ cl->serverCommandSequence & ( MAX_RELIABLE_COMMANDS - 1 ) ], 32 );
+
+		Com_Memset( &nullcmd, 0, sizeof( nullcmd ) );
+		oldcmd = &nullcmd;
+		for ( i = 0; i < count; i++ ) {
+			MSG_WriteDeltaUsercmdKey( &buf, key, oldcmd, &cmds[ i ] );
+			oldcmd = &cmds[ i ];
+		}
+	}
+
+	MSG_WriteByte( &buf, clc_EOF );
+
+	// the netchan header of Netchan_Transmit, with this client's qport
+	MSG_InitOOB( &send, packet, sizeof( packet ) );
+	MSG_WriteLong( &send, cl->netchan.outgoingSequence );
+	MSG_WriteShort( &send, cl->qport );
+	MSG_WriteLong( &send, NETCHAN_GENCHECKSUM( cl->netchan.challenge, cl->netchan.outgoingSequence ) );
+	MSG_WriteData( &send, buf.data, buf.cursize );
+	cl->netchan.outgoingSequence++;
+
+	LG_Send( cl, cl->socket, send.data, send.cursize );
+}
+
+/*
+==================
+LG_SystemInfoChanged
+==================
+*/
+static void LG_SystemInfoChanged( lgClient_t *cl ) {
+	cl->serverId = atoi( Info_ValueForKey( cl->systemInfo, "sv_serverid" ) );
+}
+
+/*
+==================
+LG_ServerCommand
+
+Follows the few server commands a fake client cares about
+==================
+*/
+static void LG_ServerCommand( lgClient_t *cl, const char *text ) {
+	const char	*cmd;
+	int			index;
+
+	Cmd_TokenizeString( text );
+	cmd = Cmd_Argv( 0 );
+
+	if ( !strcmp( cmd, "disconnect" ) ) {
+		Com_Printf( "lg %d: server disconnected: %s\n", (int)( cl - lg.clients ), Cmd_Argv( 1 ) );
+		close( cl->socket );
+		cl->socket = -1;
+		cl->state = LG_FREE;
+		return;
+	}
+
+	if ( Q_strncmp( cmd, "cs", 2 ) && Q_strncmp( cmd, "bcs", 3 ) ) {
+		return;
+	}
+
+	index = atoi( Cmd_Argv( 1 ) );
+	if ( index != CS_SYSTEMINFO ) {
+		return;
+	}
+
+	if ( !strcmp( cmd, "cs" ) ) {
+		Q_strncpyz( cl->systemInfo, Cmd_Argv( 2 ), sizeof( cl->systemInfo ) );
+		LG_SystemInfoChanged( cl );
+	} else if ( !strcmp( cmd, "bcs0" ) ) {
+		Q_strncpyz( cl->systemInfo, Cmd_Argv( 2 ), sizeof( cl->systemInfo ) );
+	} else if ( !strcmp( cmd, "bcs1" ) ) {
+		Q_strcat( cl->systemInfo, sizeof( cl->systemInfo ), Cmd_Argv( 2 ) );
+	} else if ( !strcmp( cmd, "bcs2" ) ) {
+		Q_strcat( cl->systemInfo, sizeof( cl->systemInfo ), Cmd_Argv( 2 ) );
+		LG_SystemInfoChanged( cl );
+	}
+}
+
+/*
+==================
+LG_ParseGamestate
+==================
+*/
+static void LG_ParseGamestate( lgClient_t *cl, msg_t *msg ) {
+	entityState_t	nullstate, es;
+	int				cmd, index;
+	char			*s;
+
+	cl->serverCommandSequence = MSG_ReadLong( msg );
+
+	while ( 1 ) {
+		cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF ) {
+			break;
+		}
+
+		if ( cmd == svc_configstring ) {
+			index = MSG_ReadShort( msg );
+			s = MSG_ReadBigString( msg );
+			if ( index == CS_SYSTEMINFO ) {
+				Q_strncpyz( cl->systemInfo, s, sizeof( cl->systemInfo ) );
+			}
+		} else if ( cmd == svc_baseline ) {
+			index = MSG_ReadBits( msg, GENTITYNUM_BITS );
+			Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+			MSG_ReadDeltaEntity( 0, msg, &nullstate, &es, index );
+		} else {
+			Com_Printf( "lg %d: bad gamestate command byte %d\n", (int)( cl - lg.clients ), cmd );
+			return;
+		}
+	}
+
+	cl->clientNum = MSG_ReadLong( msg );
+	cl->checksumFeed = MSG_ReadLong( msg );
+	LG_SystemInfoChanged( cl );
+
+	if ( cl->state < LG_PRIMED ) {
+		cl->state = LG_PRIMED;
+	}
+}
+
+/*
+==================
+LG_ParseServerMessage
+
+Reads up to the snapshot, only its time matters
+==================
+*/
+static void LG_ParseServerMessage( lgClient_t *cl, msg_t *msg ) {
+	int		cmd, seq;
+	char	*s;
+
+	MSG_Bitstream( msg );
+
+	cl->reliableAcknowledge = MSG_ReadLong( msg );
+	if ( cl->reliableAcknowledge < cl->reliableSequence - LG_MAX_COMMANDS ) {
+		cl->reliableAcknowledge = cl->reliableSequence;
+	}
+
+	while ( cl->state != LG_FREE ) {
+		if ( msg->readcount > msg->cursize ) {
+			Com_Printf( "lg %d: read past the end of a server message\n", (int)( cl - lg.clients ) );
+			break;
+		}
+
+		cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF ) {
+			break;
+		}
+
+		switch ( cmd ) {
+		case svc_nop:
+			break;
+
+		case svc_serverCommand:
+			seq = MSG_ReadLong( msg );
+			s = MSG_ReadString( msg );
+			if ( seq <= cl->serverCommandSequence ) {
+				break;
+			}
+			cl->serverCommandSequence = seq;
+			Q_strncpyz( cl->serverCommands[ seq & ( MAX_RELIABLE_COMMANDS - 1 ) ], s,
+				sizeof( cl->serverCommands[ 0 ] ) );
+			LG_ServerCommand( cl, s );
+			break;
+
+		case svc_gamestate:
+			LG_ParseGamestate( cl, msg );
+			break;
+
+		case svc_snapshot:
+			cl->snapshotTime = MSG_ReadLong( msg );
+			cl->snapshotRealTime = Sys_Milliseconds( );
+			if ( cl->state == LG_PRIMED ) {
+				cl->state = LG_ACTIVE;
+				cl->cmdTime = cl->snapshotTime;
+				lg.lastActive = cl->snapshotRealTime;
+			}
+			if ( lg.windowStart ) {
+				cl->snapshots++;
+			}
+			return;
+
+		default:
+			// downloads and voip come after the snapshot
+			return;
+		}
+	}
+}
+
+/*
+==================
+LG_ConnectionlessPacket
+==================
+*/
+static void LG_ConnectionlessPacket( lgClient_t *cl, msg_t *msg ) {
+	char	*c;
+
+	MSG_BeginReadingOOB( msg );
+	MSG_ReadLong( msg );	// skip the -1
+
+	Cmd_TokenizeString( MSG_ReadStringLine( msg ) );
+	c = Cmd_Argv( 0 );
+
+	if ( !Q_stricmp( c, "print" ) ) {
+		if ( cl ) {
+			Com_Printf( "lg %d: %s", (int)( cl - lg.clients ), MSG_ReadString( msg ) );
+		} else {
+			Com_Printf( "%s", MSG_ReadString( msg ) );
+		}
+		return;
+	}
+
+	if ( !cl ) {
+		return;
+	}
+
+	if ( !Q_stricmp( c, "challengeResponse" ) && cl->state == LG_CHALLENGING ) {
+		if ( atoi( Cmd_Argv( 2 ) ) != cl->clientChallenge ) {
+			return;
+		}
+		cl->challenge = atoi( Cmd_Argv( 1 ) );
+		cl->state = LG_CONNECTING;
+		cl->nextResend = 0;
+		return;
+	}
+
+	if ( !Q_stricmp( c, "connectResponse" ) && cl->state == LG_CONNECTING ) {
+		if ( atoi( Cmd_Argv( 1 ) ) != cl->challenge ) {
+			return;
+		}
+		Netchan_Setup( 0, NS_CLIENT, &cl->netchan, lg.server, cl->qport, cl->challenge );
+		cl->state = LG_CONNECTED;
+		return;
+	}
+}
+
+/*
+==================
+LG_ReadPackets
+==================
+*/
+static void LG_ReadPackets( lgClient_t *cl, int s ) {
+	byte	data[ MAX_MSGLEN + 16 ];
+	msg_t	msg;
+	int		len;
+
+	while ( s >= 0 ) {
+		len = recv( s, data, sizeof( data ), 0 );
+		if ( len < 0 ) {
+			if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED ) {
+				Com_DPrintf( "LG_ReadPackets: %s\n", strerror( errno ) );
+			}
+			return;
+		}
+
+		MSG_Init( &msg, data, sizeof( data ) );
+		msg.cursize = len;
+
+		if ( len >= 4 && *(int *)data == -1 ) {
+			LG_ConnectionlessPacket( cl, &msg );
+			continue;
+		}
+
+		if ( !cl || cl->state < LG_CONNECTED || len < 4 ) {
+			continue;
+		}
+
+		if ( lg.windowStart ) {
+			cl->bytesIn += len;
+		}
+
+		if ( !Netchan_Process( &cl->netchan, &msg ) ) {
+			continue;
+		}
+		if ( lg.windowStart ) {
+			cl->dropped += cl->netchan.dropped;
+		}
+		cl->noDelta = ( cl->netchan.dropped > 0 );
+		cl->serverMessageSequence = LittleLong( *(int *)msg.data );
+
+		LG_ParseServerMessage( cl, &msg );
+		s = cl->socket;
+	}
+}
+
+/*
+===============================================================================
+
+CLIENTS
+
+===============================================================================
+*/
+
+/*
+==================
+LG_AdvanceInput
+
+Steps the input on by msec, sending the commands passed on the way
+==================
+*/
+static void LG_AdvanceInput( lgClient_t *cl, int msec ) {
+	int		steps;
+
+	cl->inputLeft -= msec;
+	for ( steps = 0; cl->inputLeft <= 0 && steps <= cl->numInputs; steps++ ) {
+		if ( ++cl->input >= cl->numInputs ) {
+			cl->input = cl->loop;
+		}
+
+		if ( cl->inputs[ cl->input ].command ) {
+			LG_AddReliableCommand( cl, cl->inputs[ cl->input ].command );
+		} else {
+			cl->inputLeft += cl->inputs[ cl->input ].msec;
+		}
+	}
+}
+
+/*
+==================
+LG_StartClient
+==================
+*/
+static void LG_StartClient( lgClient_t *cl ) {
+	demoInput_t	*inputs = cl->inputs;
+	int			numInputs = cl->numInputs, loop = cl->loop;
+	int			num = cl - lg.clients;
+
+	Com_Memset( cl, 0, sizeof( *cl ) );
+	cl->inputs = inputs;
+	cl->numInputs = numInputs;
+	cl->loop = loop;
+	cl->input = -1;
+	cl->socket = LG_OpenSocket( );
+	if ( cl->socket < 0 ) {
+		return;
+	}
+
+	cl->qport = ( Com_Milliseconds( ) + num * 7919 ) & 0xffff;
+	cl->clientChallenge = ( ( rand( ) << 16 ) ^ rand( ) ) ^ Com_Milliseconds( );
+	cl->state = LG_CHALLENGING;
+}
+
+/*
+==================
+LG_ClientFrame
+==================
+*/
+static void LG_ClientFrame( lgClient_t *cl, int now ) {
+	usercmd_t	cmds[ MAX_PACKET_USERCMDS ];
+	int			count, serverTime, cmdMsec;
+
+	switch ( cl->state ) {
+	case LG_FREE:
+		return;
+
+	case LG_CHALLENGING:
+		if ( now >= cl->nextResend ) {
+			LG_OutOfBandPrint( cl, cl->socket, "getchallenge %d %s", cl->clientChallenge, com_gamename->string );
+			cl->nextResend = now + LG_RESEND_MSEC;
+		}
+		return;
+
+	case LG_CONNECTING:
+		if ( now >= cl->nextResend ) {
+			LG_SendConnect( cl );
+			cl->nextResend = now + LG_RESEND_MSEC;
+		}
+		return;
+
+	case LG_CONNECTED:
+		// keep acknowledging until the whole gamestate is in
+		LG_WritePacket( cl, NULL, 0 );
+		return;
+
+	case LG_PRIMED:
+		// any usercmd takes the client into the world
+		cl->cmd.serverTime = ++cl->cmdTime;
+		LG_WritePacket( cl, &cl->cmd, 1 );
+		return;
+
+	case LG_ACTIVE:
+		break;
+	}
+
+	if ( cl->input < 0 ) {
+		// spread the clients out over the script
+		cl->inputLeft = 0;
+		LG_AdvanceInput( cl, 0 );
+		LG_AdvanceInput( cl, ( cl - lg.clients ) * 137 );
+	}
+
+	// run the clock on from the last snapshot, like cl.serverTime
+	serverTime = cl->snapshotTime + now - cl->snapshotRealTime;
+	cmdMsec = Com_Clamp( 1, 100, lg_cmdMsec->integer );
+
+	for ( count = 0; count < MAX_PACKET_USERCMDS && cl->cmdTime + cmdMsec <= serverTime; count++ ) {
+		cl->cmdTime += cmdMsec;
+		cl->cmd = cl->inputs[ cl->input ].cmd;
+		cl->cmd.serverTime = cl->cmdTime;
+		cmds[ count ] = cl->cmd;
+		LG_AdvanceInput( cl, cmdMsec );
+	}
+	if ( cl->cmdTime + cmdMsec <= serverTime ) {
+		// fell too far behind to catch up
+		cl->cmdTime = serverTime;
+	}
+
+	LG_WritePacket( cl, cmds, count );
+}
+
+/*
+==================
+LG_ClearStats
+==================
+*/
+static void LG_ClearStats( void ) {
+	lgClient_t	*cl;
+	int			i;
+
+	for ( i = 0, cl = lg.clients; i < lg.numClients; i++, cl++ ) {
+		cl->snapshots = 0;
+		cl->bytesIn = 0;
+		cl->bytesOut = 0;
+		cl->dropped = 0;
+	}
+
+	lg.windowStart = Sys_Milliseconds( );
+	LG_Rcon( "sv_profile 1" );
+	LG_Rcon( "profile reset" );
+}
+
+/*
+==================
+LG_Report_f
+
+Prints what the clients got since the warmup ended
+==================
+*/
+static void LG_Report_f( void ) {
+	lgClient_t	*cl;
+	float		seconds, value[ 3 ], total[ 3 ], low[ 3 ], high[ 3 ];
+	const char	*names[ 3 ] = { "snapshots/s", "KB/s down", "KB/s up" };
+	int			i, j, active, dropped;
+
+	if ( !lg.running ) {
+		Com_Printf( "tremload isn't running\n" );
+		return;
+	}
+
+	if ( !lg.windowStart ) {
+		Com_Printf( "Still warming up\n" );
+		return;
+	}
+
+	seconds = ( Sys_Milliseconds( ) - lg.windowStart ) / 1000.0f;
+	if ( seconds <= 0.0f ) {
+		seconds = 0.001f;
+	}
+
+	active = dropped = 0;
+	for ( j = 0; j < 3; j++ ) {
+		total[ j ] = 0.0f;
+		low[ j ] = 1e9f;
+		high[ j ] = 0.0f;
+	}
+
+	for ( i = 0, cl = lg.clients; i < lg.numClients; i++, cl++ ) {
+		if ( cl->state != LG_ACTIVE ) {
+			continue;
+		}
+
+		value[ 0 ] = cl->snapshots / seconds;
+		value[ 1 ] = cl->bytesIn / 1024.0f / seconds;
+		value[ 2 ] = cl->bytesOut / 1024.0f / seconds;
+		for ( j = 0; j < 3; j++ ) {
+			total[ j ] += value[ j ];
+			low[ j ] = MIN( low[ j ], value[ j ] );
+			high[ j ] = MAX( high[ j ], value[ j ] );
+		}
+		dropped += cl->dropped;
+		active++;
+	}
+
+	Com_Printf( "%d of %d clients active over %.1f seconds\n", active, lg.numClients, seconds );
+	if ( !active ) {
+		return;
+	}
+
+	Com_Printf( "%-16s %8s %8s %8s %10s\n", "per client", "avg", "min", "max", "total" );
+	for ( j = 0; j < 3; j++ ) {
+		Com_Printf( "%-16s %8.2f %8.2f %8.2f %10.2f\n", names[ j ],
+			total[ j ] / active, low[ j ], high[ j ], total[ j ] );
+	}
+	Com_Printf( "%d server packets dropped\n", dropped );
+
+	if ( lg_rconPassword->string[ 0 ] ) {
+		LG_Rcon( "profile" );
+	} else {
+		Com_Printf( "set lg_rconPassword for the server's frame times\n" );
+	}
+}
+
+/*
+==================
+LG_Start_f
+
+lg_start [clients]
+==================
+*/
+static void LG_Start_f( void ) {
+	int		count;
+
+	if ( lg.running ) {
+		Com_Printf( "tremload is already running, lg_stop first\n" );
+		return;
+	}
+
+	count = Cmd_Argc( ) > 1 ? atoi( Cmd_Argv( 1 ) ) : lg_clients->integer;
+	lg.numClients = Com_Clamp( 1, MAX_CLIENTS, count );
+
+	if ( !NET_StringToAdr( lg_server->string, &lg.server, NA_IP ) ) {
+		Com_Printf( "Bad server address %s\n", lg_server->string );
+		return;
+	}
+	if ( lg.server.type == NA_LOOPBACK ) {
+		NET_StringToAdr( "127.0.0.1", &lg.server, NA_IP );
+	}
+	if ( lg.server.type != NA_IP ) {
+		Com_Printf( "tremload only speaks IPv4\n" );
+		return;
+	}
+	if ( !lg.server.port ) {
+		lg.server.port = BigShort( PORT_SERVER );
+	}
+
+	Com_Memset( &lg.serverAddr, 0, sizeof( lg.serverAddr ) );
+	lg.serverAddr.sin_family = AF_INET;
+	lg.serverAddr.sin_port = lg.server.port;
+	Com_Memcpy( &lg.serverAddr.sin_addr, lg.server.ip, 4 );
+
+	if ( !LG_LoadInputs( ) ) {
+		return;
+	}
+
+	lg.control = LG_OpenSocket( );
+	lg.numStarted = 0;
+	lg.nextStart = 0;
+	lg.lastActive = 0;
+	lg.windowStart = 0;
+	lg.quitTime = 0;
+	lg.running = qtrue;
+
+	Com_Printf( "Connecting %d clients to %s\n", lg.numClients, NET_AdrToString( lg.server ) );
+}
+
+/*
+==================
+LG_Stop
+==================
+*/
+static void LG_Stop( void ) {
+	lgClient_t	*cl;
+	int			i, j;
+
+	if ( !lg.running ) {
+		return;
+	}
+
+	for ( i = 0, cl = lg.clients; i < lg.numStarted; i++, cl++ ) {
+		if ( cl->state >= LG_CONNECTED ) {
+			// like CL_Disconnect, send it a few times in case one is lost
+			LG_AddReliableCommand( cl, "disconnect" );
+			for ( j = 0; j < 3; j++ ) {
+				LG_WritePacket( cl, NULL, 0 );
+			}
+		}
+
+		if ( cl->socket >= 0 ) {
+			close( cl->socket );
+		}
+		cl->socket = -1;
+		cl->state = LG_FREE;
+	}
+
+	if ( lg.control >= 0 ) {
+		close( lg.control );
+	}
+	lg.control = -1;
+	lg.running = qfalse;
+
+	LG_FreeInputs( );
+}
+
+/*
+==================
+LG_Stop_f
+==================
+*/
+static void LG_Stop_f( void ) {
+	if ( !lg.running ) {
+		Com_Printf( "tremload isn't running\n" );
+		return;
+	}
+
+	LG_Stop( );
+	Com_Printf( "Disconnected all clients\n" );
+}
+
+/*
+==================
+LG_Frame
+==================
+*/
+static void LG_Frame( void ) {
+	lgClient_t	*cl;
+	int			i, now, active;
+
+	now = Sys_Milliseconds( );
+
+	if ( lg.quitTime ) {
+		if ( now >= lg.quitTime ) {
+			lg.quitTime = 0;
+			if ( lg.control >= 0 ) {
+				close( lg.control );
+				lg.control = -1;
+			}
+			Cbuf_AddText( "quit\n" );
+		}
+		LG_ReadPackets( NULL, lg.control );
+		return;
+	}
+
+	if ( !lg.running ) {
+		return;
+	}
+
+	LG_ReadPackets( NULL, lg.control );
+
+	if ( lg.numStarted < lg.numClients && now >= lg.nextStart ) {
+		LG_StartClient( &lg.clients[ lg.numStarted++ ] );
+		lg.nextStart = now + lg_connectInterval->integer;
+	}
+
+	for ( i = 0, active = 0, cl = lg.clients; i < lg.numStarted; i++, cl++ ) {
+		LG_ReadPackets( cl, cl->socket );
+		LG_ClientFrame( cl, now );
+		active += ( cl->state == LG_ACTIVE );
+	}
+
+	if ( !lg.windowStart ) {
+		if ( active == lg.numClients && now - lg.lastActive >= lg_warmup->value * 1000 ) {
+			Com_Printf( "All %d clients active, measuring\n", active );
+			LG_ClearStats( );
+		}
+		return;
+	}
+
+	if ( lg_duration->integer > 0 && now - lg.windowStart >= lg_duration->integer * 1000 ) {
+		LG_Report_f( );
+		LG_Stop( );
+
+		// give the server's profile a moment to come back
+		lg.control = LG_OpenSocket( );
+		LG_Rcon( "profile" );
+		lg.quitTime = now + 1000;
+	}
+}
+
+/*
+===============================================================================
+
+NULL CLIENT
+
+===============================================================================
+*/
+
+void CL_Shutdown(char *finalmsg, qboolean disconnect, qboolean quit)
+{
+	LG_Stop( );
+}
+
+void CL_Init( void ) {
+	cl_shownet = Cvar_Get ("cl_shownet", "0", CVAR_TEMP );
+
+	lg_server = Cvar_Get( "lg_server", "127.0.0.1", 0 );
+	lg_clients = Cvar_Get( "lg_clients", "16", 0 );
+	lg_script = Cvar_Get( "lg_script", "", 0 );
+	lg_demo = Cvar_Get( "lg_demo", "", 0 );
+	lg_rconPassword = Cvar_Get( "lg_rconPassword", "", CVAR_TEMP );
+	lg_duration = Cvar_Get( "lg_duration", "0", 0 );
+	lg_warmup = Cvar_Get( "lg_warmup", "5", 0 );
+	lg_connectInterval = Cvar_Get( "lg_connectInterval", "250", 0 );
+	lg_cmdMsec = Cvar_Get( "lg_cmdMsec", "8", 0 );
+	lg_name = Cvar_Get( "lg_name", "lg", 0 );
+
+	Cmd_AddCommand( "lg_start", LG_Start_f );
+	Cmd_AddCommand( "lg_stop", LG_Stop_f );
+	Cmd_AddCommand( "lg_report", LG_Report_f );
+
+	lg.control = -1;
+}
+
+void CL_MouseEvent( int dx, int dy, int time ) {
+}
+
+void Key_WriteBindings( fileHandle_t f ) {
+}
+
+void CL_Frame ( int msec ) {
+	LG_Frame( );
+}
+
+void CL_PacketEvent( netadr_t from, msg_t *msg ) {
+}
+
+void CL_CharEvent( int key ) {
+}
+
+void CL_Disconnect( qboolean showMainMenu ) {
+}
+
+void CL_MapLoading( void ) {
+}
+
+qboolean CL_GameCommand( void ) {
+  return qfalse;
+}
+
+void CL_KeyEvent (int key, qboolean down, unsigned time) {
+}
+
+qboolean UI_GameCommand( void ) {
+	return qfalse;
+}
+
+void CL_ForwardCommandToServer( const char *string ) {
+}
+
+void CL_ConsolePrint( char *txt ) {
+}
+
+void CL_JoystickEvent( int axis, int value, int time ) {
+}
+
+void CL_InitKeyCommands( void ) {
+}
+
+void CL_CDDialog( void ) {
+}
+
+void CL_FlushMemory(void)
+{
+}
+
+void CL_ShutdownAll(qboolean shutdownRef)
+{
+}
+
+void CL_StartHunkUsers( qboolean rendererOnly ) {
+}
+
+void CL_InitRef(void)
+{
+}
+
+void CL_Snd_Shutdown(void)
+{
+}
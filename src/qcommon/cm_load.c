@@ -64,6 +64,7 @@ byte		*cmod_base;
 cvar_t		*cm_noAreas;
 cvar_t		*cm_noCurves;
 cvar_t		*cm_playerCurveClip;
+cvar_t		*cm_simdTrace;
 #endif
 
 cmodel_t	box_model;
@@ -226,6 +227,66 @@ void CM_BoundBrush( cbrush_t *b ) {
 }
 
 
+/*
+=================
+CM_BrushPlanes4
+
+Copies the planes of a brush into ( numsides + 3 ) / 4 blocks of four for
+the SIMD path of CM_TraceThroughBrush. The unused lanes of the last block
+get a plane that everything is behind, so they never matter to a trace.
+=================
+*/
+void CM_BrushPlanes4( cbrush_t *b, cplanes4_t *out ) {
+	cplane_t	*plane;
+	int			j, k, lane;
+
+	for ( j = 0; j < ( b->numsides + 3 ) / 4 * 4; j++ ) {
+		lane = j & 3;
+		if ( j < b->numsides ) {
+			plane = b->sides[ j ].plane;
+			for ( k = 0; k < 3; k++ ) {
+				out->normal[ k ][ lane ] = plane->normal[ k ];
+				out->signs[ k ][ lane ] = ( plane->signbits & ( 1 << k ) ) ? ~0 : 0;
+			}
+			out->dist[ lane ] = plane->dist;
+		} else {
+			for ( k = 0; k < 3; k++ ) {
+				out->normal[ k ][ lane ] = 0;
+				out->signs[ k ][ lane ] = 0;
+			}
+			out->dist[ lane ] = 1e30f;
+		}
+
+		if ( lane == 3 ) {
+			out++;
+		}
+	}
+}
+
+/*
+=================
+CMod_LoadBrushPlanes4
+=================
+*/
+static void CMod_LoadBrushPlanes4( void ) {
+	cbrush_t	*b;
+	cplanes4_t	*out;
+	int			i, count;
+
+	count = 0;
+	for ( i = 0, b = cm.brushes; i < cm.numBrushes; i++, b++ ) {
+		count += ( b->numsides + 3 ) / 4;
+	}
+
+	out = Hunk_Alloc( count * sizeof( *out ), h_high );
+
+	for ( i = 0, b = cm.brushes; i < cm.numBrushes; i++, b++ ) {
+		b->planes4 = out;
+		CM_BrushPlanes4( b, out );
+		out += ( b->numsides + 3 ) / 4;
+	}
+}
+
 /*
 =================
 CMod_LoadBrushes
@@ -261,6 +322,7 @@ void CMod_LoadBrushes( lump_t *l ) {
 		CM_BoundBrush( out );
 	}
 
+	CMod_LoadBrushPlanes4( );
 }
 
 /*
@@ -732,6 +794,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	cm_noAreas = Cvar_Get ("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves = Cvar_Get ("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get ("cm_playerCurveClip", "1", CVAR_ARCHIVE|CVAR_CHEAT );
+	cm_simdTrace = Cvar_Get ("cm_simdTrace", "1", 0);
 #endif
 	Com_DPrintf( "CM_LoadMap( %s, %i )\n", name, clientload );
 
@@ -757,7 +820,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// load the file
 	//
 #ifndef BSPC
-	length = FS_ReadFile( name, &buf.v );
+	length = FS_ReadFileView( name, (const void **)&buf.v );
 #else
 	length = LoadQuakeFile((quakefile_t *) name, &buf.v);
 #endif
@@ -798,7 +861,11 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	CMod_CreateBrushSideWindings( );
 
 	// we are NOT freeing the file, because it is cached for the ref
+#ifndef BSPC
+	FS_FreeFileView (buf.v);
+#else
 	FS_FreeFile (buf.v);
+#endif
 
 	CM_InitBoxHull ();
 
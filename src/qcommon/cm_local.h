@@ -66,6 +66,13 @@ typedef struct {
 	winding_t			*winding;
 } cbrushside_t;
 
+// the planes of a brush four at a time, laid out for SIMD loads
+typedef struct {
+	float		normal[3][4];
+	float		dist[4];
+	int			signs[3][4];	// ~0 where the normal is negative, picks size[1]
+} cplanes4_t;
+
 typedef struct {
 	int			shaderNum;		// the shader that determined the contents
 	int			contents;
@@ -76,6 +83,7 @@ typedef struct {
 	qboolean	collided; // marker for optimisation
 	cbrushedge_t	*edges;
 	int						numEdges;
+	cplanes4_t	*planes4;		// ( numsides + 3 ) / 4 blocks, NULL for the box brush
 } cbrush_t;
 
 
@@ -152,6 +160,7 @@ extern	int			c_traces, c_brush_traces, c_patch_traces;
 extern	cvar_t		*cm_noAreas;
 extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
+extern	cvar_t		*cm_simdTrace;
 
 // cm_test.c
 
@@ -209,6 +218,10 @@ cmodel_t	*CM_ClipHandleToModel( clipHandle_t handle );
 qboolean CM_BoundsIntersect( const vec3_t mins, const vec3_t maxs, const vec3_t mins2, const vec3_t maxs2 );
 qboolean CM_BoundsIntersectPoint( const vec3_t mins, const vec3_t maxs, const vec3_t point );
 
+// cm_load.c
+
+void CM_BrushPlanes4( cbrush_t *b, cplanes4_t *out );
+
 // cm_patch.c
 
 struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, vec3_t *points );
@@ -23,6 +23,11 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 */
 #include "cm_local.h"
 
+#if idx64 && defined( __SSE2__ )
+#include <emmintrin.h>
+#define CM_SIMD_TRACE
+#endif
+
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
 // always use capsule vs. capsule collision and never capsule vs. bbox or vice versa
@@ -475,6 +480,124 @@ void CM_TraceThroughPatch( traceWork_t *tw, cPatch_t *patch ) {
 	}
 }
 
+#ifdef CM_SIMD_TRACE
+/*
+================
+CM_TraceThroughPlanes4
+
+The box part of CM_TraceThroughBrush, four planes of the brush at a time.
+The distances use the same operations in the same order as the plane by
+plane loop, and the fractions of the planes that are crossed are still
+worked out one plane at a time in order, so the trace comes out the same.
+Returns qfalse if the trace is completely in front of one of the planes.
+================
+*/
+static qboolean CM_TraceThroughPlanes4( traceWork_t *tw, cbrush_t *brush,
+	float *enterFrac, float *leaveFrac, cplane_t **clipplane, cbrushside_t **leadside,
+	qboolean *getout, qboolean *startout ) {
+	int			i, lane, blocks;
+	int			crossing, outside;
+	cplanes4_t	*p;
+	__m128		size0[3], size1[3], start[3], end[3];
+	__m128		mask, offset, zero, epsilon;
+	__m128		dist, d1, d2, out1, out2;
+	float		d1s[4], d2s[4];
+	float		f;
+
+	for ( i = 0; i < 3; i++ ) {
+		size0[i] = _mm_set1_ps( tw->size[0][i] );
+		size1[i] = _mm_set1_ps( tw->size[1][i] );
+		start[i] = _mm_set1_ps( tw->start[i] );
+		end[i] = _mm_set1_ps( tw->end[i] );
+	}
+	zero = _mm_setzero_ps( );
+	epsilon = _mm_set1_ps( SURFACE_CLIP_EPSILON );
+
+	blocks = ( brush->numsides + 3 ) / 4;
+	for ( i = 0, p = brush->planes4; i < blocks; i++, p++ ) {
+		// dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal )
+		mask = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)p->signs[0] ) );
+		offset = _mm_or_ps( _mm_and_ps( mask, size1[0] ), _mm_andnot_ps( mask, size0[0] ) );
+		dist = _mm_mul_ps( offset, _mm_loadu_ps( p->normal[0] ) );
+		mask = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)p->signs[1] ) );
+		offset = _mm_or_ps( _mm_and_ps( mask, size1[1] ), _mm_andnot_ps( mask, size0[1] ) );
+		dist = _mm_add_ps( dist, _mm_mul_ps( offset, _mm_loadu_ps( p->normal[1] ) ) );
+		mask = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)p->signs[2] ) );
+		offset = _mm_or_ps( _mm_and_ps( mask, size1[2] ), _mm_andnot_ps( mask, size0[2] ) );
+		dist = _mm_add_ps( dist, _mm_mul_ps( offset, _mm_loadu_ps( p->normal[2] ) ) );
+		dist = _mm_sub_ps( _mm_loadu_ps( p->dist ), dist );
+
+		d1 = _mm_mul_ps( start[0], _mm_loadu_ps( p->normal[0] ) );
+		d1 = _mm_add_ps( d1, _mm_mul_ps( start[1], _mm_loadu_ps( p->normal[1] ) ) );
+		d1 = _mm_add_ps( d1, _mm_mul_ps( start[2], _mm_loadu_ps( p->normal[2] ) ) );
+		d1 = _mm_sub_ps( d1, dist );
+
+		d2 = _mm_mul_ps( end[0], _mm_loadu_ps( p->normal[0] ) );
+		d2 = _mm_add_ps( d2, _mm_mul_ps( end[1], _mm_loadu_ps( p->normal[1] ) ) );
+		d2 = _mm_add_ps( d2, _mm_mul_ps( end[2], _mm_loadu_ps( p->normal[2] ) ) );
+		d2 = _mm_sub_ps( d2, dist );
+
+		out1 = _mm_cmpgt_ps( d1, zero );
+		out2 = _mm_cmpgt_ps( d2, zero );
+		crossing = _mm_movemask_ps( _mm_or_ps( out1, out2 ) );
+
+		// completely in front of a face, but the planes before it
+		// may still have marked the brush
+		outside = _mm_movemask_ps( _mm_and_ps( out1,
+			_mm_or_ps( _mm_cmpge_ps( d2, epsilon ), _mm_cmpge_ps( d2, d1 ) ) ) );
+		if ( outside ) {
+			if ( crossing & ( ( outside & -outside ) - 1 ) ) {
+				brush->collided = qtrue;
+			}
+			return qfalse;
+		}
+
+		if ( !crossing ) {
+			continue;
+		}
+
+		if ( _mm_movemask_ps( out2 ) ) {
+			*getout = qtrue;	// endpoint is not in solid
+		}
+		if ( _mm_movemask_ps( out1 ) ) {
+			*startout = qtrue;
+		}
+
+		brush->collided = qtrue;
+
+		_mm_storeu_ps( d1s, d1 );
+		_mm_storeu_ps( d2s, d2 );
+		for ( lane = 0; lane < 4; lane++ ) {
+			if ( !( crossing & ( 1 << lane ) ) ) {
+				continue;
+			}
+
+			if ( d1s[lane] > d2s[lane] ) {	// enter
+				f = (d1s[lane]-SURFACE_CLIP_EPSILON) / (d1s[lane]-d2s[lane]);
+				if ( f < 0 ) {
+					f = 0;
+				}
+				if ( f > *enterFrac ) {
+					*enterFrac = f;
+					*leadside = brush->sides + i * 4 + lane;
+					*clipplane = (*leadside)->plane;
+				}
+			} else {	// leave
+				f = (d1s[lane]+SURFACE_CLIP_EPSILON) / (d1s[lane]-d2s[lane]);
+				if ( f > 1 ) {
+					f = 1;
+				}
+				if ( f < *leaveFrac ) {
+					*leaveFrac = f;
+				}
+			}
+		}
+	}
+
+	return qtrue;
+}
+#endif
+
 /*
 ================
 CM_TraceThroughBrush
@@ -640,6 +763,13 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 				}
 			}
 		}
+#ifdef CM_SIMD_TRACE
+	} else if ( brush->planes4 && cm_simdTrace->integer ) {
+		if ( !CM_TraceThroughPlanes4( tw, brush, &enterFrac, &leaveFrac,
+			&clipplane, &leadside, &getout, &startout ) ) {
+			return;
+		}
+#endif
 	} else {
 		//
 		// compare the trace against all planes of the brush
@@ -729,6 +859,197 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 	}
 }
 
+#ifdef CM_SIMD_TRACE
+#define TRACETEST_MAX_SIDES		16
+
+/*
+================
+CM_TraceTestRandom
+
+A random coordinate in [-range, range], quantised to 1/8 unit half the time
+like the brushes and boxes of real maps
+================
+*/
+static float CM_TraceTestRandom( int *seed, float range ) {
+	float	v = Q_crandom( seed ) * range;
+
+	if ( Q_rand( seed ) & 1 ) {
+		v = floor( v * 8.0f + 0.5f ) / 8.0f;
+	}
+
+	return v;
+}
+
+/*
+================
+CM_TraceTestBrush
+
+Builds a random brush around origin: an axial box, like the first six
+sides of every map brush, plus a few skewed planes cutting it
+================
+*/
+static void CM_TraceTestBrush( int *seed, cbrush_t *brush, cbrushside_t *sides,
+	cplane_t *planes, const vec3_t origin ) {
+	int		i, j;
+	vec3_t	point;
+
+	Com_Memset( brush, 0, sizeof( *brush ) );
+	brush->sides = sides;
+	brush->numsides = 6 + ( Q_rand( seed ) & 0x7fffffff ) % ( TRACETEST_MAX_SIDES - 5 );
+	brush->contents = CONTENTS_SOLID | ( ( Q_rand( seed ) & 1 ) ? CONTENTS_PLAYERCLIP : 0 );
+
+	for ( i = 0; i < brush->numsides; i++ ) {
+		Com_Memset( &planes[ i ], 0, sizeof( planes[ i ] ) );
+
+		if ( i < 6 ) {
+			planes[ i ].normal[ i >> 1 ] = ( i & 1 ) ? 1.0f : -1.0f;
+			planes[ i ].dist = DotProduct( origin, planes[ i ].normal ) +
+				fabs( CM_TraceTestRandom( seed, 128.0f ) ) + 1.0f;
+			planes[ i ].type = i >> 1;
+		} else {
+			for ( j = 0; j < 3; j++ ) {
+				planes[ i ].normal[ j ] = Q_crandom( seed );
+				point[ j ] = origin[ j ] + CM_TraceTestRandom( seed, 64.0f );
+			}
+			if ( VectorNormalize( planes[ i ].normal ) == 0.0f ) {
+				planes[ i ].normal[ 2 ] = 1.0f;
+			}
+			planes[ i ].dist = DotProduct( point, planes[ i ].normal );
+			planes[ i ].type = PLANE_NON_AXIAL;
+		}
+		SetPlaneSignbits( &planes[ i ] );
+
+		sides[ i ].plane = &planes[ i ];
+		sides[ i ].planeNum = i;
+		sides[ i ].surfaceFlags = Q_rand( seed ) & 0xff;
+	}
+}
+
+/*
+================
+CM_TraceTestBox
+
+Sets up a box trace the way CM_Trace does, with the box centred on the
+trace and its offsets picked by plane signbits
+================
+*/
+static void CM_TraceTestBox( traceWork_t *tw, const vec3_t start, const vec3_t end,
+	const vec3_t halfSize ) {
+	int		i, j;
+
+	Com_Memset( tw, 0, sizeof( *tw ) );
+	tw->type = TT_AABB;
+	tw->trace.fraction = 1;
+	VectorCopy( start, tw->start );
+	VectorCopy( end, tw->end );
+
+	for ( i = 0; i < 3; i++ ) {
+		tw->size[0][i] = -halfSize[i];
+		tw->size[1][i] = halfSize[i];
+	}
+
+	for ( i = 0; i < 8; i++ ) {
+		for ( j = 0; j < 3; j++ ) {
+			tw->offsets[i][j] = tw->size[ ( i >> j ) & 1 ][j];
+		}
+	}
+}
+#endif
+
+/*
+================
+CM_TraceTest_f
+
+cm_traceTest [n]
+
+Runs n random box traces through random brushes with both the plane by
+plane loop and CM_TraceThroughPlanes4, and fails on the first trace that
+does not come out the same
+================
+*/
+void CM_TraceTest_f( void ) {
+#ifdef CM_SIMD_TRACE
+	int				i, k, count, seed, simdTrace;
+	cbrush_t		brush;
+	cbrushside_t	sides[ TRACETEST_MAX_SIDES ];
+	cplane_t		planes[ TRACETEST_MAX_SIDES ];
+	cplanes4_t		planes4[ ( TRACETEST_MAX_SIDES + 3 ) / 4 ];
+	traceWork_t		scalar, simd;
+	qboolean		scalarCollided;
+	vec3_t			origin, start, end, halfSize;
+	vec3_t			scalarEnd, simdEnd;
+
+	count = ( Cmd_Argc( ) > 1 ) ? atoi( Cmd_Argv( 1 ) ) : 1000000;
+	seed = 0x5eed;
+
+	if ( !cm_simdTrace ) {
+		cm_simdTrace = Cvar_Get( "cm_simdTrace", "1", 0 );
+	}
+	simdTrace = cm_simdTrace->integer;
+
+	for ( i = 0; i < count; i++ ) {
+		for ( k = 0; k < 3; k++ ) {
+			origin[k] = CM_TraceTestRandom( &seed, 4096.0f );
+		}
+		CM_TraceTestBrush( &seed, &brush, sides, planes, origin );
+		CM_BrushPlanes4( &brush, planes4 );
+
+		for ( k = 0; k < 3; k++ ) {
+			start[k] = origin[k] + CM_TraceTestRandom( &seed, 256.0f );
+			end[k] = origin[k] + CM_TraceTestRandom( &seed, 256.0f );
+			halfSize[k] = ( Q_rand( &seed ) & 3 ) ? fabs( CM_TraceTestRandom( &seed, 32.0f ) ) : 0.0f;
+		}
+		if ( !( Q_rand( &seed ) & 15 ) ) {
+			VectorCopy( start, end );
+		}
+
+		cm_simdTrace->integer = 0;
+		brush.planes4 = NULL;
+		brush.collided = qfalse;
+		CM_TraceTestBox( &scalar, start, end, halfSize );
+		CM_TraceThroughBrush( &scalar, &brush );
+		scalarCollided = brush.collided;
+
+		cm_simdTrace->integer = 1;
+		brush.planes4 = planes4;
+		brush.collided = qfalse;
+		CM_TraceTestBox( &simd, start, end, halfSize );
+		CM_TraceThroughBrush( &simd, &brush );
+
+		for ( k = 0; k < 3; k++ ) {
+			scalarEnd[k] = start[k] + scalar.trace.fraction * ( end[k] - start[k] );
+			simdEnd[k] = start[k] + simd.trace.fraction * ( end[k] - start[k] );
+		}
+
+		if ( scalar.trace.fraction != simd.trace.fraction ||
+			!VectorCompare( scalarEnd, simdEnd ) ||
+			memcmp( &scalar.trace.plane, &simd.trace.plane, sizeof( cplane_t ) ) ||
+			scalar.trace.surfaceFlags != simd.trace.surfaceFlags ||
+			scalar.trace.contents != simd.trace.contents ||
+			scalar.trace.startsolid != simd.trace.startsolid ||
+			scalar.trace.allsolid != simd.trace.allsolid ||
+			scalarCollided != brush.collided ) {
+			cm_simdTrace->integer = simdTrace;
+			Com_Printf( "trace %i: %i sides, start ( %f %f %f ) end ( %f %f %f ) half size ( %f %f %f )\n",
+				i, brush.numsides, start[0], start[1], start[2], end[0], end[1], end[2],
+				halfSize[0], halfSize[1], halfSize[2] );
+			Com_Printf( "  scalar: fraction %.9g startsolid %i allsolid %i contents %i surfaceFlags %i collided %i\n",
+				scalar.trace.fraction, scalar.trace.startsolid, scalar.trace.allsolid,
+				scalar.trace.contents, scalar.trace.surfaceFlags, scalarCollided );
+			Com_Printf( "  simd:   fraction %.9g startsolid %i allsolid %i contents %i surfaceFlags %i collided %i\n",
+				simd.trace.fraction, simd.trace.startsolid, simd.trace.allsolid,
+				simd.trace.contents, simd.trace.surfaceFlags, brush.collided );
+			Com_Error( ERR_DROP, "cm_traceTest: trace %i differs between the scalar and SIMD paths", i );
+		}
+	}
+
+	cm_simdTrace->integer = simdTrace;
+	Com_Printf( "cm_traceTest: %i traces, scalar and SIMD paths match\n", count );
+#else
+	Com_Printf( "cm_traceTest: no SIMD trace path in this build\n" );
+#endif
+}
+
 /*
 ================
 CM_ProximityToBrush
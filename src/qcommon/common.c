@@ -841,7 +841,12 @@ int Com_RealTime(qtime_t *qtime) {
 There is never any space between memblocks, and there will never be two
 contiguous free memblocks.
 
-The rover can be left pointing at a non-empty block
+Free blocks are also kept in segregated lists, two level like TLSF: the
+first level is the power of two of the size and the second level splits
+that range into ZONE_SL_COUNT equal parts.  A bitmap of the lists that
+have blocks finds one that is big enough without walking the zone, so
+allocating and freeing take the same time however fragmented it gets.
+The list links live in the otherwise unused memory of the free block.
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
@@ -851,6 +856,12 @@ all big things are allocated on the hunk.
 #define	ZONEID	0x1d4a11
 #define MINFRAGMENT	64
 
+#define ZONE_SL_BITS		4
+#define ZONE_SL_COUNT		( 1 << ZONE_SL_BITS )
+#define ZONE_FL_SHIFT		( ZONE_SL_BITS + 4 )
+#define ZONE_SMALL_BLOCK	( 1 << ZONE_FL_SHIFT )			// sizes below this are in 16 byte steps
+#define ZONE_FL_COUNT		( 32 - ZONE_FL_SHIFT + 1 )
+
 typedef struct zonedebug_s {
 	char *label;
 	char *file;
@@ -868,11 +879,24 @@ typedef struct memblock_s {
 #endif
 } memblock_t;
 
+// kept right after the header of a free block
+typedef struct {
+	memblock_t	*next, *prev;	// in the free list of its size
+} memfree_t;
+
+#define	FREELINKS(block)	((memfree_t *)((memblock_t *)(block) + 1))
+
+// the smallest block that still has room for the free links
+#define	ZONE_MIN_BLOCK		PAD( sizeof( memblock_t ) + sizeof( memfree_t ), sizeof( intptr_t ) )
+
 typedef struct {
 	int		size;			// total bytes malloced, including header
 	int		used;			// total bytes used
 	memblock_t	blocklist;	// start / end cap for linked list
-	memblock_t	*rover;
+	memblock_t	*rover;		// only used by the first fit allocator of zonestress
+	unsigned int	flMap;							// first levels with any free block
+	unsigned int	slMap[ZONE_FL_COUNT];			// second levels with any free block
+	memblock_t	*freeLists[ZONE_FL_COUNT][ZONE_SL_COUNT];
 } memzone_t;
 
 // main zone for all "dynamic" memory allocation
@@ -883,6 +907,155 @@ memzone_t	*smallzone;
 
 void Z_CheckHeap( void );
 
+/*
+========================
+Z_Fls / Z_Ffs
+
+Highest and lowest set bit, x must not be 0
+========================
+*/
+static ID_INLINE int Z_Fls( unsigned int x ) {
+#ifdef __GNUC__
+	return 31 - __builtin_clz( x );
+#else
+	int		bit = 31;
+
+	while ( !( x & ( 1U << bit ) ) ) {
+		bit--;
+	}
+	return bit;
+#endif
+}
+
+static ID_INLINE int Z_Ffs( unsigned int x ) {
+#ifdef __GNUC__
+	return __builtin_ctz( x );
+#else
+	int		bit = 0;
+
+	while ( !( x & ( 1U << bit ) ) ) {
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+/*
+========================
+Z_MapSize
+
+The free list a block of size belongs in
+========================
+*/
+static ID_INLINE void Z_MapSize( unsigned int size, int *fl, int *sl ) {
+	int		bit;
+
+	if ( size < ZONE_SMALL_BLOCK ) {
+		*fl = 0;
+		*sl = size / ( ZONE_SMALL_BLOCK / ZONE_SL_COUNT );
+	} else {
+		bit = Z_Fls( size );
+		*fl = bit - ZONE_FL_SHIFT + 1;
+		*sl = ( size >> ( bit - ZONE_SL_BITS ) ) ^ ZONE_SL_COUNT;
+	}
+}
+
+/*
+========================
+Z_InsertFreeBlock
+========================
+*/
+static void Z_InsertFreeBlock( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*head;
+	int			fl, sl;
+
+	Z_MapSize( block->size, &fl, &sl );
+	head = zone->freeLists[fl][sl];
+
+	FREELINKS( block )->prev = NULL;
+	FREELINKS( block )->next = head;
+	if ( head ) {
+		FREELINKS( head )->prev = block;
+	}
+	zone->freeLists[fl][sl] = block;
+
+	zone->flMap |= 1U << fl;
+	zone->slMap[fl] |= 1U << sl;
+}
+
+/*
+========================
+Z_RemoveFreeBlock
+========================
+*/
+static void Z_RemoveFreeBlock( memzone_t *zone, memblock_t *block ) {
+	memfree_t	*links = FREELINKS( block );
+	int			fl, sl;
+
+	Z_MapSize( block->size, &fl, &sl );
+
+	if ( links->next ) {
+		FREELINKS( links->next )->prev = links->prev;
+	}
+	if ( links->prev ) {
+		FREELINKS( links->prev )->next = links->next;
+	} else {
+		zone->freeLists[fl][sl] = links->next;
+		if ( !links->next ) {
+			zone->slMap[fl] &= ~( 1U << sl );
+			if ( !zone->slMap[fl] ) {
+				zone->flMap &= ~( 1U << fl );
+			}
+		}
+	}
+}
+
+/*
+========================
+Z_FindFreeBlock
+
+Rounds size up to the next list so that any block in the first list
+with blocks from there on is big enough.  Only when there is none is
+the list that size itself falls in searched for a block that fits.
+========================
+*/
+static memblock_t *Z_FindFreeBlock( memzone_t *zone, int size ) {
+	memblock_t		*block;
+	unsigned int	rounded, map;
+	int				fl, sl;
+
+	rounded = size;
+	if ( rounded >= ZONE_SMALL_BLOCK ) {
+		rounded += ( 1U << ( Z_Fls( rounded ) - ZONE_SL_BITS ) ) - 1;
+	} else {
+		rounded += ( ZONE_SMALL_BLOCK / ZONE_SL_COUNT ) - 1;
+	}
+	Z_MapSize( rounded, &fl, &sl );
+
+	if ( fl < ZONE_FL_COUNT ) {
+		map = zone->slMap[fl] & ( ~0U << sl );
+		if ( !map && fl + 1 < ZONE_FL_COUNT ) {
+			map = zone->flMap & ( ~0U << ( fl + 1 ) );
+			if ( map ) {
+				fl = Z_Ffs( map );
+				map = zone->slMap[fl];
+			}
+		}
+		if ( map ) {
+			return zone->freeLists[fl][Z_Ffs( map )];
+		}
+	}
+
+	Z_MapSize( size, &fl, &sl );
+	for ( block = zone->freeLists[fl][sl]; block; block = FREELINKS( block )->next ) {
+		if ( block->size >= size ) {
+			return block;
+		}
+	}
+
+	return NULL;
+}
+
 /*
 ========================
 Z_ClearZone
@@ -892,6 +1065,7 @@ void Z_ClearZone( memzone_t *zone, int size ) {
 	memblock_t	*block;
 
 	// set the entire zone to one free block
+	Com_Memset( zone, 0, sizeof( *zone ) );
 
 	zone->blocklist.next = zone->blocklist.prev = block =
 		(memblock_t *)( (byte *)zone + sizeof(memzone_t) );
@@ -906,6 +1080,8 @@ void Z_ClearZone( memzone_t *zone, int size ) {
 	block->tag = 0;			// free block
 	block->id = ZONEID;
 	block->size = size - sizeof(memzone_t);
+
+	Z_InsertFreeBlock( zone, block );
 }
 
 /*
@@ -926,13 +1102,53 @@ int Z_AvailableMemory( void ) {
 	return Z_AvailableZoneMemory( mainzone );
 }
 
+/*
+========================
+Z_ZoneFree
+
+Returns the free block the block ended up in
+========================
+*/
+static memblock_t *Z_ZoneFree( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*other;
+
+	zone->used -= block->size;
+	// set the block to something that should cause problems
+	// if it is referenced...
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
+
+	block->tag = 0;		// mark as free
+
+	other = block->prev;
+	if (!other->tag) {
+		// merge with previous free block
+		Z_RemoveFreeBlock( zone, other );
+		other->size += block->size;
+		other->next = block->next;
+		other->next->prev = other;
+		block = other;
+	}
+
+	other = block->next;
+	if ( !other->tag ) {
+		// merge the next free block onto the end
+		Z_RemoveFreeBlock( zone, other );
+		block->size += other->size;
+		block->next = other->next;
+		block->next->prev = block;
+	}
+
+	Z_InsertFreeBlock( zone, block );
+	return block;
+}
+
 /*
 ========================
 Z_Free
 ========================
 */
 void Z_Free( void *ptr ) {
-	memblock_t	*block, *other;
+	memblock_t	*block;
 	memzone_t *zone;
 
 	if (!ptr) {
@@ -963,34 +1179,7 @@ void Z_Free( void *ptr ) {
 		zone = mainzone;
 	}
 
-	zone->used -= block->size;
-	// set the block to something that should cause problems
-	// if it is referenced...
-	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
-
-	block->tag = 0;		// mark as free
-
-	other = block->prev;
-	if (!other->tag) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
-		block = other;
-	}
-
-	zone->rover = block;
-
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-	}
+	Z_ZoneFree( zone, block );
 }
 
 
@@ -1000,8 +1189,8 @@ Z_FreeTags
 ================
 */
 void Z_FreeTags( int tag ) {
-	int			count;
 	memzone_t	*zone;
+	memblock_t	*block;
 
 	if ( tag == TAG_SMALL ) {
 		zone = smallzone;
@@ -1009,20 +1198,78 @@ void Z_FreeTags( int tag ) {
 	else {
 		zone = mainzone;
 	}
-	count = 0;
-	// use the rover as our pointer, because
-	// Z_Free automatically adjusts it
-	zone->rover = zone->blocklist.next;
-	do {
-		if ( zone->rover->tag == tag ) {
-			count++;
-			Z_Free( (void *)(zone->rover + 1) );
-			continue;
+
+	// a freed block can be merged into the one before it,
+	// so carry on from wherever it ended up
+	for ( block = zone->blocklist.next; block != &zone->blocklist; block = block->next ) {
+		if ( block->tag == tag ) {
+			block = Z_ZoneFree( zone, block );
 		}
-		zone->rover = zone->rover->next;
-	} while ( zone->rover != &zone->blocklist );
+	}
 }
 
+/*
+================
+Z_BlockSize
+
+The size of the block an allocation of size needs
+================
+*/
+static int Z_BlockSize( int size ) {
+	size += sizeof(memblock_t);	// account for size of block header
+	size += 4;					// space for memory trash tester
+	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
+
+	// room for the free list links once it is freed again
+	if ( size < ZONE_MIN_BLOCK ) {
+		size = ZONE_MIN_BLOCK;
+	}
+
+	return size;
+}
+
+/*
+================
+Z_ZoneAlloc
+
+Takes a block of size bytes out of the free lists, or returns NULL
+================
+*/
+static memblock_t *Z_ZoneAlloc( memzone_t *zone, int size, int tag ) {
+	memblock_t	*base, *new;
+	int			extra;
+
+	base = Z_FindFreeBlock( zone, size );
+	if ( !base ) {
+		return NULL;
+	}
+	Z_RemoveFreeBlock( zone, base );
+
+	extra = base->size - size;
+	if (extra > MINFRAGMENT) {
+		// there will be a free fragment after the allocated block
+		new = (memblock_t *) ((byte *)base + size );
+		new->size = extra;
+		new->tag = 0;			// free block
+		new->prev = base;
+		new->id = ZONEID;
+		new->next = base->next;
+		new->next->prev = new;
+		base->next = new;
+		base->size = size;
+		Z_InsertFreeBlock( zone, new );
+	}
+
+	base->tag = tag;			// no longer a free block
+	zone->used += base->size;	//
+
+	base->id = ZONEID;
+
+	// marker for memory trash testing
+	*(int *)((byte *)base + base->size - 4) = ZONEID;
+
+	return base;
+}
 
 /*
 ================
@@ -1035,8 +1282,7 @@ void *Z_TagMallocDebug( int size, int tag, char *label, char *file, int line ) {
 #else
 void *Z_TagMalloc( int size, int tag ) {
 #endif
-	int		extra;
-	memblock_t	*start, *rover, *new, *base;
+	memblock_t	*base;
 	memzone_t *zone;
 
 	if (!tag) {
@@ -1053,62 +1299,22 @@ void *Z_TagMalloc( int size, int tag ) {
 #ifdef ZONE_DEBUG
 	allocSize = size;
 #endif
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
-	size += sizeof(memblock_t);	// account for size of block header
-	size += 4;					// space for memory trash tester
-	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
-
-	base = rover = zone->rover;
-	start = base->prev;
+	size = Z_BlockSize( size );
 
-	do {
-		if (rover == start)	{
-			// scaned all the way around the list
+	base = Z_ZoneAlloc( zone, size, tag );
+	if ( !base ) {
 #ifdef ZONE_DEBUG
-			Z_LogHeap();
+		Z_LogHeap();
 
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone: %s, line: %d (%s)",
-								size, zone == smallzone ? "small" : "main", file, line, label);
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone: %s, line: %d (%s)",
+							size, zone == smallzone ? "small" : "main", file, line, label);
 #else
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-								size, zone == smallzone ? "small" : "main");
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
+							size, zone == smallzone ? "small" : "main");
 #endif
-			return NULL;
-		}
-		if (rover->tag) {
-			base = rover = rover->next;
-		} else {
-			rover = rover->next;
-		}
-	} while (base->tag || base->size < size);
-
-	//
-	// found a block big enough
-	//
-	extra = base->size - size;
-	if (extra > MINFRAGMENT) {
-		// there will be a free fragment after the allocated block
-		new = (memblock_t *) ((byte *)base + size );
-		new->size = extra;
-		new->tag = 0;			// free block
-		new->prev = base;
-		new->id = ZONEID;
-		new->next = base->next;
-		new->next->prev = new;
-		base->next = new;
-		base->size = size;
+		return NULL;
 	}
 
-	base->tag = tag;			// no longer a free block
-
-	zone->rover = base->next;	// next allocation will start looking here
-	zone->used += base->size;	//
-
-	base->id = ZONEID;
-
 #ifdef ZONE_DEBUG
 	base->d.label = label;
 	base->d.file = file;
@@ -1116,9 +1322,6 @@ void *Z_TagMalloc( int size, int tag ) {
 	base->d.allocSize = allocSize;
 #endif
 
-	// marker for memory trash testing
-	*(int *)((byte *)base + base->size - 4) = ZONEID;
-
 	return (void *) ((byte *)base + sizeof(memblock_t));
 }
 
@@ -1158,14 +1361,20 @@ void *S_Malloc( int size ) {
 
 /*
 ========================
-Z_CheckHeap
+Z_CheckZone
 ========================
 */
-void Z_CheckHeap( void ) {
+static void Z_CheckZone( memzone_t *zone ) {
 	memblock_t	*block;
+	int			numFree, numListed;
+	int			fl, sl, blockFl, blockSl;
 
-	for (block = mainzone->blocklist.next ; ; block = block->next) {
-		if (block->next == &mainzone->blocklist) {
+	numFree = 0;
+	for (block = zone->blocklist.next ; ; block = block->next) {
+		if ( !block->tag ) {
+			numFree++;
+		}
+		if (block->next == &zone->blocklist) {
 			break;			// all blocks have been hit
 		}
 		if ( (byte *)block + block->size != (byte *)block->next)
@@ -1177,6 +1386,61 @@ void Z_CheckHeap( void ) {
 			Com_Error( ERR_FATAL, "Z_CheckHeap: two consecutive free blocks" );
 		}
 	}
+
+	numListed = 0;
+	for ( fl = 0; fl < ZONE_FL_COUNT; fl++ ) {
+		for ( sl = 0; sl < ZONE_SL_COUNT; sl++ ) {
+			if ( !zone->freeLists[fl][sl] != !( zone->slMap[fl] & ( 1U << sl ) ) ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: free list bitmap is out of date" );
+			}
+			for ( block = zone->freeLists[fl][sl]; block; block = FREELINKS( block )->next ) {
+				Z_MapSize( block->size, &blockFl, &blockSl );
+				if ( block->tag || blockFl != fl || blockSl != sl ) {
+					Com_Error( ERR_FATAL, "Z_CheckHeap: block in the wrong free list" );
+				}
+				numListed++;
+			}
+		}
+		if ( !zone->slMap[fl] != !( zone->flMap & ( 1U << fl ) ) ) {
+			Com_Error( ERR_FATAL, "Z_CheckHeap: free list bitmap is out of date" );
+		}
+	}
+
+	if ( numListed != numFree ) {
+		Com_Error( ERR_FATAL, "Z_CheckHeap: %d free blocks but %d in the free lists", numFree, numListed );
+	}
+}
+
+/*
+========================
+Z_CheckHeap
+========================
+*/
+void Z_CheckHeap( void ) {
+	Z_CheckZone( mainzone );
+	Z_CheckZone( smallzone );
+}
+
+/*
+========================
+Z_ZoneFragmentation
+
+Free bytes, free blocks and the biggest of them
+========================
+*/
+static void Z_ZoneFragmentation( memzone_t *zone, int *freeBytes, int *freeBlocks, int *largest ) {
+	memblock_t	*block;
+
+	*freeBytes = *freeBlocks = *largest = 0;
+	for ( block = zone->blocklist.next; block != &zone->blocklist; block = block->next ) {
+		if ( !block->tag ) {
+			*freeBytes += block->size;
+			(*freeBlocks)++;
+			if ( block->size > *largest ) {
+				*largest = block->size;
+			}
+		}
+	}
 }
 
 /*
@@ -1192,6 +1456,7 @@ void Z_LogZoneHeap( memzone_t *zone, char *name ) {
 	memblock_t	*block;
 	char		buf[4096];
 	int size, allocSize, numBlocks;
+	int freeBytes, freeBlocks, largest, fl, sl, count;
 
 	if (!logfile || !FS_Initialized())
 		return;
@@ -1233,6 +1498,26 @@ void Z_LogZoneHeap( memzone_t *zone, char *name ) {
 	FS_Write(buf, strlen(buf), logfile);
 	Com_sprintf(buf, sizeof(buf), "%d %s memory overhead\r\n", size - allocSize, name);
 	FS_Write(buf, strlen(buf), logfile);
+
+	// how badly the free memory is cut up
+	Z_ZoneFragmentation( zone, &freeBytes, &freeBlocks, &largest );
+	Com_sprintf(buf, sizeof(buf), "%d %s memory free in %d blocks, largest %d, %.1f%% fragmented\r\n",
+		freeBytes, name, freeBlocks, largest, freeBytes ? 100.0f * ( freeBytes - largest ) / freeBytes : 0.0f);
+	FS_Write(buf, strlen(buf), logfile);
+	for ( fl = 0; fl < ZONE_FL_COUNT; fl++ ) {
+		if ( !( zone->flMap & ( 1U << fl ) ) ) {
+			continue;
+		}
+		count = 0;
+		for ( sl = 0; sl < ZONE_SL_COUNT; sl++ ) {
+			for ( block = zone->freeLists[fl][sl]; block; block = FREELINKS( block )->next ) {
+				count++;
+			}
+		}
+		Com_sprintf(buf, sizeof(buf), "%8d free blocks from %d bytes\r\n", count,
+			fl ? 1 << ( fl + ZONE_FL_SHIFT - 1 ) : 0);
+		FS_Write(buf, strlen(buf), logfile);
+	}
 }
 
 /*
@@ -1245,6 +1530,200 @@ void Z_LogHeap( void ) {
 	Z_LogZoneHeap( smallzone, "SMALL" );
 }
 
+/*
+========================
+Z_FirstFitAlloc
+
+The first fit rover the zone used before the free lists, kept for
+zonestress to compare against
+========================
+*/
+static memblock_t *Z_FirstFitAlloc( memzone_t *zone, int size, int tag ) {
+	memblock_t	*start, *rover, *new, *base;
+	int			extra;
+
+	base = rover = zone->rover;
+	start = base->prev;
+
+	do {
+		if (rover == start)	{
+			return NULL;
+		}
+		if (rover->tag) {
+			base = rover = rover->next;
+		} else {
+			rover = rover->next;
+		}
+	} while (base->tag || base->size < size);
+
+	extra = base->size - size;
+	if (extra > MINFRAGMENT) {
+		new = (memblock_t *) ((byte *)base + size );
+		new->size = extra;
+		new->tag = 0;
+		new->prev = base;
+		new->id = ZONEID;
+		new->next = base->next;
+		new->next->prev = new;
+		base->next = new;
+		base->size = size;
+	}
+
+	base->tag = tag;
+	zone->rover = base->next;
+	zone->used += base->size;
+	base->id = ZONEID;
+	*(int *)((byte *)base + base->size - 4) = ZONEID;
+
+	return base;
+}
+
+/*
+========================
+Z_FirstFitFree
+========================
+*/
+static void Z_FirstFitFree( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*other;
+
+	zone->used -= block->size;
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
+	block->tag = 0;
+
+	other = block->prev;
+	if (!other->tag) {
+		other->size += block->size;
+		other->next = block->next;
+		other->next->prev = other;
+		if (block == zone->rover) {
+			zone->rover = other;
+		}
+		block = other;
+	}
+
+	zone->rover = block;
+
+	other = block->next;
+	if ( !other->tag ) {
+		block->size += other->size;
+		block->next = other->next;
+		block->next->prev = block;
+	}
+}
+
+#define	STRESS_ZONE_SIZE	( 8 * 1024 * 1024 )
+#define	STRESS_SLOTS		4096
+
+/*
+========================
+Z_StressSize
+
+Mostly string and struct sized allocations with the odd big one,
+roughly what the zones get from cvars, commands and loading
+========================
+*/
+static int Z_StressSize( unsigned int *seed ) {
+	*seed = *seed * 1664525 + 1013904223;
+
+	switch ( ( *seed >> 8 ) & 15 ) {
+	case 0:
+		return 1024 + ( ( *seed >> 12 ) & 32767 );
+	case 1:
+	case 2:
+		return 128 + ( ( *seed >> 12 ) & 1023 );
+	default:
+		return 1 + ( ( *seed >> 12 ) & 63 );
+	}
+}
+
+/*
+========================
+Z_StressZone
+
+Runs the same allocations and frees through one of the allocators on a
+zone of its own and prints how long they took and how cut up the zone
+was left
+========================
+*/
+static void Z_StressZone( const char *name, qboolean firstFit, int ops ) {
+	memzone_t	*zone;
+	memblock_t	**slots;
+	unsigned int	seed;
+	int			i, slot, size, failed, freeBytes, freeBlocks, largest;
+	int64_t		start, msec;
+
+	zone = calloc( STRESS_ZONE_SIZE, 1 );
+	slots = calloc( STRESS_SLOTS, sizeof( *slots ) );
+	if ( !zone || !slots ) {
+		free( zone );
+		free( slots );
+		Com_Printf( "zonestress: out of memory\n" );
+		return;
+	}
+	Z_ClearZone( zone, STRESS_ZONE_SIZE );
+
+	seed = 0x5eed;
+	failed = 0;
+	start = Sys_Microseconds();
+
+	for ( i = 0; i < ops; i++ ) {
+		seed = seed * 1664525 + 1013904223;
+		slot = ( seed >> 10 ) % STRESS_SLOTS;
+
+		if ( slots[slot] ) {
+			if ( firstFit ) {
+				Z_FirstFitFree( zone, slots[slot] );
+			} else {
+				Z_ZoneFree( zone, slots[slot] );
+			}
+			slots[slot] = NULL;
+			continue;
+		}
+
+		size = Z_BlockSize( Z_StressSize( &seed ) );
+		if ( firstFit ) {
+			slots[slot] = Z_FirstFitAlloc( zone, size, TAG_GENERAL );
+		} else {
+			slots[slot] = Z_ZoneAlloc( zone, size, TAG_GENERAL );
+		}
+		if ( !slots[slot] ) {
+			failed++;
+		}
+	}
+
+	msec = Sys_Microseconds() - start;
+	Z_ZoneFragmentation( zone, &freeBytes, &freeBlocks, &largest );
+
+	Com_Printf( "%-10s %8.3f msec, %5.1f nsec per op, %d failed, %d bytes used, "
+		"%d free blocks, largest %d, %.1f%% fragmented\n",
+		name, msec / 1000.0f, msec * 1000.0f / ops, failed, zone->used, freeBlocks, largest,
+		freeBytes ? 100.0f * ( freeBytes - largest ) / freeBytes : 0.0f );
+
+	free( slots );
+	free( zone );
+}
+
+/*
+========================
+Z_Stress_f
+
+zonestress [ops]
+========================
+*/
+static void Z_Stress_f( void ) {
+	int		ops;
+
+	ops = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1000000;
+	if ( ops < 1 ) {
+		ops = 1;
+	}
+
+	Com_Printf( "%d random allocations and frees of up to %d blocks in a %d byte zone\n",
+		ops, STRESS_SLOTS, STRESS_ZONE_SIZE );
+	Z_StressZone( "first fit", qtrue, ops );
+	Z_StressZone( "free lists", qfalse, ops );
+}
+
 // static mem blocks to reduce a lot of small zone overhead
 typedef struct memstatic_s {
 	memblock_t b;
@@ -1668,6 +2147,7 @@ void Com_InitHunkMemory( void ) {
 	Hunk_Clear();
 
 	Cmd_AddCommand( "meminfo", Com_Meminfo_f );
+	Cmd_AddCommand( "zonestress", Z_Stress_f );
 #ifdef ZONE_DEBUG
 	Cmd_AddCommand( "zonelog", Z_LogHeap );
 #endif
@@ -2636,6 +3116,7 @@ void Com_Init( char *commandLine ) {
 		Cmd_AddCommand ("error", Com_Error_f);
 		Cmd_AddCommand ("crash", Com_Crash_f);
 		Cmd_AddCommand ("freeze", Com_Freeze_f);
+		Cmd_AddCommand ("cm_traceTest", CM_TraceTest_f);
 	}
 	Cmd_AddCommand ("quit", Com_Quit_f);
 	Cmd_AddCommand("colors", Com_Colors_f);
@@ -2711,9 +3192,8 @@ void Com_Init( char *commandLine ) {
 	SV_Init();
 
 	com_dedicated->modified = qfalse;
-#ifndef DEDICATED
+	// a dedicated build still runs its null client, which may be tremload's
 	CL_Init();
-#endif
 
 	// set com_frameTime so that if a map is started on the
 	// command line it will still be able to count on com_frameTime
@@ -2941,7 +3421,7 @@ Com_Frame
 void Com_Frame( void ) {
 
 	int		msec, minMsec;
-	int		timeVal, timeValSV;
+	int		timeVal, timeValSV, wakeTime;
 	static int	lastTime = 0, bias = 0;
 
 	int		timeBeforeFirstEvents;
@@ -3003,6 +3483,9 @@ void Com_Frame( void ) {
 
 	do
 	{
+		// when the next wakeup is due, on the Sys_Milliseconds clock
+		wakeTime = com_frameTime + minMsec;
+
 		if(com_sv_running->integer)
 		{
 			timeValSV = SV_SendQueuedPackets();
@@ -3010,14 +3493,17 @@ void Com_Frame( void ) {
 			timeVal = Com_TimeVal(minMsec);
 
 			if(timeValSV < timeVal)
+			{
 				timeVal = timeValSV;
+				wakeTime = Sys_Milliseconds() + timeValSV;
+			}
 		}
 		else
 			timeVal = Com_TimeVal(minMsec);
 
 		if(com_busyWait->integer || timeVal < 1)
 			NET_Sleep(0);
-		else
+		else if(!com_dedicated->integer || !NET_SleepUntil(wakeTime))
 			NET_Sleep(timeVal - 1);
 	} while(Com_TimeVal(minMsec));
 
@@ -3093,6 +3579,8 @@ void Com_Frame( void ) {
 		timeBeforeEvents = timeAfter;
 		timeBeforeClient = timeAfter;
 	}
+
+	CL_Frame( msec );
 #endif
 
 
@@ -34,6 +34,21 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 #include "q_shared.h"
 #include "qcommon.h"
 #include <minizip/unzip.h>
+#include <zlib.h>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 /*
 =============================================================================
@@ -186,10 +201,20 @@ or configs will never get loaded from disk!
 #define	MAX_SEARCH_PATHS	4096
 #define MAX_FILEHASH_SIZE	1024
 
+// compression methods of the files in a pk3 that can be read from the mapped zip
+#define PK3_STORED			0
+#define PK3_DEFLATED		8
+
+// files handed out by FS_ReadFileView that point into a mapped zip
+#define MAX_FILE_VIEWS		64
+
 typedef struct fileInPack_s {
 	char					*name;		// name of the file
 	unsigned long			pos;		// file info position in zip
 	unsigned long			len;		// uncompress file size
+	unsigned long			localPos;	// local header position in zip
+	unsigned long			compressedLen;
+	int						method;		// PK3_STORED, PK3_DEFLATED or -1 if only unzip can read it
 	struct	fileInPack_s*	next;		// next file in the hash
 } fileInPack_t;
 
@@ -199,6 +224,8 @@ typedef struct pack_s {
 	char			pakBasename[MAX_OSPATH];	// pak0
 	char			pakGamename[MAX_OSPATH];	// base
 	unzFile			handle;						// handle to zip file
+	const byte		*mapData;					// the whole zip mapped read only, or NULL
+	size_t			mapSize;
 	int				checksum;					// regular checksum
 	int				pure_checksum;				// checksum for pure
 	int				numfiles;					// number of files in pk3
@@ -224,6 +251,27 @@ typedef struct searchpath_s {
 	directory_t	*dir;
 } searchpath_t;
 
+typedef struct fileIndex_s {
+	fileInPack_t		*file;
+	searchpath_t		*search;	// the pack the file is in
+	int					order;		// position of search in fs_searchpaths
+	struct fileIndex_s	*next;		// next file in the hash
+} fileIndex_t;
+
+typedef struct {
+	searchpath_t	*search;
+	int				order;
+} indexDir_t;
+
+#define	MAX_FILE_MISSES		1024
+
+typedef struct {
+	char		name[MAX_QPATH];
+	int			order;			// no directory before this position has the file
+	int			time;
+	int			generation;
+} fileMiss_t;
+
 static	char		fs_gamedir[MAX_OSPATH];	// this will be a single file name with no separators
 static	cvar_t		*fs_debug;
 static	cvar_t		*fs_homepath;
@@ -243,6 +291,22 @@ static	int			fs_loadCount;			// total files read
 static	int			fs_loadStack;			// total files in memory
 static	int			fs_packFiles = 0;		// total number of files in packs
 
+// every file of every pack and every directory of fs_searchpaths, so a
+// lookup is one hash probe plus the directories that come before the pack
+static	fileIndex_t	**fs_indexHash;
+static	fileIndex_t	*fs_indexFiles;
+static	int			fs_indexHashSize;
+static	indexDir_t	*fs_indexDirs;
+static	int			fs_numIndexDirs;
+
+// names recently looked for in the directories and not found there
+static	cvar_t		*fs_missCache;
+static	fileMiss_t	fs_misses[MAX_FILE_MISSES];
+static	int			fs_missGeneration = 1;
+
+static	cvar_t		*fs_mapPaks;
+static	const void	*fs_fileViews[MAX_FILE_VIEWS];
+
 static int fs_checksumFeed;
 
 typedef union qfile_gus {
@@ -262,6 +326,12 @@ typedef struct {
 	int			zipFilePos;
 	int			zipFileLen;
 	qboolean	zipFile;
+	const byte	*zipData;		// file data in a mapped zip, unzip is not used when set
+	int			zipDataLen;
+	int			zipMethod;
+	int			zipReadPos;		// uncompressed bytes read from zipData
+	qboolean	zipInflating;
+	z_stream	zipStream;
 	qboolean	streamed;
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
@@ -369,11 +439,67 @@ static long FS_HashFileName( const char *fname, int hashSize ) {
 	return hash;
 }
 
+/*
+================
+FS_ClearMissCache
+
+Call whenever a file may have appeared in a directory
+================
+*/
+static void FS_ClearMissCache( void ) {
+	fs_missGeneration++;
+}
+
+/*
+================
+FS_MissCached
+
+Returns qtrue if the directories before order were recently found not
+to have fname
+================
+*/
+static qboolean FS_MissCached( const char *fname, int order ) {
+	fileMiss_t	*miss;
+
+	if ( !fs_missCache || fs_missCache->integer <= 0 ) {
+		return qfalse;
+	}
+
+	miss = &fs_misses[ FS_HashFileName( fname, MAX_FILE_MISSES ) ];
+	if ( miss->generation != fs_missGeneration || miss->order < order ||
+		Sys_Milliseconds() - miss->time >= fs_missCache->integer ) {
+		return qfalse;
+	}
+
+	// the directories are case sensitive on some systems
+	return !strcmp( miss->name, fname );
+}
+
+/*
+================
+FS_CacheMiss
+================
+*/
+static void FS_CacheMiss( const char *fname, int order ) {
+	fileMiss_t	*miss;
+
+	if ( !fs_missCache || fs_missCache->integer <= 0 || strlen( fname ) >= MAX_QPATH ) {
+		return;
+	}
+
+	miss = &fs_misses[ FS_HashFileName( fname, MAX_FILE_MISSES ) ];
+	Q_strncpyz( miss->name, fname, sizeof( miss->name ) );
+	miss->order = order;
+	miss->time = Sys_Milliseconds();
+	miss->generation = fs_missGeneration;
+}
+
 static fileHandle_t	FS_HandleForFile(void) {
 	int		i;
 
 	for ( i = 1 ; i < MAX_FILE_HANDLES ; i++ ) {
-		if ( fsh[i].handleFiles.file.o == NULL ) {
+		// a file in a mapped pack may have no unzip handle at all
+		if ( fsh[i].handleFiles.file.o == NULL && !fsh[i].zipData ) {
 			return i;
 		}
 	}
@@ -649,6 +775,8 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	ospath = FS_BuildOSPath( fs_homepath->string, filename, "" );
 	ospath[strlen(ospath)-1] = '\0';
 
@@ -759,6 +887,8 @@ void FS_SV_Rename( const char *from, const char *to, qboolean safe ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	// don't let sound stutter
 	S_ClearSoundBuffer();
 
@@ -793,6 +923,8 @@ void FS_Rename( const char *from, const char *to ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	// don't let sound stutter
 	S_ClearSoundBuffer();
 
@@ -824,6 +956,13 @@ void FS_FCloseFile( fileHandle_t f ) {
 	}
 
 	if (fsh[f].zipFile == qtrue) {
+		if ( fsh[f].zipData ) {
+			if ( fsh[f].zipInflating ) {
+				inflateEnd( &fsh[f].zipStream );
+			}
+			Com_Memset( &fsh[f], 0, sizeof( fsh[f] ) );
+			return;
+		}
 		unzCloseCurrentFile( fsh[f].handleFiles.file.z );
 		if ( fsh[f].handleFiles.unique ) {
 			unzClose( fsh[f].handleFiles.file.z );
@@ -853,6 +992,8 @@ fileHandle_t FS_FOpenFileWrite( const char *filename ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
 
@@ -896,6 +1037,8 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
 
@@ -939,6 +1082,8 @@ fileHandle_t FS_FCreateOpenPipeFile( const char *filename ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
+	FS_ClearMissCache();
+
 	f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
 
@@ -1059,6 +1204,124 @@ qboolean FS_IsDemoExt(const char *filename, int namelen)
 	return qfalse;
 }
 
+/*
+=================
+FS_ZipShort / FS_ZipLong
+
+Little endian fields of a mapped zip
+=================
+*/
+static ID_INLINE unsigned FS_ZipShort( const byte *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+static ID_INLINE unsigned long FS_ZipLong( const byte *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned long)p[3] << 24 );
+}
+
+/*
+=================
+FS_MappedZipData
+
+Returns where the data of a file starts in the mapped zip, or NULL if
+the file has to be read through unzip
+=================
+*/
+static const byte *FS_MappedZipData( pack_t *pack, fileInPack_t *pakFile ) {
+	const byte		*local;
+	unsigned long	offset;
+
+	if ( !pack->mapData || pakFile->method == -1 ) {
+		return NULL;
+	}
+	if ( pakFile->method == PK3_STORED && pakFile->compressedLen != pakFile->len ) {
+		return NULL;
+	}
+
+	// the local header repeats the name and has extra fields of its own
+	if ( pakFile->localPos + 30 > pack->mapSize ) {
+		return NULL;
+	}
+	local = pack->mapData + pakFile->localPos;
+	if ( FS_ZipLong( local ) != 0x04034b50 ) {
+		return NULL;
+	}
+
+	offset = pakFile->localPos + 30 + FS_ZipShort( local + 26 ) + FS_ZipShort( local + 28 );
+	if ( offset > pack->mapSize || pakFile->compressedLen > pack->mapSize - offset ) {
+		return NULL;
+	}
+
+	return pack->mapData + offset;
+}
+
+/*
+=================
+FS_PakHandle
+
+Packs that were mapped or came out of the pk3 cache only open the zip
+once something has to be read through unzip
+=================
+*/
+static unzFile FS_PakHandle( pack_t *pack )
+{
+	if ( !pack->handle ) {
+		pack->handle = unzOpen( pack->pakFilename );
+		if ( !pack->handle ) {
+			Com_Error( ERR_FATAL, "Couldn't open %s", pack->pakFilename );
+		}
+	}
+
+	return pack->handle;
+}
+
+/*
+=================
+FS_ReadMappedZip
+
+Copies a stored file or inflates a deflated one straight out of the
+mapped zip, returning what unzReadCurrentFile would
+=================
+*/
+static int FS_ReadMappedZip( fileHandleData_t *fh, void *buffer, int len ) {
+	z_stream	*zs = &fh->zipStream;
+	int			err, read;
+
+	if ( len > fh->zipFileLen - fh->zipReadPos ) {
+		len = fh->zipFileLen - fh->zipReadPos;
+	}
+	if ( len <= 0 ) {
+		return 0;
+	}
+
+	if ( fh->zipMethod == PK3_STORED ) {
+		Com_Memcpy( buffer, fh->zipData + fh->zipReadPos, len );
+		fh->zipReadPos += len;
+		return len;
+	}
+
+	if ( !fh->zipInflating ) {
+		Com_Memset( zs, 0, sizeof( *zs ) );
+		if ( inflateInit2( zs, -MAX_WBITS ) != Z_OK ) {
+			return Z_MEM_ERROR;
+		}
+		zs->next_in = (Bytef *)fh->zipData;
+		zs->avail_in = fh->zipDataLen;
+		fh->zipInflating = qtrue;
+	}
+
+	zs->next_out = buffer;
+	zs->avail_out = len;
+	err = inflate( zs, Z_SYNC_FLUSH );
+	read = len - zs->avail_out;
+	fh->zipReadPos += read;
+
+	if ( err != Z_OK && err != Z_STREAM_END ) {
+		return err == Z_BUF_ERROR ? Z_DATA_ERROR : err;
+	}
+	return read;
+}
+
 /*
 ===========
 FS_FOpenFileReadDir
@@ -1211,7 +1474,18 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 					if(strstr(filename, "ui.qvm"))
 						pak->referenced |= FS_UI_REF;
 
-					if(uniqueFILE)
+					fsh[*file].zipData = FS_MappedZipData(pak, pakFile);
+
+					if(fsh[*file].zipData)
+					{
+						// every handle keeps its own place in the mapped zip,
+						// so even a unique one needs no unzip handle of its own
+						fsh[*file].handleFiles.file.z = pak->handle;
+						fsh[*file].handleFiles.unique = qfalse;
+						fsh[*file].zipDataLen = pakFile->compressedLen;
+						fsh[*file].zipMethod = pakFile->method;
+					}
+					else if(uniqueFILE)
 					{
 						// open a new file on the pakfile
 						fsh[*file].handleFiles.file.z = unzOpen(pak->pakFilename);
@@ -1220,16 +1494,19 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 							Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
 					}
 					else
-						fsh[*file].handleFiles.file.z = pak->handle;
+						fsh[*file].handleFiles.file.z = FS_PakHandle(pak);
 
 					Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
 					fsh[*file].zipFile = qtrue;
 
-					// set the file position in the zip file (also sets the current file info)
-					unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
+					if(!fsh[*file].zipData)
+					{
+						// set the file position in the zip file (also sets the current file info)
+						unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
 
-					// open the file in the zip
-					unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+						// open the file in the zip
+						unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+					}
 					fsh[*file].zipFilePos = pakFile->pos;
 					fsh[*file].zipFileLen = pakFile->len;
 
@@ -1299,6 +1576,202 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 	return -1;
 }
 
+/*
+=================
+FS_FreeFileIndex
+=================
+*/
+static void FS_FreeFileIndex( void ) {
+	if ( fs_indexHash ) {
+		Z_Free( fs_indexHash );
+		Z_Free( fs_indexFiles );
+		Z_Free( fs_indexDirs );
+	}
+
+	fs_indexHash = NULL;
+	fs_indexFiles = NULL;
+	fs_indexDirs = NULL;
+	fs_indexHashSize = 0;
+	fs_numIndexDirs = 0;
+}
+
+/*
+=================
+FS_BuildFileIndex
+
+Indexes the files of every pack in fs_searchpaths, call whenever the
+search path changes
+=================
+*/
+static void FS_BuildFileIndex( void ) {
+	searchpath_t	*search;
+	fileInPack_t	*pakFile;
+	fileIndex_t		*entry;
+	int				numFiles, numDirs, order, i;
+	long			hash;
+
+	FS_FreeFileIndex();
+	FS_ClearMissCache();
+
+	numFiles = numDirs = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			numFiles += search->pack->numfiles;
+		} else if ( search->dir ) {
+			numDirs++;
+		}
+	}
+
+	for ( fs_indexHashSize = MAX_FILEHASH_SIZE ; fs_indexHashSize < numFiles ; fs_indexHashSize <<= 1 ) {
+	}
+
+	fs_indexHash = Z_Malloc( fs_indexHashSize * sizeof( *fs_indexHash ) );
+	fs_indexFiles = Z_Malloc( MAX( numFiles, 1 ) * sizeof( *fs_indexFiles ) );
+	fs_indexDirs = Z_Malloc( MAX( numDirs, 1 ) * sizeof( *fs_indexDirs ) );
+
+	entry = fs_indexFiles;
+	for ( search = fs_searchpaths, order = 0 ; search ; search = search->next, order++ ) {
+		if ( search->dir ) {
+			fs_indexDirs[ fs_numIndexDirs ].search = search;
+			fs_indexDirs[ fs_numIndexDirs ].order = order;
+			fs_numIndexDirs++;
+			continue;
+		}
+
+		if ( !search->pack ) {
+			continue;
+		}
+
+		for ( i = 0 ; i < search->pack->hashSize ; i++ ) {
+			for ( pakFile = search->pack->hashTable[i] ; pakFile ; pakFile = pakFile->next ) {
+				if ( entry == fs_indexFiles + numFiles ) {
+					break;
+				}
+
+				entry->file = pakFile;
+				entry->search = search;
+				entry->order = order;
+
+				hash = FS_HashFileName( pakFile->name, fs_indexHashSize );
+				entry->next = fs_indexHash[hash];
+				fs_indexHash[hash] = entry;
+				entry++;
+			}
+		}
+	}
+}
+
+/*
+=================
+FS_IndexLookup
+
+Returns the first pack in search order that has filename, leaving out
+the ones that aren't pure if pureOnly
+=================
+*/
+static fileIndex_t *FS_IndexLookup( const char *filename, qboolean pureOnly ) {
+	fileIndex_t	*entry, *found;
+
+	found = NULL;
+	for ( entry = fs_indexHash[ FS_HashFileName( filename, fs_indexHashSize ) ] ; entry ; entry = entry->next ) {
+		if ( found && entry->order >= found->order ) {
+			continue;
+		}
+
+		// case and separator insensitive comparisons
+		if ( FS_FilenameCompare( entry->file->name, filename ) ) {
+			continue;
+		}
+
+		if ( pureOnly && !FS_PakIsPure( entry->search->pack ) ) {
+			continue;
+		}
+
+		found = entry;
+	}
+
+	return found;
+}
+
+/*
+===========
+FS_FOpenFileMissing
+===========
+*/
+static long FS_FOpenFileMissing(const char *filename, fileHandle_t *file)
+{
+#ifdef FS_MISSING
+	if(missingFiles)
+		fprintf(missingFiles, "%s\n", filename);
+#endif
+
+	if(file)
+	{
+		*file = 0;
+		return -1;
+	}
+	else
+	{
+		// When file is NULL, we're querying the existance of the file
+		// If we've got here, it doesn't exist
+		return 0;
+	}
+}
+
+/*
+===========
+FS_FOpenFileReadIndexed
+
+FS_FOpenFileRead through the file index, only the directories that come
+before the pack holding the file have to be tried
+===========
+*/
+static long FS_FOpenFileReadIndexed(const char *filename, fileHandle_t *file, qboolean uniqueFILE)
+{
+	fileIndex_t	*entry;
+	int			order, i;
+	long		len;
+
+	// qpaths are not supposed to have a leading slash
+	if(filename[0] == '/' || filename[0] == '\\')
+		filename++;
+
+	if(strstr(filename, "..") || strstr(filename, "::"))
+		return FS_FOpenFileMissing(filename, file);
+
+	// impure packs are skipped when opening but not when testing
+	entry = FS_IndexLookup(filename, file != NULL);
+	order = entry ? entry->order : INT_MAX;
+
+	if(!FS_MissCached(filename, order))
+	{
+		for(i = 0; i < fs_numIndexDirs && fs_indexDirs[i].order < order; i++)
+		{
+			len = FS_FOpenFileReadDir(filename, fs_indexDirs[i].search, file, uniqueFILE, qfalse);
+
+			if(file == NULL)
+			{
+				if(len > 0)
+					return len;
+			}
+			else
+			{
+				if(len >= 0 && *file)
+					return len;
+			}
+		}
+
+		// a pure server may have kept some directories from being looked in
+		if(file == NULL || !fs_numServerPaks)
+			FS_CacheMiss(filename, order);
+	}
+
+	if(entry)
+		return FS_FOpenFileReadDir(filename, entry->search, file, uniqueFILE, qfalse);
+
+	return FS_FOpenFileMissing(filename, file);
+}
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1317,6 +1790,9 @@ long FS_FOpenFileRead(const char *filename, fileHandle_t *file, qboolean uniqueF
 	if(!fs_searchpaths)
 		Com_Error(ERR_FATAL, "Filesystem call made without initialization");
 
+	if(fs_indexHash && filename)
+		return FS_FOpenFileReadIndexed(filename, file, uniqueFILE);
+
 	for(search = fs_searchpaths; search; search = search->next)
 	{
 		len = FS_FOpenFileReadDir(filename, search, file, uniqueFILE, qfalse);
@@ -1334,22 +1810,7 @@ long FS_FOpenFileRead(const char *filename, fileHandle_t *file, qboolean uniqueF
 
 	}
 
-#ifdef FS_MISSING
-	if(missingFiles)
-		fprintf(missingFiles, "%s\n", filename);
-#endif
-
-	if(file)
-	{
-		*file = 0;
-		return -1;
-	}
-	else
-	{
-		// When file is NULL, we're querying the existance of the file
-		// If we've got here, it doesn't exist
-		return 0;
-	}
+	return FS_FOpenFileMissing(filename, file);
 }
 
 /*
@@ -1536,6 +1997,8 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 			buf += read;
 		}
 		return len;
+	} else if (fsh[f].zipData) {
+		return FS_ReadMappedZip(&fsh[f], buffer, len);
 	} else {
 		return unzReadCurrentFile(fsh[f].handleFiles.file.z, buffer, len);
 	}
@@ -1594,8 +2057,31 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	return len;
 }
 
-void QDECL FS_Printf( fileHandle_t h, const char *fmt, ... ) {
-	va_list		argptr;
+/*
+=================
+FS_ThreadWrite
+
+Writes and flushes without printing or erroring, so a thread that owns
+an already opened handle can use it. Returns qfalse if the write failed.
+=================
+*/
+qboolean FS_ThreadWrite( const void *buffer, int len, fileHandle_t h ) {
+	FILE	*f;
+
+	if ( h < 1 || h >= MAX_FILE_HANDLES || fsh[h].zipFile ) {
+		return qfalse;
+	}
+	if ( ( f = fsh[h].handleFiles.file.o ) == NULL ) {
+		return qfalse;
+	}
+	if ( fwrite( buffer, 1, len, f ) != len ) {
+		return qfalse;
+	}
+	return fflush( f ) == 0;
+}
+
+void QDECL FS_Printf( fileHandle_t h, const char *fmt, ... ) {
+	va_list		argptr;
 	char		msg[MAXPRINTMSG];
 
 	va_start (argptr,fmt);
@@ -1671,8 +2157,16 @@ int FS_Seek( fileHandle_t f, long offset, int origin ) {
 				if ( remainder == currentPosition ) {
 					return offset;
 				}
-				unzSetOffset(fsh[f].handleFiles.file.z, fsh[f].zipFilePos);
-				unzOpenCurrentFile(fsh[f].handleFiles.file.z);
+				if ( fsh[f].zipData ) {
+					fsh[f].zipReadPos = 0;
+					if ( fsh[f].zipInflating ) {
+						inflateEnd( &fsh[f].zipStream );
+						fsh[f].zipInflating = qfalse;
+					}
+				} else {
+					unzSetOffset(fsh[f].handleFiles.file.z, fsh[f].zipFilePos);
+					unzOpenCurrentFile(fsh[f].handleFiles.file.z);
+				}
 				//fallthrough
 
 			case FS_SEEK_END:
@@ -1783,213 +2277,989 @@ int	FS_FileIsInPAK_A( qboolean alternate, const char *filename, int *pChecksum )
 			} while(pakFile != NULL);
 		}
 	}
-	return -1;
+	return -1;
+}
+
+/*
+============
+FS_ReadFileDir
+
+Filename are relative to the quake search path
+a null buffer will just return the file length without loading
+If searchPath is non-NULL search only in that specific search path
+============
+*/
+long FS_ReadFileDir(const char *qpath, void *searchPath, qboolean unpure, void **buffer)
+{
+	fileHandle_t	h;
+	searchpath_t	*search;
+	byte*			buf;
+	qboolean		isConfig;
+	long				len;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+	}
+
+	buf = NULL;	// quiet compiler warning
+
+	// if this is a .cfg file and we are playing back a journal, read
+	// it from the journal file
+	if ( strstr( qpath, ".cfg" ) ) {
+		isConfig = qtrue;
+		if ( com_journal && com_journal->integer == 2 ) {
+			int		r;
+
+			Com_DPrintf( "Loading %s from journal file.\n", qpath );
+			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
+			if ( r != sizeof( len ) ) {
+				if (buffer != NULL) *buffer = NULL;
+				return -1;
+			}
+			// if the file didn't exist when the journal was created
+			if (!len) {
+				if (buffer == NULL) {
+					return 1;			// hack for old journal files
+				}
+				*buffer = NULL;
+				return -1;
+			}
+			if (buffer == NULL) {
+				return len;
+			}
+
+			buf = Hunk_AllocateTempMemory(len+1);
+			*buffer = buf;
+
+			r = FS_Read( buf, len, com_journalDataFile );
+			if ( r != len ) {
+				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
+			}
+
+			fs_loadCount++;
+			fs_loadStack++;
+
+			// guarantee that it will have a trailing 0 for string operations
+			buf[len] = 0;
+
+			return len;
+		}
+	} else {
+		isConfig = qfalse;
+	}
+
+	search = searchPath;
+
+	if(search == NULL)
+	{
+		// look for it in the filesystem or pack files
+		len = FS_FOpenFileRead(qpath, &h, qfalse);
+	}
+	else
+	{
+		// look for it in a specific search path only
+		len = FS_FOpenFileReadDir(qpath, search, &h, qfalse, unpure);
+	}
+
+	if ( h == 0 ) {
+		if ( buffer ) {
+			*buffer = NULL;
+		}
+		// if we are journalling and it is a config file, write a zero to the journal file
+		if ( isConfig && com_journal && com_journal->integer == 1 ) {
+			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
+			len = 0;
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		return -1;
+	}
+
+	if ( !buffer ) {
+		if ( isConfig && com_journal && com_journal->integer == 1 ) {
+			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		FS_FCloseFile( h);
+		return len;
+	}
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	buf = Hunk_AllocateTempMemory(len+1);
+	*buffer = buf;
+
+	FS_Read (buf, len, h);
+
+	// guarantee that it will have a trailing 0 for string operations
+	buf[len] = 0;
+	FS_FCloseFile( h );
+
+	// if we are journalling and it is a config file, write it to the journal file
+	if ( isConfig && com_journal && com_journal->integer == 1 ) {
+		Com_DPrintf( "Writing %s to journal file.\n", qpath );
+		FS_Write( &len, sizeof( len ), com_journalDataFile );
+		FS_Write( buf, len, com_journalDataFile );
+		FS_Flush( com_journalDataFile );
+	}
+	return len;
+}
+
+/*
+============
+FS_ReadFile
+
+Filename are relative to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+long FS_ReadFile(const char *qpath, void **buffer)
+{
+	return FS_ReadFileDir(qpath, NULL, qfalse, buffer);
+}
+
+/*
+============
+FS_ReadFileView
+
+Like FS_ReadFile, but a file stored uncompressed in a mapped pk3 is
+handed back where it is in the mapping instead of being copied.  The
+buffer is read only and has no trailing 0, free it with FS_FreeFileView.
+============
+*/
+long FS_ReadFileView(const char *qpath, const void **buffer)
+{
+	fileHandle_t	h;
+	byte			*buf;
+	long			len;
+	int				i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	// the journal only knows about copies
+	if ( com_journal && com_journal->integer ) {
+		return FS_ReadFile( qpath, (void **)buffer );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFileView with empty name" );
+	}
+
+	len = FS_FOpenFileRead( qpath, &h, qfalse );
+	if ( h == 0 ) {
+		*buffer = NULL;
+		return -1;
+	}
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	// views are kept int aligned for the callers that read whole structs
+	if ( fsh[h].zipData && fsh[h].zipMethod == PK3_STORED && !( (intptr_t)fsh[h].zipData & 3 ) ) {
+		for ( i = 0; i < MAX_FILE_VIEWS; i++ ) {
+			if ( !fs_fileViews[i] ) {
+				fs_fileViews[i] = fsh[h].zipData;
+				fs_readCount += len;
+				*buffer = fsh[h].zipData;
+				FS_FCloseFile( h );
+				return len;
+			}
+		}
+	}
+
+	buf = Hunk_AllocateTempMemory(len+1);
+	*buffer = buf;
+
+	FS_Read (buf, len, h);
+
+	buf[len] = 0;
+	FS_FCloseFile( h );
+	return len;
+}
+
+/*
+=============
+FS_FreeFileView
+=============
+*/
+void FS_FreeFileView( const void *buffer ) {
+	int		i;
+
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFileView( NULL )" );
+	}
+
+	for ( i = 0; i < MAX_FILE_VIEWS; i++ ) {
+		if ( fs_fileViews[i] == buffer ) {
+			fs_fileViews[i] = NULL;
+			if ( --fs_loadStack == 0 ) {
+				Hunk_ClearTempMemory();
+			}
+			return;
+		}
+	}
+
+	FS_FreeFile( (void *)buffer );
+}
+
+/*
+=============
+FS_FreeFile
+=============
+*/
+void FS_FreeFile( void *buffer ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+	}
+	fs_loadStack--;
+
+	Hunk_FreeTempMemory( buffer );
+
+	// if all of our temp files are free, clear all of our space
+	if ( fs_loadStack == 0 ) {
+		Hunk_ClearTempMemory();
+	}
+}
+
+/*
+============
+FS_WriteFile
+
+Filename are relative to the quake search path
+============
+*/
+void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
+	fileHandle_t f;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !buffer ) {
+		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
+	}
+
+	f = FS_FOpenFileWrite( qpath );
+	if ( !f ) {
+		Com_Printf( "Failed to open %s\n", qpath );
+		return;
+	}
+
+	FS_Write( buffer, size, f );
+
+	FS_FCloseFile( f );
+}
+
+
+
+/*
+==========================================================================
+
+ZIP FILE LOADING
+
+==========================================================================
+*/
+
+/*
+=================
+FS_MapZipFile
+
+Maps a whole zip read only so its files can be read without going
+through unzip
+=================
+*/
+static const byte *FS_MapZipFile( const char *zipfile, size_t *size ) {
+#ifdef __linux__
+	struct stat	st;
+	void		*data;
+	int			fd;
+#endif
+
+	*size = 0;
+
+#ifdef __linux__
+	if ( !fs_mapPaks || !fs_mapPaks->integer ) {
+		return NULL;
+	}
+
+	fd = open( zipfile, O_RDONLY );
+	if ( fd == -1 ) {
+		return NULL;
+	}
+	if ( fstat( fd, &st ) == -1 || st.st_size <= 0 ) {
+		close( fd );
+		return NULL;
+	}
+	data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( data == MAP_FAILED ) {
+		return NULL;
+	}
+	*size = st.st_size;
+	return data;
+#else
+	return NULL;
+#endif
+}
+
+/*
+=================
+FS_UnmapZipFile
+=================
+*/
+static void FS_UnmapZipFile( const byte *data, size_t size ) {
+#ifdef __linux__
+	if ( data ) {
+		munmap( (void *)data, size );
+	}
+#endif
+}
+
+/*
+=================
+FS_FindCentralDir
+
+Finds the central directory of a mapped zip.  Zips with anything in
+front of them are left to unzip, as the offsets would not be the ones
+unzGetOffset gives.
+=================
+*/
+static qboolean FS_FindCentralDir( const byte *map, size_t size, unsigned long *numEntries,
+	unsigned long *start, unsigned long *end ) {
+	const byte	*p;
+	size_t		i;
+
+	if ( size < 22 ) {
+		return qfalse;
+	}
+
+	// the end of central directory record is only followed by the comment
+	for ( i = size - 22; ; i-- ) {
+		p = map + i;
+		if ( FS_ZipLong( p ) == 0x06054b50 ) {
+			// no spanned zips, like unzOpen
+			if ( FS_ZipShort( p + 4 ) || FS_ZipShort( p + 6 ) || FS_ZipShort( p + 8 ) != FS_ZipShort( p + 10 ) ) {
+				return qfalse;
+			}
+			*numEntries = FS_ZipShort( p + 10 );
+			*start = FS_ZipLong( p + 16 );
+			*end = *start + FS_ZipLong( p + 12 );
+			return *start <= *end && *end == i;
+		}
+		if ( i == 0 || size - i >= 22 + 0xffff ) {
+			return qfalse;
+		}
+	}
+}
+
+/*
+=================
+FS_ReadCentralDirEntry
+
+Reads the central directory entry of a mapped zip at *pos and moves
+*pos on to the next one
+=================
+*/
+static qboolean FS_ReadCentralDirEntry( const byte *map, unsigned long end, unsigned long *pos,
+	fileInPack_t *entry, unsigned long *crc, char *name, int nameSize ) {
+	const byte	*p;
+	unsigned	nameLen, flags, method;
+	int			len;
+
+	if ( *pos + 46 > end ) {
+		return qfalse;
+	}
+	p = map + *pos;
+	if ( FS_ZipLong( p ) != 0x02014b50 ) {
+		return qfalse;
+	}
+
+	nameLen = FS_ZipShort( p + 28 );
+	if ( *pos + 46 + nameLen + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 ) > end ) {
+		return qfalse;
+	}
+
+	len = MIN( nameLen, nameSize - 1 );
+	Com_Memcpy( name, p + 46, len );
+	name[len] = '\0';
+
+	flags = FS_ZipShort( p + 8 );
+	method = FS_ZipShort( p + 10 );
+	*crc = FS_ZipLong( p + 16 );
+
+	entry->pos = *pos;
+	entry->compressedLen = FS_ZipLong( p + 20 );
+	entry->len = FS_ZipLong( p + 24 );
+	entry->localPos = FS_ZipLong( p + 42 );
+	if ( ( flags & 1 ) || ( method != PK3_STORED && method != PK3_DEFLATED ) ) {
+		entry->method = -1;		// encrypted or something unzip has to deal with
+	} else {
+		entry->method = method;
+	}
+
+	*pos += 46 + nameLen + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
+	return qtrue;
+}
+
+/*
+=================
+FS_AllocPak
+
+Allocates a pack with an empty hash table sized for numFiles
+=================
+*/
+static pack_t *FS_AllocPak( const char *zipfile, const char *basename, int numFiles )
+{
+	pack_t	*pack;
+	int		i;
+
+	// get the hash table size from the number of files in the zip
+	// because lots of custom pk3 files have less than 32 or 64 files
+	for (i = 1; i <= MAX_FILEHASH_SIZE; i <<= 1) {
+		if (i > numFiles) {
+			break;
+		}
+	}
+
+	pack = Z_Malloc( sizeof( pack_t ) + i * sizeof(fileInPack_t *) );
+	pack->hashSize = i;
+	pack->hashTable = (fileInPack_t **) (((char *) pack) + sizeof( pack_t ));
+	for(i = 0; i < pack->hashSize; i++) {
+		pack->hashTable[i] = NULL;
+	}
+
+	Q_strncpyz( pack->pakFilename, zipfile, sizeof( pack->pakFilename ) );
+	Q_strncpyz( pack->pakBasename, basename, sizeof( pack->pakBasename ) );
+
+	// strip .pk3 if needed
+	if ( strlen( pack->pakBasename ) > 4 && !Q_stricmp( pack->pakBasename + strlen( pack->pakBasename ) - 4, ".pk3" ) ) {
+		pack->pakBasename[strlen( pack->pakBasename ) - 4] = 0;
+	}
+
+	pack->numfiles = numFiles;
+	return pack;
+}
+
+/*
+=================
+FS_PakChecksums
+
+The pure checksum also covers fs_checksumFeed, so it is worked out
+again every time a pack is loaded
+=================
+*/
+static void FS_PakChecksums( pack_t *pack, const void *crcs, int numCrcs )
+{
+	int		*headerLongs;
+
+	headerLongs = Z_Malloc( ( numCrcs + 1 ) * sizeof( int ) );
+	headerLongs[0] = LittleLong( fs_checksumFeed );
+	Com_Memcpy( headerLongs + 1, crcs, numCrcs * sizeof( int ) );
+
+	pack->checksum = Com_BlockChecksum( headerLongs + 1, sizeof( *headerLongs ) * numCrcs );
+	pack->pure_checksum = Com_BlockChecksum( headerLongs, sizeof( *headerLongs ) * ( numCrcs + 1 ) );
+	pack->checksum = LittleLong( pack->checksum );
+	pack->pure_checksum = LittleLong( pack->pure_checksum );
+
+	Z_Free( headerLongs );
+}
+
+/*
+=============================================================================
+
+PK3 CACHE
+
+What FS_LoadZipFile learns from the central directory of every pk3 is
+kept in PAK_CACHE_NAME under fs_homepath, keyed by the path, size and
+modification time of the pk3.  The whole cache is read the first time a
+pk3 is loaded and written back at the end of FS_Startup if anything in
+it changed, so a restart only reads the central directories of the pk3s
+that are new or were changed.
+
+=============================================================================
+*/
+
+#define	PAK_CACHE_NAME		"pk3cache.dat"
+#define	PAK_CACHE_IDENT		(('C'<<24)+('3'<<16)+('K'<<8)+'P')
+#define	PAK_CACHE_VERSION	1
+#define	PAK_CACHE_HASH_SIZE	1024
+
+typedef struct {
+	int			ident;
+	int			version;
+	int			numPaks;
+	int			size;			// of the whole cache
+} pakCacheHeader_t;
+
+typedef struct {
+	int			size;			// of the whole record, a multiple of 8
+	int			pathLen;		// with the trailing 0
+	int64_t		fileSize;
+	int64_t		fileTime;
+	int			numFiles;
+	int			hashSize;
+	int			numCrcs;		// crcs of the files with data, as they go into the checksums
+	int			mapped;			// localPos and method were read from the zip
+	int			namesLen;
+	int			pad;
+	// followed by the path padded to 4 bytes, the crcs, numFiles
+	// pakCacheFile_t and the names of the files
+} pakCacheRecord_t;
+
+typedef struct {
+	unsigned int	pos;
+	unsigned int	len;
+	unsigned int	compressedLen;
+	unsigned int	localPos;
+	int				method;
+	int				hash;			// not trusted, the bucket is hashed again on load
+} pakCacheFile_t;
+
+typedef struct pakCacheEntry_s {
+	byte					*data;		// the record
+	qboolean				owned;		// data was allocated for the entry alone
+	qboolean				used;		// a pack was loaded from it this time
+	qboolean				stale;		// the pk3 changed since
+	struct pakCacheEntry_s	*next;		// next entry in the hash
+} pakCacheEntry_t;
+
+static	cvar_t			*fs_pk3Cache;
+static	qboolean		fs_pakCacheLoaded;
+static	qboolean		fs_pakCacheDirty;
+static	byte			*fs_pakCacheData;
+static	pakCacheEntry_t	*fs_pakCacheHash[PAK_CACHE_HASH_SIZE];
+
+/*
+=================
+FS_PakCachePath
+
+Returns qfalse if there is to be no cache
+=================
+*/
+static qboolean FS_PakCachePath( char *path, int size )
+{
+	if ( !fs_pk3Cache || !fs_pk3Cache->integer || !fs_homepath || !fs_homepath->string[0] ) {
+		return qfalse;
+	}
+
+	Com_sprintf( path, size, "%s%c%s", fs_homepath->string, PATH_SEP, PAK_CACHE_NAME );
+	return qtrue;
+}
+
+/*
+=================
+FS_PakCacheHash
+=================
+*/
+static int FS_PakCacheHash( const char *path )
+{
+	unsigned	hash = 0;
+
+	while ( *path ) {
+		hash = hash * 31 + (byte)*path++;
+	}
+
+	return hash & ( PAK_CACHE_HASH_SIZE - 1 );
+}
+
+/*
+=================
+FS_PakRecordSize
+
+Size of a record with these counts, or -1 if they make no sense
+=================
+*/
+static int FS_PakRecordSize( const pakCacheRecord_t *rec )
+{
+	if ( rec->pathLen < 1 || rec->pathLen > MAX_OSPATH || rec->numFiles < 0 ||
+		rec->numCrcs < 0 || rec->numCrcs > rec->numFiles || rec->namesLen < rec->numFiles ||
+		rec->numFiles > 0xffff || rec->namesLen > 0xffff * MAX_ZPATH ) {
+		return -1;
+	}
+
+	return PAD( sizeof( *rec ) + PAD( rec->pathLen, 4 ) + rec->numCrcs * sizeof( int ) +
+		rec->numFiles * sizeof( pakCacheFile_t ) + rec->namesLen, 8 );
+}
+
+/*
+=================
+FS_AddPakCacheEntry
+=================
+*/
+static pakCacheEntry_t *FS_AddPakCacheEntry( byte *data, qboolean owned )
+{
+	pakCacheEntry_t	*entry;
+	int				hash;
+
+	hash = FS_PakCacheHash( (char *)data + sizeof( pakCacheRecord_t ) );
+
+	entry = Z_Malloc( sizeof( *entry ) );
+	entry->data = data;
+	entry->owned = owned;
+	entry->next = fs_pakCacheHash[hash];
+	fs_pakCacheHash[hash] = entry;
+
+	return entry;
+}
+
+/*
+=================
+FS_FindPakCacheEntry
+=================
+*/
+static pakCacheEntry_t *FS_FindPakCacheEntry( const char *path )
+{
+	pakCacheEntry_t	*entry;
+
+	for ( entry = fs_pakCacheHash[FS_PakCacheHash( path )]; entry; entry = entry->next ) {
+		if ( !entry->stale && !strcmp( (char *)entry->data + sizeof( pakCacheRecord_t ), path ) ) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+=================
+FS_WritePakCache
+
+Writes every record that still matches a pk3.  Records of pk3s that
+were not loaded this time, from other game directories for instance,
+are kept as long as the pk3 is still there.
+=================
+*/
+static void FS_WritePakCache( void )
+{
+	pakCacheHeader_t	header;
+	pakCacheRecord_t	rec;
+	pakCacheEntry_t		*entry;
+	struct stat			st;
+	char				path[MAX_OSPATH];
+	char				tempPath[MAX_OSPATH];
+	FILE				*f;
+	int					i;
+
+	if ( !FS_PakCachePath( path, sizeof( path ) ) ) {
+		return;
+	}
+
+	// servers sharing the home path can write at the same time, each
+	// into its own file and the last rename wins
+	Com_sprintf( tempPath, sizeof( tempPath ), "%s.%d.tmp", path, (int)getpid() );
+	f = Sys_FOpen( tempPath, "wb" );
+	if ( !f ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't write %s\n", tempPath );
+		return;
+	}
+
+	header.ident = PAK_CACHE_IDENT;
+	header.version = PAK_CACHE_VERSION;
+	header.numPaks = 0;
+	header.size = sizeof( header );
+	fwrite( &header, sizeof( header ), 1, f );
+
+	for ( i = 0; i < PAK_CACHE_HASH_SIZE; i++ ) {
+		for ( entry = fs_pakCacheHash[i]; entry; entry = entry->next ) {
+			if ( entry->stale ) {
+				continue;
+			}
+
+			Com_Memcpy( &rec, entry->data, sizeof( rec ) );
+			if ( !entry->used && stat( (char *)entry->data + sizeof( rec ), &st ) == -1 ) {
+				continue;
+			}
+
+			fwrite( entry->data, rec.size, 1, f );
+			header.numPaks++;
+			header.size += rec.size;
+		}
+	}
+
+	rewind( f );
+	fwrite( &header, sizeof( header ), 1, f );
+
+	if ( ferror( f ) ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't write %s\n", tempPath );
+		fclose( f );
+		remove( tempPath );
+		return;
+	}
+	fclose( f );
+
+	remove( path );
+	if ( rename( tempPath, path ) ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't rename %s\n", tempPath );
+		remove( tempPath );
+	}
 }
 
 /*
-============
-FS_ReadFileDir
+=================
+FS_FreePakCache
 
-Filename are relative to the quake search path
-a null buffer will just return the file length without loading
-If searchPath is non-NULL search only in that specific search path
-============
+Writes the cache back first if write is set and anything changed
+=================
 */
-long FS_ReadFileDir(const char *qpath, void *searchPath, qboolean unpure, void **buffer)
+static void FS_FreePakCache( qboolean write )
 {
-	fileHandle_t	h;
-	searchpath_t	*search;
-	byte*			buf;
-	qboolean		isConfig;
-	long				len;
+	pakCacheEntry_t	*entry, *next;
+	int				i;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	if ( write && fs_pakCacheLoaded && fs_pakCacheDirty ) {
+		FS_WritePakCache();
 	}
 
-	if ( !qpath || !qpath[0] ) {
-		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+	for ( i = 0; i < PAK_CACHE_HASH_SIZE; i++ ) {
+		for ( entry = fs_pakCacheHash[i]; entry; entry = next ) {
+			next = entry->next;
+			if ( entry->owned ) {
+				Z_Free( entry->data );
+			}
+			Z_Free( entry );
+		}
+		fs_pakCacheHash[i] = NULL;
 	}
 
-	buf = NULL;	// quiet compiler warning
-
-	// if this is a .cfg file and we are playing back a journal, read
-	// it from the journal file
-	if ( strstr( qpath, ".cfg" ) ) {
-		isConfig = qtrue;
-		if ( com_journal && com_journal->integer == 2 ) {
-			int		r;
-
-			Com_DPrintf( "Loading %s from journal file.\n", qpath );
-			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
-			if ( r != sizeof( len ) ) {
-				if (buffer != NULL) *buffer = NULL;
-				return -1;
-			}
-			// if the file didn't exist when the journal was created
-			if (!len) {
-				if (buffer == NULL) {
-					return 1;			// hack for old journal files
-				}
-				*buffer = NULL;
-				return -1;
-			}
-			if (buffer == NULL) {
-				return len;
-			}
+	if ( fs_pakCacheData ) {
+		Z_Free( fs_pakCacheData );
+		fs_pakCacheData = NULL;
+	}
 
-			buf = Hunk_AllocateTempMemory(len+1);
-			*buffer = buf;
+	fs_pakCacheLoaded = qfalse;
+	fs_pakCacheDirty = qfalse;
+}
 
-			r = FS_Read( buf, len, com_journalDataFile );
-			if ( r != len ) {
-				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
-			}
+/*
+=================
+FS_LoadPakCache
 
-			fs_loadCount++;
-			fs_loadStack++;
+Reads the whole cache and checks that every record fits.  A cache that
+doesn't is thrown away and written again.
+=================
+*/
+static void FS_LoadPakCache( void )
+{
+	pakCacheHeader_t	header;
+	pakCacheRecord_t	rec;
+	char				path[MAX_OSPATH];
+	FILE				*f;
+	int					i, pos, size, len;
 
-			// guarantee that it will have a trailing 0 for string operations
-			buf[len] = 0;
+	fs_pakCacheLoaded = qtrue;
+	fs_pakCacheDirty = qfalse;
 
-			return len;
-		}
-	} else {
-		isConfig = qfalse;
+	if ( !FS_PakCachePath( path, sizeof( path ) ) ) {
+		return;
 	}
 
-	search = searchPath;
+	f = Sys_FOpen( path, "rb" );
+	if ( !f ) {
+		fs_pakCacheDirty = qtrue;
+		return;
+	}
 
-	if(search == NULL)
-	{
-		// look for it in the filesystem or pack files
-		len = FS_FOpenFileRead(qpath, &h, qfalse);
+	len = FS_fplength( f ) - (int)sizeof( header );
+	if ( len < 0 || fread( &header, sizeof( header ), 1, f ) != 1 ||
+		header.ident != PAK_CACHE_IDENT || header.version != PAK_CACHE_VERSION ||
+		header.size != len + (int)sizeof( header ) || header.numPaks < 0 ) {
+		Com_Printf( "Rebuilding %s\n", path );
+		fclose( f );
+		fs_pakCacheDirty = qtrue;
+		return;
 	}
-	else
-	{
-		// look for it in a specific search path only
-		len = FS_FOpenFileReadDir(qpath, search, &h, qfalse, unpure);
+
+	fs_pakCacheData = Z_Malloc( len + 1 );
+	if ( fread( fs_pakCacheData, 1, len, f ) != len ) {
+		header.numPaks = -1;
 	}
+	fclose( f );
 
-	if ( h == 0 ) {
-		if ( buffer ) {
-			*buffer = NULL;
+	for ( i = 0, pos = 0; i < header.numPaks; i++ ) {
+		if ( pos + (int)sizeof( rec ) > len ) {
+			break;
 		}
-		// if we are journalling and it is a config file, write a zero to the journal file
-		if ( isConfig && com_journal && com_journal->integer == 1 ) {
-			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
-			len = 0;
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
+		Com_Memcpy( &rec, fs_pakCacheData + pos, sizeof( rec ) );
+		size = FS_PakRecordSize( &rec );
+		if ( size == -1 || size != rec.size || pos + size > len ||
+			fs_pakCacheData[pos + sizeof( rec ) + rec.pathLen - 1] != '\0' ) {
+			break;
 		}
-		return -1;
-	}
 
-	if ( !buffer ) {
-		if ( isConfig && com_journal && com_journal->integer == 1 ) {
-			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
-		}
-		FS_FCloseFile( h);
-		return len;
+		FS_AddPakCacheEntry( fs_pakCacheData + pos, qfalse );
+		pos += size;
 	}
 
-	fs_loadCount++;
-	fs_loadStack++;
-
-	buf = Hunk_AllocateTempMemory(len+1);
-	*buffer = buf;
-
-	FS_Read (buf, len, h);
-
-	// guarantee that it will have a trailing 0 for string operations
-	buf[len] = 0;
-	FS_FCloseFile( h );
-
-	// if we are journalling and it is a config file, write it to the journal file
-	if ( isConfig && com_journal && com_journal->integer == 1 ) {
-		Com_DPrintf( "Writing %s to journal file.\n", qpath );
-		FS_Write( &len, sizeof( len ), com_journalDataFile );
-		FS_Write( buf, len, com_journalDataFile );
-		FS_Flush( com_journalDataFile );
+	if ( i != header.numPaks || pos != len ) {
+		Com_Printf( "Rebuilding %s\n", path );
+		FS_FreePakCache( qfalse );
+		fs_pakCacheLoaded = qtrue;
+		fs_pakCacheDirty = qtrue;
 	}
-	return len;
 }
 
 /*
-============
-FS_ReadFile
+=================
+FS_LoadCachedPak
 
-Filename are relative to the quake search path
-a null buffer will just return the file length without loading
-============
+Builds the pack out of its cache record if the pk3 hasn't changed
+since.  A record without the positions of the local headers is only
+good enough when the pk3 isn't mapped.
+=================
 */
-long FS_ReadFile(const char *qpath, void **buffer)
+static pack_t *FS_LoadCachedPak( const char *zipfile, const char *basename,
+	const struct stat *st, const byte *map, size_t mapSize )
 {
-	return FS_ReadFileDir(qpath, NULL, qfalse, buffer);
-}
+	pakCacheEntry_t		*entry;
+	pakCacheRecord_t	rec;
+	pakCacheFile_t		file;
+	fileInPack_t		*buildBuffer;
+	pack_t				*pack;
+	const byte			*crcs, *files;
+	char				*names, *namesEnd;
+	int					i;
 
-/*
-=============
-FS_FreeFile
-=============
-*/
-void FS_FreeFile( void *buffer ) {
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	if ( !fs_pakCacheLoaded ) {
+		FS_LoadPakCache();
 	}
-	if ( !buffer ) {
-		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+
+	entry = FS_FindPakCacheEntry( zipfile );
+	if ( !entry ) {
+		return NULL;
 	}
-	fs_loadStack--;
 
-	Hunk_FreeTempMemory( buffer );
+	Com_Memcpy( &rec, entry->data, sizeof( rec ) );
+	if ( rec.fileSize != st->st_size || rec.fileTime != st->st_mtime || ( map && !rec.mapped ) ) {
+		entry->stale = qtrue;
+		fs_pakCacheDirty = qtrue;
+		return NULL;
+	}
 
-	// if all of our temp files are free, clear all of our space
-	if ( fs_loadStack == 0 ) {
-		Hunk_ClearTempMemory();
+	crcs = entry->data + sizeof( rec ) + PAD( rec.pathLen, 4 );
+	files = crcs + rec.numCrcs * sizeof( int );
+
+	pack = FS_AllocPak( zipfile, basename, rec.numFiles );
+	buildBuffer = Z_Malloc( rec.numFiles * sizeof( fileInPack_t ) + rec.namesLen );
+	names = (char *)( buildBuffer + rec.numFiles );
+	namesEnd = names + rec.namesLen;
+	Com_Memcpy( names, files + rec.numFiles * sizeof( file ), rec.namesLen );
+
+	for ( i = 0; i < rec.numFiles; i++ ) {
+		Com_Memcpy( &file, files + i * sizeof( file ), sizeof( file ) );
+		if ( names >= namesEnd || !memchr( names, '\0', namesEnd - names ) ) {
+			break;
+		}
+
+		// so a change to the hash or the table size can't lose files
+		file.hash = FS_HashFileName( names, pack->hashSize );
+
+		buildBuffer[i].name = names;
+		buildBuffer[i].pos = file.pos;
+		buildBuffer[i].len = file.len;
+		buildBuffer[i].compressedLen = file.compressedLen;
+		buildBuffer[i].localPos = file.localPos;
+		buildBuffer[i].method = rec.mapped ? file.method : -1;
+		buildBuffer[i].next = pack->hashTable[file.hash];
+		pack->hashTable[file.hash] = &buildBuffer[i];
+		names += strlen( names ) + 1;
+	}
+
+	if ( i < rec.numFiles ) {
+		Z_Free( buildBuffer );
+		Z_Free( pack );
+		entry->stale = qtrue;
+		fs_pakCacheDirty = qtrue;
+		return NULL;
 	}
+
+	FS_PakChecksums( pack, crcs, rec.numCrcs );
+
+	pack->buildBuffer = buildBuffer;
+	pack->mapData = map;
+	pack->mapSize = map ? mapSize : 0;
+	entry->used = qtrue;
+	return pack;
 }
 
 /*
-============
-FS_WriteFile
+=================
+FS_CachePak
 
-Filename are relative to the quake search path
-============
+Adds a record for a pack that was just read from its zip
+=================
 */
-void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
-	fileHandle_t f;
-
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-	}
-
-	if ( !qpath || !buffer ) {
-		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
+static void FS_CachePak( const pack_t *pack, const struct stat *st,
+	const int *crcs, int numCrcs, int namesLen, qboolean mapped )
+{
+	pakCacheRecord_t	rec;
+	pakCacheFile_t		file;
+	pakCacheEntry_t		*entry;
+	char				path[MAX_OSPATH];
+	byte				*data, *p;
+	int					i;
+
+	if ( !fs_pakCacheLoaded || !FS_PakCachePath( path, sizeof( path ) ) ) {
+		return;
 	}
 
-	f = FS_FOpenFileWrite( qpath );
-	if ( !f ) {
-		Com_Printf( "Failed to open %s\n", qpath );
+	Com_Memset( &rec, 0, sizeof( rec ) );
+	rec.pathLen = strlen( pack->pakFilename ) + 1;
+	rec.fileSize = st->st_size;
+	rec.fileTime = st->st_mtime;
+	rec.numFiles = pack->numfiles;
+	rec.hashSize = pack->hashSize;
+	rec.numCrcs = numCrcs;
+	rec.mapped = mapped;
+	rec.namesLen = namesLen;
+	rec.size = FS_PakRecordSize( &rec );
+	if ( rec.size == -1 ) {
 		return;
 	}
 
-	FS_Write( buffer, size, f );
-
-	FS_FCloseFile( f );
-}
-
+	// an older record of the same pk3 goes when this one is written
+	entry = FS_FindPakCacheEntry( pack->pakFilename );
+	if ( entry ) {
+		entry->stale = qtrue;
+	}
 
+	data = Z_Malloc( rec.size );
+	Com_Memcpy( data, &rec, sizeof( rec ) );
+	p = data + sizeof( rec );
+	Com_Memcpy( p, pack->pakFilename, rec.pathLen );
+	p += PAD( rec.pathLen, 4 );
+	Com_Memcpy( p, crcs, numCrcs * sizeof( int ) );
+	p += numCrcs * sizeof( int );
 
-/*
-==========================================================================
+	for ( i = 0; i < pack->numfiles; i++ ) {
+		file.pos = pack->buildBuffer[i].pos;
+		file.len = pack->buildBuffer[i].len;
+		file.compressedLen = pack->buildBuffer[i].compressedLen;
+		file.localPos = pack->buildBuffer[i].localPos;
+		file.method = pack->buildBuffer[i].method;
+		file.hash = FS_HashFileName( pack->buildBuffer[i].name, pack->hashSize );
+		Com_Memcpy( p, &file, sizeof( file ) );
+		p += sizeof( file );
+	}
 
-ZIP FILE LOADING
+	// the names follow the files in the build buffer
+	Com_Memcpy( p, pack->buildBuffer + pack->numfiles, namesLen );
 
-==========================================================================
-*/
+	entry = FS_AddPakCacheEntry( data, qtrue );
+	entry->used = qtrue;
+	fs_pakCacheDirty = qtrue;
+}
 
 /*
 =================
@@ -2002,6 +3272,7 @@ of a zip file.
 static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 {
 	fileInPack_t	*buildBuffer;
+	fileInPack_t	entry;
 	pack_t			*pack;
 	unzFile			uf;
 	int				err;
@@ -2013,89 +3284,123 @@ static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 	int				fs_numHeaderLongs;
 	int				*fs_headerLongs;
 	char			*namePtr;
+	const byte		*map;
+	size_t			mapSize;
+	unsigned long	numEntries, cdStart, cdEnd, cdPos, crc;
+	struct stat		st;
+	qboolean		cacheable;
 
 	fs_numHeaderLongs = 0;
 
-	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
+	// with the zip mapped the central directory is read from memory
+	// and the files are read without unzip
+	cdStart = cdEnd = 0;
+	map = FS_MapZipFile(zipfile, &mapSize);
 
-	if (err != UNZ_OK)
-		return NULL;
+	cacheable = stat(zipfile, &st) != -1;
+	if (cacheable && (pack = FS_LoadCachedPak(zipfile, basename, &st, map, mapSize)) != NULL) {
+		return pack;
+	}
 
+	uf = NULL;
 	len = 0;
-	unzGoToFirstFile(uf);
-	for (i = 0; i < gi.number_entry; i++)
+	if (map && FS_FindCentralDir(map, mapSize, &numEntries, &cdStart, &cdEnd))
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
+		cdPos = cdStart;
+		for (i = 0; i < numEntries; i++)
+		{
+			if (!FS_ReadCentralDirEntry(map, cdEnd, &cdPos, &entry, &crc, filename_inzip, sizeof(filename_inzip))) {
+				break;
+			}
+			len += strlen(filename_inzip) + 1;
 		}
-		len += strlen(filename_inzip) + 1;
-		unzGoToNextFile(uf);
-	}
 
-	buildBuffer = Z_Malloc( (gi.number_entry * sizeof( fileInPack_t )) + len );
-	namePtr = ((char *) buildBuffer) + gi.number_entry * sizeof( fileInPack_t );
-	fs_headerLongs = Z_Malloc( ( gi.number_entry + 1 ) * sizeof(int) );
-	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
-
-	// get the hash table size from the number of files in the zip
-	// because lots of custom pk3 files have less than 32 or 64 files
-	for (i = 1; i <= MAX_FILEHASH_SIZE; i <<= 1) {
-		if (i > gi.number_entry) {
-			break;
+		if (i < numEntries) {
+			FS_UnmapZipFile(map, mapSize);
+			map = NULL;
+			len = 0;
 		}
 	}
-
-	pack = Z_Malloc( sizeof( pack_t ) + i * sizeof(fileInPack_t *) );
-	pack->hashSize = i;
-	pack->hashTable = (fileInPack_t **) (((char *) pack) + sizeof( pack_t ));
-	for(i = 0; i < pack->hashSize; i++) {
-		pack->hashTable[i] = NULL;
+	else if (map)
+	{
+		FS_UnmapZipFile(map, mapSize);
+		map = NULL;
 	}
 
-	Q_strncpyz( pack->pakFilename, zipfile, sizeof( pack->pakFilename ) );
-	Q_strncpyz( pack->pakBasename, basename, sizeof( pack->pakBasename ) );
+	if (!map)
+	{
+		uf = unzOpen(zipfile);
+		err = unzGetGlobalInfo (uf,&gi);
 
-	// strip .pk3 if needed
-	if ( strlen( pack->pakBasename ) > 4 && !Q_stricmp( pack->pakBasename + strlen( pack->pakBasename ) - 4, ".pk3" ) ) {
-		pack->pakBasename[strlen( pack->pakBasename ) - 4] = 0;
+		if (err != UNZ_OK)
+			return NULL;
+
+		numEntries = gi.number_entry;
+		unzGoToFirstFile(uf);
+		for (i = 0; i < numEntries; i++)
+		{
+			err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
+			if (err != UNZ_OK) {
+				break;
+			}
+			len += strlen(filename_inzip) + 1;
+			unzGoToNextFile(uf);
+		}
 	}
 
+	buildBuffer = Z_Malloc( (numEntries * sizeof( fileInPack_t )) + len );
+	namePtr = ((char *) buildBuffer) + numEntries * sizeof( fileInPack_t );
+	fs_headerLongs = Z_Malloc( ( numEntries + 1 ) * sizeof(int) );
+
+	pack = FS_AllocPak( zipfile, basename, numEntries );
 	pack->handle = uf;
-	pack->numfiles = gi.number_entry;
-	unzGoToFirstFile(uf);
+	pack->mapData = map;
+	pack->mapSize = map ? mapSize : 0;
+	if (uf) {
+		unzGoToFirstFile(uf);
+	}
+	cdPos = map ? cdStart : 0;
 
-	for (i = 0; i < gi.number_entry; i++)
+	for (i = 0; i < numEntries; i++)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
+		if (map) {
+			FS_ReadCentralDirEntry(map, cdEnd, &cdPos, &entry, &crc, filename_inzip, sizeof(filename_inzip));
+		} else {
+			err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
+			if (err != UNZ_OK) {
+				break;
+			}
+			// store the file position in the zip
+			entry.pos = unzGetOffset(uf);
+			entry.len = file_info.uncompressed_size;
+			entry.compressedLen = file_info.compressed_size;
+			entry.localPos = 0;
+			entry.method = -1;
+			crc = file_info.crc;
+			unzGoToNextFile(uf);
 		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
+		if (entry.len > 0) {
+			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(crc);
 		}
 		Q_strlwr( filename_inzip );
 		hash = FS_HashFileName(filename_inzip, pack->hashSize);
+		buildBuffer[i] = entry;
 		buildBuffer[i].name = namePtr;
 		strcpy( buildBuffer[i].name, filename_inzip );
 		namePtr += strlen(filename_inzip) + 1;
-		// store the file position in the zip
-		buildBuffer[i].pos = unzGetOffset(uf);
-		buildBuffer[i].len = file_info.uncompressed_size;
 		buildBuffer[i].next = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[i];
-		unzGoToNextFile(uf);
 	}
 
-	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], sizeof(*fs_headerLongs) * ( fs_numHeaderLongs - 1 ) );
-	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, sizeof(*fs_headerLongs) * fs_numHeaderLongs );
-	pack->checksum = LittleLong( pack->checksum );
-	pack->pure_checksum = LittleLong( pack->pure_checksum );
+	FS_PakChecksums( pack, fs_headerLongs, fs_numHeaderLongs );
+	pack->buildBuffer = buildBuffer;
 
-	Z_Free(fs_headerLongs);
+	// a zip unzip gave up on half way through isn't worth remembering
+	if (cacheable && i == numEntries) {
+		FS_CachePak( pack, &st, fs_headerLongs, fs_numHeaderLongs, len, map != NULL );
+	}
 
-	pack->buildBuffer = buildBuffer;
+	Z_Free(fs_headerLongs);
 	return pack;
 }
 
@@ -2109,7 +3414,10 @@ Frees a pak structure and releases all associated resources
 
 static void FS_FreePak(pack_t *thepak)
 {
-	unzClose(thepak->handle);
+	if (thepak->handle) {
+		unzClose(thepak->handle);
+	}
+	FS_UnmapZipFile(thepak->mapData, thepak->mapSize);
 	Z_Free(thepak->buildBuffer);
 	Z_Free(thepak);
 }
@@ -2798,7 +4106,7 @@ void FS_Path_f( void ) {
 
 	Com_Printf( "\n" );
 	for ( i = 1 ; i < MAX_FILE_HANDLES ; i++ ) {
-		if ( fsh[i].handleFiles.file.o ) {
+		if ( fsh[i].handleFiles.file.o || fsh[i].zipData ) {
 			Com_Printf( "handle %i: %s\n", i, fsh[i].name );
 		}
 	}
@@ -3284,6 +4592,8 @@ void FS_Shutdown( qboolean closemfp ) {
 
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
+	FS_FreeFileIndex();
+	FS_FreePakCache( qtrue );
 
 	Cmd_RemoveCommand( "path" );
 	Cmd_RemoveCommand( "dir" );
@@ -3363,6 +4673,9 @@ static void FS_Startup( const char *gameName )
 	fs_homepath = Cvar_Get ("fs_homepath", homePath, CVAR_INIT|CVAR_PROTECTED );
 	fs_gamedirvar = Cvar_Get ("fs_game", "gpp", CVAR_INIT|CVAR_SYSTEMINFO );
 	Cvar_Get( "fs_pk3PrefixPairs", "", CVAR_ARCHIVE|CVAR_LATCH );
+	fs_missCache = Cvar_Get( "fs_missCache", "5000", 0 );
+	fs_mapPaks = Cvar_Get( "fs_mapPaks", "1", 0 );
+	fs_pk3Cache = Cvar_Get( "fs_pk3Cache", "1", 0 );
 
 	// add search path elements in reverse priority order
 	if (fs_basepath->string[0]) {
@@ -3403,6 +4716,9 @@ static void FS_Startup( const char *gameName )
 		}
 	}
 
+	// remember the central directories of any new pk3s
+	FS_FreePakCache( qtrue );
+
 	// add our commands
 	Cmd_AddCommand ("path", FS_Path_f);
 	Cmd_AddCommand ("dir", FS_Dir_f );
@@ -3413,6 +4729,7 @@ static void FS_Startup( const char *gameName )
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
+	FS_BuildFileIndex();
 
 	// print the current search paths
 	FS_Path_f();
@@ -3936,7 +5253,10 @@ qboolean FS_ConditionalRestart(int checksumFeed, qboolean disconnect)
 	if(checksumFeed != fs_checksumFeed)
 		FS_Restart(checksumFeed);
 	else if(fs_numServerPaks && !fs_reordered)
+	{
 		FS_ReorderPurePaks();
+		FS_BuildFileIndex();
+	}
 
 	return qfalse;
 }
@@ -3999,7 +5319,9 @@ int		FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 
 int		FS_FTell( fileHandle_t f ) {
 	int pos;
-	if (fsh[f].zipFile == qtrue) {
+	if (fsh[f].zipData) {
+		pos = fsh[f].zipReadPos;
+	} else if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	} else {
 		pos = ftell(fsh[f].handleFiles.file.o);
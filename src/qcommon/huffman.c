@@ -31,14 +31,15 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 
 static int			bloc = 0;
 
+// the offset based writers don't touch bloc, so messages may be
+// written from several threads at once
 void	Huff_putBit( int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+	int b = *offset;
+	if ((b&7) == 0) {
+		fout[(b>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
-	*offset = bloc;
+	fout[(b>>3)] |= bit << (b&7);
+	*offset = b + 1;
 }
 
 int		Huff_getBloc(void)
@@ -308,21 +309,21 @@ maxoffset) {
 }
 
 /* Send the prefix code for this node */
-static void send(node_t *node, node_t *child, byte *fout, int maxoffset) {
+static void send(node_t *node, node_t *child, byte *fout, int *offset, int maxoffset) {
 	if (node->parent) {
-		send(node->parent, node, fout, maxoffset);
+		send(node->parent, node, fout, offset, maxoffset);
 	}
 	if (child) {
-		if (bloc >= maxoffset)
+		if (*offset >= maxoffset)
     {
-        bloc = maxoffset + 1;
+        *offset = maxoffset + 1;
         return;
     }
 
 		if (node->right == child) {
-			add_bit(1, fout);
+			Huff_putBit(1, fout, offset);
 		} else {
-			add_bit(0, fout);
+			Huff_putBit(0, fout, offset);
 		}
 	}
 }
@@ -337,15 +338,13 @@ void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset) {
 			add_bit((char)((ch >> i) & 0x1), fout);
 		}
 	} else {
-		send(huff->loc[ch], NULL, fout, maxoffset);
+		send(huff->loc[ch], NULL, fout, &bloc, maxoffset);
 	}
 }
 
 void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset, int
 maxoffset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout, maxoffset);
-	*offset = bloc;
+	send(huff->loc[ch], NULL, fout, offset, maxoffset);
 }
 
 void Huff_Decompress(msg_t *mbuf, int offset) {
@@ -400,8 +399,6 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern 	int oldsize;
-
 void Huff_Compress(msg_t *mbuf, int offset) {
 	int			i, ch, size;
 	byte		seq[65536];
@@ -459,3 +456,128 @@ void Huff_Init(huffman_t *huff) {
 	huff->compressor.lhead->next = huff->compressor.lhead->prev = NULL;
 	huff->compressor.tree->parent = huff->compressor.tree->left = huff->compressor.tree->right = NULL;
 }
+
+/*
+=============================================================================
+
+Static tree tables
+
+The message trees are built once in MSG_initHuffman and never change, so
+every code is looked up from a table instead of walking the tree one bit at
+a time. The codes are the tree's own, the bitstream is exactly the same.
+
+=============================================================================
+*/
+
+/* Append the low bits of value, first bit first */
+void Huff_putBits( unsigned int value, int bits, byte *fout, int *offset ) {
+	int			b = *offset;
+	int			shift = b & 7;
+	int			i, numBytes;
+	byte		*out = fout + ( b >> 3 );
+	uint64_t	acc;
+
+	acc = (uint64_t)value << shift;
+	if ( shift ) {
+		// like Huff_putBit, keep the bits already written to this byte
+		acc |= out[0] & ( ( 1 << shift ) - 1 );
+	}
+
+	numBytes = ( shift + bits + 7 ) >> 3;
+	for ( i = 0; i < numBytes; i++ ) {
+		out[i] = (byte)( acc >> ( i << 3 ) );
+	}
+
+	*offset = b + bits;
+}
+
+/* Read bits written by Huff_putBits */
+unsigned int Huff_getBits( const byte *fin, int bits, int *offset ) {
+	int			b = *offset;
+	int			shift = b & 7;
+	int			i, numBytes;
+	const byte	*in = fin + ( b >> 3 );
+	uint64_t	acc = 0;
+
+	numBytes = ( shift + bits + 7 ) >> 3;
+	for ( i = 0; i < numBytes; i++ ) {
+		acc |= (uint64_t)in[i] << ( i << 3 );
+	}
+
+	*offset = b + bits;
+	return (unsigned int)( ( acc >> shift ) & ( ( (uint64_t)1 << bits ) - 1 ) );
+}
+
+/* Build the code and lookup tables for a tree that won't be updated again */
+void Huff_BuildTable( huff_t *huff, huffTable_t *table ) {
+	node_t			*node;
+	unsigned int	code;
+	int				ch, len, i;
+
+	Com_Memset( table, 0, sizeof( *table ) );
+	table->tree = huff->tree;
+
+	for ( ch = 0; ch < HMAX; ch++ ) {
+		if ( !huff->loc[ch] ) {
+			continue;
+		}
+
+		// walk up to the root, the root's branch is sent first
+		code = 0;
+		len = 0;
+		for ( node = huff->loc[ch]; node->parent; node = node->parent ) {
+			if ( len == 32 ) {
+				Com_Error( ERR_FATAL, "Huff_BuildTable: code for %d is too long", ch );
+			}
+			code = ( code << 1 ) | ( node->parent->right == node );
+			len++;
+		}
+
+		table->code[ch] = code;
+		table->length[ch] = len;
+
+		// codes too long for the lookup are decoded from the tree
+		if ( len > HUFF_LOOKUP_BITS ) {
+			continue;
+		}
+		for ( i = 0; i < ( 1 << ( HUFF_LOOKUP_BITS - len ) ); i++ ) {
+			table->lookup[ code | ( i << len ) ] = ch | ( len << 8 );
+		}
+	}
+}
+
+/* Send a symbol, same as Huff_offsetTransmit */
+void Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset, int maxoffset ) {
+	int		len = table->length[ch];
+	int		room;
+
+	if ( *offset + len <= maxoffset ) {
+		Huff_putBits( table->code[ch], len, fout, offset );
+		return;
+	}
+
+	// send what fits and flag the overflow
+	room = maxoffset - *offset;
+	if ( room > 0 ) {
+		Huff_putBits( table->code[ch], room, fout, offset );
+	}
+	*offset = maxoffset + 1;
+}
+
+/* Get a symbol, same as Huff_offsetReceive */
+void Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int maxoffset ) {
+	int		entry;
+	int		b;
+
+	if ( *offset + HUFF_LOOKUP_BITS <= maxoffset ) {
+		b = *offset;
+		entry = table->lookup[ Huff_getBits( fin, HUFF_LOOKUP_BITS, &b ) ];
+		if ( entry ) {
+			*ch = entry & 0xff;
+			*offset += entry >> 8;
+			return;
+		}
+	}
+
+	Huff_offsetReceive( table->tree, ch, fin, offset, maxoffset );
+}
@@ -25,6 +25,7 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 #include "qcommon.h"
 
 static huffman_t		msgHuff;
+static huffTable_t		msgHuffTable;	// both trees of msgHuff are the same
 
 static qboolean			msgInit = qfalse;
 
@@ -39,8 +40,6 @@ Handles byte ordering and avoids alignment errors
 ==============================================================================
 */
 
-int oldsize = 0;
-
 void MSG_initHuffman( void );
 
 void MSG_Init( msg_t *buf, byte *data, int length ) {
@@ -108,8 +107,6 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	int	i;
 //	FILE*	fp;
 
-	oldsize += bits;
-
 	if ( msg->overflowed )
 	{
 		return;
@@ -163,16 +160,14 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 				msg->overflowed = qtrue;
 				return;
 			}
-			for(i=0;i<nbits;i++) {
-				Huff_putBit((value&1), msg->data, &msg->bit);
-				value = (value>>1);
-			}
+			Huff_putBits(value & ((1<<nbits)-1), nbits, msg->data, &msg->bit);
+			value = (value>>nbits);
 			bits = bits - nbits;
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
 //				fwrite(bp, 1, 1, fp);
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data,
+				Huff_tableTransmit (&msgHuffTable, (value&0xff), msg->data,
 														 &msg->bit, msg->maxsize << 3);
 				value = (value>>8);
 
@@ -188,6 +183,52 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	}
 }
 
+/*
+==================
+MSG_WriteBitstream
+
+Appends bits that were already written to another bitstream message
+starting at bit 0, the huffman codes don't depend on their position
+so this gives the same bits as repeating the writes
+==================
+*/
+void MSG_WriteBitstream( msg_t *msg, const byte *data, int bits ) {
+	int		i, numBytes;
+	int		shift, dst;
+
+	if ( msg->overflowed || bits <= 0 ) {
+		return;
+	}
+
+	if ( msg->oob ) {
+		Com_Error( ERR_DROP, "MSG_WriteBitstream: can't append to an OOB message" );
+	}
+
+	if ( msg->bit + bits > msg->maxsize << 3 ) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	numBytes = ( bits + 7 ) >> 3;
+	shift = msg->bit & 7;
+	dst = msg->bit >> 3;
+
+	if ( !shift ) {
+		Com_Memcpy( msg->data + dst, data, numBytes );
+	} else {
+		// like Huff_putBit, the unused high bits of the current byte are zero
+		for ( i = 0 ; i < numBytes ; i++ ) {
+			msg->data[dst + i] |= data[i] << shift;
+			if ( dst + i + 1 < msg->maxsize ) {
+				msg->data[dst + i + 1] = data[i] >> ( 8 - shift );
+			}
+		}
+	}
+
+	msg->bit += bits;
+	msg->cursize = (msg->bit>>3)+1;
+}
+
 int MSG_ReadBits( msg_t *msg, int bits ) {
 	int			value;
 	int			get;
@@ -247,14 +288,12 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 				msg->readcount = msg->cursize + 1;
 				return 0;
 			}
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
+			value = Huff_getBits(msg->data, nbits, &msg->bit);
 			bits = bits - nbits;
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data,
+				Huff_tableReceive (&msgHuffTable, &get, msg->data,
 														&msg->bit, msg->cursize << 3);
 				value |= (get<<(i+nbits));
 
@@ -654,7 +693,6 @@ void MSG_WriteDeltaUsercmdKey( msg_t *msg, int key, usercmd_t *from, usercmd_t *
 		from->buttons == to->buttons &&
 		from->weapon == to->weapon) {
 			MSG_WriteBits( msg, 0, 1 );				// no change
-			oldsize += 7;
 			return;
 	}
 	key ^= to->serverTime;
@@ -881,8 +919,6 @@ void MSG_WriteDeltaEntity( int alternateProtocol, msg_t *msg, struct entityState
 		MSG_WriteByte( msg, lc );	// # of changes
 	}
 
-	oldsize += numFields;
-
 	for ( i = 0, field = entityStateFields ; i < lc ; i++, field++ ) {
 		if ( alternateProtocol == 2 && i == 13 ) {
 			continue;
@@ -905,7 +941,6 @@ void MSG_WriteDeltaEntity( int alternateProtocol, msg_t *msg, struct entityState
 
 			if (fullFloat == 0.0f) {
 					MSG_WriteBits( msg, 0, 1 );
-					oldsize += FLOAT_INT_BITS;
 			} else {
 				MSG_WriteBits( msg, 1, 1 );
 				if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 && 
@@ -1321,8 +1356,6 @@ void MSG_WriteDeltaPlayerstate( int alternateProtocol, msg_t *msg, struct player
 		MSG_WriteByte( msg, lc );	// # of changes
 	}
 
-	oldsize += numFields - lc;
-
 	for ( i = 0, field = playerStateFields ; i < lc ; i++, field++ ) {
 		if ( alternateProtocol == 2 && ( i == 15 || i == 34 || i == 35 || i == 41 ) ) {
 			continue;
@@ -1411,7 +1444,6 @@ void MSG_WriteDeltaPlayerstate( int alternateProtocol, msg_t *msg, struct player
 
 	if (!statsbits && !persistantbits && !ammobits && !miscbits) {
 		MSG_WriteBits( msg, 0, 1 );	// no change
-		oldsize += 4;
 		return;
 	}
 	MSG_WriteBits( msg, 1, 1 );	// changed
@@ -2005,6 +2037,7 @@ void MSG_initHuffman( void ) {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	Huff_BuildTable(&msgHuff.decompressor, &msgHuffTable);
 }
 
 /*
@@ -22,6 +22,10 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 ===========================================================================
 */
 
+#ifdef __linux__
+#	define _GNU_SOURCE		// recvmmsg and sendmmsg
+#endif
+
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
 
@@ -113,6 +117,8 @@ static cvar_t	*net_mcast6addr;
 static cvar_t	*net_mcast6iface;
 
 static cvar_t	*net_dropsim;
+static cvar_t	*net_batch;
+static cvar_t	*net_epoll;
 
 static struct sockaddr	socksRelayAddr;
 
@@ -151,6 +157,72 @@ typedef struct
 static nip_localaddr_t localIP[MAX_IPS];
 static int numIP;
 
+// packets moved per socket call, for net_stats
+static struct {
+	unsigned int	recvCalls;
+	unsigned int	recvPackets;
+	unsigned int	sendCalls;
+	unsigned int	sendPackets;
+} net_stats;
+
+#ifdef __linux__
+/*
+With net_batch above 1, NET_GetPacket pulls up to that many datagrams out
+of a socket with one recvmmsg and hands them out one at a time, and the
+packets sent between Sys_BeginPacketBatch and Sys_FlushPacketBatch go out
+with sendmmsg, a batch per run of packets to the same socket.
+*/
+#define NET_BATCHED_IO
+
+#define NET_MAX_BATCH			32
+#define NET_BATCH_PACKETLEN		1400	// larger packets are sent on their own
+
+static struct {
+	int						alternateProtocol;
+	int						count;
+	int						next;
+	struct mmsghdr			msgs[NET_MAX_BATCH];
+	struct iovec			iov[NET_MAX_BATCH];
+	struct sockaddr_storage	from[NET_MAX_BATCH];
+	byte					data[NET_MAX_BATCH][MAX_MSGLEN + 1];
+} net_recvBatch;
+
+static struct {
+	qboolean				active;
+	SOCKET					sock;
+	int						count;
+	struct mmsghdr			msgs[NET_MAX_BATCH];
+	struct iovec			iov[NET_MAX_BATCH];
+	struct sockaddr_storage	to[NET_MAX_BATCH];
+	netadrtype_t			type[NET_MAX_BATCH];
+	byte					data[NET_MAX_BATCH][NET_BATCH_PACKETLEN];
+} net_sendBatch;
+#endif
+
+#if defined(__linux__) && defined(DEDICATED)
+/*
+With net_epoll set, the dedicated server waits for its next frame in
+NET_SleepUntil: one epoll set holds the sockets and a timerfd armed at the
+exact frame deadline, so the wait ends on the first packet or right on
+time instead of polling through the last millisecond.
+*/
+#define NET_EPOLL
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+static int		net_epollFd = -1;
+static int		net_timerFd = -1;
+
+// wakeups and how late the deadline ones were, for net_stats
+static struct {
+	unsigned int	socketWakeups;
+	unsigned int	timerWakeups;
+	int64_t			lateUsec;
+	int64_t			maxLateUsec;
+} net_epollStats;
+#endif
+
 
 //=============================================================================
 
@@ -523,6 +595,136 @@ qboolean	NET_IsLocalAddress( netadr_t adr ) {
 
 //=============================================================================
 
+/*
+==================
+NET_AcceptPacket
+
+Fills in the sender of a packet received on socket slot a
+==================
+*/
+static qboolean NET_AcceptPacket(int a, struct sockaddr_storage *from, socklen_t fromlen, int ret, netadr_t *net_from, msg_t *net_message)
+{
+	if(from->ss_family == AF_INET)
+	{
+		memset( ((struct sockaddr_in *)from)->sin_zero, 0, 8 );
+
+		if ( usingSocks && memcmp( from, &socksRelayAddr, fromlen ) == 0 ) {
+			if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
+				return qfalse;
+			}
+			net_from->type = NA_IP;
+			net_from->ip[0] = net_message->data[4];
+			net_from->ip[1] = net_message->data[5];
+			net_from->ip[2] = net_message->data[6];
+			net_from->ip[3] = net_message->data[7];
+			net_from->port = *(short *)&net_message->data[8];
+			net_message->readcount = 10;
+		}
+		else {
+			SockadrToNetadr( (struct sockaddr *) from, net_from );
+			net_message->readcount = 0;
+		}
+	}
+	else
+	{
+		SockadrToNetadr( (struct sockaddr *) from, net_from );
+		net_message->readcount = 0;
+	}
+
+	net_from->alternateProtocol = a;
+
+	if( ret >= net_message->maxsize ) {
+		Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
+		return qfalse;
+	}
+
+	net_message->cursize = ret;
+	return qtrue;
+}
+
+#ifdef NET_BATCHED_IO
+/*
+==================
+NET_GetBatchedPacket
+
+Hands out the next packet of the current batch, reading a new batch from
+the first socket select() flagged once it runs out. Sockets that come up
+empty are cleared from fdr so they aren't read again until the next select.
+==================
+*/
+static qboolean NET_GetBatchedPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
+{
+	int		a, i, n, ret, len;
+	SOCKET	sock;
+	int		err;
+
+	while(1)
+	{
+		while(net_recvBatch.next < net_recvBatch.count)
+		{
+			i = net_recvBatch.next++;
+			len = net_recvBatch.msgs[i].msg_len;
+
+			Com_Memcpy( net_message->data, net_recvBatch.data[i], MIN( len, net_message->maxsize ) );
+			if(NET_AcceptPacket(net_recvBatch.alternateProtocol, &net_recvBatch.from[i],
+				net_recvBatch.msgs[i].msg_hdr.msg_namelen, len, net_from, net_message))
+				return qtrue;
+		}
+
+		net_recvBatch.count = net_recvBatch.next = 0;
+
+		sock = INVALID_SOCKET;
+		for(a = 0; a < 3; ++a)
+		{
+			if(ip_sockets[a] != INVALID_SOCKET && FD_ISSET(ip_sockets[a], fdr))
+				sock = ip_sockets[a];
+			else if(ip6_sockets[a] != INVALID_SOCKET && FD_ISSET(ip6_sockets[a], fdr))
+				sock = ip6_sockets[a];
+			else
+				continue;
+			break;
+		}
+		if(sock == INVALID_SOCKET)
+			return qfalse;
+
+		n = MIN( net_batch->integer, NET_MAX_BATCH );
+		for(i = 0; i < n; i++)
+		{
+			net_recvBatch.iov[i].iov_base = net_recvBatch.data[i];
+			net_recvBatch.iov[i].iov_len = sizeof( net_recvBatch.data[i] );
+			Com_Memset( &net_recvBatch.msgs[i].msg_hdr, 0, sizeof( net_recvBatch.msgs[i].msg_hdr ) );
+			net_recvBatch.msgs[i].msg_hdr.msg_iov = &net_recvBatch.iov[i];
+			net_recvBatch.msgs[i].msg_hdr.msg_iovlen = 1;
+			net_recvBatch.msgs[i].msg_hdr.msg_name = &net_recvBatch.from[i];
+			net_recvBatch.msgs[i].msg_hdr.msg_namelen = sizeof( net_recvBatch.from[i] );
+		}
+
+		ret = recvmmsg( sock, net_recvBatch.msgs, n, MSG_DONTWAIT, NULL );
+		net_stats.recvCalls++;
+
+		if(ret == SOCKET_ERROR)
+		{
+			err = socketError;
+
+			if( err != EAGAIN && err != ECONNRESET )
+				Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+		}
+		else
+			net_stats.recvPackets += ret;
+
+		// a short batch means the socket is drained
+		if(ret < n)
+			FD_CLR(sock, fdr);
+
+		if(ret > 0)
+		{
+			net_recvBatch.alternateProtocol = a;
+			net_recvBatch.count = ret;
+		}
+	}
+}
+#endif
+
 /*
 ==================
 NET_GetPacket
@@ -537,7 +739,12 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	struct sockaddr_storage from;
 	socklen_t	fromlen;
 	int		err;
-	
+
+#ifdef NET_BATCHED_IO
+	if(net_batch->integer > 1 || net_recvBatch.next < net_recvBatch.count)
+		return NET_GetBatchedPacket(net_from, net_message, fdr);
+#endif
+
 	for(a = 0; a < 3; ++a)
 	{
 	// indent
@@ -545,7 +752,8 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	{
 		fromlen = sizeof(from);
 		ret = recvfrom( ip_sockets[a], (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen );
-		
+		net_stats.recvCalls++;
+
 		if (ret == SOCKET_ERROR)
 		{
 			err = socketError;
@@ -555,35 +763,8 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 		}
 		else
 		{
-
-			memset( ((struct sockaddr_in *)&from)->sin_zero, 0, 8 );
-		
-			if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
-				if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
-					return qfalse;
-				}
-				net_from->type = NA_IP;
-				net_from->ip[0] = net_message->data[4];
-				net_from->ip[1] = net_message->data[5];
-				net_from->ip[2] = net_message->data[6];
-				net_from->ip[3] = net_message->data[7];
-				net_from->port = *(short *)&net_message->data[8];
-				net_message->readcount = 10;
-			}
-			else {
-				SockadrToNetadr( (struct sockaddr *) &from, net_from );
-				net_message->readcount = 0;
-			}
-
-			net_from->alternateProtocol = a;
-		
-			if( ret >= net_message->maxsize ) {
-				Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
-				return qfalse;
-			}
-			
-			net_message->cursize = ret;
-			return qtrue;
+			net_stats.recvPackets++;
+			return NET_AcceptPacket(a, &from, fromlen, ret, net_from, net_message);
 		}
 	}
 	
@@ -591,7 +772,8 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	{
 		fromlen = sizeof(from);
 		ret = recvfrom(ip6_sockets[a], (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
-		
+		net_stats.recvCalls++;
+
 		if (ret == SOCKET_ERROR)
 		{
 			err = socketError;
@@ -601,19 +783,8 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 		}
 		else
 		{
-			SockadrToNetadr((struct sockaddr *) &from, net_from);
-			net_message->readcount = 0;
-		
-			net_from->alternateProtocol = a;
-
-			if(ret >= net_message->maxsize)
-			{
-				Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
-				return qfalse;
-			}
-			
-			net_message->cursize = ret;
-			return qtrue;
+			net_stats.recvPackets++;
+			return NET_AcceptPacket(a, &from, fromlen, ret, net_from, net_message);
 		}
 	}
 
@@ -658,6 +829,117 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 
 static char socksBuf[4096];
 
+/*
+==================
+NET_SendFailed
+==================
+*/
+static void NET_SendFailed( int err, netadrtype_t type ) {
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
+	}
+
+	// some PPP links do not allow broadcasts and return an error
+	if( ( err == EADDRNOTAVAIL ) && ( ( type == NA_BROADCAST ) ) ) {
+		return;
+	}
+
+	Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#ifdef NET_BATCHED_IO
+/*
+==================
+NET_SendBatch
+==================
+*/
+static void NET_SendBatch( void ) {
+	int		sent, ret;
+
+	for( sent = 0; sent < net_sendBatch.count; ) {
+		ret = sendmmsg( net_sendBatch.sock, net_sendBatch.msgs + sent, net_sendBatch.count - sent, 0 );
+		net_stats.sendCalls++;
+
+		if( ret == SOCKET_ERROR ) {
+			// the first packet failed, drop it and carry on with the rest
+			NET_SendFailed( socketError, net_sendBatch.type[sent] );
+			sent++;
+			continue;
+		}
+
+		net_stats.sendPackets += ret;
+		sent += ret;
+	}
+
+	net_sendBatch.count = 0;
+}
+
+/*
+==================
+NET_QueuePacket
+
+Returns qfalse if the packet has to be sent on its own
+==================
+*/
+static qboolean NET_QueuePacket( SOCKET sock, const struct sockaddr_storage *addr, socklen_t addrlen,
+	const void *data, int length, netadrtype_t type ) {
+	int		i;
+
+	if( length > NET_BATCH_PACKETLEN ) {
+		// keep the order packets were sent in
+		NET_SendBatch();
+		return qfalse;
+	}
+
+	if( net_sendBatch.count && ( net_sendBatch.sock != sock ||
+		net_sendBatch.count == MIN( net_batch->integer, NET_MAX_BATCH ) ) ) {
+		NET_SendBatch();
+	}
+
+	i = net_sendBatch.count++;
+	net_sendBatch.sock = sock;
+	net_sendBatch.type[i] = type;
+	Com_Memcpy( &net_sendBatch.to[i], addr, addrlen );
+	Com_Memcpy( net_sendBatch.data[i], data, length );
+
+	net_sendBatch.iov[i].iov_base = net_sendBatch.data[i];
+	net_sendBatch.iov[i].iov_len = length;
+	Com_Memset( &net_sendBatch.msgs[i].msg_hdr, 0, sizeof( net_sendBatch.msgs[i].msg_hdr ) );
+	net_sendBatch.msgs[i].msg_hdr.msg_iov = &net_sendBatch.iov[i];
+	net_sendBatch.msgs[i].msg_hdr.msg_iovlen = 1;
+	net_sendBatch.msgs[i].msg_hdr.msg_name = &net_sendBatch.to[i];
+	net_sendBatch.msgs[i].msg_hdr.msg_namelen = addrlen;
+
+	return qtrue;
+}
+#endif
+
+/*
+==================
+Sys_BeginPacketBatch
+
+Packets sent from here on may be held back until Sys_FlushPacketBatch
+==================
+*/
+void Sys_BeginPacketBatch( void ) {
+#ifdef NET_BATCHED_IO
+	net_sendBatch.active = ( net_batch->integer > 1 );
+#endif
+}
+
+/*
+==================
+Sys_FlushPacketBatch
+==================
+*/
+void Sys_FlushPacketBatch( void ) {
+#ifdef NET_BATCHED_IO
+	NET_SendBatch();
+	net_sendBatch.active = qfalse;
+#endif
+}
+
 /*
 ==================
 Sys_SendPacket
@@ -696,26 +978,28 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 		ret = sendto( ip_sockets[to.alternateProtocol], socksBuf, length+10, 0, &socksRelayAddr, sizeof(socksRelayAddr) );
 	}
 	else {
+#ifdef NET_BATCHED_IO
+		if( net_sendBatch.active ) {
+			if( addr.ss_family == AF_INET &&
+				NET_QueuePacket( ip_sockets[to.alternateProtocol], &addr, sizeof(struct sockaddr_in), data, length, to.type ) )
+				return;
+			if( addr.ss_family == AF_INET6 &&
+				NET_QueuePacket( ip6_sockets[to.alternateProtocol], &addr, sizeof(struct sockaddr_in6), data, length, to.type ) )
+				return;
+		}
+#endif
 		if(addr.ss_family == AF_INET)
 			ret = sendto( ip_sockets[to.alternateProtocol], data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in) );
 		else if(addr.ss_family == AF_INET6)
 			ret = sendto( ip6_sockets[to.alternateProtocol], data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in6) );
 	}
-	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
+	net_stats.sendCalls++;
 
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( ( err == EADDRNOTAVAIL ) && ( ( to.type == NA_BROADCAST ) ) ) {
-			return;
-		}
-
-		Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
+	if( ret == SOCKET_ERROR ) {
+		NET_SendFailed( socketError, to.type );
+		return;
 	}
+	net_stats.sendPackets++;
 }
 
 
@@ -1543,10 +1827,90 @@ static qboolean NET_GetCvars( void ) {
 
 	net_dropsim = Cvar_Get("net_dropsim", "", CVAR_TEMP);
 
+#ifdef NET_BATCHED_IO
+	net_batch = Cvar_Get( "net_batch", "16", CVAR_ARCHIVE );
+#else
+	net_batch = Cvar_Get( "net_batch", "0", CVAR_ROM );
+#endif
+
+#ifdef NET_EPOLL
+	net_epoll = Cvar_Get( "net_epoll", "1", CVAR_ARCHIVE );
+#else
+	net_epoll = Cvar_Get( "net_epoll", "0", CVAR_ROM );
+#endif
+
 	return modified ? qtrue : qfalse;
 }
 
 
+#ifdef NET_EPOLL
+/*
+====================
+NET_EpollClose
+====================
+*/
+static void NET_EpollClose( void ) {
+	if( net_epollFd != -1 ) {
+		close( net_epollFd );
+		net_epollFd = -1;
+	}
+
+	if( net_timerFd != -1 ) {
+		close( net_timerFd );
+		net_timerFd = -1;
+	}
+}
+
+/*
+====================
+NET_EpollOpen
+
+Builds the epoll set over the open sockets, falls back to select() on failure
+====================
+*/
+static void NET_EpollOpen( void ) {
+	struct epoll_event	ev;
+	int		a;
+
+	NET_EpollClose();
+
+	net_epollFd = epoll_create1( EPOLL_CLOEXEC );
+	net_timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if( net_epollFd == -1 || net_timerFd == -1 ) {
+		Com_Printf( "WARNING: NET_EpollOpen: %s\n", NET_ErrorString() );
+		NET_EpollClose();
+		return;
+	}
+
+	Com_Memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+	ev.data.fd = net_timerFd;
+	if( epoll_ctl( net_epollFd, EPOLL_CTL_ADD, net_timerFd, &ev ) == -1 ) {
+		Com_Printf( "WARNING: NET_EpollOpen: %s\n", NET_ErrorString() );
+		NET_EpollClose();
+		return;
+	}
+
+	for( a = 0; a < 3; ++a ) {
+		SOCKET	socks[2] = { ip_sockets[a], ip6_sockets[a] };
+		int		i;
+
+		for( i = 0; i < 2; i++ ) {
+			if( socks[i] == INVALID_SOCKET ) {
+				continue;
+			}
+
+			ev.data.fd = socks[i];
+			if( epoll_ctl( net_epollFd, EPOLL_CTL_ADD, socks[i], &ev ) == -1 ) {
+				Com_Printf( "WARNING: NET_EpollOpen: %s\n", NET_ErrorString() );
+				NET_EpollClose();
+				return;
+			}
+		}
+	}
+}
+#endif
+
 /*
 ====================
 NET_Config
@@ -1593,6 +1957,14 @@ void NET_Config( qboolean enableNetworking ) {
 	}
 
 	if( stop ) {
+#ifdef NET_BATCHED_IO
+		NET_SendBatch();
+		net_recvBatch.count = net_recvBatch.next = 0;
+#endif
+#ifdef NET_EPOLL
+		NET_EpollClose();
+#endif
+
 		for( a = 0; a < 3; ++a )
 		{
 			if ( ip_sockets[a] != INVALID_SOCKET ) {
@@ -1630,11 +2002,43 @@ void NET_Config( qboolean enableNetworking ) {
 		{
 			NET_OpenIP();
 			NET_SetMulticast6();
+#ifdef NET_EPOLL
+			NET_EpollOpen();
+#endif
 		}
 	}
 }
 
 
+/*
+====================
+NET_Stats_f
+====================
+*/
+static void NET_Stats_f( void ) {
+	if( !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		Com_Memset( &net_stats, 0, sizeof( net_stats ) );
+#ifdef NET_EPOLL
+		Com_Memset( &net_epollStats, 0, sizeof( net_epollStats ) );
+#endif
+		return;
+	}
+
+	Com_Printf( "receive: %u packets in %u calls, %.2f per call\n", net_stats.recvPackets,
+		net_stats.recvCalls, net_stats.recvCalls ? (float)net_stats.recvPackets / net_stats.recvCalls : 0.0f );
+	Com_Printf( "send:    %u packets in %u calls, %.2f per call\n", net_stats.sendPackets,
+		net_stats.sendCalls, net_stats.sendCalls ? (float)net_stats.sendPackets / net_stats.sendCalls : 0.0f );
+#ifndef NET_BATCHED_IO
+	Com_Printf( "batched socket calls are not available on this platform\n" );
+#endif
+#ifdef NET_EPOLL
+	Com_Printf( "epoll:   %u wakeups on packets, %u on deadlines, %.1f usec late on average, %.1f max\n",
+		net_epollStats.socketWakeups, net_epollStats.timerWakeups,
+		net_epollStats.timerWakeups ? (float)net_epollStats.lateUsec / net_epollStats.timerWakeups : 0.0f,
+		(float)net_epollStats.maxLateUsec );
+#endif
+}
+
 /*
 ====================
 NET_Init
@@ -1657,6 +2061,7 @@ void NET_Init( void ) {
 	NET_Config( qtrue );
 	
 	Cmd_AddCommand ("net_restart", NET_Restart_f);
+	Cmd_AddCommand ("net_stats", NET_Stats_f);
 }
 
 
@@ -1691,7 +2096,10 @@ void NET_Event(fd_set *fdr)
 	byte bufData[MAX_MSGLEN + 1];
 	netadr_t from = {0};
 	msg_t netmsg;
-	
+
+	// replies to a burst of requests go out together
+	Sys_BeginPacketBatch();
+
 	while(1)
 	{
 		MSG_Init(&netmsg, bufData, sizeof(bufData));
@@ -1713,6 +2121,8 @@ void NET_Event(fd_set *fdr)
 		else
 			break;
 	}
+
+	Sys_FlushPacketBatch();
 }
 
 /*
@@ -1773,6 +2183,83 @@ void NET_Sleep(int msec)
 		NET_Event(&fdr);
 }
 
+/*
+====================
+NET_SleepUntil
+
+Sleeps until Sys_Milliseconds reaches msecTime or something happens on the
+network. Returns qfalse when the epoll loop isn't in use, the caller should
+fall back to NET_Sleep then.
+====================
+*/
+qboolean NET_SleepUntil(int msecTime)
+{
+#ifdef NET_EPOLL
+	struct epoll_event events[8];
+	struct itimerspec deadline;
+	int64_t wakeUsec;
+	fd_set fdr;
+	uint64_t expirations;
+	qboolean onTime = qfalse;
+	int retval;
+	int i;
+
+	if(!net_epoll->integer || net_epollFd == -1)
+		return qfalse;
+
+	// rearming also drops an expiration left over from an earlier deadline
+	wakeUsec = Sys_MicrosecondsAt(msecTime);
+	Com_Memset(&deadline, 0, sizeof(deadline));
+	deadline.it_value.tv_sec = wakeUsec / 1000000;
+	deadline.it_value.tv_nsec = (wakeUsec % 1000000) * 1000;
+
+	if(wakeUsec <= 0 || timerfd_settime(net_timerFd, TFD_TIMER_ABSTIME, &deadline, NULL) == -1)
+		return qfalse;
+
+	retval = epoll_wait(net_epollFd, events, ARRAY_LEN(events), -1);
+
+	if(retval == -1)
+	{
+		if(errno != EINTR)
+			Com_Printf("Warning: epoll_wait() syscall failed: %s\n", NET_ErrorString());
+		return qtrue;
+	}
+
+	FD_ZERO(&fdr);
+
+	for(i = 0; i < retval; i++)
+	{
+		if(events[i].data.fd == net_timerFd)
+		{
+			if(read(net_timerFd, &expirations, sizeof(expirations)) == sizeof(expirations))
+				onTime = qtrue;
+		}
+		else
+			FD_SET(events[i].data.fd, &fdr);
+	}
+
+	if(onTime)
+	{
+		int64_t late = Sys_Microseconds() - wakeUsec;
+
+		net_epollStats.timerWakeups++;
+		net_epollStats.lateUsec += late;
+		if(late > net_epollStats.maxLateUsec)
+			net_epollStats.maxLateUsec = late;
+	}
+
+	if(retval > (onTime ? 1 : 0))
+	{
+		net_epollStats.socketWakeups++;
+		NET_Event(&fdr);
+	}
+
+	return qtrue;
+#else
+	return qfalse;
+#endif
+}
+
 /*
 ====================
 NET_Restart_f
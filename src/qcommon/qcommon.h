@@ -67,6 +67,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits( msg_t *msg, int value, int bits );
+void MSG_WriteBitstream( msg_t *msg, const byte *data, int bits );
 
 void MSG_WriteChar (msg_t *sb, int c);
 void MSG_WriteByte (msg_t *sb, int c);
@@ -193,6 +194,7 @@ qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, msg_t *net_messag
 void		NET_JoinMulticast6(void);
 void		NET_LeaveMulticast6(void);
 void		NET_Sleep(int msec);
+qboolean	NET_SleepUntil(int msecTime);
 
 
 #define	MAX_MSGLEN				16384		// max length of a message, which may
@@ -651,6 +653,8 @@ int		FS_FileIsInPAK_A(qboolean alternate, const char *filename, int *pChecksum )
 // returns 1 if a file is in the PAK file, otherwise -1
 
 int		FS_Write( const void *buffer, int len, fileHandle_t f );
+qboolean	FS_ThreadWrite( const void *buffer, int len, fileHandle_t f );
+// safe to call from a thread that owns the handle, never prints
 
 int		FS_Read2( void *buffer, int len, fileHandle_t f );
 int		FS_Read( void *buffer, int len, fileHandle_t f );
@@ -674,6 +678,13 @@ void	FS_ForceFlush( fileHandle_t f );
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+long	FS_ReadFileView( const char *qpath, const void **buffer );
+// like FS_ReadFile, but files stored uncompressed in a mapped pk3 are
+// returned in place instead of copied, with no trailing 0
+
+void	FS_FreeFileView( const void *buffer );
+// frees a buffer returned by FS_ReadFileView
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -1032,6 +1043,17 @@ int SV_FrameMsec(void);
 qboolean SV_GameCommand( void );
 int SV_SendQueuedPackets(void);
 
+// what one client of a server demo did: a usercmd in use for msec,
+// or a command when command is set
+typedef struct {
+	int			msec;
+	usercmd_t	cmd;
+	char		*command;
+} demoInput_t;
+
+int SV_DemoLoadInput( const char *name, demoInput_t **inputs, int *numInputs );
+void SV_DemoFreeInput( demoInput_t **inputs, int *numInputs );
+
 //
 // UI interface
 //
@@ -1064,6 +1086,10 @@ void	Sys_Print( const char *msg );
 // Sys_Milliseconds should only be used for profiling purposes,
 // any game related timing information should come from event timestamps
 int		Sys_Milliseconds (void);
+// monotonic, only meaningful as a difference between two calls
+int64_t	Sys_Microseconds (void);
+// Sys_Microseconds value at which Sys_Milliseconds will return msec
+int64_t	Sys_MicrosecondsAt (int msec);
 
 qboolean Sys_RandomBytes( byte *string, int len );
 
@@ -1075,6 +1101,9 @@ cpuFeatures_t Sys_GetProcessorFeatures( void );
 void	Sys_SetErrorText( const char *text );
 
 void	Sys_SendPacket( int length, const void *data, netadr_t to );
+// packets sent between these may be held back and sent with a single call
+void	Sys_BeginPacketBatch( void );
+void	Sys_FlushPacketBatch( void );
 
 qboolean	Sys_StringToAdr( const char *s, netadr_t *a, netadrtype_t family );
 //Does NOT parse port numbers, only base addresses.
@@ -1106,6 +1135,29 @@ void	Sys_Sleep(int msec);
 
 qboolean Sys_LowPhysicalMemory( void );
 
+// threads are only used for work that doesn't touch the rest of the engine,
+// nothing outside of the thread's own data may be called from it
+typedef struct sysThread_s	sysThread_t;
+typedef struct sysMutex_s	sysMutex_t;
+typedef struct sysCond_s	sysCond_t;
+
+sysThread_t	*Sys_CreateThread( void (*function)( void *data ), void *data );
+void		Sys_JoinThread( sysThread_t *thread );
+
+sysMutex_t	*Sys_CreateMutex( void );
+void		Sys_DestroyMutex( sysMutex_t *mutex );
+void		Sys_LockMutex( sysMutex_t *mutex );
+void		Sys_UnlockMutex( sysMutex_t *mutex );
+
+sysCond_t	*Sys_CreateCond( void );
+void		Sys_DestroyCond( sysCond_t *cond );
+// the mutex must be locked, returns qfalse if msec (>= 0) ran out first
+qboolean	Sys_WaitCond( sysCond_t *cond, sysMutex_t *mutex, int msec );
+void		Sys_SignalCond( sysCond_t *cond );
+void		Sys_BroadcastCond( sysCond_t *cond );
+
+int			Sys_NumProcessors( void );
+
 typedef enum
 {
 	DR_YES = 0,
@@ -1161,6 +1213,16 @@ typedef struct {
 	huff_t		decompressor;
 } huffman_t;
 
+#define HUFF_LOOKUP_BITS	11
+
+// codes of a tree that is no longer updated, see Huff_BuildTable
+typedef struct {
+	unsigned int	code[HMAX];		// first bit sent in bit 0
+	byte			length[HMAX];
+	unsigned short	lookup[1 << HUFF_LOOKUP_BITS];	// symbol | ( length << 8 ), 0 for longer codes
+	node_t			*tree;
+} huffTable_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
@@ -1173,6 +1235,11 @@ void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset, int
 maxoffset);
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
+void	Huff_putBits( unsigned int value, int bits, byte *fout, int *offset );
+unsigned int	Huff_getBits( const byte *fin, int bits, int *offset );
+void	Huff_BuildTable( huff_t *huff, huffTable_t *table );
+void	Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset, int maxoffset );
+void	Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int maxoffset );
 
 // don't use if you don't know what you're doing.
 int		Huff_getBloc(void);
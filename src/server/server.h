@@ -65,7 +65,6 @@ typedef struct svEntity_s {
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
-	int			snapshotCounter;	// used to prevent double adding from portal views
 } svEntity_t;
 
 typedef enum {
@@ -90,7 +89,6 @@ typedef struct {
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=475
 	// the serverId associated with the current checksumFeed (always <= serverId)
 	int       checksumFeedServerId;
-	int				snapshotCounter;	// incremented for each snapshot built
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	configString_t	configstrings[MAX_CONFIGSTRINGS];
@@ -346,6 +344,13 @@ extern	cvar_t	*sv_maxPing;
 extern	cvar_t	*sv_pure;
 extern	cvar_t	*sv_lanForceRate;
 extern	cvar_t	*sv_banFile;
+extern	cvar_t	*sv_snapshotIndexing;
+extern	cvar_t	*sv_snapshotThreads;
+extern	cvar_t	*sv_deltaCache;
+extern	cvar_t	*sv_worldGrid;
+extern	cvar_t	*sv_traceCache;
+extern	cvar_t	*sv_dbThread;
+extern	cvar_t	*sv_profile;
 
 extern	cvar_t *sv_protect;
 extern	cvar_t *sv_protectLog;
@@ -465,6 +470,8 @@ void SV_WriteFrameToClient (client_t *client, msg_t *msg);
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+void SV_InitSnapshotIndex( void );
+void SV_ShutdownSnapshotWorkers( void );
 
 //
 // sv_game.c
@@ -504,6 +511,47 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent );
 
 void SV_SectorList_f( void );
 
+//
+// sv_profile.c
+//
+// zones registered by SV_ProfileInit, the game adds its own
+typedef enum {
+	PROFILE_FRAME,
+	PROFILE_CALCPINGS,
+	PROFILE_GAME,
+	PROFILE_TIMEOUTS,
+	PROFILE_SENDMESSAGES,
+	PROFILE_DEMO,
+	PROFILE_CLIENTTHINK
+} profileZoneNum_t;
+
+void SV_ProfileInit( void );
+int SV_ProfileZone( const char *name );
+void SV_ProfileBegin( int zone );
+void SV_ProfileEnd( int zone );
+void SV_ProfileFrame( void );
+void SV_ProfileReset( void );
+void SV_ProfilePrint( void );
+void SV_Profile_f( void );
+
+//
+// sv_demo.c
+//
+void SV_DemoConfigstring( int index, const char *string );
+void SV_DemoServerCommand( int clientNum, const char *text );
+void SV_DemoUsercmd( int clientNum, usercmd_t *cmd );
+void SV_DemoClientCommand( int clientNum, const char *text );
+void SV_DemoFrame( void );
+void SV_DemoStop( void );
+void SV_DemoRecord_f( void );
+void SV_DemoStopRecord_f( void );
+void SV_DemoReplay_f( void );
+
+//
+// sv_bench.c
+//
+void SV_GameBench_f( void );
+
 
 int SV_AreaEntities(
 	const vec3_t mins, const vec3_t maxs, const content_mask_t *content_mask,
@@ -560,3 +608,5 @@ void SV_Netchan_FreeQueue(client_t *client);
 // sv_sqlite.c
 //
 int sl_query( dbArray_t type, char *data, int *steps );
+void sl_poll( qboolean drop );
+void sl_shutdown( void );
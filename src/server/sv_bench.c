@@ -0,0 +1,270 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// sv_bench.c -- game frame benchmark driven by recorded usercmds
+
+#include "server.h"
+
+/*
+gamebench runs the game on the map that is loaded as fast as it can,
+with no sockets and no waiting between frames. Every client of a server
+demo gets a slot of its own and has the usercmds and commands it sent fed
+straight into ClientThink and ClientCommand, at the times they were sent
+relative to the start of the run. Only G_RunFrame is timed as the frame,
+with the profile zones of the engine and the game turned on for the whole
+run so the report shows where the time went.
+
+The random seed and the frame length are the same on every run, so two
+builds can be compared with
+
+	tremded +set sv_pure 0 +map <map> +gamebench <demo> 5000 +quit
+
+The server doesn't send anything while the benchmark runs, so it is best
+run on a server nobody else is on.
+*/
+
+#define BENCH_DEFAULT_FRAMES	5000
+#define BENCH_MAX_FRAMES		1000000		// keeps the frame times and sv.time in range
+#define BENCH_SEED				0x5eed
+
+typedef struct {
+	client_t	*cl;
+	demoInput_t	*inputs;
+	int			numInputs;
+	int			input;
+	int			cmdTime;		// serverTime of the next usercmd
+} benchClient_t;
+
+/*
+==================
+SV_BenchAddClient
+
+Connects a client with no address that only the benchmark drives
+==================
+*/
+static qboolean SV_BenchAddClient( client_t *cl ) {
+	int			clientNum = cl - svs.clients;
+	intptr_t	denied;
+
+	Com_Memset( cl, 0, sizeof( *cl ) );
+	cl->gentity = SV_GentityNum( clientNum );
+	cl->netchan.remoteAddress.type = NA_LOOPBACK;
+	Cvar_Set( va( "sv_clAltProto%i", clientNum ), "0" );
+
+	Com_sprintf( cl->userinfo, sizeof( cl->userinfo ),
+		"\\name\\bench%d\\ip\\localhost\\cl_guid\\%032X", clientNum, clientNum + 1 );
+
+	denied = (intptr_t)dll_ClientConnect( clientNum, qtrue );
+	if ( denied ) {
+		Com_Printf( "The game turned away bench client %d: %s\n", clientNum,
+			(char *)VM_ExplicitArgPtr( gvm, denied ) );
+		SV_SetUserinfo( clientNum, "" );
+		cl->state = CS_FREE;
+		return qfalse;
+	}
+
+	SV_UserinfoChanged( cl );
+	cl->state = CS_CONNECTED;
+	SV_ClientEnterWorld( cl, NULL );
+
+	// nothing is sent, so everything counts as received
+	cl->reliableAcknowledge = cl->reliableSequence;
+	return qtrue;
+}
+
+/*
+==================
+SV_BenchRunInput
+
+Runs the usercmds and commands of a client up to sv.time
+==================
+*/
+static void SV_BenchRunInput( benchClient_t *bc ) {
+	demoInput_t	*in;
+	usercmd_t	cmd;
+
+	while ( bc->cl->state == CS_ACTIVE && bc->cmdTime <= sv.time ) {
+		in = &bc->inputs[ bc->input ];
+		if ( ++bc->input >= bc->numInputs ) {
+			bc->input = 0;
+		}
+
+		if ( in->command ) {
+			SV_ExecuteClientCommand( bc->cl, in->command, qtrue );
+		} else {
+			cmd = in->cmd;
+			cmd.serverTime = bc->cmdTime;
+			bc->cmdTime += in->msec;
+			SV_ClientThink( bc->cl, &cmd );
+		}
+
+		bc->cl->reliableAcknowledge = bc->cl->reliableSequence;
+	}
+}
+
+/*
+==================
+SV_BenchCompare
+==================
+*/
+static int QDECL SV_BenchCompare( const void *a, const void *b ) {
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+==================
+SV_GameBench_f
+
+gamebench <demoname> [frames]
+==================
+*/
+void SV_GameBench_f( void ) {
+	demoInput_t		*inputs[ MAX_CLIENTS ];
+	int				numInputs[ MAX_CLIENTS ];
+	benchClient_t	clients[ MAX_CLIENTS ];
+	char			demoName[ MAX_QPATH ];
+	int				*frameTimes;
+	int				numClients, frames, frameMsec, profile;
+	int				i, j, slot;
+	int64_t			start, frameStart, total, thinkTime;
+
+	if ( Cmd_Argc() < 2 || Cmd_Argc() > 3 ) {
+		Com_Printf( "gamebench <demoname> [frames]\n" );
+		return;
+	}
+
+	if ( !com_sv_running->integer || sv.state != SS_GAME ) {
+		Com_Printf( "Server is not running a map\n" );
+		return;
+	}
+
+	Q_strncpyz( demoName, Cmd_Argv( 1 ), sizeof( demoName ) );
+	frames = Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : BENCH_DEFAULT_FRAMES;
+	if ( frames < 1 ) {
+		frames = 1;
+	} else if ( frames > BENCH_MAX_FRAMES ) {
+		Com_Printf( "Running at most %d frames\n", BENCH_MAX_FRAMES );
+		frames = BENCH_MAX_FRAMES;
+	}
+
+	if ( !SV_DemoLoadInput( demoName, inputs, numInputs ) ) {
+		return;
+	}
+
+	// a slot for every client of the demo that did anything
+	numClients = 0;
+	for ( i = 0, slot = 0; i < MAX_CLIENTS; i++ ) {
+		for ( j = 0; j < numInputs[ i ] && inputs[ i ][ j ].command; j++ );
+		if ( j == numInputs[ i ] ) {
+			continue;
+		}
+
+		while ( slot < sv_maxclients->integer && svs.clients[ slot ].state != CS_FREE ) {
+			slot++;
+		}
+		if ( slot == sv_maxclients->integer ) {
+			Com_Printf( "Only room for %d of the clients\n", numClients );
+			break;
+		}
+
+		if ( !SV_BenchAddClient( &svs.clients[ slot ] ) ) {
+			continue;
+		}
+
+		clients[ numClients ].cl = &svs.clients[ slot ];
+		clients[ numClients ].inputs = inputs[ i ];
+		clients[ numClients ].numInputs = numInputs[ i ];
+		clients[ numClients ].input = 0;
+		clients[ numClients ].cmdTime = sv.time;
+		numClients++;
+	}
+
+	if ( !numClients ) {
+		Com_Printf( "%s has no usercmds to play\n", demoName );
+		SV_DemoFreeInput( inputs, numInputs );
+		return;
+	}
+
+	frameMsec = 1000 / sv_fps->integer;
+	if ( frameMsec < 1 ) {
+		frameMsec = 1;
+	}
+	frameTimes = Z_Malloc( frames * sizeof( *frameTimes ) );
+
+	profile = sv_profile->integer;
+	Cvar_Set( "sv_profile", "1" );
+	SV_ProfileFrame();
+	SV_ProfileReset();
+
+	Com_Printf( "Running %d frames of %d msec with %d clients from %s\n",
+		frames, frameMsec, numClients, demoName );
+
+	srand( BENCH_SEED );
+	total = thinkTime = 0;
+	start = Sys_Microseconds();
+
+	for ( i = 0; i < frames; i++ ) {
+		svs.time += frameMsec;
+		sv.time += frameMsec;
+
+		frameStart = Sys_Microseconds();
+		for ( j = 0; j < numClients; j++ ) {
+			SV_BenchRunInput( &clients[ j ] );
+		}
+		thinkTime += Sys_Microseconds() - frameStart;
+
+		frameStart = Sys_Microseconds();
+		SV_ProfileBegin( PROFILE_GAME );
+		dll_G_RunFrame( sv.time );
+		SV_ProfileEnd( PROFILE_GAME );
+		frameTimes[ i ] = Sys_Microseconds() - frameStart;
+		total += frameTimes[ i ];
+
+		SV_ProfileFrame();
+
+		for ( j = 0; j < numClients; j++ ) {
+			clients[ j ].cl->reliableAcknowledge = clients[ j ].cl->reliableSequence;
+		}
+	}
+
+	start = Sys_Microseconds() - start;
+	qsort( frameTimes, frames, sizeof( *frameTimes ), SV_BenchCompare );
+
+	Com_Printf( "%d frames in %.2f seconds, %.1f frames/sec, %.1f frames/sec counting ClientThink\n",
+		frames, start / 1000000.0f, frames * 1000000.0f / MAX( total, 1 ),
+		frames * 1000000.0f / MAX( total + thinkTime, 1 ) );
+	Com_Printf( "G_RunFrame usec: mean %d, p50 %d, p99 %d, max %d\n", (int)( total / frames ),
+		frameTimes[ frames / 2 ], frameTimes[ (int)( frames * 0.99f ) ], frameTimes[ frames - 1 ] );
+	Com_Printf( "ClientThink and commands: %.1f usec per frame\n", (float)thinkTime / frames );
+	SV_ProfilePrint();
+
+	for ( j = 0; j < numClients; j++ ) {
+		if ( clients[ j ].cl->state >= CS_CONNECTED ) {
+			dll_ClientDisconnect( clients[ j ].cl - svs.clients );
+		}
+		SV_SetUserinfo( clients[ j ].cl - svs.clients, "" );
+		clients[ j ].cl->state = CS_FREE;
+	}
+
+	Cvar_Set( "sv_profile", va( "%d", profile ) );
+	Z_Free( frameTimes );
+	SV_DemoFreeInput( inputs, numInputs );
+}
@@ -394,6 +394,11 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("systeminfo", SV_Systeminfo_f);
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f);
 	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("profile", SV_Profile_f);
+	Cmd_AddCommand ("svrecord", SV_DemoRecord_f);
+	Cmd_AddCommand ("svstoprecord", SV_DemoStopRecord_f);
+	Cmd_AddCommand ("svreplay", SV_DemoReplay_f);
+	Cmd_AddCommand ("gamebench", SV_GameBench_f);
 	Cmd_AddCommand ("map", SV_Map_f);
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 	Cmd_AddCommand ("devmap", SV_Map_f);
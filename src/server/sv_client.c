@@ -1369,6 +1369,7 @@ void SV_ExecuteClientCommand( client_t *cl, const char *s, qboolean clientOK ) {
 	if (clientOK) {
 		// pass unknown strings to the game
 		if (!u->name && sv.state == SS_GAME && (cl->state == CS_ACTIVE || cl->state == CS_PRIMED)) {
+			SV_DemoClientCommand( cl - svs.clients, s );
 			dll_ClientCommand( cl - svs.clients );
 		}
 	}
@@ -1451,7 +1452,11 @@ void SV_ClientThink (client_t *cl, usercmd_t *cmd) {
 		return;		// may have been kicked during the last usercmd
 	}
 
+	SV_DemoUsercmd( cl - svs.clients, cmd );
+
+	SV_ProfileBegin( PROFILE_CLIENTTHINK );
 	dll_ClientThink( cl - svs.clients );
+	SV_ProfileEnd( PROFILE_CLIENTTHINK );
 }
 
 /*
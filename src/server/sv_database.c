@@ -48,24 +48,25 @@ int db_add_mapstat( char *data, int *steps ) {
   char   *name, *result;
   int     players, start;
   int64_t key, newstart;
-  unpack_start( data, DATABASE_DATA_MAX );
-  name = unpack_text3( );
-  result = unpack_text3( );
-  unpack_int( &players );
-  unpack_int( &start );
+  sl_unpack_t unpack;
+  sl_unpack_start( &unpack, data, DATABASE_DATA_MAX );
+  name = sl_unpack_text( &unpack );
+  result = sl_unpack_text( &unpack );
+  sl_unpack_int( &unpack, &players );
+  sl_unpack_int( &unpack, &start );
   newstart = start + TIME_OFFSET;
   //Attempt to add the map.
   if( sl_bind( add_map_stmt, qtrue ) ||
       sl_bind_text( name, -1 ) ||
       sl_step( qtrue ) ) {
-    Com_Error( ERR_DROP, "db_add_mapstat: Could not add map name %s", name );
+    sl_error( "db_add_mapstat: Could not add map name %s", name );
     return 1;
   }
   //Query for map key.
   if( sl_bind( get_map_key_stmt, qtrue ) ||
       sl_bind_text( name, -1 ) ||
       sl_step( qfalse ) ) {
-    Com_Error( ERR_DROP, "db_add_mapstat: Could not get map key for %s", name );
+    sl_error( "db_add_mapstat: Could not get map key for %s", name );
     return 1;
   }
   //Add the mapstat.
@@ -76,7 +77,7 @@ int db_add_mapstat( char *data, int *steps ) {
       sl_bind_int( players ) ||
       sl_bind_int64( newstart ) ||
       sl_step( qtrue ) ) {
-    Com_Error( ERR_DROP, "db_add_mapstat: Could not add mapstat for %s", name );
+    sl_error( "db_add_mapstat: Could not add mapstat for %s", name );
     return 2;
   }
   return 0;
@@ -88,7 +89,7 @@ int db_add_seen( char *data, int *steps ) {
   if( sl_bind( add_seen_stmt, qtrue ) ||
       sl_bind_text( name, -1 ) ||
       sl_step( qtrue ) ) {
-    Com_Error( ERR_DROP, "db_add_seen: Could not add %s", name );
+    sl_error( "db_add_seen: Could not add %s", name );
     return 1;
   }
   return 0;
@@ -97,7 +98,7 @@ int db_add_seen( char *data, int *steps ) {
 int db_get_time( char *data, int *steps ) {
   if( sl_bind( get_time_stmt, qtrue ) ||
       sl_step( qtrue ) ) {
-    Com_Error( ERR_DROP, "db_get_time: Could not get current time" );
+    sl_error( "db_get_time: Could not get current time" );
     return 1;
   }
   pack_start( data, DATABASE_DATA_MAX );
@@ -107,16 +108,17 @@ int db_get_time( char *data, int *steps ) {
 
 int db_get_last_maps( char *data, int *steps ) {
   int client_number, player_count, limit, offset;
-  unpack_start( data, DATABASE_DATA_MAX );
-  unpack_int( &client_number );
-  unpack_int( &player_count );
-  unpack_int( &limit );
-  unpack_int( &offset );
+  sl_unpack_t unpack;
+  sl_unpack_start( &unpack, data, DATABASE_DATA_MAX );
+  sl_unpack_int( &unpack, &client_number );
+  sl_unpack_int( &unpack, &player_count );
+  sl_unpack_int( &unpack, &limit );
+  sl_unpack_int( &unpack, &offset );
   if( sl_bind( get_last_maps_stmt, qtrue ) ||
       sl_bind_int( player_count ) ||
       sl_bind_int( limit ) ||
       sl_bind_int( offset ) ) {
-    Com_Error( ERR_DROP, "db_get_last_maps: Could not bind stmt" );
+    sl_error( "db_get_last_maps: Could not bind stmt" );
     return 1;
   }
   while( sl_step( qfalse ) == 0 ) {
@@ -131,12 +133,7 @@ int db_get_last_maps( char *data, int *steps ) {
     hour_min( sl_result_int64( ), &elapsed_hours, &elapsed_mins );
     hour_min( end - start, &hours, &mins );
     sl_result_text( &endstr );
-    if( client_number < 0 ) {
-      Com_Printf( "%02d:%02d(%s) %s (%d players) (%02d:%02d playtime): %s\n", elapsed_hours, elapsed_mins, endstr, name, players, (int)hours, (int)mins, result );
-    }
-    else {
-      SV_AddServerCommand( svs.clients + client_number, va( "print \"%02d:%02d(%s) %s (%d players) (%02d:%02d playtime): %s\n\"", elapsed_hours, elapsed_mins, endstr, name, players, (int)hours, (int)mins, result ) );
-    }
+    sl_print( client_number, "%02d:%02d(%s) %s (%d players) (%02d:%02d playtime): %s\n", elapsed_hours, elapsed_mins, endstr, name, players, (int)hours, (int)mins, result );
   }
   return 0;
 }
@@ -144,16 +141,17 @@ int db_get_last_maps( char *data, int *steps ) {
 int db_get_seen( char *data, int *steps ) {
   int client_number, limit, offset;
   char *search;
-  unpack_start( data, DATABASE_DATA_MAX );
-  unpack_int( &client_number );
-  search = unpack_text3( );
-  unpack_int( &limit );
-  unpack_int( &offset );
+  sl_unpack_t unpack;
+  sl_unpack_start( &unpack, data, DATABASE_DATA_MAX );
+  sl_unpack_int( &unpack, &client_number );
+  search = sl_unpack_text( &unpack );
+  sl_unpack_int( &unpack, &limit );
+  sl_unpack_int( &unpack, &offset );
   if( sl_bind( get_seen_stmt, qtrue ) ||
       sl_bind_text( search, -1 ) ||
       sl_bind_int64( limit ) ||
       sl_bind_int64( offset ) ) {
-    Com_Error( ERR_DROP, "db_get_seen: Could not bind stmt" );
+    sl_error( "db_get_seen: Could not bind stmt" );
     return 1;
   }
   while( sl_step( qfalse ) == 0 ) {
@@ -162,12 +160,7 @@ int db_get_seen( char *data, int *steps ) {
     sl_result_text( &name );
     hour_min( sl_result_int64( ), &elapsed_hours, &elapsed_mins );
     sl_result_text( &time );
-    if( client_number < 0 ) {
-      Com_Printf( "%02d:%02d(%s) : %s\n", elapsed_hours, elapsed_mins, time, name );
-    }
-    else {
-      SV_AddServerCommand( svs.clients + client_number, va( "print \"%02d:%02d(%s) : %s\n\"", elapsed_hours, elapsed_mins, time, name ) );
-    }
+    sl_print( client_number, "%02d:%02d(%s) : %s\n", elapsed_hours, elapsed_mins, time, name );
   }
   return 0;
 }
@@ -0,0 +1,898 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// sv_demo.c -- server side recording of the whole world
+
+#include "server.h"
+
+/*
+A server demo holds every entity any client could be sent and the
+playerstate of every active client, for each game frame, along with the
+configstring changes, the game's server commands and the usercmds and
+commands every client sent in between. Unlike a client demo it isn't
+limited to what one player could see, and what the clients did can be fed
+back into a server by tremload.
+
+The file is a header followed by records, each a little endian length and
+a huffman coded message of DEMOOP_ ops ending with DEMOOP_END. The first
+record holds the configstrings at the time recording started, a frame is
+delta compressed against the frame before it.
+
+Messages are built on the main thread and copied into a ring buffer that a
+thread of its own writes out, the frame only waits when the disk has
+fallen a whole buffer behind.
+*/
+
+#define DEMO_MAGIC			"SVDM"
+#define DEMO_VERSION		2
+#define DEMO_EXT			"svdm"
+
+#define DEMO_RECORD_SIZE	0x40000
+#define DEMO_BUFFER_SIZE	0x100000	// must be a power of two
+#define DEMO_FLUSH_SIZE		0x10000
+#define DEMO_FLUSH_MSEC		1000
+
+typedef enum {
+	DEMOOP_END,
+	DEMOOP_CONFIGSTRING,	// short index, bigstring
+	DEMOOP_COMMAND,			// short clientNum or -1 for everyone, string
+	DEMOOP_FRAME,			// long time, playerstates, entities
+	DEMOOP_USERCMD,			// byte clientNum, usercmd delta
+	DEMOOP_CLIENTCOMMAND	// byte clientNum, string
+} demoOp_t;
+
+// the world as of one frame, what the recorder deltas against
+// and what a replay rebuilds
+typedef struct {
+	int				time;
+	int				numEntities;	// highest present entity + 1
+	qboolean		entityPresent[ MAX_GENTITIES ];
+	entityState_t	entities[ MAX_GENTITIES ];
+	qboolean		playerPresent[ MAX_CLIENTS ];
+	playerState_t	players[ MAX_CLIENTS ];
+	usercmd_t		cmds[ MAX_CLIENTS ];
+} demoWorld_t;
+
+// what decoding a whole demo found
+typedef struct {
+	demoWorld_t		*world;
+	int				maxclients;
+	qboolean		verbose;
+	qboolean		error;
+
+	demoInput_t		**inputs;		// the input of each client, if wanted
+	int				*numInputs;
+	int				maxInputs[ MAX_CLIENTS ];
+
+	int				records;
+	int64_t			bytes;
+	int				frames;
+	int				firstTime;
+	int				lastTime;
+	int				configstrings;
+	int				commands;
+	int				usercmds;
+	int				clientCommands;
+	int64_t			totalEntities;
+	int				peakEntities;
+	int				peakPlayers;
+} demoReader_t;
+
+static struct {
+	qboolean		recording;
+	fileHandle_t	file;
+	char			name[ MAX_OSPATH ];
+	int				maxclients;
+
+	demoWorld_t		*world;
+	msg_t			record;
+	byte			*recordData;
+
+	int				frames;
+	int64_t			bytes;
+	int64_t			encodeTime;
+
+	sysThread_t		*thread;
+	sysMutex_t		*mutex;
+	sysCond_t		*flushCond;		// wakes the writer thread
+	sysCond_t		*spaceCond;		// wakes the server when the buffer was full
+	qboolean		shutdown;
+	qboolean		failed;
+	unsigned int	head;			// bytes added by the server
+	unsigned int	tail;			// bytes written by the writer thread
+	byte			*buffer;
+} demo;
+
+static entityState_t	nullEntity;
+
+/*
+==================
+SV_DemoThread
+==================
+*/
+static void SV_DemoThread( void *data ) {
+	Sys_LockMutex( demo.mutex );
+	while ( 1 ) {
+		unsigned int	start, len;
+		qboolean		written;
+
+		while ( !demo.shutdown && demo.head - demo.tail < DEMO_FLUSH_SIZE ) {
+			if ( !Sys_WaitCond( demo.flushCond, demo.mutex, DEMO_FLUSH_MSEC ) ) {
+				break;
+			}
+		}
+
+		if ( demo.head == demo.tail ) {
+			if ( demo.shutdown ) {
+				break;
+			}
+			continue;
+		}
+
+		// the server only ever appends, so the pending bytes
+		// can be written without holding the lock
+		start = demo.tail & ( DEMO_BUFFER_SIZE - 1 );
+		len = MIN( demo.head - demo.tail, DEMO_BUFFER_SIZE - start );
+
+		Sys_UnlockMutex( demo.mutex );
+		written = FS_ThreadWrite( demo.buffer + start, len, demo.file );
+		Sys_LockMutex( demo.mutex );
+
+		if ( !written ) {
+			demo.failed = qtrue;
+		}
+		demo.tail += len;
+		Sys_BroadcastCond( demo.spaceCond );
+	}
+	Sys_UnlockMutex( demo.mutex );
+}
+
+/*
+==================
+SV_DemoWrite
+
+Queues bytes for the writer thread, or writes them straight away without one
+==================
+*/
+static void SV_DemoWrite( const void *data, int len ) {
+	unsigned int	start, first;
+
+	demo.bytes += len;
+
+	if ( !demo.thread ) {
+		FS_Write( data, len, demo.file );
+		return;
+	}
+
+	Sys_LockMutex( demo.mutex );
+	while ( DEMO_BUFFER_SIZE - ( demo.head - demo.tail ) < len ) {
+		Sys_SignalCond( demo.flushCond );
+		Sys_WaitCond( demo.spaceCond, demo.mutex, -1 );
+	}
+
+	start = demo.head & ( DEMO_BUFFER_SIZE - 1 );
+	first = MIN( len, DEMO_BUFFER_SIZE - start );
+	Com_Memcpy( demo.buffer + start, data, first );
+	Com_Memcpy( demo.buffer, (const byte *)data + first, len - first );
+	demo.head += len;
+
+	if ( demo.head - demo.tail >= DEMO_FLUSH_SIZE ) {
+		Sys_SignalCond( demo.flushCond );
+	}
+	Sys_UnlockMutex( demo.mutex );
+}
+
+/*
+==================
+SV_DemoFlushRecord
+
+Ends the record being built and queues it, an overflowed record stops the demo
+==================
+*/
+static void SV_DemoFlushRecord( void ) {
+	int		len;
+
+	if ( !demo.record.cursize ) {
+		return;
+	}
+
+	MSG_WriteByte( &demo.record, DEMOOP_END );
+	if ( demo.record.overflowed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: server demo record overflowed\n" );
+		SV_DemoStop();
+		return;
+	}
+
+	len = LittleLong( demo.record.cursize );
+	SV_DemoWrite( &len, sizeof( len ) );
+	SV_DemoWrite( demo.record.data, demo.record.cursize );
+
+	MSG_Init( &demo.record, demo.recordData, DEMO_RECORD_SIZE );
+}
+
+/*
+==================
+SV_DemoReserve
+
+Makes sure len more bytes fit in the record being built,
+returns qfalse if that stopped the demo
+==================
+*/
+static qboolean SV_DemoReserve( int len ) {
+	if ( demo.record.cursize + len + 1 > demo.record.maxsize ) {
+		SV_DemoFlushRecord();
+	}
+
+	return demo.recording;
+}
+
+/*
+==================
+SV_DemoConfigstring
+==================
+*/
+void SV_DemoConfigstring( int index, const char *string ) {
+	if ( !demo.recording ) {
+		return;
+	}
+
+	if ( !SV_DemoReserve( strlen( string ) + 16 ) ) {
+		return;
+	}
+	MSG_WriteByte( &demo.record, DEMOOP_CONFIGSTRING );
+	MSG_WriteShort( &demo.record, index );
+	MSG_WriteBigString( &demo.record, string );
+}
+
+/*
+==================
+SV_DemoServerCommand
+
+clientNum is -1 for a command sent to everyone
+==================
+*/
+void SV_DemoServerCommand( int clientNum, const char *text ) {
+	if ( !demo.recording ) {
+		return;
+	}
+
+	if ( !SV_DemoReserve( strlen( text ) + 16 ) ) {
+		return;
+	}
+	MSG_WriteByte( &demo.record, DEMOOP_COMMAND );
+	MSG_WriteShort( &demo.record, clientNum );
+	MSG_WriteString( &demo.record, text );
+}
+
+/*
+==================
+SV_DemoUsercmd
+
+Records a usercmd a client's think ran
+==================
+*/
+void SV_DemoUsercmd( int clientNum, usercmd_t *cmd ) {
+	if ( !demo.recording || clientNum >= demo.maxclients ) {
+		return;
+	}
+
+	if ( !SV_DemoReserve( 64 ) ) {
+		return;
+	}
+	MSG_WriteByte( &demo.record, DEMOOP_USERCMD );
+	MSG_WriteByte( &demo.record, clientNum );
+	MSG_WriteDeltaUsercmdKey( &demo.record, 0, &demo.world->cmds[ clientNum ], cmd );
+	demo.world->cmds[ clientNum ] = *cmd;
+}
+
+/*
+==================
+SV_DemoClientCommand
+
+Records a command a client sent the game
+==================
+*/
+void SV_DemoClientCommand( int clientNum, const char *text ) {
+	if ( !demo.recording || clientNum >= demo.maxclients ) {
+		return;
+	}
+
+	if ( !SV_DemoReserve( strlen( text ) + 16 ) ) {
+		return;
+	}
+	MSG_WriteByte( &demo.record, DEMOOP_CLIENTCOMMAND );
+	MSG_WriteByte( &demo.record, clientNum );
+	MSG_WriteString( &demo.record, text );
+}
+
+/*
+==================
+SV_DemoFrame
+
+Records the world as the game left it after a frame
+==================
+*/
+void SV_DemoFrame( void ) {
+	demoWorld_t		*world = demo.world;
+	msg_t			*msg = &demo.record;
+	sharedEntity_t	*ent = NULL;
+	int64_t			start;
+	int				i, numEntities;
+
+	if ( !demo.recording ) {
+		return;
+	}
+
+	SV_ProfileBegin( PROFILE_DEMO );
+	start = Sys_Microseconds();
+
+	// a frame can be large, start it on a fresh record
+	if ( !SV_DemoReserve( DEMO_RECORD_SIZE * 3 / 4 ) ) {
+		SV_ProfileEnd( PROFILE_DEMO );
+		return;
+	}
+
+	MSG_WriteByte( msg, DEMOOP_FRAME );
+	MSG_WriteLong( msg, sv.time );
+	world->time = sv.time;
+
+	for ( i = 0; i < demo.maxclients; i++ ) {
+		if ( svs.clients[ i ].state != CS_ACTIVE ) {
+			MSG_WriteBits( msg, 0, 1 );
+			world->playerPresent[ i ] = qfalse;
+			continue;
+		}
+
+		MSG_WriteBits( msg, 1, 1 );
+		MSG_WriteDeltaPlayerstate( 0, msg,
+			world->playerPresent[ i ] ? &world->players[ i ] : NULL, SV_GameClientNum( i ) );
+		world->players[ i ] = *SV_GameClientNum( i );
+		world->playerPresent[ i ] = qtrue;
+	}
+
+	// everything that can ever be sent to a client
+	numEntities = 0;
+	for ( i = 0; i < MAX( sv.num_entities, world->numEntities ); i++ ) {
+		qboolean	present = qfalse;
+
+		if ( i < sv.num_entities ) {
+			ent = SV_GentityNum( i );
+			present = ent->r.linked && !( ent->r.svFlags & SVF_NOCLIENT ) && ent->s.number == i;
+		}
+
+		if ( present ) {
+			MSG_WriteDeltaEntity( 0, msg,
+				world->entityPresent[ i ] ? &world->entities[ i ] : &nullEntity, &ent->s,
+				!world->entityPresent[ i ] );
+			world->entities[ i ] = ent->s;
+			numEntities = i + 1;
+		} else if ( world->entityPresent[ i ] ) {
+			MSG_WriteDeltaEntity( 0, msg, &world->entities[ i ], NULL, qtrue );
+		}
+
+		world->entityPresent[ i ] = present;
+	}
+	MSG_WriteBits( msg, MAX_GENTITIES - 1, GENTITYNUM_BITS );
+	world->numEntities = numEntities;
+
+	demo.frames++;
+	SV_DemoFlushRecord();
+
+	demo.encodeTime += Sys_Microseconds() - start;
+	SV_ProfileEnd( PROFILE_DEMO );
+}
+
+/*
+==================
+SV_DemoStop
+
+Closes the demo being recorded, if any
+==================
+*/
+void SV_DemoStop( void ) {
+	if ( !demo.recording ) {
+		return;
+	}
+
+	// stop recording first so an overflow on this last record can't recurse
+	demo.recording = qfalse;
+	if ( !demo.record.overflowed ) {
+		SV_DemoFlushRecord();
+	}
+
+	if ( demo.thread ) {
+		Sys_LockMutex( demo.mutex );
+		demo.shutdown = qtrue;
+		Sys_SignalCond( demo.flushCond );
+		Sys_UnlockMutex( demo.mutex );
+		Sys_JoinThread( demo.thread );
+		demo.thread = NULL;
+	}
+
+	Sys_DestroyCond( demo.flushCond );
+	Sys_DestroyCond( demo.spaceCond );
+	Sys_DestroyMutex( demo.mutex );
+	demo.flushCond = demo.spaceCond = NULL;
+	demo.mutex = NULL;
+
+	FS_FCloseFile( demo.file );
+	demo.file = 0;
+
+	if ( demo.failed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: some of %s could not be written\n", demo.name );
+	}
+	Com_Printf( "Stopped recording %s: %d frames, %.1f KB, %.1f usec per frame\n", demo.name,
+		demo.frames, demo.bytes / 1024.0f, demo.frames ? (float)demo.encodeTime / demo.frames : 0.0f );
+
+	Z_Free( demo.world );
+	Z_Free( demo.recordData );
+	Z_Free( demo.buffer );
+	demo.world = NULL;
+	demo.recordData = NULL;
+	demo.buffer = NULL;
+}
+
+/*
+==================
+SV_DemoRecord_f
+
+svrecord [demoname]
+==================
+*/
+void SV_DemoRecord_f( void ) {
+	char	name[ MAX_OSPATH ];
+	int		header[ 3 ];
+	int		i;
+
+	if ( Cmd_Argc() > 2 ) {
+		Com_Printf( "svrecord [demoname]\n" );
+		return;
+	}
+
+	if ( !com_sv_running->integer || sv.state != SS_GAME ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	if ( demo.recording ) {
+		Com_Printf( "Already recording %s.\n", demo.name );
+		return;
+	}
+
+	if ( Cmd_Argc() == 2 ) {
+		Com_sprintf( name, sizeof( name ), "demos/server/%s.%s", Cmd_Argv( 1 ), DEMO_EXT );
+	} else {
+		// scan for a free demo name
+		for ( i = 0; i <= 9999; i++ ) {
+			Com_sprintf( name, sizeof( name ), "demos/server/svdemo%04i.%s", i, DEMO_EXT );
+			if ( !FS_FileExists( name ) ) {
+				break;
+			}
+		}
+	}
+
+	demo.file = FS_FOpenFileWrite( name );
+	if ( !demo.file ) {
+		Com_Printf( "ERROR: couldn't open %s.\n", name );
+		return;
+	}
+	Com_Printf( "recording to %s.\n", name );
+
+	Q_strncpyz( demo.name, name, sizeof( demo.name ) );
+	demo.maxclients = sv_maxclients->integer;
+	demo.frames = 0;
+	demo.bytes = 0;
+	demo.encodeTime = 0;
+	demo.head = demo.tail = 0;
+	demo.shutdown = qfalse;
+	demo.failed = qfalse;
+
+	demo.world = Z_Malloc( sizeof( *demo.world ) );
+	demo.recordData = Z_Malloc( DEMO_RECORD_SIZE );
+	demo.buffer = Z_Malloc( DEMO_BUFFER_SIZE );
+	MSG_Init( &demo.record, demo.recordData, DEMO_RECORD_SIZE );
+
+	demo.mutex = Sys_CreateMutex();
+	demo.flushCond = Sys_CreateCond();
+	demo.spaceCond = Sys_CreateCond();
+	if ( demo.mutex && demo.flushCond && demo.spaceCond ) {
+		demo.thread = Sys_CreateThread( SV_DemoThread, NULL );
+	}
+	if ( !demo.thread ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start the demo thread, writing %s directly\n", name );
+	}
+
+	demo.recording = qtrue;
+
+	Com_Memcpy( header, DEMO_MAGIC, 4 );
+	header[ 1 ] = LittleLong( DEMO_VERSION );
+	header[ 2 ] = LittleLong( demo.maxclients );
+	SV_DemoWrite( header, sizeof( header ) );
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( sv.configstrings[ i ].s[ 0 ] ) {
+			SV_DemoConfigstring( i, sv.configstrings[ i ].s );
+		}
+	}
+	SV_DemoFlushRecord();
+}
+
+/*
+==================
+SV_DemoStopRecord_f
+==================
+*/
+void SV_DemoStopRecord_f( void ) {
+	if ( !demo.recording ) {
+		Com_Printf( "Not recording a server demo.\n" );
+		return;
+	}
+
+	SV_DemoStop();
+}
+
+/*
+==================
+SV_DemoReadFrame
+
+Applies a frame to the world of a replay
+==================
+*/
+static void SV_DemoReadFrame( msg_t *msg, demoWorld_t *world, int maxclients ) {
+	entityState_t	from;
+	playerState_t	ps;
+	int				i, num;
+
+	world->time = MSG_ReadLong( msg );
+
+	for ( i = 0; i < maxclients; i++ ) {
+		if ( !MSG_ReadBits( msg, 1 ) ) {
+			world->playerPresent[ i ] = qfalse;
+			continue;
+		}
+
+		MSG_ReadDeltaPlayerstate( msg, world->playerPresent[ i ] ? &world->players[ i ] : NULL, &ps );
+		world->players[ i ] = ps;
+		world->playerPresent[ i ] = qtrue;
+	}
+
+	while ( 1 ) {
+		num = MSG_ReadBits( msg, GENTITYNUM_BITS );
+		if ( num == MAX_GENTITIES - 1 || msg->readcount > msg->cursize ) {
+			break;
+		}
+
+		from = world->entityPresent[ num ] ? world->entities[ num ] : nullEntity;
+		MSG_ReadDeltaEntity( 0, msg, &from, &world->entities[ num ], num );
+		world->entityPresent[ num ] = ( world->entities[ num ].number != MAX_GENTITIES - 1 );
+	}
+
+	world->numEntities = 0;
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		if ( world->entityPresent[ i ] ) {
+			world->numEntities = i + 1;
+		}
+	}
+}
+
+/*
+==================
+SV_DemoAddInput
+
+Appends to the input of one client, growing it as needed
+==================
+*/
+static void SV_DemoAddInput( demoReader_t *reader, int clientNum, const demoInput_t *input ) {
+	demoInput_t	*inputs;
+
+	if ( reader->numInputs[ clientNum ] == reader->maxInputs[ clientNum ] ) {
+		reader->maxInputs[ clientNum ] = MAX( 256, reader->maxInputs[ clientNum ] * 2 );
+		inputs = Z_Malloc( reader->maxInputs[ clientNum ] * sizeof( *inputs ) );
+		if ( reader->inputs[ clientNum ] ) {
+			Com_Memcpy( inputs, reader->inputs[ clientNum ],
+				reader->numInputs[ clientNum ] * sizeof( *inputs ) );
+			Z_Free( reader->inputs[ clientNum ] );
+		}
+		reader->inputs[ clientNum ] = inputs;
+	}
+
+	reader->inputs[ clientNum ][ reader->numInputs[ clientNum ]++ ] = *input;
+}
+
+/*
+==================
+SV_DemoRead
+
+Decodes a whole server demo into reader->world, counting what it holds
+and collecting the input of each client if reader->inputs is wanted
+==================
+*/
+static qboolean SV_DemoRead( const char *name, demoReader_t *reader ) {
+	fileHandle_t	f;
+	demoWorld_t		*world = reader->world;
+	byte			*data;
+	msg_t			msg;
+	demoInput_t		input;
+	usercmd_t		cmd;
+	int				header[ 3 ];
+	int				len, op, i;
+
+	FS_FOpenFileRead( name, &f, qtrue );
+	if ( !f ) {
+		Com_Printf( "couldn't open %s\n", name );
+		return qfalse;
+	}
+
+	if ( FS_Read( header, sizeof( header ), f ) != sizeof( header ) ||
+		memcmp( header, DEMO_MAGIC, 4 ) || LittleLong( header[ 1 ] ) != DEMO_VERSION ) {
+		Com_Printf( "%s is not a version %d server demo\n", name, DEMO_VERSION );
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	reader->maxclients = LittleLong( header[ 2 ] );
+	if ( reader->maxclients < 0 || reader->maxclients > MAX_CLIENTS ) {
+		Com_Printf( "%s has a bad client count %d\n", name, reader->maxclients );
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+	reader->bytes = sizeof( header );
+
+	data = Z_Malloc( DEMO_RECORD_SIZE );
+
+	while ( !reader->error && FS_Read( &len, sizeof( len ), f ) == sizeof( len ) ) {
+		len = LittleLong( len );
+		if ( len <= 0 || len > DEMO_RECORD_SIZE || FS_Read( data, len, f ) != len ) {
+			Com_Printf( "record %d is cut short\n", reader->records );
+			reader->error = qtrue;
+			break;
+		}
+
+		reader->records++;
+		reader->bytes += sizeof( len ) + len;
+
+		MSG_Init( &msg, data, DEMO_RECORD_SIZE );
+		msg.cursize = len;
+		MSG_BeginReading( &msg );
+
+		while ( 1 ) {
+			op = MSG_ReadByte( &msg );
+			if ( msg.readcount > msg.cursize ) {
+				Com_Printf( "record %d is corrupt\n", reader->records - 1 );
+				reader->error = qtrue;
+				break;
+			}
+
+			if ( op == DEMOOP_END ) {
+				break;
+			}
+
+			switch ( op ) {
+			case DEMOOP_CONFIGSTRING:
+				i = MSG_ReadShort( &msg );
+				if ( reader->verbose ) {
+					Com_Printf( "%8d cs %d %s\n", world->time, i, MSG_ReadBigString( &msg ) );
+				} else {
+					MSG_ReadBigString( &msg );
+				}
+				reader->configstrings++;
+				break;
+
+			case DEMOOP_COMMAND:
+				i = MSG_ReadShort( &msg );
+				if ( reader->verbose ) {
+					Com_Printf( "%8d cmd %d %s\n", world->time, i, MSG_ReadString( &msg ) );
+				} else {
+					MSG_ReadString( &msg );
+				}
+				reader->commands++;
+				break;
+
+			case DEMOOP_FRAME:
+				SV_DemoReadFrame( &msg, world, reader->maxclients );
+
+				if ( !reader->frames++ ) {
+					reader->firstTime = world->time;
+				}
+				reader->lastTime = world->time;
+
+				for ( i = 0, len = 0; i < world->numEntities; i++ ) {
+					len += world->entityPresent[ i ];
+				}
+				reader->totalEntities += len;
+				reader->peakEntities = MAX( reader->peakEntities, len );
+
+				for ( i = 0, len = 0; i < reader->maxclients; i++ ) {
+					len += world->playerPresent[ i ];
+				}
+				reader->peakPlayers = MAX( reader->peakPlayers, len );
+				break;
+
+			case DEMOOP_USERCMD:
+				i = MSG_ReadByte( &msg );
+				if ( i < 0 || i >= reader->maxclients ) {
+					Com_Printf( "record %d has a bad client %d\n", reader->records - 1, i );
+					reader->error = qtrue;
+					break;
+				}
+
+				MSG_ReadDeltaUsercmdKey( &msg, 0, &world->cmds[ i ], &cmd );
+				world->cmds[ i ] = cmd;
+				reader->usercmds++;
+
+				if ( reader->inputs ) {
+					// the last usercmd was in use until this one came
+					len = reader->numInputs[ i ];
+					while ( len > 0 && !reader->inputs[ i ][ len - 1 ].msec &&
+						reader->inputs[ i ][ len - 1 ].command ) {
+						len--;
+					}
+					if ( len > 0 ) {
+						reader->inputs[ i ][ len - 1 ].msec =
+							Com_Clamp( 1, 1000, cmd.serverTime - reader->inputs[ i ][ len - 1 ].cmd.serverTime );
+					}
+
+					Com_Memset( &input, 0, sizeof( input ) );
+					input.msec = 1000 / sv_fps->integer;
+					input.cmd = cmd;
+					SV_DemoAddInput( reader, i, &input );
+				}
+				break;
+
+			case DEMOOP_CLIENTCOMMAND:
+				i = MSG_ReadByte( &msg );
+				if ( i < 0 || i >= reader->maxclients ) {
+					Com_Printf( "record %d has a bad client %d\n", reader->records - 1, i );
+					reader->error = qtrue;
+					break;
+				}
+
+				if ( reader->verbose ) {
+					Com_Printf( "%8d clientcmd %d %s\n", world->time, i, MSG_ReadString( &msg ) );
+				} else if ( reader->inputs ) {
+					Com_Memset( &input, 0, sizeof( input ) );
+					input.command = CopyString( MSG_ReadString( &msg ) );
+					SV_DemoAddInput( reader, i, &input );
+				} else {
+					MSG_ReadString( &msg );
+				}
+				reader->clientCommands++;
+				break;
+
+			default:
+				Com_Printf( "record %d has a bad op %d\n", reader->records - 1, op );
+				reader->error = qtrue;
+				break;
+			}
+
+			if ( reader->error ) {
+				break;
+			}
+		}
+	}
+
+	FS_FCloseFile( f );
+	Z_Free( data );
+
+	return qtrue;
+}
+
+/*
+==================
+SV_DemoReplay_f
+
+svreplay <demoname> [verbose]
+
+Plays a server demo back into a client that keeps the world state but
+draws nothing, checking the stream and timing how long decoding takes.
+verbose prints the configstrings and commands as they come.
+==================
+*/
+void SV_DemoReplay_f( void ) {
+	char			name[ MAX_OSPATH ];
+	demoReader_t	reader;
+	int64_t			start;
+
+	if ( Cmd_Argc() < 2 || Cmd_Argc() > 3 ) {
+		Com_Printf( "svreplay <demoname> [verbose]\n" );
+		return;
+	}
+
+	Com_sprintf( name, sizeof( name ), "demos/server/%s", Cmd_Argv( 1 ) );
+	COM_DefaultExtension( name, sizeof( name ), "." DEMO_EXT );
+
+	Com_Memset( &reader, 0, sizeof( reader ) );
+	reader.verbose = ( Cmd_Argc() == 3 && !Q_stricmp( Cmd_Argv( 2 ), "verbose" ) );
+	reader.world = Z_Malloc( sizeof( *reader.world ) );
+
+	start = Sys_Microseconds();
+	if ( !SV_DemoRead( name, &reader ) ) {
+		Z_Free( reader.world );
+		return;
+	}
+	start = Sys_Microseconds() - start;
+	Z_Free( reader.world );
+
+	Com_Printf( "%s: %d records, %d frames over %.1f seconds, %.1f KB\n", name,
+		reader.records, reader.frames, ( reader.lastTime - reader.firstTime ) / 1000.0f,
+		reader.bytes / 1024.0f );
+	Com_Printf( "%d configstrings, %d commands, %d usercmds, %d client commands\n",
+		reader.configstrings, reader.commands, reader.usercmds, reader.clientCommands );
+	Com_Printf( "%.1f entities per frame (peak %d), peak %d players\n",
+		reader.frames ? (float)reader.totalEntities / reader.frames : 0.0f,
+		reader.peakEntities, reader.peakPlayers );
+	Com_Printf( "decoded in %.1f msec, %.1f usec per frame%s\n", start / 1000.0f,
+		reader.frames ? (float)start / reader.frames : 0.0f,
+		reader.error ? ", stopped at an error" : "" );
+}
+
+/*
+==================
+SV_DemoLoadInput
+
+Fills inputs[ MAX_CLIENTS ] with what each client of a server demo did,
+returns the number of client slots the demo has or 0 if it couldn't be read
+==================
+*/
+int SV_DemoLoadInput( const char *name, demoInput_t **inputs, int *numInputs ) {
+	char			path[ MAX_OSPATH ];
+	demoReader_t	reader;
+
+	Com_sprintf( path, sizeof( path ), "demos/server/%s", name );
+	COM_DefaultExtension( path, sizeof( path ), "." DEMO_EXT );
+
+	Com_Memset( &reader, 0, sizeof( reader ) );
+	reader.world = Z_Malloc( sizeof( *reader.world ) );
+	reader.inputs = inputs;
+	reader.numInputs = numInputs;
+	Com_Memset( inputs, 0, MAX_CLIENTS * sizeof( *inputs ) );
+	Com_Memset( numInputs, 0, MAX_CLIENTS * sizeof( *numInputs ) );
+
+	if ( !SV_DemoRead( path, &reader ) ) {
+		reader.maxclients = 0;
+	}
+	Z_Free( reader.world );
+
+	return reader.maxclients;
+}
+
+/*
+==================
+SV_DemoFreeInput
+==================
+*/
+void SV_DemoFreeInput( demoInput_t **inputs, int *numInputs ) {
+	int		i, j;
+
+	for ( i = 0; i < MAX_CLIENTS; i++ ) {
+		for ( j = 0; j < numInputs[ i ]; j++ ) {
+			if ( inputs[ i ][ j ].command ) {
+				Z_Free( inputs[ i ][ j ].command );
+			}
+		}
+
+		if ( inputs[ i ] ) {
+			Z_Free( inputs[ i ] );
+		}
+		inputs[ i ] = NULL;
+		numInputs[ i ] = 0;
+	}
+}
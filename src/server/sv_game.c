@@ -81,6 +81,8 @@ void SV_GameSendServerCommand( int clientNum, const char *text ) {
 		}
 		SV_SendServerCommand( svs.clients + clientNum, "%s", text );
 	}
+
+	SV_DemoServerCommand( clientNum, text );
 }
 
 
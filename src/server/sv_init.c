@@ -898,6 +898,7 @@ void SV_SetConfigstring (int index, const char *val) {
 			modified[0] = qtrue;
 			Z_Free( sv.configstrings[index].s );
 			sv.configstrings[index].s = CopyString( val );
+			SV_DemoConfigstring( index, val );
 		}
 
 		if ( !modified[0] && !modified[1] && !modified[2] ) {
@@ -912,6 +913,7 @@ void SV_SetConfigstring (int index, const char *val) {
 		// change the string in sv
 		Z_Free( sv.configstrings[index].s );
 		sv.configstrings[index].s = CopyString( val );
+		SV_DemoConfigstring( index, val );
 	}
 
 	// send it to all the clients if we aren't
@@ -1224,6 +1226,9 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 	char		systemInfo[16384];
 	const char	*p;
 
+	// a server demo ends with its map
+	SV_DemoStop();
+
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
 
@@ -1308,6 +1313,9 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 	// clear physics interaction links
 	SV_ClearWorld ();
 
+	// allocate the per cluster snapshot buckets for the new map
+	SV_InitSnapshotIndex ();
+
 	// media configstring setting should be done during
 	// the loading stage, so connected clients don't have
 	// to load during actual gameplay
@@ -1562,6 +1570,15 @@ void SV_Init (void)
 	sv_killserver = Cvar_Get ("sv_killserver", "0", 0);
 	sv_mapChecksum = Cvar_Get ("sv_mapChecksum", "", CVAR_ROM);
 	sv_lanForceRate = Cvar_Get ("sv_lanForceRate", "1", CVAR_ARCHIVE );
+	sv_snapshotIndexing = Cvar_Get ("sv_snapshotIndexing", "1", CVAR_ARCHIVE );
+	sv_snapshotThreads = Cvar_Get ("sv_snapshotThreads", "0", CVAR_ARCHIVE );
+	sv_deltaCache = Cvar_Get ("sv_deltaCache", "1", CVAR_ARCHIVE );
+	sv_worldGrid = Cvar_Get ("sv_worldGrid", "0", CVAR_ARCHIVE );
+	sv_traceCache = Cvar_Get ("sv_traceCache", "0", CVAR_ARCHIVE );
+	sv_dbThread = Cvar_Get ("sv_dbThread", "1", CVAR_ARCHIVE );
+	sv_profile = Cvar_Get ("sv_profile", "0", 0 );
+
+	SV_ProfileInit();
 }
 
 
@@ -1621,9 +1638,13 @@ void SV_Shutdown( char *finalmsg ) {
 		SV_FinalMessage( finalmsg );
 	}
 
+	SV_ShutdownSnapshotWorkers();
+
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
+	SV_DemoStop();
 	SV_ShutdownGameProgs();
+	sl_shutdown();
 
 	// free current level
 	SV_ClearServer();
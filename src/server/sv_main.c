@@ -59,6 +59,13 @@ cvar_t	*sv_maxPing;
 cvar_t	*sv_pure;
 cvar_t	*sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
 cvar_t	*sv_banFile;
+cvar_t	*sv_snapshotIndexing;	// bucket entities by PVS cluster once per frame for snapshots
+cvar_t	*sv_snapshotThreads;	// worker threads building snapshots, -1 picks from the processor count
+cvar_t	*sv_deltaCache;		// share encoded entity deltas between the clients of a frame
+cvar_t	*sv_worldGrid;		// link entities into a uniform grid instead of the sector tree, from the next map
+cvar_t	*sv_traceCache;		// reuse the results of identical traces until something is linked or unlinked
+cvar_t	*sv_dbThread;		// run database writes and lookups on a background thread
+cvar_t	*sv_profile;		// time the phases of each frame for the profile command
 
 // server attack protection
 cvar_t *sv_protect;     // 0 - unprotected
@@ -1227,6 +1234,9 @@ void SV_Frame( int msec ) {
 		return;
 	}
 
+	// hand out the results of finished database queries
+	sl_poll( qtrue );
+
 	// allow pause if only the local client is connected
 	if ( SV_CheckPaused() ) {
 		return;
@@ -1290,8 +1300,12 @@ void SV_Frame( int msec ) {
 		startTime = 0;	// quite a compiler warning
 	}
 
+	SV_ProfileBegin( PROFILE_FRAME );
+
 	// update ping based on the all received frames
+	SV_ProfileBegin( PROFILE_CALCPINGS );
 	SV_CalcPings();
+	SV_ProfileEnd( PROFILE_CALCPINGS );
 
 	// run the game simulation in chunks
 	while ( sv.timeResidual >= frameMsec ) {
@@ -1300,7 +1314,11 @@ void SV_Frame( int msec ) {
 		sv.time += frameMsec;
 
 		// let everything in the world think and move
+		SV_ProfileBegin( PROFILE_GAME );
 		dll_G_RunFrame( sv.time );
+		SV_ProfileEnd( PROFILE_GAME );
+
+		SV_DemoFrame();
 	}
 
 	if ( com_speeds->integer ) {
@@ -1308,10 +1326,14 @@ void SV_Frame( int msec ) {
 	}
 
 	// check timeouts
+	SV_ProfileBegin( PROFILE_TIMEOUTS );
 	SV_CheckTimeouts();
+	SV_ProfileEnd( PROFILE_TIMEOUTS );
 
 	// send messages back to the clients
+	SV_ProfileBegin( PROFILE_SENDMESSAGES );
 	SV_SendClientMessages();
+	SV_ProfileEnd( PROFILE_SENDMESSAGES );
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat(HEARTBEAT_FOR_MASTER);
@@ -1367,6 +1389,9 @@ void SV_Frame( int msec ) {
 		svs.serverLoad = -1;
 	}
 
+	SV_ProfileEnd( PROFILE_FRAME );
+	SV_ProfileFrame();
+
 	// collect timing statistics
 	// - the above 2.60 performance thingy is just inaccurate (30 seconds 'stats')
 	//   to give good warning messages and is only done for dedicated
@@ -0,0 +1,452 @@
+/*
+===========================================================================
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// sv_profile.c -- per phase frame timing
+
+#include "server.h"
+
+/*
+Zones are named phases of a server frame, timed with SV_ProfileBegin and
+SV_ProfileEnd. They nest, and the first zone a zone is seen inside of
+becomes its parent in the report. A zone can be entered any number of
+times in a frame (once per entity, say); the time of all of them is
+summed and goes into the zone's histogram once at the end of the frame.
+
+While sv_profile is 0, begin and end return straight away.
+*/
+
+#define MAX_PROFILE_ZONES	64
+#define MAX_PROFILE_DEPTH	16
+#define MAX_TRACE_EVENTS	( 1 << 16 )
+
+// log-linear microsecond buckets: exact below 16, then 8 per power of two
+#define PROFILE_LINEAR		16
+#define PROFILE_SUBBUCKETS	8
+#define PROFILE_BUCKETS		( PROFILE_LINEAR + 27 * PROFILE_SUBBUCKETS )
+
+typedef struct {
+	char		name[ 32 ];
+	int			parent;			// -1 for a top level zone, -2 before it was first entered
+
+	int64_t		frameTime;		// summed over the current frame
+	int			frameCalls;
+
+	int			frames;			// frames the zone was entered in
+	int			calls;
+	int64_t		total;
+	int64_t		max;
+	int			histogram[ PROFILE_BUCKETS ];
+} profileZone_t;
+
+typedef struct {
+	int			zone;
+	int			frame;
+	int64_t		start;
+	int64_t		duration;
+} traceEvent_t;
+
+static struct {
+	qboolean		active;
+	profileZone_t	zones[ MAX_PROFILE_ZONES ];
+	int				numZones;
+
+	int				stack[ MAX_PROFILE_DEPTH ];
+	int64_t			stackStart[ MAX_PROFILE_DEPTH ];
+	int				depth;
+
+	// trace capture for the profile trace command
+	int				traceFrames;
+	int				traceFrame;
+	int64_t			traceStart;
+	char			traceFile[ MAX_QPATH ];
+	traceEvent_t	*traceEvents;
+	int				numTraceEvents;
+} profiler;
+
+/*
+================
+SV_ProfileBucket
+================
+*/
+static int SV_ProfileBucket( int64_t usec ) {
+	int		exponent;
+
+	if ( usec < PROFILE_LINEAR ) {
+		return usec < 0 ? 0 : (int)usec;
+	}
+
+	for ( exponent = 4 ; exponent < 30 && ( usec >> ( exponent + 1 ) ) ; exponent++ ) {
+	}
+	if ( exponent == 30 ) {
+		return PROFILE_BUCKETS - 1;
+	}
+
+	return PROFILE_LINEAR + ( exponent - 4 ) * PROFILE_SUBBUCKETS +
+		(int)( ( usec >> ( exponent - 3 ) ) & ( PROFILE_SUBBUCKETS - 1 ) );
+}
+
+/*
+================
+SV_ProfileBucketValue
+
+The lowest time that falls into a bucket
+================
+*/
+static int64_t SV_ProfileBucketValue( int bucket ) {
+	int		exponent, sub;
+
+	if ( bucket < PROFILE_LINEAR ) {
+		return bucket;
+	}
+
+	exponent = 4 + ( bucket - PROFILE_LINEAR ) / PROFILE_SUBBUCKETS;
+	sub = ( bucket - PROFILE_LINEAR ) % PROFILE_SUBBUCKETS;
+
+	return ( (int64_t)1 << exponent ) + ( (int64_t)sub << ( exponent - 3 ) );
+}
+
+/*
+================
+SV_ProfilePercentile
+================
+*/
+static int64_t SV_ProfilePercentile( const profileZone_t *zone, float fraction ) {
+	int		i, want, seen;
+
+	want = (int)( zone->frames * fraction );
+	for ( i = 0, seen = 0 ; i < PROFILE_BUCKETS ; i++ ) {
+		seen += zone->histogram[ i ];
+		if ( seen > want ) {
+			return SV_ProfileBucketValue( i );
+		}
+	}
+
+	return zone->max;
+}
+
+/*
+================
+SV_ProfileZone
+
+Returns the handle for a named zone, creating it the first time
+================
+*/
+int SV_ProfileZone( const char *name ) {
+	profileZone_t	*zone;
+	int				i;
+
+	for ( i = 0 ; i < profiler.numZones ; i++ ) {
+		if ( !Q_stricmp( profiler.zones[ i ].name, name ) ) {
+			return i;
+		}
+	}
+
+	if ( profiler.numZones == MAX_PROFILE_ZONES ) {
+		Com_DPrintf( "SV_ProfileZone: no free zone for %s\n", name );
+		return -1;
+	}
+
+	zone = &profiler.zones[ profiler.numZones ];
+	Com_Memset( zone, 0, sizeof( *zone ) );
+	Q_strncpyz( zone->name, name, sizeof( zone->name ) );
+	zone->parent = -2;
+
+	return profiler.numZones++;
+}
+
+/*
+================
+SV_ProfileBegin
+================
+*/
+void SV_ProfileBegin( int zone ) {
+	int		depth = profiler.depth;
+
+	if ( !profiler.active || zone < 0 ) {
+		return;
+	}
+
+	if ( depth == MAX_PROFILE_DEPTH ) {
+		return;
+	}
+
+	if ( profiler.zones[ zone ].parent == -2 ) {
+		profiler.zones[ zone ].parent = depth ? profiler.stack[ depth - 1 ] : -1;
+	}
+
+	profiler.stack[ depth ] = zone;
+	profiler.stackStart[ depth ] = Sys_Microseconds( );
+	profiler.depth++;
+}
+
+/*
+================
+SV_ProfileEnd
+================
+*/
+void SV_ProfileEnd( int zone ) {
+	profileZone_t	*z;
+	int64_t			now, duration;
+	int				depth;
+
+	if ( !profiler.active || zone < 0 ) {
+		return;
+	}
+
+	// tolerate unbalanced zones by unwinding to the one being closed
+	for ( depth = profiler.depth - 1 ; depth >= 0 ; depth-- ) {
+		if ( profiler.stack[ depth ] == zone ) {
+			break;
+		}
+	}
+	if ( depth < 0 ) {
+		return;
+	}
+	profiler.depth = depth;
+
+	now = Sys_Microseconds( );
+	duration = now - profiler.stackStart[ depth ];
+
+	z = &profiler.zones[ zone ];
+	z->frameTime += duration;
+	z->frameCalls++;
+
+	if ( profiler.traceEvents && profiler.numTraceEvents < MAX_TRACE_EVENTS ) {
+		traceEvent_t *event = &profiler.traceEvents[ profiler.numTraceEvents++ ];
+
+		event->zone = zone;
+		event->frame = profiler.traceFrame;
+		event->start = profiler.stackStart[ depth ] - profiler.traceStart;
+		event->duration = duration;
+	}
+}
+
+/*
+================
+SV_ProfileWriteTrace
+
+Writes the captured frames in the Chrome trace event format, which
+chrome://tracing and Perfetto both load
+================
+*/
+static void SV_ProfileWriteTrace( void ) {
+	fileHandle_t	f;
+	char			line[ 256 ];
+	int				i;
+
+	f = FS_FOpenFileWrite( profiler.traceFile );
+	if ( !f ) {
+		Com_Printf( "Couldn't write %s\n", profiler.traceFile );
+		return;
+	}
+
+	FS_Write( "{\"traceEvents\":[\n", 17, f );
+	for ( i = 0 ; i < profiler.numTraceEvents ; i++ ) {
+		const traceEvent_t *event = &profiler.traceEvents[ i ];
+
+		Com_sprintf( line, sizeof( line ),
+			"%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1,\"args\":{\"frame\":%d}}\n",
+			i ? "," : "", profiler.zones[ event->zone ].name,
+			(long long)event->start, (long long)event->duration, event->frame );
+		FS_Write( line, strlen( line ), f );
+	}
+	FS_Write( "],\"displayTimeUnit\":\"ms\"}\n", 26, f );
+	FS_FCloseFile( f );
+
+	Com_Printf( "Wrote %d events from %d frames to %s%s\n", profiler.numTraceEvents,
+		profiler.traceFrame, profiler.traceFile,
+		profiler.numTraceEvents == MAX_TRACE_EVENTS ? " (truncated)" : "" );
+}
+
+/*
+================
+SV_ProfileFrame
+
+Called at the end of every server frame
+================
+*/
+void SV_ProfileFrame( void ) {
+	profileZone_t	*zone;
+	int				i;
+
+	if ( profiler.active ) {
+		for ( i = 0, zone = profiler.zones ; i < profiler.numZones ; i++, zone++ ) {
+			if ( !zone->frameCalls ) {
+				continue;
+			}
+
+			zone->frames++;
+			zone->calls += zone->frameCalls;
+			zone->total += zone->frameTime;
+			if ( zone->frameTime > zone->max ) {
+				zone->max = zone->frameTime;
+			}
+			zone->histogram[ SV_ProfileBucket( zone->frameTime ) ]++;
+
+			zone->frameTime = 0;
+			zone->frameCalls = 0;
+		}
+	}
+	profiler.depth = 0;
+
+	if ( profiler.traceEvents && ++profiler.traceFrame >= profiler.traceFrames ) {
+		SV_ProfileWriteTrace( );
+		Z_Free( profiler.traceEvents );
+		profiler.traceEvents = NULL;
+	}
+
+	profiler.active = sv_profile->integer || profiler.traceEvents;
+}
+
+/*
+================
+SV_ProfileReset
+================
+*/
+void SV_ProfileReset( void ) {
+	profileZone_t	*zone;
+	int				i;
+
+	for ( i = 0, zone = profiler.zones ; i < profiler.numZones ; i++, zone++ ) {
+		zone->frameTime = 0;
+		zone->frameCalls = 0;
+		zone->frames = 0;
+		zone->calls = 0;
+		zone->total = 0;
+		zone->max = 0;
+		Com_Memset( zone->histogram, 0, sizeof( zone->histogram ) );
+	}
+}
+
+/*
+================
+SV_ProfilePrintZone
+================
+*/
+static void SV_ProfilePrintZone( int index, int indent ) {
+	const profileZone_t	*zone = &profiler.zones[ index ];
+	char				name[ 48 ];
+	int					i;
+
+	if ( zone->frames ) {
+		Com_sprintf( name, sizeof( name ), "%*s%s", indent * 2, "", zone->name );
+		Com_Printf( "%-32s %6d %8.1f %8d %8d %8d %8d\n", name, zone->frames,
+			(float)zone->calls / zone->frames,
+			(int)( zone->total / zone->frames ),
+			(int)SV_ProfilePercentile( zone, 0.5f ),
+			(int)SV_ProfilePercentile( zone, 0.99f ),
+			(int)zone->max );
+	}
+
+	for ( i = 0 ; i < profiler.numZones ; i++ ) {
+		if ( profiler.zones[ i ].parent == index ) {
+			SV_ProfilePrintZone( i, indent + 1 );
+		}
+	}
+}
+
+/*
+================
+SV_ProfilePrint
+
+Prints the collected times as a tree of zones
+================
+*/
+void SV_ProfilePrint( void ) {
+	int		i;
+
+	Com_Printf( "%-32s %6s %8s %8s %8s %8s %8s\n", "zone (usec per frame)", "frames", "calls", "mean", "p50", "p99", "max" );
+	for ( i = 0 ; i < profiler.numZones ; i++ ) {
+		if ( profiler.zones[ i ].parent < 0 ) {
+			SV_ProfilePrintZone( i, 0 );
+		}
+	}
+}
+
+/*
+================
+SV_Profile_f
+
+profile                  print per frame times of every zone in usec
+profile reset            clear the collected times
+profile trace [frames] [file]
+                         write the next frames as a Chrome trace
+================
+*/
+void SV_Profile_f( void ) {
+	char	*cmd = Cmd_Argv( 1 );
+
+	if ( !Q_stricmp( cmd, "reset" ) ) {
+		SV_ProfileReset( );
+		Com_Printf( "Profile reset\n" );
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "trace" ) ) {
+		if ( profiler.traceEvents ) {
+			Com_Printf( "Already tracing\n" );
+			return;
+		}
+
+		profiler.traceFrames = Cmd_Argc( ) > 2 ? atoi( Cmd_Argv( 2 ) ) : 100;
+		if ( profiler.traceFrames < 1 ) {
+			profiler.traceFrames = 1;
+		}
+		Q_strncpyz( profiler.traceFile, Cmd_Argc( ) > 3 ? Cmd_Argv( 3 ) : "profile.json",
+			sizeof( profiler.traceFile ) );
+		COM_DefaultExtension( profiler.traceFile, sizeof( profiler.traceFile ), ".json" );
+
+		profiler.traceEvents = Z_Malloc( MAX_TRACE_EVENTS * sizeof( traceEvent_t ) );
+		profiler.numTraceEvents = 0;
+		profiler.traceFrame = 0;
+		profiler.traceStart = Sys_Microseconds( );
+		Com_Printf( "Tracing %d frames to %s\n", profiler.traceFrames, profiler.traceFile );
+		return;
+	}
+
+	if ( *cmd ) {
+		Com_Printf( "usage: profile [reset|trace [frames] [file]]\n" );
+		return;
+	}
+
+	if ( !sv_profile->integer ) {
+		Com_Printf( "sv_profile is 0, times are not being collected\n" );
+	}
+
+	SV_ProfilePrint( );
+}
+
+/*
+================
+SV_ProfileInit
+
+Registers the engine's own zones in profileZoneNum_t order
+================
+*/
+void SV_ProfileInit( void ) {
+	SV_ProfileZone( "SV_Frame" );
+	SV_ProfileZone( "SV_CalcPings" );
+	SV_ProfileZone( "G_RunFrame" );
+	SV_ProfileZone( "SV_CheckTimeouts" );
+	SV_ProfileZone( "SV_SendClientMessages" );
+	SV_ProfileZone( "SV_DemoFrame" );
+	SV_ProfileZone( "ClientThink" );
+}
@@ -47,6 +47,198 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Most clients get an entity delta compressed from the same state, either the
+baseline or the state they all saw in the previous snapshot, so the encoded
+bits of each transition are kept for the rest of the frame and appended to
+the other clients' messages instead of encoding them again.
+
+=============================================================================
+*/
+
+#define DELTA_CACHE_ENTRIES		4096		// must be a power of two
+#define DELTA_CACHE_PROBES		8
+#define DELTA_CACHE_BYTES		0x100000
+#define MAX_DELTA_BYTES			512			// largest encoded entityState_t
+
+typedef struct {
+	int				generation;		// valid while it matches the cache's
+	unsigned int	hash;
+	int				alternateProtocol;
+	qboolean		force;
+	entityState_t	from;
+	entityState_t	to;
+	int				offset;			// into deltaCache_t.data
+	int				bits;
+} deltaCacheEntry_t;
+
+typedef struct {
+	int					generation;
+	sysMutex_t			*mutex;		// set while snapshot workers share the cache
+	int					dataUsed;
+	deltaCacheEntry_t	entries[DELTA_CACHE_ENTRIES];
+	byte				data[DELTA_CACHE_BYTES];
+} deltaCache_t;
+
+static deltaCache_t		deltaCache;
+
+/*
+=============
+SV_ClearDeltaCache
+
+Forgets the transitions of the previous frame
+=============
+*/
+static void SV_ClearDeltaCache( void ) {
+	deltaCache.generation++;
+	deltaCache.dataUsed = 0;
+}
+
+/*
+=============
+SV_HashDelta
+=============
+*/
+static unsigned int SV_HashDelta( int alternateProtocol, const entityState_t *from, qboolean force ) {
+	const unsigned int	*p = (const unsigned int *)from;
+	unsigned int		hash;
+	int					i;
+
+	hash = 2166136261u ^ ( alternateProtocol << 1 ) ^ force;
+	for ( i = 0 ; i < sizeof( *from ) / 4 ; i++ ) {
+		hash = ( hash ^ p[i] ) * 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+=============
+SV_FindDelta
+
+Entries are never changed again during a generation, so the bits can
+be used after the mutex is released
+=============
+*/
+static deltaCacheEntry_t *SV_FindDelta( unsigned int hash, int alternateProtocol,
+	const entityState_t *from, const entityState_t *to, qboolean force ) {
+	deltaCacheEntry_t	*entry;
+	int					i;
+
+	for ( i = 0 ; i < DELTA_CACHE_PROBES ; i++ ) {
+		entry = &deltaCache.entries[ ( hash + i ) & ( DELTA_CACHE_ENTRIES - 1 ) ];
+
+		if ( entry->generation != deltaCache.generation ) {
+			break;
+		}
+
+		if ( entry->hash == hash && entry->alternateProtocol == alternateProtocol &&
+			entry->force == force && !memcmp( &entry->to, to, sizeof( *to ) ) &&
+			!memcmp( &entry->from, from, sizeof( *from ) ) ) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+=============
+SV_StoreDelta
+=============
+*/
+static void SV_StoreDelta( unsigned int hash, int alternateProtocol,
+	const entityState_t *from, const entityState_t *to, qboolean force, msg_t *encoded ) {
+	deltaCacheEntry_t	*entry;
+	int					i, numBytes;
+
+	numBytes = ( encoded->bit + 7 ) >> 3;
+	if ( deltaCache.dataUsed + numBytes > DELTA_CACHE_BYTES ) {
+		return;
+	}
+
+	for ( i = 0 ; i < DELTA_CACHE_PROBES ; i++ ) {
+		entry = &deltaCache.entries[ ( hash + i ) & ( DELTA_CACHE_ENTRIES - 1 ) ];
+		if ( entry->generation != deltaCache.generation ) {
+			break;
+		}
+	}
+	if ( i == DELTA_CACHE_PROBES ) {
+		return;
+	}
+
+	entry->hash = hash;
+	entry->alternateProtocol = alternateProtocol;
+	entry->force = force;
+	entry->from = *from;
+	entry->to = *to;
+	entry->offset = deltaCache.dataUsed;
+	entry->bits = encoded->bit;
+	Com_Memcpy( deltaCache.data + entry->offset, encoded->data, numBytes );
+	deltaCache.dataUsed += numBytes;
+
+	entry->generation = deltaCache.generation;
+}
+
+/*
+=============
+SV_WriteDeltaEntity
+
+MSG_WriteDeltaEntity through the delta cache
+=============
+*/
+static void SV_WriteDeltaEntity( int alternateProtocol, msg_t *msg,
+	entityState_t *from, entityState_t *to, qboolean force ) {
+	deltaCacheEntry_t	*entry;
+	unsigned int		hash;
+	msg_t				encoded;
+	byte				encodedBuf[MAX_DELTA_BYTES];
+
+	if ( !sv_deltaCache->integer || !deltaCache.generation || !to ) {
+		MSG_WriteDeltaEntity( alternateProtocol, msg, from, to, force );
+		return;
+	}
+
+	// nothing at all is written for unchanged entities
+	if ( !force && !memcmp( from, to, sizeof( *to ) ) ) {
+		return;
+	}
+
+	hash = SV_HashDelta( alternateProtocol, from, force );
+
+	if ( deltaCache.mutex ) {
+		Sys_LockMutex( deltaCache.mutex );
+	}
+	entry = SV_FindDelta( hash, alternateProtocol, from, to, force );
+	if ( deltaCache.mutex ) {
+		Sys_UnlockMutex( deltaCache.mutex );
+	}
+
+	if ( entry ) {
+		MSG_WriteBitstream( msg, deltaCache.data + entry->offset, entry->bits );
+		return;
+	}
+
+	MSG_Init( &encoded, encodedBuf, sizeof( encodedBuf ) );
+	MSG_WriteDeltaEntity( alternateProtocol, &encoded, from, to, force );
+	if ( encoded.overflowed ) {
+		MSG_WriteDeltaEntity( alternateProtocol, msg, from, to, force );
+		return;
+	}
+
+	MSG_WriteBitstream( msg, encodedBuf, encoded.bit );
+
+	if ( deltaCache.mutex ) {
+		Sys_LockMutex( deltaCache.mutex );
+	}
+	SV_StoreDelta( hash, alternateProtocol, from, to, force, &encoded );
+	if ( deltaCache.mutex ) {
+		Sys_UnlockMutex( deltaCache.mutex );
+	}
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -90,7 +282,7 @@ static void SV_EmitPacketEntities( client_t *client, int alternateProtocol, clie
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity (alternateProtocol, msg, oldent, newent, qfalse );
+			SV_WriteDeltaEntity (alternateProtocol, msg, oldent, newent, qfalse );
 			oldindex++;
 			newindex++;
 			continue;
@@ -98,7 +290,7 @@ static void SV_EmitPacketEntities( client_t *client, int alternateProtocol, clie
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (alternateProtocol, msg, &sv.svEntities[newnum].baseline[client - svs.clients], newent, qtrue );
+			SV_WriteDeltaEntity (alternateProtocol, msg, &sv.svEntities[newnum].baseline[client - svs.clients], newent, qtrue );
 			newindex++;
 			continue;
 		}
@@ -118,42 +310,56 @@ static void SV_EmitPacketEntities( client_t *client, int alternateProtocol, clie
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SnapshotDeltaFrame
+
+Picks the previous frame the new snapshot will be delta compressed from
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
-	clientSnapshot_t	*frame, *oldframe;
-	int					lastframe;
-	int					i;
-	int					snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+static clientSnapshot_t *SV_SnapshotDeltaFrame( client_t *client, int *lastframe ) {
+	clientSnapshot_t	*oldframe;
 
 	// try to use a previous frame as the source for delta compressing the snapshot
 	if ( client->deltaMessage <= 0 || client->state != CS_ACTIVE ) {
 		// client is asking for a retransmit
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else if ( client->netchan.outgoingSequence - client->deltaMessage
 		>= (PACKET_BACKUP - 3) ) {
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else {
 		// we have a valid snapshot to delta from
 		oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
-		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
+		*lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
 		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
 			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
 			oldframe = NULL;
-			lastframe = 0;
+			*lastframe = 0;
 		}
 	}
 
+	return oldframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+
+Safe to call from the snapshot worker threads
+==================
+*/
+static void SV_WriteSnapshotToClient( client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg ) {
+	clientSnapshot_t	*frame;
+	int					i;
+	int					snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	MSG_WriteByte (msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -240,8 +446,11 @@ Build a client snapshot structure
 typedef struct {
 	int		numSnapshotEntities;
 	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	unsigned int	added[MAX_GENTITIES / 32];	// prevents double adding from portal views
 } snapshotEntityNumbers_t;
 
+#define SV_SnapshotHasEntity( eNums, e ) ( (eNums)->added[ (e) >> 5 ] & ( 1u << ( (e) & 31 ) ) )
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -270,12 +479,14 @@ static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
 SV_AddEntToSnapshot
 ===============
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	int		e = gEnt->s.number;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( SV_SnapshotHasEntity( eNums, e ) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[ e >> 5 ] |= 1u << ( e & 31 );
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
@@ -286,208 +497,385 @@ static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapsh
 	eNums->numSnapshotEntities++;
 }
 
+/*
+=============================================================================
+
+Per-frame snapshot candidate index
+
+Rather than every client walking all of sv.num_entities for every snapshot,
+the linked entities are bucketed once per server frame by the PVS clusters
+they touch.  Entities that have to be considered regardless of the viewer's
+PVS (broadcast, inclusive client masks, cluster overflow) are kept in a
+separate list.  Each viewpoint then only gathers the buckets of the clusters
+set in its PVS into a candidate bitmask, and the regular per entity checks
+are run on those candidates in entity number order.
+
+=============================================================================
+*/
+
+typedef struct {
+	int		entityNum;
+	int		next;		// next link in the same cluster, -1 terminates
+} snapshotClusterLink_t;
+
+typedef struct {
+	qboolean	active;			// only valid inside SV_SendClientMessages
+
+	int			numClusters;
+	int			*clusterLinks;	// [numClusters], first link for each cluster
+
+	snapshotClusterLink_t	links[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+	int			numLinks;
+
+	int			globalEntities[MAX_GENTITIES];
+	int			numGlobalEntities;
+} snapshotIndex_t;
+
+static snapshotIndex_t	sv_snapshotIndex;
+
 /*
 ===============
-SV_AddEntitiesVisibleFromPoint
+SV_InitSnapshotIndex
+
+Called after the world has been loaded to allocate the per cluster buckets
 ===============
 */
-static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
-									snapshotEntityNumbers_t *eNums, qboolean portal ) {
-	int		e, i;
-	sharedEntity_t *ent;
-	svEntity_t	*svEnt;
-	int		l;
-	int		clientarea, clientcluster;
-	int		leafnum;
-	byte	*clientpvs;
-	byte	*bitvector;
+void SV_InitSnapshotIndex( void ) {
+	sv_snapshotIndex.active = qfalse;
+	sv_snapshotIndex.numClusters = CM_NumClusters();
+	sv_snapshotIndex.clusterLinks = Hunk_Alloc(
+		sv_snapshotIndex.numClusters * sizeof( *sv_snapshotIndex.clusterLinks ), h_high );
+}
 
-	// during an error shutdown message we may need to transmit
-	// the shutdown message after the server has shutdown, so
-	// specfically check for it
-	if ( !sv.state ) {
-		return;
+/*
+===============
+SV_FixEntityNumbers
+
+The snapshot code relies on ent->s.number, which the game may have left stale
+===============
+*/
+static void SV_FixEntityNumbers( void ) {
+	sharedEntity_t	*ent;
+	int				e;
+
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+
+		if ( ent->r.linked && ent->s.number != e ) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
 	}
+}
 
-	leafnum = CM_PointLeafnum (origin);
-	clientarea = CM_LeafArea (leafnum);
-	clientcluster = CM_LeafCluster (leafnum);
+/*
+===============
+SV_BuildSnapshotIndex
 
-	// calculate the visible areas
-	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
+Buckets every entity that can be sent to a client by the clusters it touches
+===============
+*/
+static void SV_BuildSnapshotIndex( void ) {
+	snapshotIndex_t	*index = &sv_snapshotIndex;
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	int				e, i, cluster;
+
+	index->active = qfalse;
+	if ( !sv_snapshotIndexing->integer || sv.state != SS_GAME || !index->clusterLinks ) {
+		return;
+	}
 
-	clientpvs = CM_ClusterPVS (clientcluster);
+	for ( i = 0 ; i < index->numClusters ; i++ ) {
+		index->clusterLinks[i] = -1;
+	}
+	index->numLinks = 0;
+	index->numGlobalEntities = 0;
 
 	for ( e = 0 ; e < sv.num_entities ; e++ ) {
 		ent = SV_GentityNum(e);
 
-		// never send entities that aren't linked in
-		if ( !ent->r.linked ) {
+		if ( !ent->r.linked || ( ent->r.svFlags & SVF_NOCLIENT ) ) {
 			continue;
 		}
 
-		if (ent->s.number != e) {
-			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
+		svEnt = &sv.svEntities[ e ];
 
-		// entities can be flagged to explicitly not be sent to the client
-		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		// these can be sent without being in the viewer's PVS, or they
+		// touch more clusters than could be stored, so always check them
+		if ( ( ent->r.svFlags & ( SVF_BROADCAST | SVF_CLIENTMASK_INCLUSIVE ) ) ||
+			svEnt->lastCluster ) {
+			index->globalEntities[ index->numGlobalEntities++ ] = e;
 			continue;
 		}
 
-		// entities can be flagged to be sent to only one client
-		if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
-			if ( ent->r.singleClient != frame->ps.clientNum ) {
-				continue;
-			}
-		}
-		// entities can be flagged to be sent to everyone but one client
-		if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
-			if ( ent->r.singleClient == frame->ps.clientNum ) {
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			cluster = svEnt->clusternums[i];
+			if ( cluster < 0 || cluster >= index->numClusters ) {
 				continue;
 			}
+			index->links[ index->numLinks ].entityNum = e;
+			index->links[ index->numLinks ].next = index->clusterLinks[ cluster ];
+			index->clusterLinks[ cluster ] = index->numLinks;
+			index->numLinks++;
 		}
-		// entities can be flagged to be sent only to a given mask of clients
-		if ( ent->r.svFlags & SVF_CLIENTMASK_EXCLUSIVE ) {
-			if ( frame->ps.clientNum >= 32 ) {
-				if ( ~ent->r.hack.generic1 & ( 1 << ( frame->ps.clientNum - 32 ) ) )
-					continue;
-			} else {
-				if ( ~ent->r.singleClient & ( 1 << frame->ps.clientNum ) )
-					continue;
-			}
-		}
+	}
+
+	index->active = qtrue;
+}
+
+/*
+===============
+SV_GatherSnapshotCandidates
+
+Fills a bitmask with every entity that could be visible through the given PVS
+===============
+*/
+static void SV_GatherSnapshotCandidates( const byte *pvs, unsigned int *candidates ) {
+	snapshotIndex_t	*index = &sv_snapshotIndex;
+	int				i, cluster, link, e;
+
+	Com_Memset( candidates, 0, ( MAX_GENTITIES / 32 ) * sizeof( *candidates ) );
 
-		svEnt = SV_SvEntityForGentity( ent );
+	for ( i = 0 ; i < index->numGlobalEntities ; i++ ) {
+		e = index->globalEntities[i];
+		candidates[ e >> 5 ] |= 1u << ( e & 31 );
+	}
 
-		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	for ( cluster = 0 ; cluster < index->numClusters ; cluster++ ) {
+		if ( !pvs[ cluster >> 3 ] ) {
+			// skip a whole byte of invisible clusters at once
+			cluster |= 7;
 			continue;
 		}
-
-		// broadcast entities are always sent
-		if ( ent->r.svFlags & SVF_BROADCAST ) {
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+		if ( !( pvs[ cluster >> 3 ] & ( 1 << ( cluster & 7 ) ) ) ) {
 			continue;
 		}
+		for ( link = index->clusterLinks[ cluster ] ; link != -1 ; link = index->links[ link ].next ) {
+			e = index->links[ link ].entityNum;
+			candidates[ e >> 5 ] |= 1u << ( e & 31 );
+		}
+	}
+}
 
-		// entities can be flagged to be sent always to a given mask of clients,
-		// while still can be sent to other clients
-		if ( ent->r.svFlags & SVF_CLIENTMASK_INCLUSIVE ) {
-			if ( frame->ps.clientNum >= 32 ) {
-				if ( ent->r.hack.generic1 & ( 1 << ( frame->ps.clientNum - 32 ) ) ) {
-					SV_AddEntToSnapshot( svEnt, ent, eNums );
-					continue;
-				}
-			} else {
-				if ( ent->r.singleClient & ( 1 << frame->ps.clientNum ) ){
-					SV_AddEntToSnapshot( svEnt, ent, eNums );
-					continue;
-				}
-			}
+static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, qboolean portal );
+
+/*
+===============
+SV_AddEntityIfVisible
+===============
+*/
+static void SV_AddEntityIfVisible( int e, vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, int clientarea, byte *clientpvs ) {
+	int		i;
+	sharedEntity_t *ent;
+	svEntity_t	*svEnt;
+	int		l;
+	byte	*bitvector;
+
+	ent = SV_GentityNum(e);
+
+	// never send entities that aren't linked in
+	if ( !ent->r.linked ) {
+		return;
+	}
+
+	// SV_FixEntityNumbers has made sure ent->s.number == e
+
+	// entities can be flagged to explicitly not be sent to the client
+	if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		return;
+	}
+
+	// entities can be flagged to be sent to only one client
+	if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
+		if ( ent->r.singleClient != frame->ps.clientNum ) {
+			return;
+		}
+	}
+	// entities can be flagged to be sent to everyone but one client
+	if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
+		if ( ent->r.singleClient == frame->ps.clientNum ) {
+			return;
 		}
+	}
+	// entities can be flagged to be sent only to a given mask of clients
+	if ( ent->r.svFlags & SVF_CLIENTMASK_EXCLUSIVE ) {
+		if ( frame->ps.clientNum >= 32 ) {
+			if ( ~ent->r.hack.generic1 & ( 1 << ( frame->ps.clientNum - 32 ) ) )
+				return;
+		} else {
+			if ( ~ent->r.singleClient & ( 1 << frame->ps.clientNum ) )
+				return;
+		}
+	}
+
+	svEnt = &sv.svEntities[ e ];
+
+	// don't double add an entity through portals
+	if ( SV_SnapshotHasEntity( eNums, e ) ) {
+		return;
+	}
 
-		// ignore if not touching a PV leaf
-		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
-				continue;		// blocked by a door
+	// broadcast entities are always sent
+	if ( ent->r.svFlags & SVF_BROADCAST ) {
+		SV_AddEntToSnapshot( ent, eNums );
+		return;
+	}
+
+	// entities can be flagged to be sent always to a given mask of clients,
+	// while still can be sent to other clients
+	if ( ent->r.svFlags & SVF_CLIENTMASK_INCLUSIVE ) {
+		if ( frame->ps.clientNum >= 32 ) {
+			if ( ent->r.hack.generic1 & ( 1 << ( frame->ps.clientNum - 32 ) ) ) {
+				SV_AddEntToSnapshot( ent, eNums );
+				return;
+			}
+		} else {
+			if ( ent->r.singleClient & ( 1 << frame->ps.clientNum ) ){
+				SV_AddEntToSnapshot( ent, eNums );
+				return;
 			}
 		}
+	}
 
-		bitvector = clientpvs;
-
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
-			continue;
+	// ignore if not touching a PV leaf
+	// check area
+	if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			return;		// blocked by a door
 		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
-			}
+	}
+
+	bitvector = clientpvs;
+
+	// check individual leafs
+	if ( !svEnt->numClusters ) {
+		return;
+	}
+	l = 0;
+	for ( i=0 ; i < svEnt->numClusters ; i++ ) {
+		l = svEnt->clusternums[i];
+		if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+			break;
 		}
+	}
 
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
-					}
-				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
+	// if we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	if ( i == svEnt->numClusters ) {
+		if ( svEnt->lastCluster ) {
+			for ( ; l <= svEnt->lastCluster ; l++ ) {
+				if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+					break;
 				}
-			} else {
-				continue;
 			}
+			if ( l == svEnt->lastCluster ) {
+				return;	// not visible
+			}
+		} else {
+			return;
 		}
+	}
 
-		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+	// add it
+	SV_AddEntToSnapshot( ent, eNums );
 
-		// if it's a portal entity, add everything visible from its camera position
-		if ( ent->r.svFlags & SVF_PORTAL ) {
-			if ( ent->s.generic1 ) {
-				vec3_t dir;
-				VectorSubtract(ent->r.currentOrigin, origin, dir);
-				if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
-					continue;
-				}
+	// if it's a portal entity, add everything visible from its camera position
+	if ( ent->r.svFlags & SVF_PORTAL ) {
+		if ( ent->s.generic1 ) {
+			vec3_t dir;
+			VectorSubtract(ent->r.currentOrigin, origin, dir);
+			if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
+				return;
+			}
+		}
+		SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+	}
+}
+
+/*
+===============
+SV_AddEntitiesVisibleFromPoint
+===============
+*/
+static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, qboolean portal ) {
+	int		e, i, b;
+	int		clientarea, clientcluster;
+	int		leafnum;
+	byte	*clientpvs;
+	unsigned int	candidates[MAX_GENTITIES / 32];
+
+	// during an error shutdown message we may need to transmit
+	// the shutdown message after the server has shutdown, so
+	// specfically check for it
+	if ( !sv.state ) {
+		return;
+	}
+
+	leafnum = CM_PointLeafnum (origin);
+	clientarea = CM_LeafArea (leafnum);
+	clientcluster = CM_LeafCluster (leafnum);
+
+	// calculate the visible areas
+	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
+
+	clientpvs = CM_ClusterPVS (clientcluster);
+
+	if ( !sv_snapshotIndex.active ) {
+		for ( e = 0 ; e < sv.num_entities ; e++ ) {
+			SV_AddEntityIfVisible( e, origin, frame, eNums, clientarea, clientpvs );
+		}
+		return;
+	}
+
+	// only visit the entities bucketed in the clusters this point can see,
+	// still in increasing entity number order
+	SV_GatherSnapshotCandidates( clientpvs, candidates );
+
+	for ( i = 0 ; i < MAX_GENTITIES / 32 ; i++ ) {
+		if ( !candidates[i] ) {
+			continue;
+		}
+		for ( b = 0 ; b < 32 ; b++ ) {
+			if ( candidates[i] & ( 1u << b ) ) {
+				SV_AddEntityIfVisible( ( i << 5 ) + b, origin, frame, eNums, clientarea, clientpvs );
 			}
-			SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
 		}
-
 	}
 }
 
 /*
 =============
-SV_BuildClientSnapshot
-
-Decides which entities are going to be visible to the client, and
-copies off the playerstate and areabits.
-
-This properly handles multiple recursive portals, but the render
-currently doesn't.
-
-For viewing through other player's eyes, clent can be something other than client->gentity
-=============
+SV_BeginClientSnapshot
+
+Copies off the playerstate and resets the frame we are creating.
+Returns qfalse if the client has nothing to see.
+=============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
-	vec3_t						org;
+static qboolean SV_BeginClientSnapshot( client_t *client, snapshotEntityNumbers_t *eNums ) {
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
-	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
-	sharedEntity_t				*clent;
 	int							clientNum;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	eNums->numSnapshotEntities = 0;
+	Com_Memset( eNums->added, 0, sizeof( eNums->added ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
   // https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=62
 	frame->num_entities = 0;
+	frame->first_entity = svs.nextSnapshotEntities;
 
-	clent = client->gentity;
-	if ( !clent || client->state == CS_ZOMBIE ) {
-		return;
+	if ( !client->gentity || client->state == CS_ZOMBIE ) {
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -500,45 +888,120 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
+	eNums->added[ clientNum >> 5 ] |= 1u << ( clientNum & 31 );
+
+	return qtrue;
+}
+
+/*
+=============
+SV_AddClientSnapshotEntities
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
+Decides which entities are going to be visible to the client.
+
+This properly handles multiple recursive portals, but the render
+currently doesn't.
+
+Safe to call from the snapshot worker threads
+=============
+*/
+static void SV_AddClientSnapshotEntities( client_t *client, snapshotEntityNumbers_t *eNums ) {
+	vec3_t						org;
+	clientSnapshot_t			*frame;
+	int							i;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// find the client's viewpoint
-	VectorCopy( ps->origin, org );
-	org[2] += ps->viewheight;
+	VectorCopy( frame->ps.origin, org );
+	org[2] += frame->ps.viewheight;
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
+	SV_AddEntitiesVisibleFromPoint( org, frame, eNums, qfalse );
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	// to work correctly.
+	qsort( eNums->snapshotEntities, eNums->numSnapshotEntities,
+		sizeof( eNums->snapshotEntities[0] ), SV_QsortEntityNumbers );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
 	for ( i = 0 ; i < MAX_MAP_AREA_BYTES/4 ; i++ ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
+}
 
-	// copy the entity states out
-	frame->num_entities = 0;
+/*
+=============
+SV_ReserveSnapshotEntities
+
+Claims the client's range of svs.snapshotEntities, clients must
+be handled one at a time here
+=============
+*/
+static void SV_ReserveSnapshotEntities( client_t *client, int numEntities ) {
+	clientSnapshot_t			*frame;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	frame->num_entities = numEntities;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
-			Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
-		}
-		frame->num_entities++;
+	svs.nextSnapshotEntities += numEntities;
+
+	// this should never hit, map should always be restarted first in SV_Frame
+	if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
+		Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
+	}
+}
+
+/*
+=============
+SV_CopySnapshotEntities
+
+Copies the entity states out into the reserved range.
+
+Safe to call from the snapshot worker threads
+=============
+*/
+static void SV_CopySnapshotEntities( client_t *client, snapshotEntityNumbers_t *eNums ) {
+	clientSnapshot_t			*frame;
+	int							i;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	for ( i = 0 ; i < frame->num_entities ; i++ ) {
+		svs.snapshotEntities[ ( frame->first_entity + i ) % svs.numSnapshotEntities ] =
+			SV_GentityNum( eNums->snapshotEntities[i] )->s;
+	}
+}
+
+/*
+=============
+SV_BuildClientSnapshot
+
+Decides which entities are going to be visible to the client, and
+copies off the playerstate and areabits.
+
+For viewing through other player's eyes, clent can be something other than client->gentity
+=============
+*/
+static void SV_BuildClientSnapshot( client_t *client ) {
+	snapshotEntityNumbers_t		entityNumbers;
+
+	// outside of SV_SendClientMessages nobody has checked the numbers yet
+	if ( !sv_snapshotIndex.active ) {
+		SV_FixEntityNumbers();
+	}
+
+	if ( !SV_BeginClientSnapshot( client, &entityNumbers ) ) {
+		return;
 	}
+
+	SV_AddClientSnapshotEntities( client, &entityNumbers );
+	SV_ReserveSnapshotEntities( client, entityNumbers.numSnapshotEntities );
+	SV_CopySnapshotEntities( client, &entityNumbers );
 }
 
 #ifdef USE_VOIP
@@ -612,6 +1075,45 @@ void SV_SendMessageToClient(msg_t *msg, client_t *client)
 }
 
 
+/*
+=======================
+SV_WriteClientSnapshotMessage
+
+Safe to call from the snapshot worker threads
+=======================
+*/
+static void SV_WriteClientSnapshotMessage( client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg ) {
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong( msg, client->lastClientCommand );
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient( client, msg );
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient( client, oldframe, lastframe, msg );
+}
+
+/*
+=======================
+SV_TransmitClientSnapshotMessage
+=======================
+*/
+static void SV_TransmitClientSnapshotMessage( client_t *client, msg_t *msg ) {
+#ifdef USE_VOIP
+	SV_WriteVoipToClient( client, msg );
+#endif
+
+	// check for overflow
+	if ( msg->overflowed ) {
+		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
+		MSG_Clear (msg);
+	}
+
+	SV_SendMessageToClient( msg, client );
+}
+
 /*
 =======================
 SV_SendClientSnapshot
@@ -623,6 +1125,8 @@ Also called by SV_FinalMessage
 void SV_SendClientSnapshot( client_t *client ) {
 	byte		msg_buf[MAX_MSGLEN];
 	msg_t		msg;
+	clientSnapshot_t	*oldframe;
+	int			lastframe;
 
 	// build the snapshot
 	SV_BuildClientSnapshot( client );
@@ -630,28 +1134,313 @@ void SV_SendClientSnapshot( client_t *client ) {
 	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = qtrue;
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong( &msg, client->lastClientCommand );
+	oldframe = SV_SnapshotDeltaFrame( client, &lastframe );
+	SV_WriteClientSnapshotMessage( client, oldframe, lastframe, &msg );
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient( client, &msg );
+	SV_TransmitClientSnapshotMessage( client, &msg );
+}
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+/*
+=============================================================================
 
-#ifdef USE_VOIP
-	SV_WriteVoipToClient( client, &msg );
-#endif
+Parallel snapshot construction
 
-	// check for overflow
-	if ( msg.overflowed ) {
-		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+Once the game frame has run the world is frozen, so choosing the visible
+entities and delta encoding the message are independent for every client.
+With sv_snapshotThreads set these two steps are handed to a pool of
+worker threads, the main thread helping out.  Everything that touches
+shared server state (reserving svs.snapshotEntities, choosing the delta
+frame, VoIP and the netchan transmit) stays on the main thread, in client
+order, so the messages are identical to the serial ones.
+
+=============================================================================
+*/
+
+#define MAX_SNAPSHOT_THREADS	16
+
+typedef enum {
+	SNAPSHOT_PHASE_ENTITIES,	// SV_AddClientSnapshotEntities
+	SNAPSHOT_PHASE_ENCODE		// SV_CopySnapshotEntities + SV_WriteClientSnapshotMessage
+} snapshotPhase_t;
+
+typedef struct {
+	client_t				*client;
+	qboolean				hasView;	// SV_BeginClientSnapshot succeeded
+	snapshotEntityNumbers_t	entityNumbers;
+	clientSnapshot_t		*oldframe;
+	int						lastframe;
+	msg_t					msg;
+	byte					msgBuf[MAX_MSGLEN];
+} snapshotJob_t;
+
+typedef struct {
+	int				numThreads;
+	sysThread_t		*threads[MAX_SNAPSHOT_THREADS];
+	sysMutex_t		*mutex;
+	sysCond_t		*workCond;		// a new phase was dispatched
+	sysCond_t		*doneCond;		// the last job of a phase finished
+	qboolean		shutdown;
+
+	int				generation;		// bumped for every dispatched phase
+	snapshotPhase_t	phase;
+	int				nextJob;
+	int				jobsDone;
+	int				numJobs;
+
+	int				maxJobs;
+	snapshotJob_t	*jobs;			// [sv_maxclients->integer]
+} snapshotWorkers_t;
+
+static snapshotWorkers_t	sv_snapshotWorkers;
+
+/*
+=======================
+SV_RunSnapshotJob
+=======================
+*/
+static void SV_RunSnapshotJob( snapshotJob_t *job, snapshotPhase_t phase ) {
+	switch ( phase ) {
+		case SNAPSHOT_PHASE_ENTITIES:
+			if ( job->hasView ) {
+				SV_AddClientSnapshotEntities( job->client, &job->entityNumbers );
+			}
+			break;
+
+		case SNAPSHOT_PHASE_ENCODE:
+			SV_CopySnapshotEntities( job->client, &job->entityNumbers );
+			SV_WriteClientSnapshotMessage( job->client, job->oldframe, job->lastframe, &job->msg );
+			break;
+	}
+}
+
+/*
+=======================
+SV_WorkOnSnapshotJobs
+
+Takes jobs of the current phase until there are none left,
+the mutex must be held and is held again on return
+=======================
+*/
+static void SV_WorkOnSnapshotJobs( void ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+	snapshotPhase_t		phase = w->phase;
+	int					job;
+
+	while ( w->nextJob < w->numJobs ) {
+		job = w->nextJob++;
+
+		Sys_UnlockMutex( w->mutex );
+		SV_RunSnapshotJob( &w->jobs[ job ], phase );
+		Sys_LockMutex( w->mutex );
+
+		if ( ++w->jobsDone == w->numJobs ) {
+			Sys_BroadcastCond( w->doneCond );
+		}
 	}
+}
+
+/*
+=======================
+SV_SnapshotWorkerThread
+=======================
+*/
+static void SV_SnapshotWorkerThread( void *data ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+	int					generation = 0;
+
+	Sys_LockMutex( w->mutex );
+	while ( 1 ) {
+		while ( !w->shutdown && w->generation == generation ) {
+			Sys_WaitCond( w->workCond, w->mutex, -1 );
+		}
+		if ( w->shutdown ) {
+			break;
+		}
+		generation = w->generation;
 
-	SV_SendMessageToClient( &msg, client );
+		SV_WorkOnSnapshotJobs( );
+	}
+	Sys_UnlockMutex( w->mutex );
+}
+
+/*
+=======================
+SV_ShutdownSnapshotWorkers
+=======================
+*/
+void SV_ShutdownSnapshotWorkers( void ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+	int					i;
+
+	if ( w->mutex ) {
+		Sys_LockMutex( w->mutex );
+		w->shutdown = qtrue;
+		Sys_BroadcastCond( w->workCond );
+		Sys_UnlockMutex( w->mutex );
+
+		for ( i = 0 ; i < w->numThreads ; i++ ) {
+			Sys_JoinThread( w->threads[i] );
+		}
+	}
+
+	Sys_DestroyCond( w->workCond );
+	Sys_DestroyCond( w->doneCond );
+	Sys_DestroyMutex( w->mutex );
+	Sys_DestroyMutex( deltaCache.mutex );
+	deltaCache.mutex = NULL;
+
+	if ( w->jobs ) {
+		Z_Free( w->jobs );
+	}
+
+	Com_Memset( w, 0, sizeof( *w ) );
+}
+
+/*
+=======================
+SV_InitSnapshotWorkers
+
+(Re)starts the worker pool when sv_snapshotThreads or sv_maxclients changed
+=======================
+*/
+static void SV_InitSnapshotWorkers( void ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+	int					numThreads;
+
+	numThreads = sv_snapshotThreads->integer;
+	if ( numThreads < 0 ) {
+		// one less than the processors, the main thread helps as well
+		numThreads = Sys_NumProcessors() - 1;
+	}
+	numThreads = Com_Clamp( 0, MAX_SNAPSHOT_THREADS, numThreads );
+
+	if ( numThreads == w->numThreads && w->maxJobs == sv_maxclients->integer ) {
+		return;
+	}
+
+	SV_ShutdownSnapshotWorkers( );
+
+	if ( !numThreads ) {
+		return;
+	}
+
+	w->mutex = Sys_CreateMutex( );
+	w->workCond = Sys_CreateCond( );
+	w->doneCond = Sys_CreateCond( );
+	deltaCache.mutex = Sys_CreateMutex( );
+	if ( !w->mutex || !w->workCond || !w->doneCond || !deltaCache.mutex ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create the snapshot worker pool\n" );
+		SV_ShutdownSnapshotWorkers( );
+		return;
+	}
+
+	w->maxJobs = sv_maxclients->integer;
+	w->jobs = Z_Malloc( w->maxJobs * sizeof( *w->jobs ) );
+
+	for ( w->numThreads = 0 ; w->numThreads < numThreads ; w->numThreads++ ) {
+		w->threads[ w->numThreads ] = Sys_CreateThread( SV_SnapshotWorkerThread, NULL );
+		if ( !w->threads[ w->numThreads ] ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: only started %d of %d snapshot threads\n",
+				w->numThreads, numThreads );
+			break;
+		}
+	}
+
+	if ( !w->numThreads ) {
+		SV_ShutdownSnapshotWorkers( );
+	}
+}
+
+/*
+=======================
+SV_RunSnapshotPhase
+
+Hands every job to the workers and helps until they are all done
+=======================
+*/
+static void SV_RunSnapshotPhase( snapshotPhase_t phase, int numJobs ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+
+	Sys_LockMutex( w->mutex );
+	w->phase = phase;
+	w->numJobs = numJobs;
+	w->nextJob = 0;
+	w->jobsDone = 0;
+	w->generation++;
+	Sys_BroadcastCond( w->workCond );
+
+	SV_WorkOnSnapshotJobs( );
+
+	while ( w->jobsDone < w->numJobs ) {
+		Sys_WaitCond( w->doneCond, w->mutex, -1 );
+	}
+	Sys_UnlockMutex( w->mutex );
+}
+
+/*
+=======================
+SV_CheckSnapshotJob
+
+Com_Error can only unwind the main thread, so the entity numbers
+MSG_WriteDeltaEntity would reject are checked here before the job is
+handed to a worker.  The other errors on the encode path are for bad
+field tables or OOB messages and don't depend on the entities, an
+overflow is flagged in the message and dealt with after the join
+=======================
+*/
+static void SV_CheckSnapshotJob( snapshotJob_t *job ) {
+	int		i, num;
+
+	for ( i = 0 ; i < job->entityNumbers.numSnapshotEntities ; i++ ) {
+		num = SV_GentityNum( job->entityNumbers.snapshotEntities[i] )->s.number;
+		if ( num < 0 || num >= MAX_GENTITIES ) {
+			Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", num );
+		}
+	}
+}
+
+/*
+=======================
+SV_SendClientSnapshotsParallel
+=======================
+*/
+static void SV_SendClientSnapshotsParallel( client_t **clients, int numClients ) {
+	snapshotWorkers_t	*w = &sv_snapshotWorkers;
+	snapshotJob_t		*job;
+	int					i;
+
+	// playerstates and anything that can Com_Error stay on this thread
+	for ( i = 0 ; i < numClients ; i++ ) {
+		job = &w->jobs[ i ];
+		job->client = clients[ i ];
+		job->hasView = SV_BeginClientSnapshot( job->client, &job->entityNumbers );
+	}
+
+	SV_RunSnapshotPhase( SNAPSHOT_PHASE_ENTITIES, numClients );
+
+	// claim the snapshot entity ranges in client order, then pick the delta
+	// frames against the final position so no range read by one worker can
+	// be overwritten by another
+	for ( i = 0 ; i < numClients ; i++ ) {
+		job = &w->jobs[ i ];
+		SV_ReserveSnapshotEntities( job->client, job->entityNumbers.numSnapshotEntities );
+		SV_CheckSnapshotJob( job );
+	}
+
+	for ( i = 0 ; i < numClients ; i++ ) {
+		job = &w->jobs[ i ];
+		job->oldframe = SV_SnapshotDeltaFrame( job->client, &job->lastframe );
+
+		MSG_Init( &job->msg, job->msgBuf, sizeof( job->msgBuf ) );
+		job->msg.allowoverflow = qtrue;
+	}
+
+	SV_RunSnapshotPhase( SNAPSHOT_PHASE_ENCODE, numClients );
+
+	for ( i = 0 ; i < numClients ; i++ ) {
+		job = &w->jobs[ i ];
+		SV_TransmitClientSnapshotMessage( job->client, &job->msg );
+	}
 }
 
 
@@ -664,8 +1453,20 @@ void SV_SendClientMessages(void)
 {
 	int		i;
 	client_t	*c;
+	client_t	*ready[MAX_CLIENTS];
+	int		numReady;
+
+	SV_FixEntityNumbers();
+
+	// bucket the world's entities once for all of this frame's snapshots
+	SV_BuildSnapshotIndex();
+
+	SV_InitSnapshotWorkers();
 
-	// send a message to each connected client
+	SV_ClearDeltaCache();
+
+	// find every connected client that is due a new message
+	numReady = 0;
 	for(i=0; i < sv_maxclients->integer; i++)
 	{
 		c = &svs.clients[i];
@@ -698,9 +1499,27 @@ void SV_SendClientMessages(void)
 			}
 		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot(c);
-		c->lastSnapshotTime = svs.time;
-		c->rateDelayed = qfalse;
+		ready[numReady++] = c;
+	}
+
+	// generate and send the new messages, the workers depend
+	// on the index to never write to the entities
+	Sys_BeginPacketBatch();
+	if(sv_snapshotWorkers.numThreads && sv_snapshotIndex.active && numReady > 1)
+		SV_SendClientSnapshotsParallel(ready, numReady);
+	else
+	{
+		for(i = 0; i < numReady; i++)
+			SV_SendClientSnapshot(ready[i]);
+	}
+	Sys_FlushPacketBatch();
+
+	for(i = 0; i < numReady; i++)
+	{
+		ready[i]->lastSnapshotTime = svs.time;
+		ready[i]->rateDelayed = qfalse;
 	}
+
+	// entities may be relinked before the next frame's snapshots
+	sv_snapshotIndex.active = qfalse;
 }
@@ -9,7 +9,7 @@ int           sl_result_offset = 0;
 int sl_exec_w( const char *sql ) {
   char *errmsg;
   if( sqlite3_exec( sl, sql, NULL, NULL, &errmsg ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "db_exec error: %s", errmsg );
+    sl_error( "db_exec error: %s", errmsg );
     sqlite3_free( errmsg );
     return 1;
   }
@@ -25,30 +25,30 @@ int sl_mem_load( const char *uriname ) {
   sqlite3 *file;
   sqlite3_backup *back;
   if( sqlite3_open( ":memory:", &sl ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_mem_load error: %s", sqlite3_errmsg( sl ) );
+    sl_error( "sl_mem_load error: %s", sqlite3_errmsg( sl ) );
     sl_close_sl( );
     return 1;
   }
   if( sqlite3_open( uriname, &file ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_mem_load error: %s", sqlite3_errmsg( file ) );
+    sl_error( "sl_mem_load error: %s", sqlite3_errmsg( file ) );
     sqlite3_close( file );
     sl_close_sl( );
     return 2;
   }
   if( ( back = sqlite3_backup_init( sl, "main", file, "main" ) ) == NULL ) {
-    Com_Error( ERR_DROP, "sl_mem_load error: %s", sqlite3_errmsg( sl ) );
+    sl_error( "sl_mem_load error: %s", sqlite3_errmsg( sl ) );
     sqlite3_close( file );
     sl_close_sl( );
     return 3;
   }
   if( sqlite3_backup_step( back, -1 ) != SQLITE_DONE ) {
-    Com_Error( ERR_DROP, "sl_mem_load error: sqlite3_backup_step failed" );
+    sl_error( "sl_mem_load error: sqlite3_backup_step failed" );
     sqlite3_close( file );
     sl_close_sl( );
     return 4;
   }
   if( sqlite3_backup_finish( back ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_mem_load error: sqlite3_backup_finish failed" );
+    sl_error( "sl_mem_load error: sqlite3_backup_finish failed" );
     sqlite3_close( file );
     sl_close_sl( );
     return 5;
@@ -62,22 +62,22 @@ int sl_mem_close( void ) {
   sqlite3 *file;
   sqlite3_backup *back;
   if( sqlite3_open( sl_mem_name, &file ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_mem_close error: %s", sqlite3_errmsg( file ) );
+    sl_error( "sl_mem_close error: %s", sqlite3_errmsg( file ) );
     sqlite3_close( file );
     return 1;
   }
   if( ( back = sqlite3_backup_init( file, "main", sl, "main" ) ) == NULL ) {
-    Com_Error( ERR_DROP, "sl_mem_close error: %s", sqlite3_errmsg( file ) );
+    sl_error( "sl_mem_close error: %s", sqlite3_errmsg( file ) );
     sqlite3_close( file );
     return 2;
   }
   if( sqlite3_backup_step( back, -1 ) != SQLITE_DONE ) {
-    Com_Error( ERR_DROP, "sl_mem_close error: sqlite3_backup_step failed" );
+    sl_error( "sl_mem_close error: sqlite3_backup_step failed" );
     sqlite3_close( file );
     return 3;
   }
   if( sqlite3_backup_finish( back ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_mem_close error: sqlite3_backup_finish failed" );
+    sl_error( "sl_mem_close error: sqlite3_backup_finish failed" );
     sqlite3_close( file );
     return 4;
   }
@@ -95,7 +95,7 @@ int sl_prep( const char *sql, sqlite3_stmt **stmt ) {
 
 int sl_open( char *data, int *steps ) {
   if( sl != NULL ) {
-    Com_Error( ERR_DROP, "sl_open error: This implementation only supports 1 open database at a time." );
+    sl_error( "sl_open error: This implementation only supports 1 open database at a time." );
     return 1;
   }
 #ifdef MEMORY_DATABASE
@@ -104,7 +104,7 @@ int sl_open( char *data, int *steps ) {
   }
 #else
   if( sqlite3_open( data, &sl ) != SQLITE_OK ) {
-    Com_Error( ERR_DROP, "sl_open error: %s", sqlite3_errmsg( sl ) );
+    sl_error( "sl_open error: %s", sqlite3_errmsg( sl ) );
     sl_close_sl( );
     return 2;
   }
@@ -121,11 +121,11 @@ int sl_open( char *data, int *steps ) {
     sl_statements_s *statements_end = sl_statements + sl_statements_count;
     for( ; statements < statements_end; statements++ ) {
       if( *( statements->stmt ) != NULL ) {
-        Com_Error( ERR_DROP, "sl_open error: stmt for '%s' is not NULL. Maybe there is a duplicate or it is not initialized.", statements->sqlstmt );
+        sl_error( "sl_open error: stmt for '%s' is not NULL. Maybe there is a duplicate or it is not initialized.", statements->sqlstmt );
         continue;
       }
       if( sl_prep( statements->sqlstmt, statements->stmt ) != 0 ) {
-        Com_Error( ERR_DROP, "sl_open error: Failed to prepare '%s'", statements->sqlstmt );
+        sl_error( "sl_open error: Failed to prepare '%s'", statements->sqlstmt );
       }
     }
   }
@@ -155,15 +155,342 @@ void sl_close_sl( void ) {
   sl = NULL;
 }
 
+/*
+The database thread
+
+Writes and lookups are copied into a ring of jobs and run in order on a
+background thread, so disk stalls and the MEMORY_DATABASE backup on close
+never hold up a server frame. The game thread is the only producer and
+the database thread the only consumer, so submitting a job is just
+filling the next slot and publishing the new count; the mutex is only
+taken to wake a sleeping worker. Finished jobs are retired by sl_poll on
+the game thread, which is where their output and errors are delivered.
+
+DB_OPEN and DB_TIME_GET are needed immediately, so they wait for the queue
+to drain and then run on the game thread like everything did before.
+*/
+
+#define SL_QUEUE_SIZE 64 // must be a power of two
+#define SL_OUTPUT_MAX 4096
+#define SL_OUTPUT_TRUNCATED "...truncated\n" // ends the output of a job that printed too much
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define SL_BARRIER( ) _ReadWriteBarrier( ) // x86 only reorders stores after loads
+#else
+#define SL_BARRIER( ) __sync_synchronize( )
+#endif
+
+typedef struct {
+  dbArray_t type;
+  char      data[ DATABASE_DATA_MAX ];
+  int       client_number;                // who the output goes to, -1 for the console
+  char      output[ SL_OUTPUT_MAX ];      // '\0' separated lines
+  int       output_len;
+  qboolean  output_truncated;             // lines were dropped after SL_OUTPUT_TRUNCATED
+  char      error[ MAX_STRING_CHARS ];
+} sl_job_t;
+
+static struct {
+  sysThread_t  *thread;
+  sysMutex_t   *mutex;
+  sysCond_t    *work_cond;
+  sysCond_t    *done_cond;
+  qboolean      shutdown;
+  volatile int  sleeping;
+  qboolean      open;                     // whether queued queries will find a database
+  volatile int  submitted;                // written by the game thread
+  volatile int  completed;                // written by the database thread
+  int           retired;                  // written by the game thread
+  sl_job_t      jobs[ SL_QUEUE_SIZE ];
+} sl_worker;
+
+// job being run on the database thread, NULL when queries run on the game thread
+static sl_job_t *sl_current_job = NULL;
+
+void sl_print( int client_number, const char *fmt, ... ) {
+  va_list argptr;
+  char    line[ MAX_STRING_CHARS ];
+  int     len;
+  va_start( argptr, fmt );
+  Q_vsnprintf( line, sizeof( line ), fmt, argptr );
+  va_end( argptr );
+  if( sl_current_job != NULL ) {
+    sl_job_t *job = sl_current_job;
+    len = strlen( line ) + 1;
+    if( !job->output_truncated ) {
+      // keep room to say that the rest was dropped
+      if( job->output_len + len + sizeof( SL_OUTPUT_TRUNCATED ) <= sizeof( job->output ) ) {
+        memcpy( job->output + job->output_len, line, len );
+        job->output_len += len;
+      }
+      else {
+        memcpy( job->output + job->output_len, SL_OUTPUT_TRUNCATED, sizeof( SL_OUTPUT_TRUNCATED ) );
+        job->output_len += sizeof( SL_OUTPUT_TRUNCATED );
+        job->output_truncated = qtrue;
+      }
+    }
+    job->client_number = client_number;
+    return;
+  }
+  if( client_number < 0 ) {
+    Com_Printf( "%s", line );
+  }
+  else {
+    SV_AddServerCommand( svs.clients + client_number, va( "print \"%s\"", line ) );
+  }
+}
+
+void sl_error( const char *fmt, ... ) {
+  va_list argptr;
+  char    text[ MAX_STRING_CHARS ];
+  va_start( argptr, fmt );
+  Q_vsnprintf( text, sizeof( text ), fmt, argptr );
+  va_end( argptr );
+  if( sl_current_job != NULL ) {
+    if( !sl_current_job->error[ 0 ] ) {
+      Q_strncpyz( sl_current_job->error, text, sizeof( sl_current_job->error ) );
+    }
+    return;
+  }
+  Com_Error( ERR_DROP, "%s", text );
+}
+
+void sl_unpack_start( sl_unpack_t *unpack, char *data, int max ) {
+  unpack->data = data;
+  unpack->max = max;
+}
+
+int sl_unpack_int( sl_unpack_t *unpack, int *out ) {
+  if( unpack->max < 4 ) {
+    return 1;
+  }
+  *out = ( ( ( int )unpack->data[ 0 ] & 0xFF )       ) |
+         ( ( ( int )unpack->data[ 1 ] & 0xFF ) <<  8 ) |
+         ( ( ( int )unpack->data[ 2 ] & 0xFF ) << 16 ) |
+         ( ( ( int )unpack->data[ 3 ] & 0xFF ) << 24 );
+  unpack->data += 4;
+  unpack->max -= 4;
+  return 0;
+}
+
+char *sl_unpack_text( sl_unpack_t *unpack ) {
+  char *ret = unpack->data;
+  char *end = memchr( unpack->data, '\0', unpack->max );
+  int len;
+  if( end == NULL ) {
+    return NULL;
+  }
+  len = end - unpack->data + 1;
+  unpack->data += len;
+  unpack->max -= len;
+  return ret;
+}
+
+static void sl_worker_thread( void *unused ) {
+  Sys_LockMutex( sl_worker.mutex );
+  while( 1 ) {
+    sl_job_t *job;
+    if( sl_worker.completed == sl_worker.submitted ) {
+      if( sl_worker.shutdown ) {
+        break;
+      }
+      // the submitter checks sleeping after publishing, so one of us
+      // always sees the other
+      sl_worker.sleeping = qtrue;
+      SL_BARRIER( );
+      if( sl_worker.completed == sl_worker.submitted && !sl_worker.shutdown ) {
+        Sys_WaitCond( sl_worker.work_cond, sl_worker.mutex, -1 );
+      }
+      sl_worker.sleeping = qfalse;
+      continue;
+    }
+    Sys_UnlockMutex( sl_worker.mutex );
+
+    SL_BARRIER( );
+    job = &sl_worker.jobs[ sl_worker.completed & ( SL_QUEUE_SIZE - 1 ) ];
+    if( sl != NULL ) {
+      sl_current_job = job;
+      (*sl_queries[ job->type ])( job->data, NULL );
+      sl_current_job = NULL;
+    }
+    SL_BARRIER( );
+    sl_worker.completed++;
+
+    Sys_LockMutex( sl_worker.mutex );
+    Sys_BroadcastCond( sl_worker.done_cond );
+  }
+  Sys_UnlockMutex( sl_worker.mutex );
+}
+
+static qboolean sl_start_worker( void ) {
+  if( sl_worker.thread != NULL ) {
+    return qtrue;
+  }
+  if( ( sl_worker.mutex = Sys_CreateMutex( ) ) == NULL ||
+      ( sl_worker.work_cond = Sys_CreateCond( ) ) == NULL ||
+      ( sl_worker.done_cond = Sys_CreateCond( ) ) == NULL ) {
+    sl_shutdown( );
+    return qfalse;
+  }
+  sl_worker.open = ( sl != NULL );
+  if( ( sl_worker.thread = Sys_CreateThread( sl_worker_thread, NULL ) ) == NULL ) {
+    Com_Printf( S_COLOR_YELLOW "WARNING: sl_query: could not start the database thread\n" );
+    sl_shutdown( );
+    return qfalse;
+  }
+  return qtrue;
+}
+
+/*
+Waits until the database thread has run everything queued, after which
+the game thread may use the connection itself.
+*/
+static void sl_drain( void ) {
+  if( sl_worker.thread == NULL ) {
+    return;
+  }
+  Sys_LockMutex( sl_worker.mutex );
+  while( sl_worker.completed != sl_worker.submitted ) {
+    Sys_WaitCond( sl_worker.done_cond, sl_worker.mutex, -1 );
+  }
+  Sys_UnlockMutex( sl_worker.mutex );
+  sl_poll( qtrue );
+}
+
+static void sl_submit( dbArray_t type, char *data ) {
+  sl_job_t *job;
+  if( sl_worker.submitted - sl_worker.retired == SL_QUEUE_SIZE ) {
+    Sys_LockMutex( sl_worker.mutex );
+    while( sl_worker.completed == sl_worker.retired ) {
+      Sys_WaitCond( sl_worker.done_cond, sl_worker.mutex, -1 );
+    }
+    Sys_UnlockMutex( sl_worker.mutex );
+    sl_poll( qtrue );
+  }
+  job = &sl_worker.jobs[ sl_worker.submitted & ( SL_QUEUE_SIZE - 1 ) ];
+  job->type = type;
+  job->client_number = -1;
+  job->output_len = 0;
+  job->output_truncated = qfalse;
+  job->error[ 0 ] = '\0';
+  switch( type ) {
+    case DB_EXEC:
+    case DB_SEEN_ADD:
+      Q_strncpyz( job->data, data, sizeof( job->data ) );
+      break;
+    case DB_MAPSTAT_ADD:
+    case DB_LAST_MAPS:
+    case DB_SEEN:
+      memcpy( job->data, data, sizeof( job->data ) );
+      break;
+    default:
+      job->data[ 0 ] = '\0';
+      break;
+  }
+  SL_BARRIER( );
+  sl_worker.submitted++;
+  SL_BARRIER( );
+  if( sl_worker.sleeping ) {
+    Sys_LockMutex( sl_worker.mutex );
+    Sys_SignalCond( sl_worker.work_cond );
+    Sys_UnlockMutex( sl_worker.mutex );
+  }
+}
+
+/*
+Delivers the output of finished jobs. Errors drop the server like they did
+when the queries ran inline, unless drop is qfalse.
+*/
+void sl_poll( qboolean drop ) {
+  while( sl_worker.retired != sl_worker.completed ) {
+    sl_job_t *job = &sl_worker.jobs[ sl_worker.retired & ( SL_QUEUE_SIZE - 1 ) ];
+    char error[ MAX_STRING_CHARS ];
+    char *line, *end;
+    SL_BARRIER( );
+    for( line = job->output, end = job->output + job->output_len; line < end; line += strlen( line ) + 1 ) {
+      if( job->client_number < 0 ) {
+        Com_Printf( "%s", line );
+      }
+      else if( job->client_number < sv_maxclients->integer &&
+               svs.clients[ job->client_number ].state >= CS_CONNECTED ) {
+        SV_AddServerCommand( svs.clients + job->client_number, va( "print \"%s\"", line ) );
+      }
+    }
+    Q_strncpyz( error, job->error, sizeof( error ) );
+    sl_worker.retired++;
+    if( error[ 0 ] ) {
+      if( drop ) {
+        Com_Error( ERR_DROP, "%s", error );
+      }
+      Com_Printf( S_COLOR_YELLOW "WARNING: %s\n", error );
+    }
+  }
+}
+
+/*
+Finishes whatever is still queued and stops the database thread.
+*/
+void sl_shutdown( void ) {
+  if( sl_worker.thread != NULL ) {
+    Sys_LockMutex( sl_worker.mutex );
+    sl_worker.shutdown = qtrue;
+    Sys_SignalCond( sl_worker.work_cond );
+    Sys_UnlockMutex( sl_worker.mutex );
+    Sys_JoinThread( sl_worker.thread );
+    sl_poll( qfalse );
+  }
+  Sys_DestroyCond( sl_worker.work_cond );
+  Sys_DestroyCond( sl_worker.done_cond );
+  Sys_DestroyMutex( sl_worker.mutex );
+  sl_worker.thread = NULL;
+  sl_worker.mutex = NULL;
+  sl_worker.work_cond = sl_worker.done_cond = NULL;
+  sl_worker.shutdown = qfalse;
+  sl_worker.submitted = sl_worker.completed = sl_worker.retired = 0;
+}
+
 int sl_query( dbArray_t type, char *data, int *steps ) {
+  int ret;
   if( type >= DB_COUNT ) {
     Com_Error( ERR_FATAL, "sl_query: Invalid query enum/type %d", (int)type );
     return 1;
   }
+  if( sv_dbThread->integer && sl_start_worker( ) ) {
+    switch( type ) {
+      case DB_CLOSE:
+        if( !sl_worker.open ) {
+          return 2;
+        }
+        sl_worker.open = qfalse;
+        sl_submit( type, data );
+        return 0;
+      case DB_EXEC:
+      case DB_MAPSTAT_ADD:
+      case DB_SEEN_ADD:
+        if( !sl_worker.open ) {
+          return 2;
+        }
+        sl_submit( type, data );
+        return 0;
+      case DB_LAST_MAPS:
+      case DB_SEEN:
+        if( !sl_worker.open ) {
+          return 2;
+        }
+        sl_submit( type, data );
+        return DB_QUEUED;
+      default:
+        break;
+    }
+  }
+  sl_drain( );
   if( type != DB_OPEN && sl == NULL ) {
     return 2;
   }
-  return (*sl_queries[ type ])( data, steps );
+  ret = (*sl_queries[ type ])( data, steps );
+  sl_worker.open = ( sl != NULL );
+  return ret;
 }
 
 int sl_bind( sqlite3_stmt *stmt, qboolean reset ) {
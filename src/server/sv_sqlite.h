@@ -21,6 +21,19 @@ typedef int (*sl_queries_t)( char *data, int *steps );
 extern sl_queries_t sl_queries[DB_COUNT];
 extern size_t sl_queries_count;
 
+// query functions may run on the database thread, so they report through
+// these instead of Com_Printf/Com_Error and unpack with their own cursor
+typedef struct {
+  char *data;
+  int max;
+} sl_unpack_t;
+
+void sl_print( int client_number, const char *fmt, ... ) __attribute__ ((format (printf, 2, 3)));
+void sl_error( const char *fmt, ... ) __attribute__ ((format (printf, 1, 2)));
+void sl_unpack_start( sl_unpack_t *unpack, char *data, int max );
+int sl_unpack_int( sl_unpack_t *unpack, int *out );
+char *sl_unpack_text( sl_unpack_t *unpack );
+
 int sl_exec_w( const char *sql );
 int sl_exec( char *data, int *steps );
 int sl_mem_load( const char *uriname );
@@ -76,6 +76,77 @@ typedef struct worldSector_s {
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
 
+/*
+With sv_worldGrid set the world is instead cut into a uniform grid of
+square cells sized from the map bounds.  The grid is loose: an entity is
+only linked into the cell holding the center of its box, which is fine as
+long as it is no wider than a cell, so queries look half a cell further
+out on every side.  Entities too wide for that are kept in one extra chain
+that every query checks.
+*/
+
+#define	GRID_MAX_DIM		64
+#define	GRID_MIN_CELL_SIZE	256
+
+typedef struct {
+	qboolean		active;		// sv_worldGrid when the world was cleared
+	vec2_t			origin;
+	float			cellSize;
+	int				dim[2];
+	worldSector_t	cells[GRID_MAX_DIM*GRID_MAX_DIM];
+	worldSector_t	large;
+} worldGrid_t;
+
+static worldGrid_t	sv_grid;
+
+typedef struct {
+	uint64_t	queries;
+	uint64_t	checked;		// entities looked at
+	uint64_t	found;			// entities returned
+} worldStats_t;
+
+static worldStats_t	sv_worldStats;
+
+/*
+With sv_traceCache set SV_Trace remembers its results for the rest of the
+game frame.  Every link or unlink starts a new generation, and a result is
+only handed back for the same generation and sv.time, so a trace is only
+skipped when nothing it could hit has been moved since.  The game can
+still change contents or owners of an entity without relinking it, which
+the cache can't see, hence it is off by default.
+*/
+
+#define	TRACE_CACHE_SIZE	512		// power of two
+
+typedef struct {
+	vec3_t			start, end;
+	vec3_t			mins, maxs;
+	int				passEntityNum;
+	qboolean		clip_against_missiles;
+	content_mask_t	content_mask;
+	traceType_t		type;
+	int				generation;
+	int				time;
+} traceCacheKey_t;
+
+typedef struct {
+	traceCacheKey_t	key;
+	trace_t			trace;
+} traceCacheEntry_t;
+
+typedef struct {
+	int					generation;		// bumped by every link and unlink
+	int					time;			// sv.time of the generation
+	qboolean			stored;			// anything cached in this generation
+	traceCacheEntry_t	entries[TRACE_CACHE_SIZE];
+
+	uint64_t			lookups;
+	uint64_t			hits;
+	uint64_t			invalidations;	// links and unlinks that threw results away
+} traceCache_t;
+
+static traceCache_t	sv_cachedTraces;
+
 
 /*
 ===============
@@ -84,17 +155,58 @@ SV_SectorList_f
 */
 void SV_SectorList_f( void ) {
 	int				i, c;
+	int				cells, maxCell;
 	worldSector_t	*sec;
 	svEntity_t		*ent;
 
-	for ( i = 0 ; i < AREA_NODES ; i++ ) {
-		sec = &sv_worldSectors[i];
+	if ( sv_grid.active ) {
+		cells = maxCell = 0;
+		for ( i = 0 ; i < sv_grid.dim[0] * sv_grid.dim[1] ; i++ ) {
+			c = 0;
+			for ( ent = sv_grid.cells[i].entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+				c++;
+			}
+			if ( c ) {
+				cells++;
+			}
+			if ( c > maxCell ) {
+				maxCell = c;
+			}
+		}
 
 		c = 0;
-		for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+		for ( ent = sv_grid.large.entities ; ent ; ent = ent->nextEntityInWorldSector ) {
 			c++;
 		}
-		Com_Printf( "sector %i: %i entities\n", i, c );
+
+		Com_Printf( "grid %ix%i, %.0f units per cell\n", sv_grid.dim[0], sv_grid.dim[1], sv_grid.cellSize );
+		Com_Printf( "%i cells used, at most %i entities in a cell, %i large entities\n", cells, maxCell, c );
+	} else {
+		for ( i = 0 ; i < AREA_NODES ; i++ ) {
+			sec = &sv_worldSectors[i];
+
+			c = 0;
+			for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+				c++;
+			}
+			Com_Printf( "sector %i: %i entities\n", i, c );
+		}
+	}
+
+	// the counters run for the whole game, printed as doubles as not every
+	// Q_vsnprintf knows a 64 bit format
+	Com_Printf( "%.0f area queries, %.1f entities checked and %.1f found per query\n",
+		(double)sv_worldStats.queries,
+		sv_worldStats.queries ? (double)sv_worldStats.checked / sv_worldStats.queries : 0.0,
+		sv_worldStats.queries ? (double)sv_worldStats.found / sv_worldStats.queries : 0.0 );
+	Com_Printf( "%.0f cached traces, %.1f%% hits, %.0f invalidations\n",
+		(double)sv_cachedTraces.lookups,
+		sv_cachedTraces.lookups ? 100.0 * sv_cachedTraces.hits / sv_cachedTraces.lookups : 0.0,
+		(double)sv_cachedTraces.invalidations );
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		Com_Memset( &sv_worldStats, 0, sizeof( sv_worldStats ) );
+		sv_cachedTraces.lookups = sv_cachedTraces.hits = sv_cachedTraces.invalidations = 0;
 	}
 }
 
@@ -140,6 +252,91 @@ static worldSector_t *SV_CreateworldSector( int depth, vec3_t mins, vec3_t maxs
 	return anode;
 }
 
+/*
+===============
+SV_CreateWorldGrid
+
+Sizes the grid cells so the map bounds fit in GRID_MAX_DIM cells a side
+===============
+*/
+static void SV_CreateWorldGrid( vec3_t mins, vec3_t maxs ) {
+	int		i;
+	float	size;
+
+	size = MAX( maxs[0] - mins[0], maxs[1] - mins[1] );
+	sv_grid.cellSize = MAX( GRID_MIN_CELL_SIZE, ceil( size / GRID_MAX_DIM ) );
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		sv_grid.origin[i] = mins[i];
+		sv_grid.dim[i] = (int)ceil( ( maxs[i] - mins[i] ) / sv_grid.cellSize );
+		sv_grid.dim[i] = Com_Clamp( 1, GRID_MAX_DIM, sv_grid.dim[i] );
+	}
+
+	for ( i = 0 ; i < sv_grid.dim[0] * sv_grid.dim[1] ; i++ ) {
+		sv_grid.cells[i].axis = -1;
+	}
+	sv_grid.large.axis = -1;
+
+	sv_grid.active = qtrue;
+}
+
+/*
+===============
+SV_GridCoord
+
+The cell column or row holding the given coordinate, anything
+outside the map goes to the cells on its edge
+===============
+*/
+static int SV_GridCoord( float v, int axis ) {
+	int		c;
+
+	c = (int)floor( ( v - sv_grid.origin[axis] ) / sv_grid.cellSize );
+	if ( c < 0 ) {
+		return 0;
+	}
+	if ( c >= sv_grid.dim[axis] ) {
+		return sv_grid.dim[axis] - 1;
+	}
+	return c;
+}
+
+/*
+===============
+SV_GridCellForBox
+
+The chain an entity with this box is linked into
+===============
+*/
+static worldSector_t *SV_GridCellForBox( const vec3_t absmin, const vec3_t absmax ) {
+	int		x, y;
+
+	if ( absmax[0] - absmin[0] > sv_grid.cellSize ||
+		absmax[1] - absmin[1] > sv_grid.cellSize ) {
+		return &sv_grid.large;
+	}
+
+	x = SV_GridCoord( 0.5f * ( absmin[0] + absmax[0] ), 0 );
+	y = SV_GridCoord( 0.5f * ( absmin[1] + absmax[1] ), 1 );
+
+	return &sv_grid.cells[ y * sv_grid.dim[0] + x ];
+}
+
+/*
+===============
+SV_TraceCacheInvalidate
+
+Starts a new generation so nothing cached before is handed out again
+===============
+*/
+static void SV_TraceCacheInvalidate( void ) {
+	sv_cachedTraces.generation++;
+	if ( sv_cachedTraces.stored ) {
+		sv_cachedTraces.stored = qfalse;
+		sv_cachedTraces.invalidations++;
+	}
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -152,11 +349,19 @@ void SV_ClearWorld( void ) {
 
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
+	Com_Memset( &sv_grid, 0, sizeof(sv_grid) );
+	Com_Memset( &sv_worldStats, 0, sizeof(sv_worldStats) );
+	Com_Memset( &sv_cachedTraces, 0, sizeof(sv_cachedTraces) );
+	sv_cachedTraces.generation = 1;	// never matches an empty slot
 
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	if ( sv_worldGrid->integer ) {
+		SV_CreateWorldGrid( mins, maxs );
+	}
 }
 
 
@@ -180,6 +385,7 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 		return;		// not linked in anywhere
 	}
 	ent->worldSector = NULL;
+	SV_TraceCacheInvalidate( );
 
 	if ( ws->entities == ent ) {
 		ws->entities = ent->nextEntityInWorldSector;
@@ -219,6 +425,8 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	if ( ent->worldSector ) {
 		SV_UnlinkEntity( gEnt );	// unlink from old position
+	} else {
+		SV_TraceCacheInvalidate( );
 	}
 
 	// get the position
@@ -356,20 +564,24 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-			break;
-		if ( gEnt->r.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if ( gEnt->r.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
+	if ( sv_grid.active ) {
+		node = SV_GridCellForBox( gEnt->r.absmin, gEnt->r.absmax );
+	} else {
+		// find the first world sector node that the ent's box crosses
+		node = sv_worldSectors;
+		while (1)
+		{
+			if (node->axis == -1)
+				break;
+			if ( gEnt->r.absmin[node->axis] > node->dist)
+				node = node->children[0];
+			else if ( gEnt->r.absmax[node->axis] < node->dist)
+				node = node->children[1];
+			else
+				break;		// crosses the node
+		}
 	}
-	
+
 	// link it in
 	ent->worldSector = node;
 	ent->nextEntityInWorldSector = node->entities;
@@ -394,21 +606,24 @@ typedef struct {
 	const content_mask_t *content_mask;
 	int			*list;
 	int			count, maxcount;
+	int			checked;
 } areaParms_t;
 
 
 /*
 ====================
-SV_AreaEntities_r
+SV_SectorEntities
 
+Adds the entities chained at one node
 ====================
 */
-static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+static void SV_SectorEntities( worldSector_t *node, areaParms_t *ap ) {
 	svEntity_t	*check, *next;
 	sharedEntity_t *gcheck;
 
 	for ( check = node->entities  ; check ; check = next ) {
 		next = check->nextEntityInWorldSector;
+		ap->checked++;
 
 		gcheck = SV_GEntityForSvEntity( check );
 
@@ -436,6 +651,16 @@ static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 		ap->list[ap->count] = check - sv.svEntities;
 		ap->count++;
 	}
+}
+
+/*
+====================
+SV_AreaEntities_r
+
+====================
+*/
+static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+	SV_SectorEntities( node, ap );
 	
 	if (node->axis == -1) {
 		return;		// terminal node
@@ -450,6 +675,33 @@ static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 }
 
+/*
+====================
+SV_GridAreaEntities
+
+Entities are only linked by the center of their box, so every cell
+within half a cell of the bounds may hold some
+====================
+*/
+static void SV_GridAreaEntities( areaParms_t *ap ) {
+	int		x, y;
+	int		x0, x1, y0, y1;
+	float	margin = 0.5f * sv_grid.cellSize;
+
+	x0 = SV_GridCoord( ap->mins[0] - margin, 0 );
+	x1 = SV_GridCoord( ap->maxs[0] + margin, 0 );
+	y0 = SV_GridCoord( ap->mins[1] - margin, 1 );
+	y1 = SV_GridCoord( ap->maxs[1] + margin, 1 );
+
+	SV_SectorEntities( &sv_grid.large, ap );
+
+	for ( y = y0 ; y <= y1 ; y++ ) {
+		for ( x = x0 ; x <= x1 ; x++ ) {
+			SV_SectorEntities( &sv_grid.cells[ y * sv_grid.dim[0] + x ], ap );
+		}
+	}
+}
+
 /*
 ================
 SV_AreaEntities
@@ -465,8 +717,17 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs,
 	ap.content_mask = content_mask;
 	ap.count = 0;
 	ap.maxcount = maxcount;
+	ap.checked = 0;
+
+	if ( sv_grid.active ) {
+		SV_GridAreaEntities( &ap );
+	} else {
+		SV_AreaEntities_r( sv_worldSectors, &ap );
+	}
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	sv_worldStats.queries++;
+	sv_worldStats.checked += ap.checked;
+	sv_worldStats.found += ap.count;
 
 	return ap.count;
 }
@@ -668,23 +929,13 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 
 /*
 ==================
-SV_Trace
-
-Moves the given mins/maxs volume through the world from start to end.
-passEntityNum and entities owned by passEntityNum are explicitly not checked.
+SV_TraceUncached
 ==================
 */
-void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, qboolean clip_against_missiles, const content_mask_t content_mask, traceType_t type ) {
+static void SV_TraceUncached( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, qboolean clip_against_missiles, const content_mask_t content_mask, traceType_t type ) {
 	moveclip_t	clip;
 	int			i;
 
-	if ( !mins ) {
-		mins = vec3_origin;
-	}
-	if ( !maxs ) {
-		maxs = vec3_origin;
-	}
-
 	Com_Memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 	// clip to world
@@ -725,6 +976,90 @@ void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, c
 	*results = clip.trace;
 }
 
+/*
+==================
+SV_TraceCacheEntry
+
+The slot a trace goes in, with key filled in for comparing and storing
+==================
+*/
+static traceCacheEntry_t *SV_TraceCacheEntry( traceCacheKey_t *key, const vec3_t start,
+	const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum,
+	qboolean clip_against_missiles, const content_mask_t content_mask, traceType_t type ) {
+	const byte		*b;
+	unsigned int	hash;
+	int				i;
+
+	if ( sv_cachedTraces.time != sv.time ) {
+		sv_cachedTraces.time = sv.time;
+		SV_TraceCacheInvalidate( );
+	}
+
+	// no padding in the key, but clear it so memcmp is safe anyway
+	Com_Memset( key, 0, sizeof( *key ) );
+	VectorCopy( start, key->start );
+	VectorCopy( end, key->end );
+	VectorCopy( mins, key->mins );
+	VectorCopy( maxs, key->maxs );
+	key->passEntityNum = passEntityNum;
+	key->clip_against_missiles = clip_against_missiles;
+	key->content_mask = content_mask;
+	key->type = type;
+	key->generation = sv_cachedTraces.generation;
+	key->time = sv.time;
+
+	// FNV-1a
+	hash = 2166136261u;
+	for ( i = 0, b = (const byte *)key; i < sizeof( *key ); i++ ) {
+		hash = ( hash ^ b[i] ) * 16777619u;
+	}
+
+	return &sv_cachedTraces.entries[ hash & ( TRACE_CACHE_SIZE - 1 ) ];
+}
+
+/*
+==================
+SV_Trace
+
+Moves the given mins/maxs volume through the world from start to end.
+passEntityNum and entities owned by passEntityNum are explicitly not checked.
+==================
+*/
+void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, qboolean clip_against_missiles, const content_mask_t content_mask, traceType_t type ) {
+	traceCacheKey_t		key;
+	traceCacheEntry_t	*entry;
+
+	if ( !mins ) {
+		mins = vec3_origin;
+	}
+	if ( !maxs ) {
+		maxs = vec3_origin;
+	}
+
+	if ( !sv_traceCache->integer ) {
+		SV_TraceUncached( results, start, mins, maxs, end, passEntityNum,
+			clip_against_missiles, content_mask, type );
+		return;
+	}
+
+	entry = SV_TraceCacheEntry( &key, start, mins, maxs, end, passEntityNum,
+		clip_against_missiles, content_mask, type );
+	sv_cachedTraces.lookups++;
+
+	if ( !memcmp( &entry->key, &key, sizeof( key ) ) ) {
+		sv_cachedTraces.hits++;
+		*results = entry->trace;
+		return;
+	}
+
+	SV_TraceUncached( results, start, mins, maxs, end, passEntityNum,
+		clip_against_missiles, content_mask, type );
+
+	entry->key = key;
+	entry->trace = *results;
+	sv_cachedTraces.stored = qtrue;
+}
+
 
 /*
 ==================
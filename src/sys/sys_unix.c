@@ -40,6 +40,7 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 #include <fcntl.h>
 #include <fenv.h>
 #include <sys/wait.h>
+#include <pthread.h>
 
 qboolean stdinIsATTY;
 
@@ -104,6 +105,39 @@ int Sys_Milliseconds (void)
 	return curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int64_t Sys_Microseconds (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+================
+Sys_MicrosecondsAt
+
+The Sys_Microseconds value at which Sys_Milliseconds reaches msec
+================
+*/
+int64_t Sys_MicrosecondsAt (int msec)
+{
+	struct timeval tp;
+	int64_t now, wall;
+
+	now = Sys_Microseconds();
+	gettimeofday(&tp, NULL);
+	wall = (int64_t)(tp.tv_sec - sys_timeBase) * 1000000 + tp.tv_usec;
+
+	return now + (int64_t)msec * 1000 - wall;
+}
+
 /*
 ==================
 Sys_RandomBytes
@@ -408,6 +442,235 @@ void Sys_FreeFileList( char **list )
 	Z_Free( list );
 }
 
+/*
+==============================================================
+
+THREADS
+
+==============================================================
+*/
+
+struct sysThread_s
+{
+	pthread_t	handle;
+	void		(*function)( void *data );
+	void		*data;
+};
+
+struct sysMutex_s
+{
+	pthread_mutex_t	handle;
+};
+
+struct sysCond_s
+{
+	pthread_cond_t	handle;
+};
+
+/*
+==================
+Sys_ThreadMain
+==================
+*/
+static void *Sys_ThreadMain( void *arg )
+{
+	sysThread_t *thread = arg;
+
+	thread->function( thread->data );
+	return NULL;
+}
+
+/*
+==================
+Sys_CreateThread
+==================
+*/
+sysThread_t *Sys_CreateThread( void (*function)( void *data ), void *data )
+{
+	sysThread_t *thread;
+
+	thread = calloc( 1, sizeof( *thread ) );
+	if( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->data = data;
+
+	if( pthread_create( &thread->handle, NULL, Sys_ThreadMain, thread ) )
+	{
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+==================
+Sys_JoinThread
+==================
+*/
+void Sys_JoinThread( sysThread_t *thread )
+{
+	if( !thread )
+		return;
+
+	pthread_join( thread->handle, NULL );
+	free( thread );
+}
+
+/*
+==================
+Sys_CreateMutex
+==================
+*/
+sysMutex_t *Sys_CreateMutex( void )
+{
+	sysMutex_t *mutex;
+
+	mutex = calloc( 1, sizeof( *mutex ) );
+	if( !mutex )
+		return NULL;
+
+	if( pthread_mutex_init( &mutex->handle, NULL ) )
+	{
+		free( mutex );
+		return NULL;
+	}
+
+	return mutex;
+}
+
+/*
+==================
+Sys_DestroyMutex
+==================
+*/
+void Sys_DestroyMutex( sysMutex_t *mutex )
+{
+	if( !mutex )
+		return;
+
+	pthread_mutex_destroy( &mutex->handle );
+	free( mutex );
+}
+
+/*
+==================
+Sys_LockMutex
+==================
+*/
+void Sys_LockMutex( sysMutex_t *mutex )
+{
+	pthread_mutex_lock( &mutex->handle );
+}
+
+/*
+==================
+Sys_UnlockMutex
+==================
+*/
+void Sys_UnlockMutex( sysMutex_t *mutex )
+{
+	pthread_mutex_unlock( &mutex->handle );
+}
+
+/*
+==================
+Sys_CreateCond
+==================
+*/
+sysCond_t *Sys_CreateCond( void )
+{
+	sysCond_t *cond;
+
+	cond = calloc( 1, sizeof( *cond ) );
+	if( !cond )
+		return NULL;
+
+	if( pthread_cond_init( &cond->handle, NULL ) )
+	{
+		free( cond );
+		return NULL;
+	}
+
+	return cond;
+}
+
+/*
+==================
+Sys_DestroyCond
+==================
+*/
+void Sys_DestroyCond( sysCond_t *cond )
+{
+	if( !cond )
+		return;
+
+	pthread_cond_destroy( &cond->handle );
+	free( cond );
+}
+
+/*
+==================
+Sys_WaitCond
+==================
+*/
+qboolean Sys_WaitCond( sysCond_t *cond, sysMutex_t *mutex, int msec )
+{
+	struct timeval now;
+	struct timespec timeout;
+
+	if( msec < 0 )
+	{
+		pthread_cond_wait( &cond->handle, &mutex->handle );
+		return qtrue;
+	}
+
+	gettimeofday( &now, NULL );
+	timeout.tv_sec = now.tv_sec + msec / 1000;
+	timeout.tv_nsec = ( now.tv_usec + ( msec % 1000 ) * 1000 ) * 1000;
+	if( timeout.tv_nsec >= 1000000000 )
+	{
+		timeout.tv_sec++;
+		timeout.tv_nsec -= 1000000000;
+	}
+
+	return pthread_cond_timedwait( &cond->handle, &mutex->handle, &timeout ) != ETIMEDOUT;
+}
+
+/*
+==================
+Sys_SignalCond
+==================
+*/
+void Sys_SignalCond( sysCond_t *cond )
+{
+	pthread_cond_signal( &cond->handle );
+}
+
+/*
+==================
+Sys_BroadcastCond
+==================
+*/
+void Sys_BroadcastCond( sysCond_t *cond )
+{
+	pthread_cond_broadcast( &cond->handle );
+}
+
+/*
+==================
+Sys_NumProcessors
+==================
+*/
+int Sys_NumProcessors( void )
+{
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count > 0 ? (int)count : 1;
+}
+
 /*
 ==================
 Sys_Sleep
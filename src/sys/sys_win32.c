@@ -149,6 +149,38 @@ int Sys_Milliseconds (void)
 	return sys_curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int64_t Sys_Microseconds (void)
+{
+	static LARGE_INTEGER	frequency;
+	LARGE_INTEGER			counter;
+
+	if (!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+
+	return (int64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+		(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+/*
+================
+Sys_MicrosecondsAt
+
+The Sys_Microseconds value at which Sys_Milliseconds reaches msec,
+only as precise as timeGetTime
+================
+*/
+int64_t Sys_MicrosecondsAt (int msec)
+{
+	return Sys_Microseconds() + (int64_t)(msec - Sys_Milliseconds()) * 1000;
+}
+
 /*
 ================
 Sys_RandomBytes
@@ -485,6 +517,242 @@ void Sys_FreeFileList( char **list )
 }
 
 
+/*
+==============================================================
+
+THREADS
+
+==============================================================
+*/
+
+struct sysThread_s
+{
+	HANDLE		handle;
+	void		(*function)( void *data );
+	void		*data;
+};
+
+struct sysMutex_s
+{
+	CRITICAL_SECTION	handle;
+};
+
+// WINVER 0x501 has no condition variables, so use a counted semaphore;
+// waiters always recheck their predicate, spurious wakeups are harmless
+struct sysCond_s
+{
+	HANDLE				semaphore;
+	LONG				waiters;
+	CRITICAL_SECTION	waitersLock;
+};
+
+/*
+==============
+Sys_ThreadMain
+==============
+*/
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg )
+{
+	sysThread_t *thread = arg;
+
+	thread->function( thread->data );
+	return 0;
+}
+
+/*
+==============
+Sys_CreateThread
+==============
+*/
+sysThread_t *Sys_CreateThread( void (*function)( void *data ), void *data )
+{
+	sysThread_t *thread;
+
+	thread = calloc( 1, sizeof( *thread ) );
+	if( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->data = data;
+	thread->handle = CreateThread( NULL, 0, Sys_ThreadMain, thread, 0, NULL );
+
+	if( !thread->handle )
+	{
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+==============
+Sys_JoinThread
+==============
+*/
+void Sys_JoinThread( sysThread_t *thread )
+{
+	if( !thread )
+		return;
+
+	WaitForSingleObject( thread->handle, INFINITE );
+	CloseHandle( thread->handle );
+	free( thread );
+}
+
+/*
+==============
+Sys_CreateMutex
+==============
+*/
+sysMutex_t *Sys_CreateMutex( void )
+{
+	sysMutex_t *mutex;
+
+	mutex = calloc( 1, sizeof( *mutex ) );
+	if( !mutex )
+		return NULL;
+
+	InitializeCriticalSection( &mutex->handle );
+	return mutex;
+}
+
+/*
+==============
+Sys_DestroyMutex
+==============
+*/
+void Sys_DestroyMutex( sysMutex_t *mutex )
+{
+	if( !mutex )
+		return;
+
+	DeleteCriticalSection( &mutex->handle );
+	free( mutex );
+}
+
+/*
+==============
+Sys_LockMutex
+==============
+*/
+void Sys_LockMutex( sysMutex_t *mutex )
+{
+	EnterCriticalSection( &mutex->handle );
+}
+
+/*
+==============
+Sys_UnlockMutex
+==============
+*/
+void Sys_UnlockMutex( sysMutex_t *mutex )
+{
+	LeaveCriticalSection( &mutex->handle );
+}
+
+/*
+==============
+Sys_CreateCond
+==============
+*/
+sysCond_t *Sys_CreateCond( void )
+{
+	sysCond_t *cond;
+
+	cond = calloc( 1, sizeof( *cond ) );
+	if( !cond )
+		return NULL;
+
+	cond->semaphore = CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+	if( !cond->semaphore )
+	{
+		free( cond );
+		return NULL;
+	}
+
+	InitializeCriticalSection( &cond->waitersLock );
+	return cond;
+}
+
+/*
+==============
+Sys_DestroyCond
+==============
+*/
+void Sys_DestroyCond( sysCond_t *cond )
+{
+	if( !cond )
+		return;
+
+	CloseHandle( cond->semaphore );
+	DeleteCriticalSection( &cond->waitersLock );
+	free( cond );
+}
+
+/*
+==============
+Sys_WaitCond
+==============
+*/
+qboolean Sys_WaitCond( sysCond_t *cond, sysMutex_t *mutex, int msec )
+{
+	DWORD result;
+
+	EnterCriticalSection( &cond->waitersLock );
+	cond->waiters++;
+	LeaveCriticalSection( &cond->waitersLock );
+
+	LeaveCriticalSection( &mutex->handle );
+	result = WaitForSingleObject( cond->semaphore, msec < 0 ? INFINITE : (DWORD)msec );
+	EnterCriticalSection( &mutex->handle );
+
+	EnterCriticalSection( &cond->waitersLock );
+	cond->waiters--;
+	LeaveCriticalSection( &cond->waitersLock );
+
+	return result != WAIT_TIMEOUT;
+}
+
+/*
+==============
+Sys_SignalCond
+==============
+*/
+void Sys_SignalCond( sysCond_t *cond )
+{
+	EnterCriticalSection( &cond->waitersLock );
+	if( cond->waiters > 0 )
+		ReleaseSemaphore( cond->semaphore, 1, NULL );
+	LeaveCriticalSection( &cond->waitersLock );
+}
+
+/*
+==============
+Sys_BroadcastCond
+==============
+*/
+void Sys_BroadcastCond( sysCond_t *cond )
+{
+	EnterCriticalSection( &cond->waitersLock );
+	if( cond->waiters > 0 )
+		ReleaseSemaphore( cond->semaphore, cond->waiters, NULL );
+	LeaveCriticalSection( &cond->waitersLock );
+}
+
+/*
+==============
+Sys_NumProcessors
+==============
+*/
+int Sys_NumProcessors( void )
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
 /*
 ==============
 Sys_Sleep